@@ -0,0 +1,126 @@
+#include "AIScheduler.h"
+
+// Constructor.
+AIScheduler::AIScheduler()
+	: m_iBudgetTicks(0)
+	, m_iBudget(0)
+	, m_iQuota(0)
+	, m_iCursor(0)
+	, m_iPassSlices(0)
+	, m_iPassBots(0)
+	, m_iLastPassSlices(0)
+	, m_iWorstPassSlices(0)
+	, m_iLastDecided(0)
+	, m_iSlices(0)
+	, m_iDecided(0)
+	, m_iOverruns(0)
+	, m_dWorstOverrun(0.0)
+{
+}
+
+void AIScheduler::Initialize(int iBudgetMicroseconds, int iQuota)
+{
+	m_Clock.Initialize();
+	m_iBudget = (iBudgetMicroseconds < 0) ? 0 : iBudgetMicroseconds;
+	m_iBudgetTicks = m_Clock.FromSeconds(m_iBudget * 1e-6);
+	m_iQuota = (iQuota < 0) ? 0 : iQuota;
+	m_iCursor = 0;
+	m_iPassSlices = 0;
+	m_iPassBots = 0;
+	m_iLastPassSlices = 0;
+	m_iWorstPassSlices = 0;
+	m_iLastDecided = 0;
+	m_iSlices = 0;
+	m_iDecided = 0;
+	m_iOverruns = 0;
+	m_dWorstOverrun = 0.0;
+}
+
+int AIScheduler::RunSlice(JobFunction pFunction, void* pData, int iBotCount)
+{
+	m_iLastDecided = 0;
+	if(iBotCount <= 0)
+	{
+		return 0;
+	}
+
+	// Bots may have been removed since the last slice.
+	m_iCursor = (m_iCursor < iBotCount) ? m_iCursor : 0;
+	int iLimit = (m_iQuota > 0 && m_iQuota < iBotCount) ? m_iQuota : iBotCount;
+	int64_t iStart = m_Clock.GetTicks();
+	int64_t iElapsed = 0;
+	int iDecided = 0;
+	int iChunks = 0;
+	while(iDecided < iLimit)
+	{
+		// Chunks stop at the end of the list, so each one is a single range.
+		int iChunk = iLimit - iDecided;
+		iChunk = (iChunk < AISchedulerNS::CHUNK) ? iChunk : AISchedulerNS::CHUNK;
+		iChunk = (iChunk < iBotCount - m_iCursor) ? iChunk : iBotCount - m_iCursor;
+		pFunction(pData, m_iCursor, m_iCursor + iChunk);
+		iDecided += iChunk;
+		m_iCursor += iChunk;
+		m_iCursor = (m_iCursor < iBotCount) ? m_iCursor : 0;
+
+		// Stop if another chunk as long as the average so far wouldn't fit.
+		iElapsed = m_Clock.GetTicks() - iStart;
+		++iChunks;
+		if(m_iBudgetTicks > 0 && iElapsed + iElapsed / iChunks > m_iBudgetTicks)
+		{
+			break;
+		}
+	}
+
+	if(m_iBudgetTicks > 0 && iElapsed > m_iBudgetTicks)
+	{
+		double dOver = m_Clock.ToSeconds(iElapsed - m_iBudgetTicks);
+		m_dWorstOverrun = (dOver > m_dWorstOverrun) ? dOver : m_dWorstOverrun;
+		++m_iOverruns;
+	}
+
+	// A round ends once every bot has had a turn since the last one ended.
+	++m_iPassSlices;
+	m_iPassBots += iDecided;
+	if(m_iPassBots >= iBotCount)
+	{
+		m_iLastPassSlices = m_iPassSlices;
+		m_iWorstPassSlices = (m_iPassSlices > m_iWorstPassSlices) ? m_iPassSlices : m_iWorstPassSlices;
+		m_iPassSlices = 0;
+		m_iPassBots = 0;
+	}
+
+	++m_iSlices;
+	m_iDecided += iDecided;
+	m_iLastDecided = iDecided;
+	return iDecided;
+}
+
+void AIScheduler::SaveState(StateBuffer& state) const
+{
+	state.Write(m_iCursor);
+	state.Write(m_iPassSlices);
+	state.Write(m_iPassBots);
+	state.Write(m_iLastPassSlices);
+	state.Write(m_iWorstPassSlices);
+	state.Write(m_iLastDecided);
+	state.Write(m_iSlices);
+	state.Write(m_iDecided);
+	state.Write(m_iOverruns);
+	state.Write(m_dWorstOverrun);
+}
+
+bool AIScheduler::LoadState(StateBuffer& state)
+{
+	state.Read(m_iCursor);
+	state.Read(m_iPassSlices);
+	state.Read(m_iPassBots);
+	state.Read(m_iLastPassSlices);
+	state.Read(m_iWorstPassSlices);
+	state.Read(m_iLastDecided);
+	state.Read(m_iSlices);
+	state.Read(m_iDecided);
+	state.Read(m_iOverruns);
+	state.Read(m_dWorstOverrun);
+	m_iCursor = (m_iCursor < 0) ? 0 : m_iCursor;
+	return state.IsGood();
+}
@@ -0,0 +1,84 @@
+#ifndef AI_SCHEDULER_H_
+#define AI_SCHEDULER_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stdint.h>
+
+#include "Clock.h"
+#include "JobSystem.h"
+#include "StateBuffer.h"
+
+namespace AISchedulerNS
+{
+	const int CHUNK = 16;					// Bots decided between looks at the clock.
+}
+
+// AIScheduler: Spreads bot decisions over ticks so thinking costs about the same
+// however many bots there are. Each tick RunSlice decides bots round robin from
+// where the last slice stopped, a chunk at a time, until another chunk wouldn't fit
+// in the budget, the slice has decided its quota, or it got back to where it started.
+// A slice that ends over its budget anyway, say because a chunk was preempted, is
+// counted as an overrun. Bots keep acting on their last decision until their turn
+// comes round again. The budget is wall clock time, so how far a slice gets depends
+// on the machine. Runs that must be repeatable, like comparisons between worker
+// counts, set the budget to 0 and rely on the quota, which depends only on the bot
+// count.
+class AIScheduler
+{
+private:
+
+	HighResClock		m_Clock;
+	int64_t				m_iBudgetTicks;		// Clock ticks per slice, 0 for no limit.
+	int					m_iBudget;			// Microseconds per slice, 0 for no limit.
+	int					m_iQuota;			// Bots per slice, 0 for no limit.
+	int					m_iCursor;			// Next bot to decide.
+	int					m_iPassSlices;		// Slices so far in the current round of every bot.
+	int					m_iPassBots;		// Bots decided so far in the current round.
+	int					m_iLastPassSlices;	// Slices the last full round took.
+	int					m_iWorstPassSlices;
+	int					m_iLastDecided;		// Bots decided by the last slice.
+	int64_t				m_iSlices;
+	int64_t				m_iDecided;
+	int64_t				m_iOverruns;		// Slices that went over the budget.
+	double				m_dWorstOverrun;	// Seconds.
+
+public:
+
+	// Constructor.
+	AIScheduler();
+
+	// Set the time per slice in microseconds and the most bots per slice. 0 lifts either limit.
+	void Initialize(int iBudgetMicroseconds, int iQuota);
+
+	// Decide bots [i, j) with pFunction(pData, i, j), starting after the last bot the
+	// previous slice decided, until a limit is hit or all iBotCount bots have had a turn.
+	// Returns the number of bots decided.
+	int RunSlice(JobFunction pFunction, void* pData, int iBotCount);
+
+	// Append where the round robin is, and the totals, to state, or take them back.
+	void SaveState(StateBuffer& state) const;
+	bool LoadState(StateBuffer& state);
+
+	// Return the limits.
+	int GetBudget(void) const { return m_iBudget; }
+	int GetQuota(void) const { return m_iQuota; }
+
+	// Return how many slices the last and longest rounds of every bot took, which is
+	// the most ticks a bot went on its old decision.
+	int GetLastPassSlices(void) const { return m_iLastPassSlices; }
+	int GetWorstPassSlices(void) const { return m_iWorstPassSlices; }
+
+	// Return the bots the last slice decided.
+	int GetLastDecided(void) const { return m_iLastDecided; }
+
+	// Return totals since Initialize.
+	int64_t GetSliceCount(void) const { return m_iSlices; }
+	int64_t GetDecidedCount(void) const { return m_iDecided; }
+	int64_t GetOverrunCount(void) const { return m_iOverruns; }
+
+	// Return the furthest a slice went over its budget, in seconds.
+	double GetWorstOverrun(void) const { return m_dWorstOverrun; }
+};
+
+#endif
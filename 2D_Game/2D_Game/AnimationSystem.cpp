@@ -0,0 +1,255 @@
+#include "AnimationSystem.h"
+#include "Profiler.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define ANIMATION_X86 1
+#include <emmintrin.h>
+#else
+#define ANIMATION_X86 0
+#endif
+
+// Constructor.
+AnimationSystem::AnimationSystem()
+{
+
+}
+
+int AnimationSystem::GetLayout(int iWidth, int iHeight, int iCols, int iFrameCount)
+{
+	if(iCols < 1)
+	{
+		iCols = 1;
+	}
+	if(iFrameCount < 1)
+	{
+		iFrameCount = 1;
+	}
+
+	for(size_t i = 0; i < m_Layouts.size(); ++i)
+	{
+		const FrameLayout& layout = m_Layouts[i];
+		if(layout.iWidth == iWidth && layout.iHeight == iHeight && layout.iCols == iCols && layout.iFrameCount >= iFrameCount)
+		{
+			return (int)i;
+		}
+	}
+
+	FrameLayout layout = { iWidth, iHeight, iCols, iFrameCount, (int)m_Rects.size() };
+	for(int iFrame = 0; iFrame < iFrameCount; ++iFrame)
+	{
+		RECT rect;
+		rect.left = (iFrame % iCols) * iWidth;
+		rect.right = rect.left + iWidth;
+		rect.top = (iFrame / iCols) * iHeight;
+		rect.bottom = rect.top + iHeight;
+		m_Rects.push_back(rect);
+	}
+	m_Layouts.push_back(layout);
+	return (int)m_Layouts.size() - 1;
+}
+
+RECT AnimationSystem::GetFrameRect(int iLayout, int iFrame) const
+{
+	const FrameLayout& layout = m_Layouts[iLayout];
+	if(iFrame >= 0 && iFrame < layout.iFrameCount)
+	{
+		return m_Rects[layout.iFirstRect + iFrame];
+	}
+
+	// Outside the table, work it out the slow way.
+	RECT rect;
+	rect.left = (iFrame % layout.iCols) * layout.iWidth;
+	rect.right = rect.left + layout.iWidth;
+	rect.top = (iFrame / layout.iCols) * layout.iHeight;
+	rect.bottom = rect.top + layout.iHeight;
+	return rect;
+}
+
+int AnimationSystem::AddTrack(int iLayout, RECT* pTarget)
+{
+	int iTrack;
+	if(m_FreeTracks.empty())
+	{
+		iTrack = (int)m_fTimer.size();
+		m_fTimer.push_back(0.0f);
+		m_fDelay.push_back(1.0f);
+		m_iFrame.push_back(0);
+		m_iStart.push_back(0);
+		m_iEnd.push_back(0);
+		m_iLoop.push_back(-1);
+		m_iComplete.push_back(0);
+		m_iLayout.push_back(iLayout);
+		m_pTarget.push_back(pTarget);
+	}
+	else
+	{
+		iTrack = m_FreeTracks.back();
+		m_FreeTracks.pop_back();
+		m_fTimer[iTrack] = 0.0f;
+		m_fDelay[iTrack] = 1.0f;
+		m_iFrame[iTrack] = 0;
+		m_iLoop[iTrack] = -1;
+		m_iComplete[iTrack] = 0;
+		m_iLayout[iTrack] = iLayout;
+		m_pTarget[iTrack] = pTarget;
+	}
+
+	return iTrack;
+}
+
+void AnimationSystem::RemoveTrack(int iTrack)
+{
+	// An empty range is never stepped, so the slot costs nothing until it is reused.
+	m_iStart[iTrack] = 0;
+	m_iEnd[iTrack] = 0;
+	m_pTarget[iTrack] = nullptr;
+	m_FreeTracks.push_back(iTrack);
+}
+
+void AnimationSystem::SetAnimation(int iTrack, int iStart, int iEnd, float fDelay, bool bLoop)
+{
+	m_iStart[iTrack] = iStart;
+	m_iEnd[iTrack] = iEnd;
+	m_fDelay[iTrack] = fDelay;
+	m_iLoop[iTrack] = bLoop ? -1 : 0;
+}
+
+void AnimationSystem::SetFrame(int iTrack, int iFrame)
+{
+	m_iFrame[iTrack] = iFrame;
+	m_iComplete[iTrack] = 0;
+	WriteRect(iTrack);
+}
+
+void AnimationSystem::WriteRect(int iTrack) const
+{
+	if(m_pTarget[iTrack])
+	{
+		*m_pTarget[iTrack] = GetFrameRect(m_iLayout[iTrack], m_iFrame[iTrack]);
+	}
+}
+
+void AnimationSystem::AdvanceScalar(int iBegin, int iEnd, float fDelta)
+{
+	for(int i = iBegin; i < iEnd; ++i)
+	{
+		if(m_iEnd[i] - m_iStart[i] > 0)
+		{
+			m_fTimer[i] += fDelta;
+			if(m_fTimer[i] > m_fDelay[i])
+			{
+				m_fTimer[i] -= m_fDelay[i];
+				m_iFrame[i]++;
+				if(m_iFrame[i] < m_iStart[i] || m_iFrame[i] > m_iEnd[i])
+				{
+					if(m_iLoop[i])
+					{
+						m_iFrame[i] = m_iStart[i];
+					}
+					else
+					{
+						m_iFrame[i] = m_iEnd[i];
+						m_iComplete[i] = -1;
+					}
+				}
+				WriteRect(i);
+			}
+		}
+	}
+}
+
+void AnimationSystem::Advance(float fDelta)
+{
+	PROFILE_SCOPE("AnimationSystem::Advance");
+
+	int iCount = (int)m_fTimer.size();
+	int iBody = 0;
+
+#if ANIMATION_X86
+	// Same steps as AdvanceScalar, four tracks at a time with masks in place of branches.
+	iBody = iCount & ~3;
+	__m128 delta = _mm_set1_ps(fDelta);
+	for(int i = 0; i < iBody; i += 4)
+	{
+		__m128i start = _mm_loadu_si128((const __m128i*)&m_iStart[i]);
+		__m128i end = _mm_loadu_si128((const __m128i*)&m_iEnd[i]);
+		__m128i animated = _mm_cmpgt_epi32(_mm_sub_epi32(end, start), _mm_setzero_si128());
+
+		__m128 timer = _mm_loadu_ps(&m_fTimer[i]);
+		__m128 delay = _mm_loadu_ps(&m_fDelay[i]);
+		timer = _mm_add_ps(timer, _mm_and_ps(delta, _mm_castsi128_ps(animated)));
+		__m128i step = _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(timer, delay)), animated);
+		int iStepped = _mm_movemask_ps(_mm_castsi128_ps(step));
+		if(0 == iStepped)
+		{
+			// Only animated timers changed, keep the stores for the usual case.
+			_mm_storeu_ps(&m_fTimer[i], timer);
+			continue;
+		}
+		timer = _mm_sub_ps(timer, _mm_and_ps(delay, _mm_castsi128_ps(step)));
+
+		// step is -1 in stepping lanes.
+		__m128i frame = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)&m_iFrame[i]), step);
+		__m128i outside = _mm_and_si128(step, _mm_or_si128(_mm_cmplt_epi32(frame, start), _mm_cmpgt_epi32(frame, end)));
+		__m128i loop = _mm_loadu_si128((const __m128i*)&m_iLoop[i]);
+		__m128i restart = _mm_and_si128(outside, loop);
+		__m128i hold = _mm_andnot_si128(loop, outside);
+		frame = _mm_or_si128(_mm_andnot_si128(outside, frame), _mm_or_si128(_mm_and_si128(restart, start), _mm_and_si128(hold, end)));
+		__m128i complete = _mm_or_si128(_mm_loadu_si128((const __m128i*)&m_iComplete[i]), hold);
+
+		_mm_storeu_ps(&m_fTimer[i], timer);
+		_mm_storeu_si128((__m128i*)&m_iFrame[i], frame);
+		_mm_storeu_si128((__m128i*)&m_iComplete[i], complete);
+
+		for(int iLane = 0; iLane < 4; ++iLane)
+		{
+			if(iStepped & (1 << iLane))
+			{
+				WriteRect(i + iLane);
+			}
+		}
+	}
+#endif
+
+	AdvanceScalar(iBody, iCount, fDelta);
+}
+
+void AnimationSystem::AdvanceLooping(float* pTimer, int* pFrame, int iCount, float fDelta, float fDelay, int iStart, int iEnd)
+{
+	int iBody = 0;
+
+#if ANIMATION_X86
+	iBody = iCount & ~3;
+	__m128 delta = _mm_set1_ps(fDelta);
+	__m128 delay = _mm_set1_ps(fDelay);
+	__m128i start = _mm_set1_epi32(iStart);
+	__m128i end = _mm_set1_epi32(iEnd);
+	for(int i = 0; i < iBody; i += 4)
+	{
+		__m128 timer = _mm_add_ps(_mm_loadu_ps(pTimer + i), delta);
+		__m128 step = _mm_cmpgt_ps(timer, delay);
+		timer = _mm_sub_ps(timer, _mm_and_ps(delay, step));
+
+		__m128i frame = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(pFrame + i)), _mm_castps_si128(step));
+		__m128i outside = _mm_or_si128(_mm_cmplt_epi32(frame, start), _mm_cmpgt_epi32(frame, end));
+		outside = _mm_and_si128(outside, _mm_castps_si128(step));
+		frame = _mm_or_si128(_mm_andnot_si128(outside, frame), _mm_and_si128(outside, start));
+
+		_mm_storeu_ps(pTimer + i, timer);
+		_mm_storeu_si128((__m128i*)(pFrame + i), frame);
+	}
+#endif
+
+	for(int i = iBody; i < iCount; ++i)
+	{
+		pTimer[i] += fDelta;
+		if(pTimer[i] > fDelay)
+		{
+			pTimer[i] -= fDelay;
+			if(++pFrame[i] < iStart || pFrame[i] > iEnd)
+			{
+				pFrame[i] = iStart;
+			}
+		}
+	}
+}
@@ -0,0 +1,113 @@
+#ifndef ANIMATION_SYSTEM_H_
+#define ANIMATION_SYSTEM_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include "Platform.h"
+
+#include <vector>
+
+namespace AnimationSystemNS
+{
+	const int INVALID_TRACK = -1;		// Not registered with an AnimationSystem.
+}
+
+// AnimationSystem: Frame animation for every registered sprite, advanced in one pass.
+// Each track is an animation timer and frame range, kept in parallel arrays so Advance
+// steps four tracks per SSE2 instruction. Frame RECTs come from tables built once per
+// frame layout, so a frame change is a table lookup instead of a divide and modulo.
+// Stepping matches Image::Update: looping tracks go back to the start frame,
+// one-shot tracks hold the end frame and are marked complete.
+class AnimationSystem
+{
+private:
+
+	// Frame layout of a texture: frame size and frames per row.
+	struct FrameLayout
+	{
+		int		iWidth;
+		int		iHeight;
+		int		iCols;
+		int		iFrameCount;		// Entries in the table.
+		int		iFirstRect;			// Index of frame 0 in m_Rects.
+	};
+
+	std::vector<FrameLayout>	m_Layouts;
+	std::vector<RECT>			m_Rects;			// Every layout's frame table, back to back.
+
+	// Tracks, indexed by track id.
+	std::vector<float>			m_fTimer;			// Time into the current frame.
+	std::vector<float>			m_fDelay;			// Seconds per frame.
+	std::vector<int>			m_iFrame;			// Current frame.
+	std::vector<int>			m_iStart;			// Animation range. Not animated unless end > start.
+	std::vector<int>			m_iEnd;
+	std::vector<int>			m_iLoop;			// -1 to loop, 0 to stop on the end frame.
+	std::vector<int>			m_iComplete;		// -1 once a one-shot track reaches its end.
+	std::vector<int>			m_iLayout;			// Frame table of each track.
+	std::vector<RECT*>			m_pTarget;			// Receives the frame RECT whenever the frame steps, or null.
+	std::vector<int>			m_FreeTracks;		// Removed tracks to reuse.
+
+	// Copy the RECT of track iTrack's frame to its target.
+	void WriteRect(int iTrack) const;
+
+	// Step tracks [iBegin, iEnd) one at a time.
+	void AdvanceScalar(int iBegin, int iEnd, float fDelta);
+
+public:
+
+	// Constructor.
+	AnimationSystem();
+
+	// Return the frame table for a layout, building it the first time.
+	// The table holds at least iFrameCount frames, laid out iCols to a row.
+	int GetLayout(int iWidth, int iHeight, int iCols, int iFrameCount);
+
+	// Return the RECT of frame iFrame of a layout.
+	RECT GetFrameRect(int iLayout, int iFrame) const;
+
+	// Return the number of frames in a layout's table.
+	int GetFrameCount(int iLayout) const { return m_Layouts[iLayout].iFrameCount; }
+
+	// Add a track drawing frames from iLayout. pTarget, if not null, must outlive the track.
+	int AddTrack(int iLayout, RECT* pTarget);
+
+	// Remove a track. Its id may be handed out again.
+	void RemoveTrack(int iTrack);
+
+	// Set a track's frame range, seconds per frame and loop mode.
+	void SetAnimation(int iTrack, int iStart, int iEnd, float fDelay, bool bLoop);
+
+	// Change the frame layout of a track.
+	void SetLayout(int iTrack, int iLayout) { m_iLayout[iTrack] = iLayout; }
+
+	// Jump to a frame and clear the complete flag.
+	void SetFrame(int iTrack, int iFrame);
+
+	// Set or clear the complete flag.
+	void SetComplete(int iTrack, bool bComplete) { m_iComplete[iTrack] = bComplete ? -1 : 0; }
+
+	// Return a track's current frame.
+	int GetFrame(int iTrack) const { return m_iFrame[iTrack]; }
+
+	// Return true once a one-shot track has shown its end frame for a full delay.
+	bool IsComplete(int iTrack) const { return 0 != m_iComplete[iTrack]; }
+
+	// Return the RECT of a track's current frame.
+	RECT GetRect(int iTrack) const { return GetFrameRect(m_iLayout[iTrack], m_iFrame[iTrack]); }
+
+	// Return or set the time track iTrack has spent on its current frame.
+	float GetTimer(int iTrack) const { return m_fTimer[iTrack]; }
+	void SetTimer(int iTrack, float fTimer) { m_fTimer[iTrack] = fTimer; }
+
+	// Return number of track ids in use or free.
+	int GetTrackCount(void) const { return (int)m_fTimer.size(); }
+
+	// Advance every track by fDelta seconds.
+	void Advance(float fDelta);
+
+	// Advance iCount looping animations that share one frame range and delay.
+	// For entity stores that keep their own timer and frame arrays.
+	static void AdvanceLooping(float* pTimer, int* pFrame, int iCount, float fDelta, float fDelay, int iStart, int iEnd);
+};
+
+#endif
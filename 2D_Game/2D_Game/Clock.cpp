@@ -0,0 +1,72 @@
+#include "Clock.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <MMSystem.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+// Constructor.
+HighResClock::HighResClock()
+	: m_iFrequency(1)
+	, m_bTimerPeriodSet(false)
+{
+
+}
+
+// Destructor.
+HighResClock::~HighResClock()
+{
+#ifdef _WIN32
+	if(m_bTimerPeriodSet)
+	{
+		timeEndPeriod(1);
+	}
+#endif
+}
+
+bool HighResClock::Initialize(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq;
+	if(QueryPerformanceFrequency(&freq) == FALSE)
+	{
+		return false;
+	}
+	m_iFrequency = freq.QuadPart;
+
+	// Request 1 ms sleep granularity once for the lifetime of the clock,
+	// rather than around every Sleep call.
+	if(!m_bTimerPeriodSet)
+	{
+		m_bTimerPeriodSet = (timeBeginPeriod(1) == TIMERR_NOERROR);
+	}
+#else
+	m_iFrequency = 1000000000;			// steady_clock is read in nanoseconds.
+#endif
+
+	return true;
+}
+
+int64_t HighResClock::GetTicks(void) const
+{
+#ifdef _WIN32
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void HighResClock::SleepMs(unsigned int uMilliseconds)
+{
+#ifdef _WIN32
+	Sleep(uMilliseconds);
+#else
+	std::this_thread::sleep_for(std::chrono::milliseconds(uMilliseconds));
+#endif
+}
@@ -0,0 +1,66 @@
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <stdint.h>
+
+// Clock: Source of high resolution time.
+// Implemented per platform so timing code can be built and measured anywhere.
+class Clock
+{
+public:
+
+	// Destructor.
+	virtual ~Clock() {}
+
+	// Return the current time in clock ticks.
+	virtual int64_t GetTicks(void) const = 0;
+
+	// Return the number of clock ticks per second.
+	virtual int64_t GetFrequency(void) const = 0;
+
+	// Give up the CPU for roughly the specified number of milliseconds.
+	// May oversleep by the scheduler granularity.
+	virtual void SleepMs(unsigned int uMilliseconds) = 0;
+
+	// Convert a tick count to seconds.
+	double ToSeconds(int64_t iTicks) const
+	{
+		return (double)iTicks / (double)GetFrequency();
+	}
+
+	// Convert seconds to a tick count.
+	int64_t FromSeconds(double dSeconds) const
+	{
+		return (int64_t)(dSeconds * (double)GetFrequency());
+	}
+};
+
+// HighResClock: The platform's high resolution counter.
+// QueryPerformanceCounter on Windows, steady_clock elsewhere.
+class HighResClock : public Clock
+{
+private:
+
+	int64_t		m_iFrequency;		// Counter ticks per second.
+	bool		m_bTimerPeriodSet;	// True while the 1 ms scheduler period is requested.
+
+public:
+
+	// Constructor.
+	HighResClock();
+
+	// Destructor.
+	virtual ~HighResClock();
+
+	// Query the counter frequency and request fine scheduler granularity.
+	// Returns false if no high resolution counter is available.
+	bool Initialize(void);
+
+	virtual int64_t GetTicks(void) const;
+
+	virtual int64_t GetFrequency(void) const { return m_iFrequency; }
+
+	virtual void SleepMs(unsigned int uMilliseconds);
+};
+
+#endif
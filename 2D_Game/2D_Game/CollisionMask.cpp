@@ -0,0 +1,250 @@
+#include "CollisionMask.h"
+#include "GameError.h"
+
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define COLLISION_MASK_X86 1
+#include <emmintrin.h>
+#else
+#define COLLISION_MASK_X86 0
+#endif
+
+namespace
+{
+	const float TWO_PI = 6.28318530718f;
+
+	// Return the row bits of a mask starting at bit iBit, as one word.
+	// Reads the word after, which the padding word makes safe.
+	inline uint64_t ReadBits(const uint64_t* pRow, int iBit)
+	{
+		int iWord = iBit >> 6;
+		int iShift = iBit & 63;
+		return (pRow[iWord] >> iShift) | ((pRow[iWord + 1] << 1) << (63 - iShift));
+	}
+
+	// Return true if bit iBit of a row is set.
+	inline bool TestBit(const uint64_t* pRow, int iBit)
+	{
+		return 0 != ((pRow[iBit >> 6] >> (iBit & 63)) & 1);
+	}
+}
+
+// Constructor.
+CollisionMask::CollisionMask()
+{
+	MaskLayout layout = {};
+	m_Layout = layout;
+}
+
+void CollisionMask::Build(const MaskLayout& layout, const uint64_t* pOpacity, int iOpacityStride, int iTextureWidth, int iTextureHeight)
+{
+	// Fill in the defaults.
+	m_Layout = layout;
+	m_Layout.iFrameWidth = (layout.iFrameWidth > 0) ? layout.iFrameWidth : iTextureWidth;
+	m_Layout.iFrameHeight = (layout.iFrameHeight > 0) ? layout.iFrameHeight : iTextureHeight;
+	m_Layout.iCols = (layout.iCols > 0) ? layout.iCols : 1;
+	m_Layout.iFrames = (layout.iFrames > 0) ? layout.iFrames : 1;
+	m_Layout.iRotations = (layout.iRotations > 0) ? layout.iRotations : 1;
+	m_Layout.iScales = (layout.iScales > 0) ? layout.iScales : 1;
+	m_Layout.fMinScale = (layout.fMinScale > 0.0f) ? layout.fMinScale : 1.0f;
+	m_Layout.fMaxScale = (layout.fMaxScale > m_Layout.fMinScale) ? layout.fMaxScale : m_Layout.fMinScale;
+
+	if(m_Layout.iFrames * m_Layout.iRotations * m_Layout.iScales > CollisionMaskNS::MAX_VARIANTS)
+	{
+		throw(GameError(GameErrorNS::FATAL_ERROR, "Too many collision mask variants!"));
+	}
+
+	const float fFrameWidth = (float)m_Layout.iFrameWidth;
+	const float fFrameHeight = (float)m_Layout.iFrameHeight;
+	std::vector<size_t> offsets;
+	m_Words.clear();
+	m_Variants.clear();
+	for(int iFrame = 0; iFrame < m_Layout.iFrames; ++iFrame)
+	{
+		int iFrameX = (iFrame % m_Layout.iCols) * m_Layout.iFrameWidth;
+		int iFrameY = (iFrame / m_Layout.iCols) * m_Layout.iFrameHeight;
+		for(int iScale = 0; iScale < m_Layout.iScales; ++iScale)
+		{
+			float fScale = m_Layout.fMinScale;
+			if(m_Layout.iScales > 1)
+			{
+				fScale += (m_Layout.fMaxScale - m_Layout.fMinScale) * iScale / (m_Layout.iScales - 1);
+			}
+
+			for(int iRotation = 0; iRotation < m_Layout.iRotations; ++iRotation)
+			{
+				float fAngle = TWO_PI * iRotation / m_Layout.iRotations;
+				float fCos = cosf(fAngle);
+				float fSin = sinf(fAngle);
+
+				// Big enough for the rotated, scaled frame, centered on its center.
+				float fExtentX = (fabsf(fCos) * fFrameWidth + fabsf(fSin) * fFrameHeight) * .5f * fScale;
+				float fExtentY = (fabsf(fSin) * fFrameWidth + fabsf(fCos) * fFrameHeight) * .5f * fScale;
+				MaskFrame variant;
+				variant.pRows = nullptr;
+				variant.iWidth = (int)ceilf(fExtentX * 2.0f - .001f);
+				variant.iHeight = (int)ceilf(fExtentY * 2.0f - .001f);
+				variant.iWidth = (variant.iWidth < 1) ? 1 : variant.iWidth;
+				variant.iHeight = (variant.iHeight < 1) ? 1 : variant.iHeight;
+				variant.iStride = (variant.iWidth + 63) / 64 + 1;
+
+				size_t iOffset = m_Words.size();
+				m_Words.resize(iOffset + (size_t)variant.iStride * variant.iHeight, 0);
+				uint64_t* pRows = m_Words.data() + iOffset;
+
+				// Sample the texel under each pixel center, undoing the rotation and scale.
+				for(int v = 0; v < variant.iHeight; ++v)
+				{
+					float fY = v + .5f - variant.iHeight * .5f;
+					for(int u = 0; u < variant.iWidth; ++u)
+					{
+						float fX = u + .5f - variant.iWidth * .5f;
+						float fU = (fCos * fX + fSin * fY) / fScale + fFrameWidth * .5f;
+						float fV = (fCos * fY - fSin * fX) / fScale + fFrameHeight * .5f;
+						if(fU < 0.0f || fV < 0.0f || fU >= fFrameWidth || fV >= fFrameHeight)
+						{
+							continue;
+						}
+
+						int iTexelX = iFrameX + (int)fU;
+						int iTexelY = iFrameY + (int)fV;
+						bool bOpaque = (nullptr == pOpacity);
+						if(pOpacity && iTexelX < iTextureWidth && iTexelY < iTextureHeight)
+						{
+							bOpaque = TestBit(pOpacity + (size_t)iTexelY * iOpacityStride, iTexelX);
+						}
+
+						if(bOpaque)
+						{
+							pRows[(size_t)v * variant.iStride + (u >> 6)] |= (uint64_t)1 << (u & 63);
+						}
+					}
+				}
+
+				offsets.push_back(iOffset);
+				m_Variants.push_back(variant);
+			}
+		}
+	}
+
+	// m_Words has stopped moving, point the variants into it.
+	for(size_t i = 0; i < m_Variants.size(); ++i)
+	{
+		m_Variants[i].pRows = m_Words.data() + offsets[i];
+	}
+}
+
+const MaskFrame& CollisionMask::Get(int iFrame, float fAngle, float fScale) const
+{
+	iFrame = (iFrame < 0) ? 0 : ((iFrame >= m_Layout.iFrames) ? m_Layout.iFrames - 1 : iFrame);
+
+	int iRotation = (int)floorf(fAngle * (m_Layout.iRotations / TWO_PI) + .5f) % m_Layout.iRotations;
+	iRotation += (iRotation < 0) ? m_Layout.iRotations : 0;
+
+	int iScale = 0;
+	if(m_Layout.iScales > 1)
+	{
+		float fStep = (m_Layout.fMaxScale - m_Layout.fMinScale) / (m_Layout.iScales - 1);
+		iScale = (int)floorf((fScale - m_Layout.fMinScale) / fStep + .5f);
+		iScale = (iScale < 0) ? 0 : ((iScale >= m_Layout.iScales) ? m_Layout.iScales - 1 : iScale);
+	}
+
+	return m_Variants[(iFrame * m_Layout.iScales + iScale) * m_Layout.iRotations + iRotation];
+}
+
+void CollisionMask::Place(const MaskFrame& frame, float fCenterX, float fCenterY, int& iX, int& iY)
+{
+	iX = (int)floorf(fCenterX - frame.iWidth * .5f + .5f);
+	iY = (int)floorf(fCenterY - frame.iHeight * .5f + .5f);
+}
+
+bool CollisionMask::Overlap(const MaskFrame& a, int iAX, int iAY, const MaskFrame& b, int iBX, int iBY)
+{
+	int iLeft = (iAX > iBX) ? iAX : iBX;
+	int iTop = (iAY > iBY) ? iAY : iBY;
+	int iRight = (iAX + a.iWidth < iBX + b.iWidth) ? iAX + a.iWidth : iBX + b.iWidth;
+	int iBottom = (iAY + a.iHeight < iBY + b.iHeight) ? iAY + a.iHeight : iBY + b.iHeight;
+	if(iLeft >= iRight || iTop >= iBottom)
+	{
+		return false;
+	}
+
+	int iWidth = iRight - iLeft;
+	int iRows = iBottom - iTop;
+	const uint64_t* pA = a.pRows + (size_t)(iTop - iAY) * a.iStride;
+	const uint64_t* pB = b.pRows + (size_t)(iTop - iBY) * b.iStride;
+
+	// 64 columns of the overlap at a time, lined up so bit 0 is column iLeft + iColumn in both.
+	for(int iColumn = 0; iColumn < iWidth; iColumn += 64)
+	{
+		int iBitA = iLeft - iAX + iColumn;
+		int iBitB = iLeft - iBX + iColumn;
+		uint64_t iKeep = (iWidth - iColumn >= 64) ? ~(uint64_t)0 : (((uint64_t)1 << (iWidth - iColumn)) - 1);
+		int iRow = 0;
+
+#if COLLISION_MASK_X86
+		// Every row shifts by the same amount, so two rows go through each 128-bit step.
+		const uint64_t* pWordA = pA + (iBitA >> 6);
+		const uint64_t* pWordB = pB + (iBitB >> 6);
+		__m128i shiftA = _mm_cvtsi32_si128(iBitA & 63);
+		__m128i carryA = _mm_cvtsi32_si128(64 - (iBitA & 63));
+		__m128i shiftB = _mm_cvtsi32_si128(iBitB & 63);
+		__m128i carryB = _mm_cvtsi32_si128(64 - (iBitB & 63));
+		__m128i keep = _mm_set1_epi64x((long long)iKeep);
+		__m128i zero = _mm_setzero_si128();
+		for(; iRow + 2 <= iRows; iRow += 2)
+		{
+			const uint64_t* pRowA = pWordA + (size_t)iRow * a.iStride;
+			const uint64_t* pRowB = pWordB + (size_t)iRow * b.iStride;
+			__m128i lowA = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)pRowA), _mm_loadl_epi64((const __m128i*)(pRowA + a.iStride)));
+			__m128i highA = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(pRowA + 1)), _mm_loadl_epi64((const __m128i*)(pRowA + a.iStride + 1)));
+			__m128i lowB = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)pRowB), _mm_loadl_epi64((const __m128i*)(pRowB + b.iStride)));
+			__m128i highB = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(pRowB + 1)), _mm_loadl_epi64((const __m128i*)(pRowB + b.iStride + 1)));
+
+			// A shift by 64 gives 0, so a carry from an aligned row adds nothing.
+			__m128i bitsA = _mm_or_si128(_mm_srl_epi64(lowA, shiftA), _mm_sll_epi64(highA, carryA));
+			__m128i bitsB = _mm_or_si128(_mm_srl_epi64(lowB, shiftB), _mm_sll_epi64(highB, carryB));
+			__m128i hit = _mm_and_si128(_mm_and_si128(bitsA, bitsB), keep);
+			if(0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi8(hit, zero)))
+			{
+				return true;
+			}
+		}
+#endif
+
+		for(; iRow < iRows; ++iRow)
+		{
+			if(ReadBits(pA + (size_t)iRow * a.iStride, iBitA) & ReadBits(pB + (size_t)iRow * b.iStride, iBitB) & iKeep)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool CollisionMask::OverlapReference(const MaskFrame& a, int iAX, int iAY, const MaskFrame& b, int iBX, int iBY)
+{
+	for(int y = 0; y < a.iHeight; ++y)
+	{
+		int iBY2 = iAY + y - iBY;
+		if(iBY2 < 0 || iBY2 >= b.iHeight)
+		{
+			continue;
+		}
+
+		for(int x = 0; x < a.iWidth; ++x)
+		{
+			int iBX2 = iAX + x - iBX;
+			if(iBX2 >= 0 && iBX2 < b.iWidth && TestBit(a.pRows + (size_t)y * a.iStride, x)
+				&& TestBit(b.pRows + (size_t)iBY2 * b.iStride, iBX2))
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
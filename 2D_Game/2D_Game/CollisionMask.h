@@ -0,0 +1,83 @@
+#ifndef COLLISION_MASK_H_
+#define COLLISION_MASK_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace CollisionMaskNS
+{
+	const int MAX_VARIANTS = 8192;		// Frames x rotations x scales in one mask.
+}
+
+// One frame of a mask at one rotation and scale. Row y holds iWords 64-bit words,
+// bit x of the row is pixel x, and each row ends with a zero word so a read may
+// run one word past the last pixel.
+struct MaskFrame
+{
+	const uint64_t*	pRows;
+	int				iWidth;
+	int				iHeight;
+	int				iStride;			// Words from one row to the next, iWords + 1.
+};
+
+// How a mask is cut from a texture and which variants to build.
+struct MaskLayout
+{
+	int		iFrameWidth;				// Frame size in texels, 0 for the whole texture.
+	int		iFrameHeight;
+	int		iCols;						// Frames per row of the texture, 0 for one.
+	int		iFrames;					// Frames to build, 0 for one.
+	int		iRotations;					// Angles spaced evenly around the circle, 0 for one.
+	float	fMinScale;					// Scales spaced evenly from min to max.
+	float	fMaxScale;
+	int		iScales;					// 0 for one, at fMinScale.
+};
+
+// CollisionMask: 1-bit opacity masks for every frame of a sprite sheet, pre-rotated
+// and pre-scaled into a grid of variants so the narrowphase never transforms pixels.
+// A variant is centered on the sprite's center, the point Graphics rotates about,
+// and is large enough to hold the rotated, scaled frame.
+class CollisionMask
+{
+private:
+
+	MaskLayout				m_Layout;
+	std::vector<uint64_t>	m_Words;			// Every variant's rows, back to back.
+	std::vector<MaskFrame>	m_Variants;			// Indexed by (frame * scales + scale) * rotations + rotation.
+
+public:
+
+	// Constructor.
+	CollisionMask();
+
+	// Build every variant. pOpacity is the texture's opacity, one bit per texel,
+	// iOpacityStride words per row. Null treats every texel as opaque.
+	void Build(const MaskLayout& layout, const uint64_t* pOpacity, int iOpacityStride, int iTextureWidth, int iTextureHeight);
+
+	// Return the layout the mask was built with.
+	const MaskLayout& GetLayout(void) const { return m_Layout; }
+
+	// Return the variant closest to a frame drawn at fAngle radians and fScale.
+	const MaskFrame& Get(int iFrame, float fAngle, float fScale) const;
+
+	// Return the number of variants.
+	int GetVariantCount(void) const { return (int)m_Variants.size(); }
+
+	// Return bytes held by the masks.
+	size_t GetBytes(void) const { return m_Words.size() * sizeof(uint64_t); }
+
+	// Return the top left pixel of a variant whose sprite is centered on (fCenterX, fCenterY).
+	static void Place(const MaskFrame& frame, float fCenterX, float fCenterY, int& iX, int& iY);
+
+	// Return true if two placed variants share an opaque pixel. Tests two rows per
+	// SSE2 step and stops at the first hit.
+	static bool Overlap(const MaskFrame& a, int iAX, int iAY, const MaskFrame& b, int iBX, int iBY);
+
+	// Overlap one pixel at a time. The reference for testing Overlap.
+	static bool OverlapReference(const MaskFrame& a, int iAX, int iAY, const MaskFrame& b, int iBX, int iBY);
+};
+
+#endif
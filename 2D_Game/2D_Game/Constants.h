@@ -1,9 +1,7 @@
 #ifndef CONSTANTS_H_
 #define CONSTANTS_H_
 
-#define WIN32_LEAN_AND_MEAN
-
-#include <windows.h>
+#include "Platform.h"
 
 // Macros
 
@@ -25,8 +23,8 @@
 	((COLOR_ARGB)((((a)&0xff)<<24)|(((r)&0xff)<<16)|(((g)&0xff)<<8)|((b)&0xff)))
 
 
-// Transparent color magenta
-#define TRANSCOLOR SETCOLOR_ARGB(0, 255, 0, 255)
+// Transparent color magenta. The color key compares alpha too, and the textures are opaque RGB.
+#define TRANSCOLOR SETCOLOR_ARGB(255, 255, 0, 255)
 
 
 // Constants
@@ -35,6 +33,7 @@ const char SHIP_IMAGE[] = "textures\\ship.png";
 const char SHIP_2_IMAGE[] = "textures\\ship2.png";
 const char NEBULA_IMAGE[] = "textures\\orion.jpg";
 const char PLANET_IMAGE[] = "textures\\planet.png";
+const char TORPEDO_IMAGE[] = "textures\\torpedo.png";
 
 const char CLASS_NAME[] = "Spacewar";
 const char GAME_TITLE[] = "Spacewar";
@@ -49,7 +48,6 @@ const int SHIP_COLS = 2;							// Ship texture has 2 columns;
 const int SHIP_WIDTH = 32;							// Width of ship image.
 const int SHIP_HEIGHT = 32;							// Height of ship image.
 const float ROTATION_RATE = 180.0f;					// Degrees per second
-const float SCALE_RATE = 0.2f;						// % change per second
 const float SHIP_SPEED = 100.0f;					// Pixels per second
 const float SHIP_SCALE = 1.5f;						// Starting ship scale.
 
@@ -60,6 +58,86 @@ const float MIN_FRAME_RATE = 10.0f;					// Minimum desired time for 1 frame
 const float MIN_FRAME_TIME = 1.0f / FRAME_RATE;		// Maximum time use for calculations.
 const float MAX_FRAME_TIME = 1.0f / MIN_FRAME_RATE;
 
+// Simulation
+const float TICK_RATE = 120.0f;						// Fixed simulation ticks per second.
+const float TICK_TIME = 1.0f / TICK_RATE;			// Length of one simulation tick.
+const int MAX_TICKS_PER_FRAME = 8;					// Catch-up limit, extra backlog is dropped.
+const int WORKER_COUNT = -1;						// Job system worker threads, -1 for one per spare core.
+const size_t FRAME_ARENA_SIZE = 1024 * 1024;		// Bytes of per-frame scratch memory, grows if a frame needs more.
+
+// Textures
+const size_t TEXTURE_CACHE_BUDGET = 32 * 1024 * 1024;	// Bytes of decoded pixels kept to restore textures after a device reset.
+
+// Drones
+const int DRONE_COUNT = 0;							// AI ships spawned at start.
+const float DRONE_SPEED = 80.0f;					// Pixels per second
+const float DRONE_STEER_RATE = 2.0f;				// Share of velocity error corrected per second.
+const UINT DRONE_SEED = 12345;						// Spawn positions, the same every run.
+
+// AI
+// The budget is wall clock time, so how many bots decide each tick, and so the game itself,
+// differs from run to run and machine to machine. Networked and journaled play ignore it.
+const int AI_BUDGET = 500;							// Microseconds of decisions per tick, 0 for no limit.
+const int AI_QUOTA = 0;								// Most bots decided per tick, 0 for no limit.
+const float AI_LOOKAHEAD = 3.0f;					// Longest intercept aimed for, in seconds.
+const float AI_PLANET_MARGIN = 24.0f;				// Clearance bots keep from the planet, in pixels.
+
+// Torpedoes
+const int TORPEDO_CAPACITY = 8192;					// Most torpedoes in flight at once.
+const int TORPEDO_WIDTH = 8;						// Width of torpedo image.
+const int TORPEDO_HEIGHT = 8;						// Height of torpedo image.
+const float TORPEDO_SPEED = 240.0f;					// Pixels per second
+const float TORPEDO_LIFETIME = 2.0f;				// Seconds before a torpedo burns out.
+const float TORPEDO_FIRE_DELAY = .25f;				// Shortest time between shots from one ship.
+
+// Collisions
+const float COLLISION_CELL_SIZE = 32.0f;			// Broadphase grid cell, about one ship across.
+const float DRONE_HIT_PUSH = .5f;					// Share of a torpedo's velocity passed to the drone it hits.
+const int MASK_ROTATIONS = 32;						// Angles ship collision masks are pre-rotated to.
+const float MASK_MIN_SCALE = .5f;					// Range of ship scales given collision masks.
+const float MASK_MAX_SCALE = 1.5f;
+const int MASK_SCALES = 5;							// Ship scales given collision masks, min to max.
+const float SWEEP_STEP = 2.0f;						// Most pixels two objects close on between mask tests along a sweep.
+const int SWEEP_MAX_STEPS = 32;						// Most mask tests of one pair in a tick.
+
+// Gravity
+const float PLANET_GRAVITY = 400000.0f;				// Planet's pull, G times its mass: speeds things up by this / distance^2 per second.
+const float SHIP_GRAVITY = 20000.0f;				// Pull of each body on the others, with mutual gravity on.
+const float DRONE_GRAVITY = 2000.0f;
+const float TORPEDO_GRAVITY = 200.0f;
+const float GRAVITY_SOFTENING = 8.0f;				// Pixels the pull is softened over, so it stays finite close in.
+const float GRAVITY_RANGE = 240.0f;					// Pixels the pull fades out over, at most half the screen height.
+const float SHIP_MAX_DRIFT = 100.0f;				// Fastest gravity can carry a ship, pixels per second.
+
+// Particles
+const int PARTICLE_CAPACITY = 131072;				// Most particles alive at once.
+const float PARTICLE_DRAG = 1.5f;					// Share of a particle's speed lost per second.
+const float PARTICLE_SCALE = .5f;					// Particles are torpedoes drawn at this scale.
+const UINT PARTICLE_SEED = 54321;					// Emission spread, the same every run.
+const float EXHAUST_RATE = 60.0f;					// Particles per second behind a moving ship.
+const float EXHAUST_SPEED = 60.0f;					// Pixels per second, out of the back of the ship.
+const float EXHAUST_SPREAD = 20.0f;					// Most random speed added to each particle.
+const float EXHAUST_LIFETIME = .6f;					// Longest a particle lives, in seconds.
+const COLOR_ARGB EXHAUST_COLOR = SETCOLOR_ARGB(255, 255, 160, 64);
+const int EXPLOSION_PARTICLES = 24;					// Sparks from a torpedo hit.
+const float EXPLOSION_SPEED = 120.0f;
+const float EXPLOSION_LIFETIME = .8f;
+const COLOR_ARGB EXPLOSION_COLOR = SETCOLOR_ARGB(255, 255, 240, 160);
+
+// Networking
+const int NET_INPUT_DELAY = 2;						// Ticks local input waits before use, hiding that much latency.
+const int NET_MAX_ROLLBACK = 30;					// Most ticks predicted ahead of the remote peer's input before stalling.
+const float NET_TEST_LATENCY = 50.0f;				// Loopback test one-way delay, in milliseconds.
+const float NET_TEST_JITTER = 20.0f;				// Most extra delay added at random.
+const float NET_TEST_LOSS = 5.0f;					// Percent of datagrams dropped.
+
+// Diagnostics
+const char FRAME_STATS_FILE[] = "frame_stats.csv";		// Per-phase percentiles, written on exit.
+const char FRAME_SAMPLES_FILE[] = "frame_samples.csv";	// Recent per-phase samples, written on exit.
+const char TRACE_FILE[] = "trace.json";					// Profiler zones in Chrome trace format, written on exit.
+const char FRAME_ARENA_FILE[] = "frame_arena.csv";		// Frame arena high water marks, written on exit.
+const char INPUT_JOURNAL_FILE[] = "input_journal.bin";	// Input and frame times, written on exit when run with -record.
+
 const UCHAR ESC_KEY			= VK_ESCAPE;
 const UCHAR ALT_KEY			= VK_MENU;
 const UCHAR ENTER_KEY		= VK_RETURN;
@@ -67,5 +145,6 @@ const UCHAR SHIP_LEFT_KEY	= VK_LEFT;
 const UCHAR SHIP_RIGHT_KEY	= VK_RIGHT;
 const UCHAR	SHIP_UP_KEY		= VK_UP;
 const UCHAR SHIP_DOWN_KEY	= VK_DOWN;
+const UCHAR SHIP_FIRE_KEY	= VK_SPACE;
 
 #endif
\ No newline at end of file
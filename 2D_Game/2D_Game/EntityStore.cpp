@@ -0,0 +1,240 @@
+#include "EntityStore.h"
+
+#include <string.h>
+
+// Constructor.
+EntityStore::EntityStore()
+{
+
+}
+
+void EntityStore::Reserve(size_t iCount)
+{
+	m_Slots.reserve(iCount);
+	m_FreeSlots.reserve(iCount);
+	m_DenseSlot.reserve(iCount);
+	m_fX.reserve(iCount);
+	m_fY.reserve(iCount);
+	m_fVelocityX.reserve(iCount);
+	m_fVelocityY.reserve(iCount);
+	m_fAngle.reserve(iCount);
+	m_fScale.reserve(iCount);
+	m_fPrevX.reserve(iCount);
+	m_fPrevY.reserve(iCount);
+	m_fPrevAngle.reserve(iCount);
+	m_fPrevScale.reserve(iCount);
+	m_fAnimTimer.reserve(iCount);
+	m_fAimX.reserve(iCount);
+	m_fAimY.reserve(iCount);
+	m_iFrame.reserve(iCount);
+	m_iSheet.reserve(iCount);
+}
+
+void EntityStore::Clear(void)
+{
+	// Keep the slots so handles from before the clear stay stale.
+	for(size_t i = 0; i < m_DenseSlot.size(); ++i)
+	{
+		Slot& slot = m_Slots[m_DenseSlot[i]];
+		slot.iDense = EntityStoreNS::INVALID_INDEX;
+		++slot.iGeneration;
+		m_FreeSlots.push_back(m_DenseSlot[i]);
+	}
+
+	m_DenseSlot.clear();
+	m_fX.clear();
+	m_fY.clear();
+	m_fVelocityX.clear();
+	m_fVelocityY.clear();
+	m_fAngle.clear();
+	m_fScale.clear();
+	m_fPrevX.clear();
+	m_fPrevY.clear();
+	m_fPrevAngle.clear();
+	m_fPrevScale.clear();
+	m_fAnimTimer.clear();
+	m_fAimX.clear();
+	m_fAimY.clear();
+	m_iFrame.clear();
+	m_iSheet.clear();
+}
+
+int EntityStore::AddSheet(const SpriteSheet& sheet)
+{
+	m_Sheets.push_back(sheet);
+	return (int)m_Sheets.size() - 1;
+}
+
+EntityHandle EntityStore::Create(int iSheet, float fX, float fY)
+{
+	uint32_t iSlot;
+	if(m_FreeSlots.empty())
+	{
+		iSlot = (uint32_t)m_Slots.size();
+		Slot slot = { 0, EntityStoreNS::INVALID_INDEX };
+		m_Slots.push_back(slot);
+	}
+	else
+	{
+		iSlot = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+	}
+
+	uint32_t iDense = (uint32_t)m_DenseSlot.size();
+	m_Slots[iSlot].iDense = iDense;
+
+	m_DenseSlot.push_back(iSlot);
+	m_fX.push_back(fX);
+	m_fY.push_back(fY);
+	m_fVelocityX.push_back(0.0f);
+	m_fVelocityY.push_back(0.0f);
+	m_fAngle.push_back(0.0f);
+	m_fScale.push_back(1.0f);
+	m_fPrevX.push_back(fX);
+	m_fPrevY.push_back(fY);
+	m_fPrevAngle.push_back(0.0f);
+	m_fPrevScale.push_back(1.0f);
+	m_fAnimTimer.push_back(0.0f);
+	m_fAimX.push_back(0.0f);
+	m_fAimY.push_back(0.0f);
+	m_iFrame.push_back(m_Sheets[iSheet].iStartFrame);
+	m_iSheet.push_back(iSheet);
+
+	EntityHandle handle = { iSlot, m_Slots[iSlot].iGeneration };
+	return handle;
+}
+
+bool EntityStore::Destroy(EntityHandle handle)
+{
+	if(!IsAlive(handle))
+	{
+		return false;
+	}
+
+	Slot& slot = m_Slots[handle.iSlot];
+	uint32_t iDense = slot.iDense;
+	uint32_t iLast = (uint32_t)m_DenseSlot.size() - 1;
+
+	// Fill the hole with the last entity to keep the arrays packed.
+	if(iDense != iLast)
+	{
+		MoveEntity(iLast, iDense);
+		m_Slots[m_DenseSlot[iDense]].iDense = iDense;
+	}
+
+	m_DenseSlot.pop_back();
+	m_fX.pop_back();
+	m_fY.pop_back();
+	m_fVelocityX.pop_back();
+	m_fVelocityY.pop_back();
+	m_fAngle.pop_back();
+	m_fScale.pop_back();
+	m_fPrevX.pop_back();
+	m_fPrevY.pop_back();
+	m_fPrevAngle.pop_back();
+	m_fPrevScale.pop_back();
+	m_fAnimTimer.pop_back();
+	m_fAimX.pop_back();
+	m_fAimY.pop_back();
+	m_iFrame.pop_back();
+	m_iSheet.pop_back();
+
+	slot.iDense = EntityStoreNS::INVALID_INDEX;
+	++slot.iGeneration;
+	m_FreeSlots.push_back(handle.iSlot);
+	return true;
+}
+
+void EntityStore::MoveEntity(uint32_t iFrom, uint32_t iTo)
+{
+	m_DenseSlot[iTo] = m_DenseSlot[iFrom];
+	m_fX[iTo] = m_fX[iFrom];
+	m_fY[iTo] = m_fY[iFrom];
+	m_fVelocityX[iTo] = m_fVelocityX[iFrom];
+	m_fVelocityY[iTo] = m_fVelocityY[iFrom];
+	m_fAngle[iTo] = m_fAngle[iFrom];
+	m_fScale[iTo] = m_fScale[iFrom];
+	m_fPrevX[iTo] = m_fPrevX[iFrom];
+	m_fPrevY[iTo] = m_fPrevY[iFrom];
+	m_fPrevAngle[iTo] = m_fPrevAngle[iFrom];
+	m_fPrevScale[iTo] = m_fPrevScale[iFrom];
+	m_fAnimTimer[iTo] = m_fAnimTimer[iFrom];
+	m_fAimX[iTo] = m_fAimX[iFrom];
+	m_fAimY[iTo] = m_fAimY[iFrom];
+	m_iFrame[iTo] = m_iFrame[iFrom];
+	m_iSheet[iTo] = m_iSheet[iFrom];
+}
+
+void EntityStore::StorePreviousState(void)
+{
+	size_t iBytes = m_DenseSlot.size() * sizeof(float);
+	if(0 == iBytes)
+	{
+		return;
+	}
+
+	memcpy(m_fPrevX.data(), m_fX.data(), iBytes);
+	memcpy(m_fPrevY.data(), m_fY.data(), iBytes);
+	memcpy(m_fPrevAngle.data(), m_fAngle.data(), iBytes);
+	memcpy(m_fPrevScale.data(), m_fScale.data(), iBytes);
+}
+
+void EntityStore::SaveState(StateBuffer& state) const
+{
+	int iCount = GetCount();
+	state.WriteArray(m_Slots.data(), (int)m_Slots.size());
+	state.WriteArray(m_FreeSlots.data(), (int)m_FreeSlots.size());
+	state.WriteArray(m_DenseSlot.data(), iCount);
+	state.WriteArray(m_fX.data(), iCount);
+	state.WriteArray(m_fY.data(), iCount);
+	state.WriteArray(m_fVelocityX.data(), iCount);
+	state.WriteArray(m_fVelocityY.data(), iCount);
+	state.WriteArray(m_fAngle.data(), iCount);
+	state.WriteArray(m_fScale.data(), iCount);
+	state.WriteArray(m_fPrevX.data(), iCount);
+	state.WriteArray(m_fPrevY.data(), iCount);
+	state.WriteArray(m_fPrevAngle.data(), iCount);
+	state.WriteArray(m_fPrevScale.data(), iCount);
+	state.WriteArray(m_fAnimTimer.data(), iCount);
+	state.WriteArray(m_fAimX.data(), iCount);
+	state.WriteArray(m_fAimY.data(), iCount);
+	state.WriteArray(m_iFrame.data(), iCount);
+	state.WriteArray(m_iSheet.data(), iCount);
+}
+
+bool EntityStore::LoadState(StateBuffer& state)
+{
+	// Ids are 32 bits, so that many is the most a valid state could hold.
+	const int MAX = 0x7FFFFFFF;
+	state.ReadArray(m_Slots, MAX);
+	state.ReadArray(m_FreeSlots, MAX);
+	state.ReadArray(m_DenseSlot, MAX);
+	int iCount = GetCount();
+	state.ReadArray(m_fX, iCount);
+	state.ReadArray(m_fY, iCount);
+	state.ReadArray(m_fVelocityX, iCount);
+	state.ReadArray(m_fVelocityY, iCount);
+	state.ReadArray(m_fAngle, iCount);
+	state.ReadArray(m_fScale, iCount);
+	state.ReadArray(m_fPrevX, iCount);
+	state.ReadArray(m_fPrevY, iCount);
+	state.ReadArray(m_fPrevAngle, iCount);
+	state.ReadArray(m_fPrevScale, iCount);
+	state.ReadArray(m_fAnimTimer, iCount);
+	state.ReadArray(m_fAimX, iCount);
+	state.ReadArray(m_fAimY, iCount);
+	state.ReadArray(m_iFrame, iCount);
+	state.ReadArray(m_iSheet, iCount);
+
+	// Every component array must have come back the same length.
+	bool bGood = state.IsGood() && (int)m_iSheet.size() == iCount;
+	for(int i = 0; bGood && i < iCount; ++i)
+	{
+		bGood = m_iSheet[i] >= 0 && m_iSheet[i] < (int)m_Sheets.size() && m_DenseSlot[i] < m_Slots.size();
+	}
+	if(!bGood)
+	{
+		Clear();
+	}
+	return bGood;
+}
@@ -0,0 +1,165 @@
+#ifndef ENTITY_STORE_H_
+#define ENTITY_STORE_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "StateBuffer.h"
+
+namespace EntityStoreNS
+{
+	const uint32_t INVALID_INDEX = 0xFFFFFFFF;		// Free slot, or no entity.
+}
+
+// EntityHandle: Names one entity for as long as it lives.
+// Destroying the entity bumps its slot's generation, so old handles stop resolving
+// instead of silently pointing at whatever reuses the slot.
+struct EntityHandle
+{
+	uint32_t	iSlot;
+	uint32_t	iGeneration;
+
+	bool operator==(const EntityHandle& other) const { return iSlot == other.iSlot && iGeneration == other.iGeneration; }
+	bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+// SpriteSheet: Texture and frame layout shared by many entities.
+struct SpriteSheet
+{
+	int		iTextureId;			// TextureManager id.
+	int		iWidth;				// Frame size in pixels.
+	int		iHeight;
+	int		iCols;				// Frames per row in the texture.
+	int		iStartFrame;		// Animation range.
+	int		iEndFrame;
+	float	fFrameDelay;		// Seconds per frame.
+	int		iLayout;			// AnimationSystem frame table.
+};
+
+// EntityStore: Sprite entities kept as parallel component arrays.
+// Live entities are packed into [0, GetCount()) so systems loop over plain arrays.
+// Destroy moves the last entity into the hole, so dense indices are only stable
+// between Create and Destroy calls. Hold an EntityHandle to refer to an entity for longer.
+class EntityStore
+{
+private:
+
+	// Handle slot. Points at the entity's dense index while it lives.
+	struct Slot
+	{
+		uint32_t	iGeneration;
+		uint32_t	iDense;
+	};
+
+	std::vector<Slot>			m_Slots;
+	std::vector<uint32_t>		m_FreeSlots;		// Slots to reuse, most recently freed last.
+	std::vector<SpriteSheet>	m_Sheets;
+
+	// Components, indexed by dense index.
+	std::vector<uint32_t>		m_DenseSlot;		// Slot that owns each dense entry.
+	std::vector<float>			m_fX;				// Top left corner, like SpriteData.
+	std::vector<float>			m_fY;
+	std::vector<float>			m_fVelocityX;		// Pixels per second.
+	std::vector<float>			m_fVelocityY;
+	std::vector<float>			m_fAngle;			// Radians.
+	std::vector<float>			m_fScale;
+	std::vector<float>			m_fPrevX;			// State at the start of the tick, for interpolation.
+	std::vector<float>			m_fPrevY;
+	std::vector<float>			m_fPrevAngle;
+	std::vector<float>			m_fPrevScale;
+	std::vector<float>			m_fAnimTimer;
+	std::vector<float>			m_fAimX;			// Velocity the AI last chose, steered toward between decisions.
+	std::vector<float>			m_fAimY;
+	std::vector<int>			m_iFrame;			// Current animation frame.
+	std::vector<int>			m_iSheet;			// Index into m_Sheets.
+
+	// Copy the components of dense entry iFrom over iTo.
+	void MoveEntity(uint32_t iFrom, uint32_t iTo);
+
+public:
+
+	// Constructor.
+	EntityStore();
+
+	// Reserve room for iCount entities so Create doesn't reallocate.
+	void Reserve(size_t iCount);
+
+	// Remove every entity. Outstanding handles become invalid.
+	void Clear(void);
+
+	// Append every entity and handle slot to state, or take them back. Sheets are
+	// configuration and are left alone. Returns false if state was malformed.
+	void SaveState(StateBuffer& state) const;
+	bool LoadState(StateBuffer& state);
+
+	// Register a sprite sheet and return its index.
+	int AddSheet(const SpriteSheet& sheet);
+
+	// Return a registered sprite sheet.
+	const SpriteSheet& GetSheet(int iSheet) const { return m_Sheets[iSheet]; }
+
+	// Create an entity at (fX, fY) drawn from sheet iSheet, at rest, scale 1, first frame.
+	EntityHandle Create(int iSheet, float fX, float fY);
+
+	// Destroy an entity. Returns false if the handle is stale.
+	bool Destroy(EntityHandle handle);
+
+	// Return true while the entity named by handle exists.
+	bool IsAlive(EntityHandle handle) const
+	{
+		return handle.iSlot < m_Slots.size() && m_Slots[handle.iSlot].iGeneration == handle.iGeneration
+			&& m_Slots[handle.iSlot].iDense != EntityStoreNS::INVALID_INDEX;
+	}
+
+	// Return the dense index of an entity, or INVALID_INDEX if the handle is stale.
+	uint32_t GetIndex(EntityHandle handle) const
+	{
+		return IsAlive(handle) ? m_Slots[handle.iSlot].iDense : EntityStoreNS::INVALID_INDEX;
+	}
+
+	// Return the handle of the entity at dense index iIndex.
+	EntityHandle GetHandle(uint32_t iIndex) const
+	{
+		EntityHandle handle = { m_DenseSlot[iIndex], m_Slots[m_DenseSlot[iIndex]].iGeneration };
+		return handle;
+	}
+
+	// Return number of live entities.
+	int GetCount(void) const { return (int)m_DenseSlot.size(); }
+
+	// Save position, angle and scale of every entity for interpolation.
+	void StorePreviousState(void);
+
+	// Component arrays, GetCount() entries each.
+	float* GetX(void) { return m_fX.data(); }
+	float* GetY(void) { return m_fY.data(); }
+	float* GetVelocityX(void) { return m_fVelocityX.data(); }
+	float* GetVelocityY(void) { return m_fVelocityY.data(); }
+	float* GetAngle(void) { return m_fAngle.data(); }
+	float* GetScale(void) { return m_fScale.data(); }
+	float* GetAnimTimer(void) { return m_fAnimTimer.data(); }
+	float* GetAimX(void) { return m_fAimX.data(); }
+	float* GetAimY(void) { return m_fAimY.data(); }
+	int* GetFrame(void) { return m_iFrame.data(); }
+	int* GetSheetIndex(void) { return m_iSheet.data(); }
+	const float* GetX(void) const { return m_fX.data(); }
+	const float* GetY(void) const { return m_fY.data(); }
+	const float* GetVelocityX(void) const { return m_fVelocityX.data(); }
+	const float* GetVelocityY(void) const { return m_fVelocityY.data(); }
+	const float* GetAngle(void) const { return m_fAngle.data(); }
+	const float* GetScale(void) const { return m_fScale.data(); }
+	const float* GetPrevX(void) const { return m_fPrevX.data(); }
+	const float* GetPrevY(void) const { return m_fPrevY.data(); }
+	const float* GetPrevAngle(void) const { return m_fPrevAngle.data(); }
+	const float* GetPrevScale(void) const { return m_fPrevScale.data(); }
+	const float* GetAnimTimer(void) const { return m_fAnimTimer.data(); }
+	const float* GetAimX(void) const { return m_fAimX.data(); }
+	const float* GetAimY(void) const { return m_fAimY.data(); }
+	const int* GetFrame(void) const { return m_iFrame.data(); }
+	const int* GetSheetIndex(void) const { return m_iSheet.data(); }
+};
+
+#endif
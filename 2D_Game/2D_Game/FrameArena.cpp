@@ -0,0 +1,120 @@
+#include "FrameArena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+// Constructor.
+FrameArena::FrameArena()
+	: m_pMemory(nullptr)
+	, m_iCapacity(0)
+	, m_iUsed(0)
+	, m_iOverflowBytes(0)
+	, m_iHighWater(0)
+	, m_iOverflows(0)
+{
+
+}
+
+// Destructor.
+FrameArena::~FrameArena()
+{
+	Reset();
+	free(m_pMemory);
+}
+
+void FrameArena::Initialize(size_t iCapacity)
+{
+	Reset();
+	free(m_pMemory);
+	m_pMemory = nullptr;
+	m_iCapacity = 0;
+
+	if(iCapacity > 0)
+	{
+		m_pMemory = (unsigned char*)malloc(iCapacity);
+		if(nullptr == m_pMemory)
+		{
+			throw std::bad_alloc();
+		}
+		m_iCapacity = iCapacity;
+	}
+
+	m_iHighWater = 0;
+	m_iOverflows = 0;
+	m_Overflow.reserve(16);
+}
+
+void* FrameArena::Allocate(size_t iSize, size_t iAlignment)
+{
+	size_t iStart = (m_iUsed + iAlignment - 1) & ~(iAlignment - 1);
+	if(iStart + iSize <= m_iCapacity)
+	{
+		m_iUsed = iStart + iSize;
+#if FRAME_ARENA_POISON
+		memset(m_pMemory + iStart, FrameArenaNS::POISON_ALLOCATED, iSize);
+#endif
+		return m_pMemory + iStart;
+	}
+
+	// Out of room. Take it from the heap for this frame, Reset makes the block big enough.
+	size_t iPadded = iSize + iAlignment;
+	unsigned char* pBlock = (unsigned char*)malloc(iPadded ? iPadded : 1);
+	if(nullptr == pBlock)
+	{
+		throw std::bad_alloc();
+	}
+	m_Overflow.push_back(pBlock);
+	m_iOverflowBytes += iPadded;
+	++m_iOverflows;
+
+	unsigned char* pAligned = pBlock + ((iAlignment - ((uintptr_t)pBlock & (iAlignment - 1))) & (iAlignment - 1));
+#if FRAME_ARENA_POISON
+	memset(pAligned, FrameArenaNS::POISON_ALLOCATED, iSize);
+#endif
+	return pAligned;
+}
+
+void FrameArena::Reset(void)
+{
+	size_t iFrameBytes = m_iUsed + m_iOverflowBytes;
+	if(iFrameBytes > m_iHighWater)
+	{
+		m_iHighWater = iFrameBytes;
+	}
+
+#if FRAME_ARENA_POISON
+	if(m_pMemory)
+	{
+		memset(m_pMemory, FrameArenaNS::POISON_RELEASED, m_iUsed);
+	}
+#endif
+
+	for(size_t i = 0; i < m_Overflow.size(); ++i)
+	{
+		free(m_Overflow[i]);
+	}
+
+	// Grow once so the frame that overflowed would have fitted.
+	if(!m_Overflow.empty())
+	{
+		size_t iCapacity = m_iCapacity * 2 > m_iHighWater ? m_iCapacity * 2 : m_iHighWater;
+		unsigned char* pMemory = (unsigned char*)malloc(iCapacity);
+		if(pMemory)
+		{
+			free(m_pMemory);
+			m_pMemory = pMemory;
+			m_iCapacity = iCapacity;
+		}
+		m_Overflow.clear();
+	}
+
+	m_iUsed = 0;
+	m_iOverflowBytes = 0;
+}
+
+void FrameArena::WriteReportCSV(FILE* pOut, const char* pName) const
+{
+	fprintf(pOut, "%s,%llu,%llu,%lld\n", pName, (unsigned long long)m_iCapacity,
+		(unsigned long long)m_iHighWater, (long long)m_iOverflows);
+}
@@ -0,0 +1,121 @@
+#ifndef FRAME_ARENA_H_
+#define FRAME_ARENA_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Debug builds fill handed out memory with POISON_ALLOCATED and released memory with
+// POISON_RELEASED, so reads of uninitialized or stale scratch stand out.
+#ifndef FRAME_ARENA_POISON
+#if defined(_DEBUG) || !defined(NDEBUG)
+#define FRAME_ARENA_POISON 1
+#else
+#define FRAME_ARENA_POISON 0
+#endif
+#endif
+
+namespace FrameArenaNS
+{
+	const unsigned char POISON_ALLOCATED = 0xCD;	// Fresh memory, not yet written.
+	const unsigned char POISON_RELEASED = 0xDD;		// Memory from before the last Reset.
+	const size_t DEFAULT_ALIGNMENT = 16;
+}
+
+// FrameArena: Bump allocator for scratch memory that lives until the end of the frame.
+// Allocate moves a pointer through one block; Reset releases everything at once.
+// When a frame needs more than the block holds the extra comes from the heap, and
+// the next Reset grows the block to the high water mark so later frames fit.
+// Not thread safe, each thread needs its own arena.
+class FrameArena
+{
+private:
+
+	unsigned char*		m_pMemory;
+	size_t				m_iCapacity;
+	size_t				m_iUsed;			// Bytes handed out from m_pMemory this frame, padding included.
+	size_t				m_iOverflowBytes;	// Bytes handed out from the heap this frame.
+	size_t				m_iHighWater;		// Most bytes used in one frame since Initialize.
+	int64_t				m_iOverflows;		// Allocations that missed the block since Initialize.
+	std::vector<void*>	m_Overflow;			// Heap blocks to free at Reset.
+
+public:
+
+	// Constructor.
+	FrameArena();
+
+	// Destructor.
+	~FrameArena();
+
+	// Allocate the block. Drops anything allocated before.
+	void Initialize(size_t iCapacity);
+
+	// Return iSize bytes aligned to iAlignment, a power of two. Never returns null.
+	void* Allocate(size_t iSize, size_t iAlignment = FrameArenaNS::DEFAULT_ALIGNMENT);
+
+	// Return uninitialized room for iCount objects of type T.
+	template<typename T>
+	T* AllocateArray(size_t iCount)
+	{
+		return (T*)Allocate(iCount * sizeof(T), alignof(T) > FrameArenaNS::DEFAULT_ALIGNMENT ? alignof(T) : FrameArenaNS::DEFAULT_ALIGNMENT);
+	}
+
+	// Release every allocation. Call once per frame.
+	void Reset(void);
+
+	// Return the size of the block.
+	size_t GetCapacity(void) const { return m_iCapacity; }
+
+	// Return bytes in use this frame.
+	size_t GetUsed(void) const { return m_iUsed + m_iOverflowBytes; }
+
+	// Return the most bytes used in one frame.
+	size_t GetHighWater(void) const { return m_iHighWater; }
+
+	// Return allocations that had to go to the heap.
+	int64_t GetOverflowCount(void) const { return m_iOverflows; }
+
+	// Write a CSV row: name, capacity, high water, overflows.
+	void WriteReportCSV(FILE* pOut, const char* pName) const;
+};
+
+// FrameAllocator: STL allocator that takes memory from a FrameArena.
+// deallocate does nothing, so containers must not outlive the arena's next Reset.
+template<typename T>
+class FrameAllocator
+{
+public:
+
+	typedef T value_type;
+
+	FrameArena*		m_pArena;
+
+	// Constructor.
+	explicit FrameAllocator(FrameArena* pArena) : m_pArena(pArena) {}
+
+	// Rebinding constructor.
+	template<typename U>
+	FrameAllocator(const FrameAllocator<U>& other) : m_pArena(other.m_pArena) {}
+
+	T* allocate(size_t iCount) { return m_pArena->AllocateArray<T>(iCount); }
+
+	void deallocate(T*, size_t) {}
+
+	template<typename U>
+	bool operator==(const FrameAllocator<U>& other) const { return m_pArena == other.m_pArena; }
+
+	template<typename U>
+	bool operator!=(const FrameAllocator<U>& other) const { return m_pArena != other.m_pArena; }
+};
+
+// Containers for frame scratch, e.g. FrameVector<int> list{FrameAllocator<int>(pArena)}.
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T> >;
+
+typedef std::basic_string<char, std::char_traits<char>, FrameAllocator<char> > FrameString;
+
+#endif
@@ -0,0 +1,145 @@
+#include "FramePacer.h"
+
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define PACER_SPIN_PAUSE() _mm_pause()
+#else
+#define PACER_SPIN_PAUSE()
+#endif
+
+// Constructor.
+FramePacer::FramePacer()
+	: m_pClock(nullptr)
+	, m_iPeriod(0)
+	, m_iDeadline(0)
+	, m_dSpinTime(FramePacerNS::INITIAL_SPIN_TIME)
+{
+	ResetStats();
+}
+
+void FramePacer::Initialize(Clock* pClock, float fFrameRate)
+{
+	m_pClock = pClock;
+	SetFrameRate(fFrameRate);
+}
+
+void FramePacer::SetFrameRate(float fFrameRate)
+{
+	m_iPeriod = 0;
+	if(m_pClock && fFrameRate > 0.0f)
+	{
+		m_iPeriod = m_pClock->FromSeconds(1.0 / fFrameRate);
+	}
+
+	Reset();
+}
+
+int64_t FramePacer::Wait(void)
+{
+	if(nullptr == m_pClock)
+	{
+		return 0;
+	}
+
+	int64_t iNow = m_pClock->GetTicks();
+	if(0 == m_iPeriod)
+	{
+		return iNow;
+	}
+
+	// First frame of a schedule starts now.
+	if(0 == m_iDeadline)
+	{
+		m_iDeadline = iNow;
+	}
+
+	// Sleep while the deadline is further away than the spin tail.
+	double dRemaining = m_pClock->ToSeconds(m_iDeadline - iNow);
+	if(dRemaining > m_dSpinTime)
+	{
+		unsigned int uSleepMs = (unsigned int)((dRemaining - m_dSpinTime) * 1000.0);
+		if(uSleepMs > 0)
+		{
+			int64_t iWake = iNow + m_pClock->FromSeconds(uSleepMs * 0.001);
+			m_pClock->SleepMs(uSleepMs);
+			iNow = m_pClock->GetTicks();
+
+			// Grow the spin tail straight away when the scheduler oversleeps,
+			// shrink it slowly when it wakes on time.
+			double dOversleep = m_pClock->ToSeconds(iNow - iWake);
+			if(dOversleep > m_dSpinTime)
+			{
+				m_dSpinTime = dOversleep;
+			}
+			else
+			{
+				m_dSpinTime += (dOversleep - m_dSpinTime) * FramePacerNS::SPIN_DECAY;
+				if(m_dSpinTime < FramePacerNS::MIN_SPIN_TIME)
+				{
+					m_dSpinTime = FramePacerNS::MIN_SPIN_TIME;
+				}
+			}
+		}
+	}
+
+	// Spin out the remainder.
+	while(iNow < m_iDeadline)
+	{
+		PACER_SPIN_PAUSE();
+		iNow = m_pClock->GetTicks();
+	}
+
+	// Record how late this frame started.
+	double dError = m_pClock->ToSeconds(iNow - m_iDeadline);
+	++m_iFrames;
+	m_dErrorSum += dError;
+	m_dErrorSqSum += dError * dError;
+	if(dError > m_dMaxError)
+	{
+		m_dMaxError = dError;
+	}
+
+	// Next deadline is one period after this one, not after now, so error doesn't add up.
+	// If the frame was more than a period late, start a new schedule instead of bursting to catch up.
+	m_iDeadline += m_iPeriod;
+	if(m_iDeadline <= iNow)
+	{
+		++m_iMissed;
+		m_iDeadline = iNow + m_iPeriod;
+	}
+
+	return iNow;
+}
+
+void FramePacer::ResetStats(void)
+{
+	m_iFrames = 0;
+	m_dErrorSum = 0.0;
+	m_dErrorSqSum = 0.0;
+	m_dMaxError = 0.0;
+	m_iMissed = 0;
+}
+
+double FramePacer::GetMeanJitter(void) const
+{
+	if(0 == m_iFrames)
+	{
+		return 0.0;
+	}
+
+	return m_dErrorSum / (double)m_iFrames;
+}
+
+double FramePacer::GetJitterStdDev(void) const
+{
+	if(0 == m_iFrames)
+	{
+		return 0.0;
+	}
+
+	double dMean = GetMeanJitter();
+	double dVariance = m_dErrorSqSum / (double)m_iFrames - dMean * dMean;
+	return (dVariance > 0.0) ? sqrt(dVariance) : 0.0;
+}
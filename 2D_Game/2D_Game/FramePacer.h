@@ -0,0 +1,71 @@
+#ifndef FRAME_PACER_H_
+#define FRAME_PACER_H_
+
+#include "Clock.h"
+
+namespace FramePacerNS
+{
+	const double MIN_SPIN_TIME = 0.0005;		// Shortest tail of a wait that is spun, in seconds.
+	const double INITIAL_SPIN_TIME = 0.002;		// Spin tail used until oversleep has been measured.
+	const double SPIN_DECAY = 0.05;				// How quickly the spin tail shrinks back after a late wake up.
+}
+
+// FramePacer: Holds frames to a fixed rate.
+// Sleeps for the bulk of the wait and spins on the clock for the last fraction.
+// Deadlines advance by exactly one period so rounding error does not accumulate.
+class FramePacer
+{
+private:
+
+	Clock*		m_pClock;			// Time source.
+	int64_t		m_iPeriod;			// Target frame length in ticks, 0 when uncapped.
+	int64_t		m_iDeadline;		// Time the current frame may start.
+	double		m_dSpinTime;		// Tail of each wait spun instead of slept, in seconds.
+
+	// Pacing statistics. Error is how late a frame started compared to its deadline.
+	int64_t		m_iFrames;			// Frames measured.
+	double		m_dErrorSum;		// Sum of errors in seconds.
+	double		m_dErrorSqSum;		// Sum of squared errors.
+	double		m_dMaxError;		// Largest error seen.
+	int64_t		m_iMissed;			// Frames that started more than a period late.
+
+public:
+
+	// Constructor.
+	FramePacer();
+
+	// Set the clock and target rate. A rate of 0 disables pacing.
+	void Initialize(Clock* pClock, float fFrameRate);
+
+	// Change the target frame rate. A rate of 0 disables pacing.
+	void SetFrameRate(float fFrameRate);
+
+	// Block until the next frame deadline. Returns the clock ticks at wake up.
+	int64_t Wait(void);
+
+	// Forget the current deadline, the next Wait() starts a new schedule.
+	void Reset(void) { m_iDeadline = 0; }
+
+	// Clear the pacing statistics.
+	void ResetStats(void);
+
+	// Return number of frames measured.
+	int64_t GetFrameCount(void) const { return m_iFrames; }
+
+	// Return mean lateness in seconds.
+	double GetMeanJitter(void) const;
+
+	// Return standard deviation of lateness in seconds.
+	double GetJitterStdDev(void) const;
+
+	// Return largest lateness in seconds.
+	double GetMaxJitter(void) const { return m_dMaxError; }
+
+	// Return number of frames that missed their deadline by over a period.
+	int64_t GetMissedFrames(void) const { return m_iMissed; }
+
+	// Return the current spin tail in seconds.
+	double GetSpinTime(void) const { return m_dSpinTime; }
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "FrameStats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace FrameStatsNS;
+
+// Constructor.
+TimingHistogram::TimingHistogram()
+{
+	Reset();
+}
+
+// Values below SUB_BUCKET_HALF * 2 map 1:1, larger values keep their top SUB_BUCKET_BITS bits.
+int TimingHistogram::BucketOf(uint64_t iValue)
+{
+	const uint64_t iMaxValue = (1ULL << MAX_VALUE_BITS) - 1;
+	if(iValue > iMaxValue)
+	{
+		iValue = iMaxValue;
+	}
+
+	int iMsb = 0;
+	for(uint64_t v = iValue; v > 1; v >>= 1)
+	{
+		++iMsb;
+	}
+
+	if(iMsb < SUB_BUCKET_BITS)
+	{
+		return (int)iValue;
+	}
+
+	int iShift = iMsb - (SUB_BUCKET_BITS - 1);
+	return iShift * SUB_BUCKET_HALF + (int)(iValue >> iShift);
+}
+
+uint64_t TimingHistogram::BucketUpperBound(int iBucket)
+{
+	if(iBucket < SUB_BUCKET_HALF * 2)
+	{
+		return (uint64_t)iBucket;
+	}
+
+	int iShift = iBucket / SUB_BUCKET_HALF - 1;
+	uint64_t iSub = (uint64_t)(iBucket - iShift * SUB_BUCKET_HALF);
+	return ((iSub + 1) << iShift) - 1;
+}
+
+void TimingHistogram::Add(uint64_t iValue)
+{
+	++m_Counts[BucketOf(iValue)];
+	++m_iTotal;
+	if(iValue > m_iMax)
+	{
+		m_iMax = iValue;
+	}
+}
+
+void TimingHistogram::Remove(uint64_t iValue)
+{
+	int iBucket = BucketOf(iValue);
+	if(m_Counts[iBucket] > 0)
+	{
+		--m_Counts[iBucket];
+		--m_iTotal;
+	}
+}
+
+void TimingHistogram::Reset(void)
+{
+	memset(m_Counts, 0, sizeof(m_Counts));
+	m_iTotal = 0;
+	m_iMax = 0;
+}
+
+uint64_t TimingHistogram::GetPercentile(double dP) const
+{
+	if(0 == m_iTotal)
+	{
+		return 0;
+	}
+
+	// Rank of the wanted sample, 1 based.
+	uint64_t iRank = (uint64_t)(dP / 100.0 * (double)m_iTotal + 0.5);
+	if(iRank < 1)
+	{
+		iRank = 1;
+	}
+
+	uint64_t iSeen = 0;
+	for(int i = 0; i < BUCKET_COUNT; ++i)
+	{
+		iSeen += m_Counts[i];
+		if(iSeen >= iRank)
+		{
+			return BucketUpperBound(i);
+		}
+	}
+
+	return BucketUpperBound(BUCKET_COUNT - 1);
+}
+
+// Constructor.
+FrameStats::FrameStats()
+	: m_pClock(nullptr)
+{
+	Reset();
+}
+
+void FrameStats::Record(PHASE phase, int64_t iTicks)
+{
+	if(nullptr == m_pClock || iTicks < 0)
+	{
+		return;
+	}
+
+	RecordNs(phase, (uint64_t)(m_pClock->ToSeconds(iTicks) * 1e9));
+}
+
+void FrameStats::RecordNs(PHASE phase, uint64_t iNs)
+{
+	PhaseData& data = m_Phases[phase];
+
+	// Evict the oldest sample once the ring is full.
+	if(data.iCount == WINDOW_SIZE)
+	{
+		uint64_t iOld = data.samples[data.iNext];
+		data.window.Remove(iOld);
+		if(iOld >= data.iWindowMax)
+		{
+			data.bMaxDirty = true;
+		}
+	}
+	else
+	{
+		++data.iCount;
+	}
+
+	data.samples[data.iNext] = iNs;
+	data.iNext = (data.iNext + 1) % WINDOW_SIZE;
+	data.window.Add(iNs);
+	data.total.Add(iNs);
+
+	if(iNs >= data.iWindowMax)
+	{
+		data.iWindowMax = iNs;
+		data.bMaxDirty = false;
+	}
+}
+
+void FrameStats::Reset(void)
+{
+	for(int i = 0; i < PHASE_COUNT; ++i)
+	{
+		m_Phases[i].iNext = 0;
+		m_Phases[i].iCount = 0;
+		m_Phases[i].iWindowMax = 0;
+		m_Phases[i].bMaxDirty = false;
+		m_Phases[i].window.Reset();
+		m_Phases[i].total.Reset();
+	}
+}
+
+double FrameStats::GetPercentile(PHASE phase, double dP) const
+{
+	return m_Phases[phase].window.GetPercentile(dP) * 1e-6;
+}
+
+double FrameStats::GetMax(PHASE phase)
+{
+	PhaseData& data = m_Phases[phase];
+
+	// The largest sample was evicted, rescan the ring.
+	if(data.bMaxDirty)
+	{
+		data.iWindowMax = 0;
+		for(int i = 0; i < data.iCount; ++i)
+		{
+			if(data.samples[i] > data.iWindowMax)
+			{
+				data.iWindowMax = data.samples[i];
+			}
+		}
+		data.bMaxDirty = false;
+	}
+
+	return data.iWindowMax * 1e-6;
+}
+
+double FrameStats::GetTotalPercentile(PHASE phase, double dP) const
+{
+	return m_Phases[phase].total.GetPercentile(dP) * 1e-6;
+}
+
+bool FrameStats::WriteSummaryCSV(const char* pFile)
+{
+	FILE* pOut = fopen(pFile, "w");
+	if(nullptr == pOut)
+	{
+		return false;
+	}
+
+	fprintf(pOut, "phase,window_samples,window_p50_ms,window_p95_ms,window_p99_ms,window_max_ms,"
+		"total_samples,total_p50_ms,total_p95_ms,total_p99_ms,total_max_ms\n");
+
+	for(int i = 0; i < PHASE_COUNT; ++i)
+	{
+		PHASE phase = (PHASE)i;
+		fprintf(pOut, "%s,%d,%.4f,%.4f,%.4f,%.4f,%llu,%.4f,%.4f,%.4f,%.4f\n",
+			PHASE_NAMES[i],
+			m_Phases[i].iCount,
+			GetPercentile(phase, 50.0), GetPercentile(phase, 95.0), GetPercentile(phase, 99.0), GetMax(phase),
+			(unsigned long long)m_Phases[i].total.GetCount(),
+			GetTotalPercentile(phase, 50.0), GetTotalPercentile(phase, 95.0), GetTotalPercentile(phase, 99.0),
+			m_Phases[i].total.GetMax() * 1e-6);
+	}
+
+	fclose(pOut);
+	return true;
+}
+
+bool FrameStats::WriteSamplesCSV(const char* pFile) const
+{
+	FILE* pOut = fopen(pFile, "w");
+	if(nullptr == pOut)
+	{
+		return false;
+	}
+
+	fprintf(pOut, "phase,sample,ms\n");
+	for(int i = 0; i < PHASE_COUNT; ++i)
+	{
+		const PhaseData& data = m_Phases[i];
+		int iFirst = (data.iCount == WINDOW_SIZE) ? data.iNext : 0;
+		for(int j = 0; j < data.iCount; ++j)
+		{
+			fprintf(pOut, "%s,%d,%.4f\n", PHASE_NAMES[i], j, data.samples[(iFirst + j) % WINDOW_SIZE] * 1e-6);
+		}
+	}
+
+	fclose(pOut);
+	return true;
+}
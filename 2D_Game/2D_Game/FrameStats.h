@@ -0,0 +1,132 @@
+#ifndef FRAME_STATS_H_
+#define FRAME_STATS_H_
+
+#include <stdint.h>
+
+#include "Clock.h"
+
+namespace FrameStatsNS
+{
+	// Timed phases of the game loop.
+	// Simulation phases are recorded once per tick, the others once per rendered frame.
+	enum PHASE
+	{
+		UPDATE,
+		AI,
+		COLLISIONS,
+		RENDER,			// BeginScene..EndScene
+		PRESENT,		// ShowBackBuffer
+		FRAME,			// Full frame period, including pacing.
+		PHASE_COUNT
+	};
+
+	const char* const PHASE_NAMES[PHASE_COUNT] = { "Update", "AI", "Collisions", "Render", "Present", "Frame" };
+
+	const int WINDOW_SIZE = 1024;			// Samples kept per phase for the sliding window.
+
+	// Histogram layout. Values are nanoseconds.
+	// Each power of two is split into SUB_BUCKET_HALF linear buckets, about 1.5% precision.
+	const int SUB_BUCKET_BITS = 6;
+	const int SUB_BUCKET_HALF = 1 << (SUB_BUCKET_BITS - 1);
+	const int MAX_VALUE_BITS = 40;			// About 18 minutes, larger values are clamped.
+	const int BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 2) * SUB_BUCKET_HALF;
+}
+
+// TimingHistogram: Fixed memory log-linear histogram of durations.
+class TimingHistogram
+{
+private:
+
+	uint32_t	m_Counts[FrameStatsNS::BUCKET_COUNT];	// Samples per bucket.
+	uint64_t	m_iTotal;								// Number of samples.
+	uint64_t	m_iMax;									// Largest sample, exact.
+
+	// Map a value to its bucket.
+	static int BucketOf(uint64_t iValue);
+
+	// Return the largest value that maps to the bucket.
+	static uint64_t BucketUpperBound(int iBucket);
+
+public:
+
+	// Constructor.
+	TimingHistogram();
+
+	// Add a sample in nanoseconds.
+	void Add(uint64_t iValue);
+
+	// Remove a sample previously added.
+	void Remove(uint64_t iValue);
+
+	// Clear all samples.
+	void Reset(void);
+
+	// Return the value at percentile fP (0..100), in nanoseconds.
+	uint64_t GetPercentile(double dP) const;
+
+	// Return number of samples.
+	uint64_t GetCount(void) const { return m_iTotal; }
+
+	// Return largest sample seen since the last Reset, in nanoseconds.
+	uint64_t GetMax(void) const { return m_iMax; }
+};
+
+// FrameStats: Per-phase timing of the game loop.
+// Every phase keeps a ring of its last WINDOW_SIZE samples with a matching histogram for
+// sliding window queries, and a lifetime histogram for the whole session.
+class FrameStats
+{
+private:
+
+	struct PhaseData
+	{
+		uint64_t		samples[FrameStatsNS::WINDOW_SIZE];	// Ring of recent samples in nanoseconds.
+		int				iNext;								// Next ring slot to write.
+		int				iCount;								// Valid samples in the ring.
+		uint64_t		iWindowMax;							// Cached max of the ring.
+		bool			bMaxDirty;							// True when the cached max left the ring.
+		TimingHistogram	window;								// Histogram of the ring contents.
+		TimingHistogram	total;								// Histogram of every sample.
+	};
+
+	const Clock*	m_pClock;									// Converts clock ticks to time.
+	PhaseData		m_Phases[FrameStatsNS::PHASE_COUNT];
+
+public:
+
+	// Constructor.
+	FrameStats();
+
+	// Set the clock used to convert tick counts.
+	void Initialize(const Clock* pClock) { m_pClock = pClock; }
+
+	// Record a phase duration measured in clock ticks.
+	void Record(FrameStatsNS::PHASE phase, int64_t iTicks);
+
+	// Record a phase duration in nanoseconds.
+	void RecordNs(FrameStatsNS::PHASE phase, uint64_t iNs);
+
+	// Clear all samples.
+	void Reset(void);
+
+	// Return the percentile (0..100) of the sliding window in milliseconds.
+	double GetPercentile(FrameStatsNS::PHASE phase, double dP) const;
+
+	// Return the largest sample in the sliding window in milliseconds.
+	double GetMax(FrameStatsNS::PHASE phase);
+
+	// Return the percentile (0..100) over the whole session in milliseconds.
+	double GetTotalPercentile(FrameStatsNS::PHASE phase, double dP) const;
+
+	// Return the number of samples recorded over the whole session.
+	uint64_t GetTotalCount(FrameStatsNS::PHASE phase) const { return m_Phases[phase].total.GetCount(); }
+
+	// Write p50/p95/p99/max per phase, for the window and the session.
+	// Returns false if the file could not be written.
+	bool WriteSummaryCSV(const char* pFile);
+
+	// Write the raw samples of the sliding window, oldest first.
+	bool WriteSamplesCSV(const char* pFile) const;
+};
+
+#endif
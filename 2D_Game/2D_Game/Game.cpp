@@ -1,26 +1,51 @@
 #include "Game.h"
 
+#include <cmath>
+
 // Constructor.
 Game::Game()
-	: m_bPaused(false)
-	, m_pGraphics(nullptr)
+	: m_pGraphics(nullptr)
+	, m_pWindow(nullptr)
+	, m_pInputSource(nullptr)
+	, m_iTickCount(0)
+	, m_iWorkerCount(WORKER_COUNT)
+	, m_fTickTime(TICK_TIME)
+	, m_fAccumulator(0.0f)
+	, m_fInterpolation(0.0f)
+	, m_iMaxTicksPerFrame(MAX_TICKS_PER_FRAME)
+	, m_bPaused(false)
+	, m_iHistoryTicks(0)
+	, m_pNetSession(nullptr)
+	, m_pJournal(nullptr)
+	, m_bResimulating(false)
 	, m_bInitialized(false)
+	, m_bThreaded(false)
+	, m_bSimRunning(false)
+	, m_pSnapshots(nullptr)
+	, m_iDisplayRequest(-1)
 {
 	m_pInput = new Input();
+	m_pClock = &m_HighResClock;
 }
 
 // Destructor.
 Game::~Game()
 {
 	DeleteAll();
+#ifdef _WIN32
 	ShowCursor(true);
+#endif
 }
 
+#ifdef _WIN32
 // Windows message handler.
 LRESULT Game::MessageHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
 	if(m_bInitialized)
 	{
+		// Input is queued with the time it arrived, for the tick that covers that time.
+		int64_t iTime = m_pClock->GetTicks();
+
 		switch(msg)
 		{
 			case WM_DESTROY:
@@ -31,95 +56,85 @@ LRESULT Game::MessageHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			case WM_KEYDOWN:
 			case WM_SYSKEYDOWN:
 				
-				m_pInput->KeyDown(wParam);
+				m_pInput->PostEvent(InputNS::EVENT_KEY_DOWN, (int)wParam, 0, iTime);
 				return 0;
 
 			case WM_KEYUP:
 			case WM_SYSKEYUP:
 
-				m_pInput->KeyUp(wParam);
+				m_pInput->PostEvent(InputNS::EVENT_KEY_UP, (int)wParam, 0, iTime);
 				return 0;
 
 			case WM_CHAR:
 
-				m_pInput->KeyIn(wParam);
+				m_pInput->PostEvent(InputNS::EVENT_KEY_IN, (int)wParam, 0, iTime);
 				return 0;
 
 			case WM_MOUSEMOVE:
 
-				m_pInput->MouseIn(lParam);
+				m_pInput->PostEvent(InputNS::EVENT_MOUSE, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam), iTime);
 				return 0;
 
 			case WM_INPUT:
 
-				m_pInput->MouseRawIn(lParam);
+				m_pInput->PostMouseRawIn(lParam, iTime);
 				return 0;
 
 			case WM_LBUTTONDOWN:
-
-				m_pInput->SetMouseLButton(true);
-				m_pInput->MouseIn(lParam);
-				return 0;
-
 			case WM_LBUTTONUP:
-
-				m_pInput->SetMouseLButton(false);
-				m_pInput->MouseIn(lParam);
-				return 0;
-
 			case WM_MBUTTONDOWN:
-
-				m_pInput->SetMouseMButton(true);
-				m_pInput->MouseIn(lParam);
-				return 0;
-
 			case WM_MBUTTONUP:
-
-				m_pInput->SetMouseMButton(false);
-				m_pInput->MouseIn(lParam);
-				return 0;
-
 			case WM_RBUTTONDOWN:
-
-				m_pInput->SetMouseRButton(true);
-				m_pInput->MouseIn(lParam);
-				return 0;
-
 			case WM_RBUTTONUP:
-
-				m_pInput->SetMouseRButton(false);
-				m_pInput->MouseIn(lParam);
-				return 0;
-
 			case WM_XBUTTONDOWN:
 			case WM_XBUTTONUP:
-				
-				m_pInput->SetMouseXButton(wParam);
-				m_pInput->MouseIn(lParam);
+			{
+				// wParam holds the state of every button after the message.
+				int iButtons = ((wParam & MK_LBUTTON) ? InputNS::BUTTON_LEFT : 0) | ((wParam & MK_MBUTTON) ? InputNS::BUTTON_MIDDLE : 0) |
+					((wParam & MK_RBUTTON) ? InputNS::BUTTON_RIGHT : 0) | ((wParam & MK_XBUTTON1) ? InputNS::BUTTON_X1 : 0) |
+					((wParam & MK_XBUTTON2) ? InputNS::BUTTON_X2 : 0);
+				int iChanged = InputNS::BUTTON_LEFT | InputNS::BUTTON_MIDDLE | InputNS::BUTTON_RIGHT | InputNS::BUTTON_X1 | InputNS::BUTTON_X2;
+				m_pInput->PostEvent(InputNS::EVENT_MOUSE_BUTTONS, iChanged, iButtons, iTime);
+				m_pInput->PostEvent(InputNS::EVENT_MOUSE, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam), iTime);
 				return 0;
+			}
 		}
 	}
 
 	return DefWindowProc(hWnd, msg, wParam, lParam);
 }
+#endif
 
 // Initialize the game.
-void Game::Initialize(HWND hWnd)
+void Game::Initialize(PlatformWindow* pWindow)
 {
-	m_Hwnd = hWnd;
+	m_pWindow = pWindow;
 
 	m_pGraphics = new Graphics;
-	m_pGraphics->Initialize(m_Hwnd, GAME_WIDTH, GAME_HEIGHT, FULLSCREEN);
+	m_pGraphics->Initialize(m_pWindow->GetHandle(), GAME_WIDTH, GAME_HEIGHT, FULLSCREEN);
 
-	m_pInput->Initialize(hWnd, false);
+	m_pInput->Initialize(m_pWindow->GetHandle(), false);
 
 	// Attempt to set high resolution timer.
-	if(QueryPerformanceFrequency(&m_TimeFreq) == false)
+	if(m_HighResClock.Initialize() == false)
 	{
 		throw(GameError(GameErrorNS::FATAL_ERROR, "Error initializing high resolution timer!"));
 	}
 
-	QueryPerformanceCounter(&m_TimeStart);
+	m_Pacer.Initialize(m_pClock, FRAME_RATE);
+	m_FrameStats.Initialize(&m_HighResClock);
+	m_FrameArena.Initialize(FRAME_ARENA_SIZE);
+	m_SimArena.Initialize(FRAME_ARENA_SIZE);
+	m_Jobs.Initialize(m_iWorkerCount);
+	PROFILE_THREAD_NAME("Main");
+	m_iTimeStart = m_pClock->GetTicks();
+	m_iRealTimeStart = m_HighResClock.GetTicks();
+	if(m_pJournal)
+	{
+		m_pJournal->GetSettings().Clear();
+		SaveSettings(m_pJournal->GetSettings());
+		m_pJournal->Begin(m_pClock, m_iTimeStart);
+	}
 
 	m_bInitialized = true;
 }
@@ -127,19 +142,42 @@ void Game::Initialize(HWND hWnd)
 // Render game.
 void Game::RenderGame(void)
 {
+	int64_t iPhaseStart = m_HighResClock.GetTicks();
+
 	// start rendering.
-	if(SUCCEEDED(m_pGraphics->BeginScene()))
 	{
-		Render();
+		PROFILE_SCOPE("Game::Render");
+		if(SUCCEEDED(m_pGraphics->BeginScene()))
+		{
+			if(m_bThreaded)
+			{
+				// Draw the newest finished tick, blended by how far we are past it.
+				const RenderSnapshot& snapshot = m_pSnapshots->Acquire();
+				float fAlpha = (float)m_pClock->ToSeconds(m_pClock->GetTicks() - snapshot.GetPublishTime()) / m_fTickTime;
+				RenderFromSnapshot(snapshot, fAlpha < 1.0f ? fAlpha : 1.0f);
+			}
+			else
+			{
+				Render();
+			}
 
-		// Stop rendering 
-		m_pGraphics->EndScene();
+			// Stop rendering 
+			m_pGraphics->EndScene();
+		}
 	}
 
+	int64_t iPhaseEnd = m_HighResClock.GetTicks();
+	m_FrameStats.Record(FrameStatsNS::RENDER, iPhaseEnd - iPhaseStart);
+
 	HandleLostGraphicsDevice();
 
 	// Display back buffer
-	m_pGraphics->ShowBackBuffer();
+	iPhaseStart = m_HighResClock.GetTicks();
+	{
+		PROFILE_SCOPE("Game::Present");
+		m_pGraphics->ShowBackBuffer();
+	}
+	m_FrameStats.Record(FrameStatsNS::PRESENT, m_HighResClock.GetTicks() - iPhaseStart);
 }
 
 // Handle lost graphics device.
@@ -151,7 +189,7 @@ void Game::HandleLostGraphicsDevice(void)
 		// If the device is lost and not available for reset.
 		if(m_Result == D3DERR_DEVICELOST)
 		{
-			Sleep(100);				// yield CPU time.
+			m_pClock->SleepMs(100);	// yield CPU time.
 			return;
 		}
 		else if(m_Result == D3DERR_DEVICENOTRESET)
@@ -178,27 +216,28 @@ void Game::SetDisplayMode(GraphicsNS::DISPLAY_MODE mode /* = GraphicsNS::TOGGLE
 	ResetAll();
 }
 
-void Game::Run(HWND hWnd)
+void Game::Run(void)
 {
 	if(nullptr == m_pGraphics)
 	{
 		return;
 	}
 
-	// Calculate elapsed time of last frame, save in frameTime;
-	QueryPerformanceCounter(&m_TimeEnd);
-	m_fFrameTime = (float)(m_TimeEnd.QuadPart - m_TimeStart.QuadPart) / (float)(m_TimeFreq.QuadPart);
-
-	// Power saving 
-	if(m_fFrameTime < MIN_FRAME_TIME)
+	// Power saving.
+	// Wait for this frame's deadline, then calculate elapsed time of last frame.
+	int64_t iTimeNow = 0;
 	{
-		m_SleepTime = (DWORD)((MIN_FRAME_TIME - m_fFrameTime) * 1000);
-		timeBeginPeriod(1);
-		Sleep(m_SleepTime);
-		timeEndPeriod(1);
-		return;
+		PROFILE_SCOPE("Game::Pace");
+		iTimeNow = m_Pacer.Wait();
 	}
 
+	PROFILE_SCOPE("Game::Run");
+	m_fFrameTime = (float)m_pClock->ToSeconds(iTimeNow - m_iTimeStart);
+
+	int64_t iRealTimeNow = m_HighResClock.GetTicks();
+	m_FrameStats.Record(FrameStatsNS::FRAME, iRealTimeNow - m_iRealTimeStart);
+	m_iRealTimeStart = iRealTimeNow;
+
 	if(m_fFrameTime > 0.0f)
 	{
 		m_fFPS = (m_fFPS * 0.99f) + (0.01f / m_fFrameTime);
@@ -209,32 +248,353 @@ void Game::Run(HWND hWnd)
 		m_fFrameTime = MAX_FRAME_TIME;
 	}
 
-	m_TimeStart = m_TimeEnd;
+	m_iTimeStart = iTimeNow;
+
+	// Gather input that doesn't come through window messages.
+	if(m_pInputSource)
+	{
+		std::unique_lock<std::mutex> lock(m_SimLock, std::defer_lock);
+		if(m_bThreaded)
+		{
+			lock.lock();
+		}
+
+		m_pInputSource->Poll(m_pInput);
+	}
 
-	// Update game functions.
-	if(!m_bPaused)
+	// Everything recorded since the last frame reached Input before this one's ticks.
+	if(m_pJournal)
 	{
-		Update();
-		AI();
-		Collisions();
+		m_pJournal->RecordFrame(iTimeNow);
+	}
+
+	// Run the simulation in fixed ticks.
+	// Time left over is carried to the next frame and used to interpolate rendering.
+	if(!m_bPaused && !m_bThreaded)
+	{
+		m_fAccumulator += m_fFrameTime;
+
+		// Each tick takes the posted input that arrived before its end, the rest waits.
+		const int64_t iTickLength = m_pClock->FromSeconds(m_fTickTime);
+		int64_t iTickEnd = iTimeNow - m_pClock->FromSeconds(m_fAccumulator);
+
+		int iTicks = 0;
+		while(m_fAccumulator >= m_fTickTime && iTicks < m_iMaxTicksPerFrame)
+		{
+			iTickEnd += iTickLength;
+			m_pInput->ApplyEvents(iTickEnd);
+			RunTick();
+
+			m_fAccumulator -= m_fTickTime;
+			++iTicks;
+		}
+
+		// Too far behind, drop the backlog instead of spiralling.
+		if(m_fAccumulator >= m_fTickTime)
+		{
+			m_fAccumulator = fmodf(m_fAccumulator, m_fTickTime);
+		}
+
+		m_fInterpolation = m_fAccumulator / m_fTickTime;
+	}
+	else if(!m_bThreaded)
+	{
+		m_pInput->ApplyEvents(iTimeNow);
 	}
 
 	RenderGame();
 
+	if(!m_bThreaded)
+	{
+		CheckDisplayKeys();
+
+		// Clear all key presses.
+		m_pInput->Clear(InputNS::KEYS_PRESSED);
+	}
+
+	// Apply a display mode change asked for by the hot keys.
+	int iDisplayRequest = m_iDisplayRequest.exchange(-1);
+	if(iDisplayRequest >= 0)
+	{
+		SetDisplayMode((GraphicsNS::DISPLAY_MODE)iDisplayRequest);
+	}
+
+	// Frame scratch is only good until here.
+	m_FrameArena.Reset();
+}
+
+// Run one simulation tick.
+void Game::RunTick(void)
+{
+	if(m_pNetSession && !SyncNetwork(true))
+	{
+		return;
+	}
+	SimulateTick();
+}
+
+// Exchange input with the remote peer.
+bool Game::SyncNetwork(bool bAdvance)
+{
+	PROFILE_SCOPE("Game::SyncNetwork");
+
+	// Rollback can go back as far as the first tick.
+	if(m_History.GetLatestTick() < 0)
+	{
+		m_HistoryState.Clear();
+		SaveState(m_HistoryState);
+		m_History.Push(m_iTickCount, m_HistoryState);
+	}
+
+	m_pNetSession->Poll();
+	int64_t iRollback = m_pNetSession->TakeRollbackTick();
+	int64_t iTarget = m_iTickCount;
+	if(iRollback >= 0 && iRollback < iTarget)
+	{
+		// Local input isn't simulation state, it carries on from now.
+		int64_t iStart = m_HighResClock.GetTicks();
+		m_LiveInput.Clear();
+		m_pInput->SaveState(m_LiveInput);
+		if(!RollBack(iRollback))
+		{
+			throw(GameError(GameErrorNS::FATAL_ERROR, "Error rolling back past the state history!"));
+		}
+		m_LiveInput.Rewind();
+		m_pInput->LoadState(m_LiveInput);
+
+		m_bResimulating = true;
+		while(m_iTickCount < iTarget)
+		{
+			SimulateTick();
+		}
+		m_bResimulating = false;
+		m_pNetSession->RecordRollback((int)(iTarget - iRollback), m_HighResClock.ToSeconds(m_HighResClock.GetTicks() - iStart));
+	}
+
+	bool bCanAdvance = m_pNetSession->CanAdvance(m_iTickCount);
+	if(bAdvance && bCanAdvance)
+	{
+		m_pNetSession->AddLocalInput(m_iTickCount + m_pNetSession->GetInputDelay(), GetNetInput());
+	}
+	else if(bAdvance)
+	{
+		m_pNetSession->RecordStall();
+	}
+	m_pNetSession->SendInputs();
+	return bCanAdvance;
+}
+
+// Keep the state after each tick far enough back to undo any misprediction.
+void Game::SetNetSession(NetSession* pSession)
+{
+	m_pNetSession = pSession;
+	if(pSession)
+	{
+		SetStateHistory(pSession->GetMaxRollback() + 2);
+	}
+}
+
+// Run Update, AI and Collisions.
+void Game::SimulateTick(void)
+{
+	PROFILE_SCOPE("Game::Tick");
+	StorePreviousState();
+
+	int64_t iPhaseStart = m_HighResClock.GetTicks();
+	m_Animations.Advance(m_fTickTime);
+	Update();
+	int64_t iPhaseEnd = m_HighResClock.GetTicks();
+	m_FrameStats.Record(FrameStatsNS::UPDATE, iPhaseEnd - iPhaseStart);
+
+	iPhaseStart = iPhaseEnd;
+	AI();
+	iPhaseEnd = m_HighResClock.GetTicks();
+	m_FrameStats.Record(FrameStatsNS::AI, iPhaseEnd - iPhaseStart);
+
+	iPhaseStart = iPhaseEnd;
+	Collisions();
+	m_FrameStats.Record(FrameStatsNS::COLLISIONS, m_HighResClock.GetTicks() - iPhaseStart);
+
+	++m_iTickCount;
+
+	if(m_iHistoryTicks > 0)
+	{
+		PROFILE_SCOPE("Game::SaveState");
+		m_HistoryState.Clear();
+		SaveState(m_HistoryState);
+		m_History.Push(m_iTickCount, m_HistoryState);
+	}
+}
+
+// Keep the state after each of the last iTicks ticks.
+void Game::SetStateHistory(int iTicks)
+{
+	m_iHistoryTicks = (iTicks < 0) ? 0 : iTicks;
+	m_History.Initialize(m_iHistoryTicks);
+}
+
+// Go back to the state after tick iTick.
+bool Game::RollBack(int64_t iTick)
+{
+	if(!m_History.Rewind(iTick, m_HistoryState))
+	{
+		return false;
+	}
+	m_HistoryState.Rewind();
+	return LoadState(m_HistoryState);
+}
+
+// Append the settings Game owns.
+void Game::SaveSettings(StateBuffer& settings) const
+{
+	settings.Write(m_fTickTime);
+	settings.Write(m_iMaxTicksPerFrame);
+}
+
+// Take back the settings Game owns.
+bool Game::LoadSettings(StateBuffer& settings)
+{
+	float fTickTime = 0.0f;
+	int iMaxTicks = 0;
+	settings.Read(fTickTime);
+	settings.Read(iMaxTicks);
+	if(!settings.IsGood() || fTickTime <= 0.0f)
+	{
+		return false;
+	}
+	m_fTickTime = fTickTime;
+	m_fAccumulator = 0.0f;
+	SetMaxTicksPerFrame(iMaxTicks);
+	return true;
+}
+
+// Append the state Game owns.
+void Game::SaveState(StateBuffer& state) const
+{
+	int64_t iTickCount = m_iTickCount;
+	state.Write(iTickCount);
+	state.Write(m_bPaused);
+	m_pInput->SaveState(state);
+}
+
+// Take back the state Game owns.
+bool Game::LoadState(StateBuffer& state)
+{
+	int64_t iTickCount = 0;
+	state.Read(iTickCount);
+	state.Read(m_bPaused);
+	m_pInput->LoadState(state);
+	if(!state.IsGood())
+	{
+		return false;
+	}
+	m_iTickCount = iTickCount;
+	return true;
+}
+
+void Game::CheckDisplayKeys(void)
+{
 	// if Alt+Enter toggle fullscreen/window.
 	if(m_pInput->IsKeyDown(ALT_KEY) && m_pInput->WasKeyPressed(ENTER_KEY))
 	{
-		SetDisplayMode(GraphicsNS::TOGGLE);
+		m_iDisplayRequest = GraphicsNS::TOGGLE;
 	}
 
 	// If Esc key is pressed, set window mode.
 	if(m_pInput->IsKeyDown(ESC_KEY))
 	{
-		SetDisplayMode(GraphicsNS::WINDOW);
+		m_iDisplayRequest = GraphicsNS::WINDOW;
+	}
+}
+
+void Game::SetThreaded(bool bThreaded)
+{
+	if(bThreaded == m_bThreaded)
+	{
+		return;
+	}
+
+	if(bThreaded)
+	{
+		if(nullptr == m_pSnapshots)
+		{
+			m_pSnapshots = new TripleBuffer<RenderSnapshot>;
+		}
+
+		// Publish the current state so there is something to draw straight away.
+		RenderSnapshot& snapshot = m_pSnapshots->GetWriteBuffer();
+		snapshot.Begin(m_iTickCount, m_pClock->GetTicks());
+		BuildSnapshot(snapshot);
+		m_pSnapshots->Publish();
+
+		m_bSimRunning = true;
+		m_bThreaded = true;
+		m_SimThread = std::thread(&Game::SimulationLoop, this);
+	}
+	else
+	{
+		m_bSimRunning = false;
+		m_SimThread.join();
+		m_bThreaded = false;
+		m_fAccumulator = 0.0f;
+	}
+}
+
+// Simulation thread.
+// Ticks at the fixed rate, publishing a snapshot after each tick.
+void Game::SimulationLoop(void)
+{
+	PROFILE_THREAD_NAME("Simulation");
+
+	FramePacer pacer;
+	pacer.Initialize(m_pClock, 1.0f / m_fTickTime);
+
+	while(m_bSimRunning)
+	{
+		int64_t iTickEnd = pacer.Wait();
+		if(m_bPaused)
+		{
+			std::lock_guard<std::mutex> lock(m_SimLock);
+			m_pInput->ApplyEvents(iTickEnd);
+			continue;
+		}
+
+		RenderSnapshot& snapshot = m_pSnapshots->GetWriteBuffer();
+		{
+			std::lock_guard<std::mutex> lock(m_SimLock);
+			m_pInput->ApplyEvents(iTickEnd);
+			RunTick();
+			CheckDisplayKeys();
+			m_pInput->Clear(InputNS::KEYS_PRESSED);
+
+			PROFILE_SCOPE("Game::BuildSnapshot");
+			snapshot.Begin(m_iTickCount, m_pClock->GetTicks());
+			BuildSnapshot(snapshot);
+		}
+		m_pSnapshots->Publish();
+		m_SimArena.Reset();
+	}
+}
+
+// Default snapshot rendering, every sprite in one batch.
+void Game::RenderFromSnapshot(const RenderSnapshot& snapshot, float fAlpha)
+{
+	m_pGraphics->SpriteBegin();
+	snapshot.Draw(m_pGraphics, fAlpha, m_SpriteBatch);
+	m_pGraphics->SpriteEnd();
+}
+
+// Set the fixed simulation rate.
+void Game::SetTickRate(float fTicksPerSecond)
+{
+	if(fTicksPerSecond <= 0.0f)
+	{
+		return;
 	}
 
-	// Clear all key presses.
-	m_pInput->Clear(InputNS::KEYS_PRESSED);
+	m_fTickTime = 1.0f / fTicksPerSecond;
+	m_fAccumulator = 0.0f;
+	m_fInterpolation = 0.0f;
 }
 
 void Game::ReleaseAll(void)
@@ -250,6 +610,27 @@ void Game::ResetAll(void)
 // Delete all reserved memory.
 void Game::DeleteAll(void)
 {
+	SetThreaded(false);
+	SAFE_DELETE(m_pSnapshots);
+	m_Jobs.Shutdown();
+
+	// Save frame timing for this session.
+	if(m_bInitialized)
+	{
+		m_FrameStats.WriteSummaryCSV(FRAME_STATS_FILE);
+		m_FrameStats.WriteSamplesCSV(FRAME_SAMPLES_FILE);
+		Profiler::WriteTrace(TRACE_FILE);
+
+		FILE* pOut = fopen(FRAME_ARENA_FILE, "w");
+		if(pOut)
+		{
+			fprintf(pOut, "arena,capacity_bytes,high_water_bytes,overflows\n");
+			m_FrameArena.WriteReportCSV(pOut, "frame");
+			m_SimArena.WriteReportCSV(pOut, "simulation");
+			fclose(pOut);
+		}
+	}
+
 	ReleaseAll();
 	SAFE_DELETE(m_pGraphics);
 	SAFE_DELETE(m_pInput);
@@ -1,12 +1,29 @@
 #ifndef GAME_H_
 #define GAME_H_
 
-#include <windows.h>
-#include <MMSystem.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
+#include "Platform.h"
+#include "PlatformLayer.h"
+#include "AnimationSystem.h"
 #include "Graphics.h"
 #include "Input.h"
 #include "GameError.h"
+#include "Clock.h"
+#include "FramePacer.h"
+#include "FrameArena.h"
+#include "FrameStats.h"
+#include "InputJournal.h"
+#include "JobSystem.h"
+#include "NetSession.h"
+#include "Profiler.h"
+#include "RenderSnapshot.h"
+#include "SpriteTransform.h"
+#include "StateBuffer.h"
+#include "StateHistory.h"
+#include "TripleBuffer.h"
 
 
 class Game
@@ -16,17 +33,63 @@ protected:
 	// Common game properties.
 	Graphics*			m_pGraphics;				// Pointer to game graphics.
 	Input*				m_pInput;					// Pointer to Input manager.
-	HWND				m_Hwnd;						// Handle to the game window.
+	PlatformWindow*		m_pWindow;					// The game window.
+	InputSource*		m_pInputSource;				// Optional input not delivered by window messages.
 	HRESULT				m_Result;					// Standard return type.
-	LARGE_INTEGER		m_TimeStart;				// Performance counter start value.
-	LARGE_INTEGER		m_TimeEnd;					// Performance counter end value.
-	LARGE_INTEGER		m_TimeFreq;					// Performance counter frequency.
+	HighResClock		m_HighResClock;				// High resolution timer, used for all measurements.
+	Clock*				m_pClock;					// Time source that drives the game. m_HighResClock unless replaced.
+	FramePacer			m_Pacer;					// Holds the frame rate to FRAME_RATE.
+	int64_t				m_iTimeStart;				// m_pClock ticks at the start of the last frame.
+	int64_t				m_iRealTimeStart;			// m_HighResClock ticks at the start of the last frame.
+	std::atomic<int64_t> m_iTickCount;				// Simulation ticks run since Initialize.
+	FrameStats			m_FrameStats;				// Per-phase timing of the game loop.
+	FrameArena			m_FrameArena;				// Scratch memory released at the end of Run.
+	FrameArena			m_SimArena;					// Scratch memory for ticks on m_SimThread, released after each tick.
+	AnimationSystem		m_Animations;				// Advances every registered Image once per tick, before Update.
+	SpriteBatch			m_SpriteBatch;				// Scratch batch for drawing many sprites, render thread only.
+	JobSystem			m_Jobs;						// Spreads simulation work across cores.
+	int					m_iWorkerCount;				// Worker threads started by Initialize.
 	float				m_fFrameTime;				// Time required for frames.
 	float				m_fFPS;						// Frames per second.
-	DWORD				m_SleepTime;				// Number of milli-seconds to sleep between frames.
+	float				m_fTickTime;				// Fixed length of one simulation tick.
+	float				m_fAccumulator;				// Elapsed time not yet consumed by simulation ticks.
+	float				m_fInterpolation;			// Fraction (0..1) of a tick between previous and current state.
+	int					m_iMaxTicksPerFrame;		// Maximum catch-up ticks run per rendered frame.
 	bool				m_bPaused;					// True if game is paused.
+	StateHistory		m_History;					// State after each of the last m_iHistoryTicks ticks.
+	StateBuffer			m_HistoryState;				// Scratch for saving into and restoring from m_History.
+	int					m_iHistoryTicks;			// 0 when no history is kept.
+	NetSession*			m_pNetSession;				// Input from a remote peer, nullptr when playing locally.
+	StateBuffer			m_LiveInput;				// Input as it is now, kept through a rollback.
+	InputJournal*		m_pJournal;					// Records input and frame times, if set.
+	bool				m_bResimulating;			// True while SyncNetwork runs ticks again after a rollback.
 	bool				m_bInitialized;		
 
+	// Threaded mode. The simulation runs on m_SimThread and hands RenderSnapshots to the render thread.
+	bool								m_bThreaded;			// True while m_SimThread is running.
+	std::thread							m_SimThread;			// Simulation thread.
+	std::atomic<bool>					m_bSimRunning;			// Cleared to stop m_SimThread.
+	std::mutex							m_SimLock;				// Held by the simulation for a tick, and by anything writing Input.
+	TripleBuffer<RenderSnapshot>*		m_pSnapshots;			// Simulation to render handoff.
+	std::atomic<int>					m_iDisplayRequest;		// Pending GraphicsNS::DISPLAY_MODE, -1 for none.
+
+	// Run one simulation tick, unless networked play has to wait for the remote peer.
+	void RunTick(void);
+
+	// Run Update, AI and Collisions, and keep the state after them.
+	void SimulateTick(void);
+
+	// Exchange input with the remote peer and simulate again from the first mispredicted tick.
+	// If bAdvance, read the local input for the next tick. Returns false if the next tick
+	// would predict the peer too far ahead.
+	bool SyncNetwork(bool bAdvance);
+
+	// Turn display hot keys into a pending display mode change.
+	void CheckDisplayKeys(void);
+
+	// Body of m_SimThread.
+	void SimulationLoop(void);
+
 public:
 
 	// Constructor.
@@ -37,14 +100,46 @@ public:
 
 	// Member functions..
 
+#ifdef _WIN32
 	// Windows message handler.
 	LRESULT MessageHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
+#endif
+
+	// Replace the clock that drives the game. Call before Initialize.
+	// The clock is not owned by Game.
+	void SetClock(Clock* pClock)
+	{
+		m_pClock = pClock ? pClock : &m_HighResClock;
+	}
+
+	// Set an input source polled at the start of every frame. Not owned by Game.
+	void SetInputSource(InputSource* pSource)
+	{
+		m_pInputSource = pSource;
+	}
+
+	// Record every input event and frame time in pJournal from Initialize on, to replay with
+	// JournalPlayer. Threaded mode reads input at times of its own and can't be replayed, and
+	// wall clock time budgets are turned off, as for SetNetSession. Call before Initialize.
+	// The journal is not owned by Game.
+	void SetInputJournal(InputJournal* pJournal)
+	{
+		m_pJournal = pJournal;
+		m_pInput->SetJournal(pJournal);
+	}
+
+	// Set the number of job system worker threads. Call before Initialize.
+	// 0 runs every job on the simulation thread, -1 uses one worker per spare core.
+	void SetWorkerCount(int iWorkers)
+	{
+		m_iWorkerCount = iWorkers;
+	}
 
 	// Initialize the game.
-	virtual void Initialize(HWND hWnd);
+	virtual void Initialize(PlatformWindow* pWindow);
 
-	// Call run repeatedly by the main message loop in WinMain.
-	virtual void Run(HWND);
+	// Call run repeatedly by the main message loop.
+	virtual void Run(void);
 
 	// Called when the graphics device is lost.
 	// Release all reserved video memory so graphics device may be reset.
@@ -77,16 +172,126 @@ public:
 		return m_pInput;
 	}
 
+	// Return per-phase frame timing statistics.
+	FrameStats* GetFrameStats(void)
+	{
+		return &m_FrameStats;
+	}
+
+	// Return scratch memory that lasts until the end of the frame. Main thread only.
+	FrameArena* GetFrameArena(void)
+	{
+		return &m_FrameArena;
+	}
+
+	// Return scratch memory for Update, AI and Collisions. Lasts until the end of the tick's frame.
+	FrameArena* GetTickArena(void)
+	{
+		return m_bThreaded ? &m_SimArena : &m_FrameArena;
+	}
+
+	// Return the job system used by the simulation.
+	JobSystem* GetJobSystem(void)
+	{
+		return &m_Jobs;
+	}
+
+	// Return the frame pacer, for frame rate control and jitter statistics.
+	FramePacer* GetFramePacer(void)
+	{
+		return &m_Pacer;
+	}
+
+	// Set the fixed simulation rate in ticks per second.
+	void SetTickRate(float fTicksPerSecond);
+
+	// Set the maximum simulation ticks run per rendered frame.
+	void SetMaxTicksPerFrame(int iMaxTicks)
+	{
+		m_iMaxTicksPerFrame = (iMaxTicks < 1) ? 1 : iMaxTicks;
+	}
+
+	// Run the simulation on its own thread and render from snapshots, or go back to one thread.
+	// Requires BuildSnapshot. Derived classes must turn threading off in their destructor.
+	void SetThreaded(bool bThreaded);
+
+	// Return true when the simulation runs on its own thread.
+	bool IsThreaded(void) const { return m_bThreaded; }
+
+	// Return true while ticks already shown are run again after a rollback. Effects
+	// that aren't part of saved state shouldn't be advanced or added twice.
+	bool IsResimulating(void) const { return m_bResimulating; }
+
+	// Keep the state after each of the last iTicks simulation ticks, for RollBack. 0 keeps none.
+	void SetStateHistory(int iTicks);
+
+	// Return the kept states.
+	const StateHistory* GetStateHistory(void) const { return &m_History; }
+
+	// Put the simulation back to how it was after tick iTick, dropping the ticks after it
+	// from the history. Returns false, and changes nothing, if the tick isn't kept.
+	bool RollBack(int64_t iTick);
+
+	// Play against a remote peer. Ship input comes from pSession, local input from
+	// GetNetInput, and ticks simulated with mispredicted remote input are rolled back and
+	// run again. The simulation must be deterministic: no wall clock time budgets.
+	// Call before Initialize. The session is not owned by Game.
+	void SetNetSession(NetSession* pSession);
+
+	// Return the network session, nullptr when playing locally.
+	NetSession* GetNetSession(void) { return m_pNetSession; }
+
+	// Exchange input with the remote peer without running a tick.
+	void PollNetwork(void) { if(m_pNetSession) { SyncNetwork(false); } }
+
+	// Return this peer's input for the next tick as NetSessionNS bits.
+	virtual uint8_t GetNetInput(void) { return 0; }
+
+	// Append the settings that shape the simulation to settings, or take them back. Overrides
+	// call these first. Initialize saves them in the input journal, so a replay can be set
+	// up the same. LoadSettings is called before Initialize and returns false if settings
+	// was malformed.
+	virtual void SaveSettings(StateBuffer& settings) const;
+	virtual bool LoadSettings(StateBuffer& settings);
+
+	// Append the simulation state to state: the tick count, pause and input here, the
+	// game's own objects in overrides, which call this first. LoadState takes it back
+	// in the same order and returns false if state was malformed.
+	// Snapshots are plain bytes, so they can be kept, compared or sent as they are.
+	virtual void SaveState(StateBuffer& state) const;
+	virtual bool LoadState(StateBuffer& state);
+
+	// Return number of simulation ticks run so far.
+	int64_t GetTickCount(void) const { return m_iTickCount; }
+
+	// Return the fixed simulation tick length in seconds.
+	float GetTickTime(void) const { return m_fTickTime; }
+
+	// Return the render interpolation factor between previous and current state.
+	float GetInterpolation(void) const { return m_fInterpolation; }
+
 	// Exit the game.
 	void ExitGame(void)
 	{
-		PostMessage(m_Hwnd, WM_DESTROY, 0, 0);
+		m_pWindow->RequestExit();
 	}
 
+	// Called before every simulation tick.
+	// Override to save the state Render interpolates from.
+	virtual void StorePreviousState(void) {}
+
+	// Copy everything Render would draw into snapshot.
+	// Called after each tick on the simulation thread in threaded mode.
+	virtual void BuildSnapshot(RenderSnapshot&) {}
+
+	// Draw a snapshot in threaded mode, fAlpha of the way through its tick.
+	virtual void RenderFromSnapshot(const RenderSnapshot& snapshot, float fAlpha);
+
 	// Pure virtual functions declarations.
 	// These functions must be written in any class that inherits from Game
 
 	// Update game items.
+	// Called at a fixed rate, m_fTickTime seconds per call.
 	virtual void Update(void) = 0;
 
 	// Perform AI
@@ -96,6 +301,7 @@ public:
 	virtual void Collisions(void) = 0;
 
 	// Render graphics.
+	// Use m_fInterpolation to blend previous and current state.
 	// Call m_pGraphics->SpriteBegin();
 	// Draw Sprite
 	// Call m_pGraohics->SpriteEnd();
@@ -55,6 +55,7 @@ public:
 		std::exception::operator =(rhs);
 		this->m_iErrorCode = rhs.m_iErrorCode;
 		this->m_Message = rhs.m_Message;
+		return *this;
 	}
 
 	// Destructor.
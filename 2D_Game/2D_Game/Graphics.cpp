@@ -1,4 +1,10 @@
 #include "Graphics.h"
+#include "Profiler.h"
+#include "SpriteTransform.h"
+
+#ifdef _WIN32
+
+#include <string.h>
 
 Graphics::Graphics()
 	: m_bFullScreen(FALSE)
@@ -113,6 +119,8 @@ void Graphics::InitD3Dpp(void)
 
 HRESULT Graphics::LoadTextures(const char* pFileName, COLOR_ARGB transColor, UINT& iWidth, UINT& iHeight, LP_TEXTURE& texture)
 {
+	PROFILE_SCOPE("Graphics::LoadTextures");
+
 	// Struct for reading file info.
 	D3DXIMAGE_INFO info;
 	m_Result = E_FAIL;
@@ -146,8 +154,97 @@ HRESULT Graphics::LoadTextures(const char* pFileName, COLOR_ARGB transColor, UIN
 	return m_Result;
 }
 
+HRESULT Graphics::DecodeImage(const char* pFileName, COLOR_ARGB transColor, UINT& iWidth, UINT& iHeight, std::vector<COLOR_ARGB>& pixels)
+{
+	PROFILE_SCOPE("Graphics::DecodeImage");
+
+	D3DXIMAGE_INFO info;
+	LP_TEXTURE staging = nullptr;
+
+	if(nullptr == pFileName)
+	{
+		return D3DERR_INVALIDCALL;
+	}
+
+	m_Result = D3DXGetImageInfoFromFile(pFileName, &info);
+	if(D3D_OK != m_Result)
+	{
+		return m_Result;
+	}
+
+	// Let D3DX decode and color key into a lockable system memory texture.
+	m_Result = D3DXCreateTextureFromFileEx(m_Device3D, pFileName, info.Width, info.Height, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_SYSTEMMEM, D3DX_DEFAULT, D3DX_DEFAULT, transColor, &info, nullptr, &staging);
+	if(FAILED(m_Result))
+	{
+		return m_Result;
+	}
+
+	D3DLOCKED_RECT locked;
+	m_Result = staging->LockRect(0, &locked, nullptr, D3DLOCK_READONLY);
+	if(SUCCEEDED(m_Result))
+	{
+		iWidth = info.Width;
+		iHeight = info.Height;
+		pixels.resize(iWidth * iHeight);
+		for(UINT y = 0; y < iHeight; ++y)
+		{
+			memcpy(&pixels[y * iWidth], (const BYTE*)locked.pBits + y * locked.Pitch, iWidth * sizeof(COLOR_ARGB));
+		}
+		staging->UnlockRect(0);
+	}
+
+	SAFE_RELEASE(staging);
+	return m_Result;
+}
+
+HRESULT Graphics::CreateTextureFromPixels(const COLOR_ARGB* pPixels, UINT iWidth, UINT iHeight, LP_TEXTURE& texture)
+{
+	PROFILE_SCOPE("Graphics::CreateTextureFromPixels");
+
+	LP_TEXTURE staging = nullptr;
+	texture = nullptr;
+
+	if(nullptr == pPixels)
+	{
+		return D3DERR_INVALIDCALL;
+	}
+
+	// Default pool textures can't be locked, fill a system memory copy and upload it.
+	m_Result = m_Device3D->CreateTexture(iWidth, iHeight, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_SYSTEMMEM, &staging, nullptr);
+	if(FAILED(m_Result))
+	{
+		return m_Result;
+	}
+
+	D3DLOCKED_RECT locked;
+	m_Result = staging->LockRect(0, &locked, nullptr, 0);
+	if(SUCCEEDED(m_Result))
+	{
+		for(UINT y = 0; y < iHeight; ++y)
+		{
+			memcpy((BYTE*)locked.pBits + y * locked.Pitch, pPixels + y * iWidth, iWidth * sizeof(COLOR_ARGB));
+		}
+		staging->UnlockRect(0);
+
+		m_Result = m_Device3D->CreateTexture(iWidth, iHeight, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &texture, nullptr);
+		if(SUCCEEDED(m_Result))
+		{
+			m_Result = m_Device3D->UpdateTexture(staging, texture);
+			if(FAILED(m_Result))
+			{
+				SAFE_RELEASE(texture);
+			}
+		}
+	}
+
+	SAFE_RELEASE(staging);
+	return m_Result;
+}
+
 void Graphics::DrawSprite(const SpriteData& spriteData, COLOR_ARGB color /* = GraphicsNS::WHITE */)
 {
+	PROFILE_SCOPE("Graphics::DrawSprite");
+
 	if(nullptr == spriteData.texture)
 	{
 		return;
@@ -199,6 +296,33 @@ void Graphics::DrawSprite(const SpriteData& spriteData, COLOR_ARGB color /* = Gr
 	m_Sprite->Draw(spriteData.texture, &spriteData.rect, nullptr, nullptr, color);
 }
 
+void Graphics::DrawSpriteBatch(SpriteBatch& batch)
+{
+	PROFILE_SCOPE("Graphics::DrawSpriteBatch");
+
+	batch.ComputeTransforms();
+
+	D3DXMATRIX matrix;
+	D3DXMatrixIdentity(&matrix);
+	for(int i = 0; i < batch.GetCount(); ++i)
+	{
+		LP_TEXTURE texture = batch.GetTexture(i);
+		if(nullptr == texture)
+		{
+			continue;
+		}
+
+		matrix._11 = batch.GetMatrix(i, SpriteTransformNS::M11);
+		matrix._12 = batch.GetMatrix(i, SpriteTransformNS::M12);
+		matrix._21 = batch.GetMatrix(i, SpriteTransformNS::M21);
+		matrix._22 = batch.GetMatrix(i, SpriteTransformNS::M22);
+		matrix._41 = batch.GetMatrix(i, SpriteTransformNS::DX);
+		matrix._42 = batch.GetMatrix(i, SpriteTransformNS::DY);
+		m_Sprite->SetTransform(&matrix);
+		m_Sprite->Draw(texture, &batch.GetRect(i), nullptr, nullptr, batch.GetColor(i));
+	}
+}
+
 void Graphics::ChangeDisplayMode(GraphicsNS::DISPLAY_MODE mode /* = GraphicsNS::TOGGLE */)
 {
 	try
@@ -314,4 +438,6 @@ HRESULT Graphics::Reset(void)
 	m_Sprite->OnResetDevice();
 
 	return m_Result;
-}
\ No newline at end of file
+}
+
+#endif
@@ -3,6 +3,13 @@
 
 #define WIN32_LEAN_AND_MEAN
 
+#include <vector>
+
+#include "Constants.h"
+#include "GameError.h"
+
+#ifdef _WIN32
+
 #ifdef _DEBUG
 #define D3D_DEBUG_INFO
 #endif
@@ -10,15 +17,38 @@
 #include <d3d9.h>
 #include <d3dx9.h>
 
-#include "Constants.h"
-#include "GameError.h"
-
 // DirectX Pointer types
 #define LP_3DDEVICE LPDIRECT3DDEVICE9
 #define LP_3D		LPDIRECT3D9
 #define LP_TEXTURE	LPDIRECT3DTEXTURE9
 #define LP_SPRITE	LPD3DXSPRITE
 
+#else
+
+// Headless backend. Textures live in system memory and there is no device.
+
+#define D3DCOLOR_ARGB(a,r,g,b)	SETCOLOR_ARGB(a,r,g,b)
+
+#define D3D_OK					S_OK
+#define D3DERR_DEVICELOST		((HRESULT)0x88760868)
+#define D3DERR_DEVICENOTRESET	((HRESULT)0x88760869)
+#define D3DERR_INVALIDCALL		((HRESULT)0x8876086C)
+
+// HeadlessTexture: Texture owned by the headless backend.
+struct HeadlessTexture
+{
+	UINT	iWidth;			// Width in pixels.
+	UINT	iHeight;		// Height in pixels.
+	std::vector<COLOR_ARGB>	pixels;	// Rows packed top to bottom, for SpriteRaster.
+
+	// Free the texture, same contract as IUnknown::Release for SAFE_RELEASE.
+	void Release(void) { delete this; }
+};
+
+#define LP_TEXTURE	HeadlessTexture*
+
+#endif
+
 
 namespace GraphicsNS
 {
@@ -71,16 +101,25 @@ struct SpriteData
 	bool			bFlipVertical;	// True to flip vertical.
 };
 
+class SpriteBatch;
+class SpriteRaster;
+
 class Graphics
 {
 private:
 
+#ifdef _WIN32
 	// DirectX pointers and stuff
 	LP_3D					m_Direct3D;
 	LP_3DDEVICE				m_Device3D;
 	LP_SPRITE				m_Sprite;
 	D3DPRESENT_PARAMETERS	m_D3Dpp;
 	D3DDISPLAYMODE			m_pMode;
+#else
+	static const char*		s_pAssetPath;		// Directory texture file names are relative to.
+	UINT					m_iSpritesDrawn;	// Sprites drawn since the last BeginScene.
+	SpriteRaster*			m_pRaster;			// Back buffer, when rendering in software. Else sprites are only counted.
+#endif
 
 	// Other variables.
 	HRESULT					m_Result;
@@ -90,9 +129,11 @@ private:
 	int						m_iHeight;
 	COLOR_ARGB				m_BackColor;
 
+#ifdef _WIN32
 	// For internal purpose only.
 	// Initialize D3D presentation parameters.
 	void InitD3Dpp(void);
+#endif
 
 public:
 
@@ -113,21 +154,35 @@ public:
 	// Use TextureManager class to load game textures.
 	HRESULT LoadTextures(const char* pFileName, COLOR_ARGB transColor, UINT& iWidth, UINT& iHeight, LP_TEXTURE& texture);
 
+	// Decode an image file into 32 bit ARGB pixels, rows packed top to bottom.
+	// Pixels equal to transColor become transparent black, as in LoadTextures.
+	HRESULT DecodeImage(const char* pFileName, COLOR_ARGB transColor, UINT& iWidth, UINT& iHeight, std::vector<COLOR_ARGB>& pixels);
+
+	// Create a default pool texture from 32 bit ARGB pixels without touching the file system.
+	HRESULT CreateTextureFromPixels(const COLOR_ARGB* pPixels, UINT iWidth, UINT iHeight, LP_TEXTURE& texture);
+
 	// Display back buffer
 	HRESULT ShowBackBuffer(void);
 
+#ifdef _WIN32
 	// Checks if the adapter is compatible with BackBuffer
 	// Width and refresh rate specified in D3Dpp. 
 	bool IsAdapterCompatible(void);
+#endif
 
 	// Draw the sprite described in SpriteData structure.
 	// Color is optional. It is applied as a filter, WHITE is default.
 	// Creates a sprite Begin/End pair.
 	void DrawSprite(const SpriteData& spriteData, COLOR_ARGB color = GraphicsNS::WHITE);
 
+	// Draw every sprite in a batch, in order. Matrices are computed for the whole batch at once.
+	// Call between SpriteBegin and SpriteEnd.
+	void DrawSpriteBatch(SpriteBatch& batch);
+
 
 	void ChangeDisplayMode(GraphicsNS::DISPLAY_MODE mode = GraphicsNS::TOGGLE);
 
+#ifdef _WIN32
 	// Getter functions.
 	LP_3D Get3D(void) const				{ return m_Direct3D; }
 		
@@ -136,6 +191,7 @@ public:
 	LP_SPRITE GetSprite(void) const		{return m_Sprite; }
 
 	HDC Get_DC(void)	const			{ GetDC(m_Hwnd); }
+#endif
 
 	// Test for lost device.
 	HRESULT GetDeviceState(void);
@@ -149,6 +205,11 @@ public:
 		m_BackColor = c;
 	}
 
+	// Return background color.
+	COLOR_ARGB GetBackColor(void) const { return m_BackColor; }
+
+#ifdef _WIN32
+
 	// Clear backbuffer and BeginScene
 	HRESULT BeginScene(void)
 	{
@@ -184,6 +245,31 @@ public:
 	{
 		m_Sprite->End();
 	}
+#else
+	// Clear backbuffer and BeginScene
+	HRESULT BeginScene(void);
+
+	HRESULT EndScene(void);
+
+	void SpriteBegin(void);
+
+	void SpriteEnd(void);
+
+	// Set the directory texture file names are resolved against.
+	static void SetAssetPath(const char* pPath) { s_pAssetPath = pPath; }
+
+	// Return sprites drawn since the last BeginScene.
+	UINT GetSpritesDrawn(void) const { return m_iSpritesDrawn; }
+
+	// Render into a software back buffer the size of the screen, or stop. Off by default.
+	void SetSoftwareRender(bool bEnable);
+
+	// Return the software back buffer, or nullptr when not rendering in software.
+	SpriteRaster* GetRaster(void) const { return m_pRaster; }
+
+	// Write the software back buffer to pFile as PNG.
+	HRESULT SaveBackBuffer(const char* pFile) const;
+#endif
 };
 
 #endif
\ No newline at end of file
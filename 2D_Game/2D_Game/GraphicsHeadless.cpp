@@ -0,0 +1,479 @@
+#include "Graphics.h"
+#include "Profiler.h"
+#include "SpriteRaster.h"
+#include "SpriteTransform.h"
+
+#ifndef _WIN32
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#ifdef SPACEWAR_HAVE_PNG
+#include <png.h>
+#endif
+
+#ifdef SPACEWAR_HAVE_JPEG
+#include <setjmp.h>
+#include <jpeglib.h>
+#endif
+
+namespace
+{
+	// Read a big-endian 16 bit value.
+	UINT ReadBE16(const unsigned char* p)
+	{
+		return ((UINT)p[0] << 8) | (UINT)p[1];
+	}
+
+	// Read a big-endian 32 bit value.
+	UINT ReadBE32(const unsigned char* p)
+	{
+		return ((UINT)p[0] << 24) | ((UINT)p[1] << 16) | ((UINT)p[2] << 8) | (UINT)p[3];
+	}
+
+	// Read width and height from a PNG or JPEG file header.
+	bool ReadImageSize(FILE* pFile, UINT& iWidth, UINT& iHeight)
+	{
+		unsigned char header[24];
+		if(fread(header, 1, 4, pFile) != 4)
+		{
+			return false;
+		}
+
+		// PNG: signature, then the IHDR chunk with width and height.
+		if(0x89 == header[0] && 'P' == header[1] && 'N' == header[2] && 'G' == header[3])
+		{
+			if(fread(header + 4, 1, 20, pFile) != 20)
+			{
+				return false;
+			}
+
+			iWidth = ReadBE32(header + 16);
+			iHeight = ReadBE32(header + 20);
+			return true;
+		}
+
+		// JPEG: walk the markers up to the start of frame.
+		if(0xFF == header[0] && 0xD8 == header[1])
+		{
+			unsigned char marker[2] = { header[2], header[3] };
+			for(;;)
+			{
+				if(marker[0] != 0xFF)
+				{
+					return false;
+				}
+
+				unsigned char length[2];
+				if(fread(length, 1, 2, pFile) != 2)
+				{
+					return false;
+				}
+
+				UINT iLength = ReadBE16(length);
+				bool bStartOfFrame = marker[1] >= 0xC0 && marker[1] <= 0xCF && marker[1] != 0xC4 && marker[1] != 0xC8 && marker[1] != 0xCC;
+				if(bStartOfFrame)
+				{
+					unsigned char frame[5];
+					if(fread(frame, 1, 5, pFile) != 5)
+					{
+						return false;
+					}
+
+					iHeight = ReadBE16(frame + 1);
+					iWidth = ReadBE16(frame + 3);
+					return true;
+				}
+
+				if(iLength < 2 || fseek(pFile, iLength - 2, SEEK_CUR) != 0 || fread(marker, 1, 2, pFile) != 2)
+				{
+					return false;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	// Turn a texture name into a path under the asset directory.
+	// Texture names use Windows separators.
+	std::string ResolveAssetPath(const char* pFileName, const char* pAssetPath)
+	{
+		std::string path = pAssetPath ? std::string(pAssetPath) + "/" : std::string();
+		for(const char* p = pFileName; *p; ++p)
+		{
+			path += ('\\' == *p) ? '/' : *p;
+		}
+
+		return path;
+	}
+
+#ifdef SPACEWAR_HAVE_PNG
+	// Decode a PNG into ARGB. BGRA bytes read as little-endian ARGB words.
+	bool DecodePNG(const char* pPath, UINT& iWidth, UINT& iHeight, std::vector<COLOR_ARGB>& pixels)
+	{
+		png_image image;
+		memset(&image, 0, sizeof(image));
+		image.version = PNG_IMAGE_VERSION;
+		if(!png_image_begin_read_from_file(&image, pPath))
+		{
+			return false;
+		}
+
+		image.format = PNG_FORMAT_BGRA;
+		pixels.resize(image.width * image.height);
+		if(!png_image_finish_read(&image, nullptr, pixels.data(), 0, nullptr))
+		{
+			png_image_free(&image);
+			return false;
+		}
+
+		iWidth = image.width;
+		iHeight = image.height;
+		return true;
+	}
+#endif
+
+#ifdef SPACEWAR_HAVE_JPEG
+	// libjpeg error handler. Jumps back to DecodeJPEG instead of exiting.
+	struct JpegError
+	{
+		jpeg_error_mgr	manager;
+		jmp_buf			jump;
+	};
+
+	void JpegErrorExit(j_common_ptr pInfo)
+	{
+		longjmp(((JpegError*)pInfo->err)->jump, 1);
+	}
+
+	// Decode a JPEG into opaque ARGB.
+	bool DecodeJPEG(FILE* pFile, UINT& iWidth, UINT& iHeight, std::vector<COLOR_ARGB>& pixels)
+	{
+		jpeg_decompress_struct info;
+		JpegError error;
+		std::vector<unsigned char> row;
+
+		info.err = jpeg_std_error(&error.manager);
+		error.manager.error_exit = JpegErrorExit;
+		if(setjmp(error.jump))
+		{
+			jpeg_destroy_decompress(&info);
+			return false;
+		}
+
+		jpeg_create_decompress(&info);
+		jpeg_stdio_src(&info, pFile);
+		jpeg_read_header(&info, TRUE);
+		info.out_color_space = JCS_RGB;
+		jpeg_start_decompress(&info);
+
+		iWidth = info.output_width;
+		iHeight = info.output_height;
+		pixels.resize(iWidth * iHeight);
+		row.resize(iWidth * 3);
+		while(info.output_scanline < info.output_height)
+		{
+			COLOR_ARGB* pOut = &pixels[info.output_scanline * iWidth];
+			JSAMPROW pRow = row.data();
+			jpeg_read_scanlines(&info, &pRow, 1);
+			for(UINT x = 0; x < iWidth; ++x)
+			{
+				pOut[x] = SETCOLOR_ARGB(255, row[x * 3], row[x * 3 + 1], row[x * 3 + 2]);
+			}
+		}
+
+		jpeg_finish_decompress(&info);
+		jpeg_destroy_decompress(&info);
+		return true;
+	}
+#endif
+}
+
+const char* Graphics::s_pAssetPath = nullptr;
+
+Graphics::Graphics()
+	: m_iSpritesDrawn(0)
+	, m_pRaster(nullptr)
+	, m_Hwnd(nullptr)
+	, m_bFullScreen(FALSE)
+	, m_iWidth(GAME_WIDTH)
+	, m_iHeight(GAME_HEIGHT)
+{
+	m_BackColor = GraphicsNS::BACK_COLOR;
+}
+
+Graphics::~Graphics()
+{
+	ReleaseAll();
+}
+
+void Graphics::ReleaseAll()
+{
+	delete m_pRaster;
+	m_pRaster = nullptr;
+}
+
+void Graphics::Initialize(HWND hWnd, int iWidth, int iHeight, bool bFullscreen)
+{
+	m_Hwnd = hWnd;
+	m_iWidth = iWidth;
+	m_iHeight = iHeight;
+	m_bFullScreen = bFullscreen;
+	if(m_pRaster)
+	{
+		m_pRaster->Initialize(m_iWidth, m_iHeight);
+	}
+}
+
+void Graphics::SetSoftwareRender(bool bEnable)
+{
+	if(!bEnable)
+	{
+		delete m_pRaster;
+		m_pRaster = nullptr;
+		return;
+	}
+
+	if(nullptr == m_pRaster)
+	{
+		m_pRaster = new SpriteRaster;
+		m_pRaster->Initialize(m_iWidth, m_iHeight);
+	}
+}
+
+// PNG takes BGRA bytes, which is ARGB read as little-endian words.
+HRESULT Graphics::SaveBackBuffer(const char* pFile) const
+{
+	if(nullptr == m_pRaster || nullptr == pFile)
+	{
+		return D3DERR_INVALIDCALL;
+	}
+
+#ifdef SPACEWAR_HAVE_PNG
+	png_image image;
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	image.width = m_pRaster->GetWidth();
+	image.height = m_pRaster->GetHeight();
+	image.format = PNG_FORMAT_BGRA;
+	if(png_image_write_to_file(&image, pFile, 0, m_pRaster->GetPixels(), 0, nullptr))
+	{
+		return S_OK;
+	}
+#endif
+	return E_FAIL;
+}
+
+HRESULT Graphics::LoadTextures(const char* pFileName, COLOR_ARGB transColor, UINT& iWidth, UINT& iHeight, LP_TEXTURE& texture)
+{
+	PROFILE_SCOPE("Graphics::LoadTextures");
+
+	(void)transColor;
+	if(nullptr == pFileName)
+	{
+		texture = nullptr;
+		return D3DERR_INVALIDCALL;
+	}
+
+	std::string path = ResolveAssetPath(pFileName, s_pAssetPath);
+	FILE* pFile = fopen(path.c_str(), "rb");
+	if(nullptr == pFile)
+	{
+		return E_FAIL;
+	}
+
+	UINT iFileWidth = 0, iFileHeight = 0;
+	bool bRead = ReadImageSize(pFile, iFileWidth, iFileHeight);
+	fclose(pFile);
+	if(!bRead)
+	{
+		return E_FAIL;
+	}
+
+	iWidth = iFileWidth;
+	iHeight = iFileHeight;
+
+	// The pixels are unknown without a decoder. Opaque white still shows where sprites go.
+	texture = new HeadlessTexture;
+	texture->iWidth = iWidth;
+	texture->iHeight = iHeight;
+	texture->pixels.assign((size_t)iWidth * iHeight, GraphicsNS::WHITE);
+	return S_OK;
+}
+
+// Decode with libpng/libjpeg when the build found them. Without them this fails
+// and TextureManager falls back to LoadTextures.
+HRESULT Graphics::DecodeImage(const char* pFileName, COLOR_ARGB transColor, UINT& iWidth, UINT& iHeight, std::vector<COLOR_ARGB>& pixels)
+{
+	PROFILE_SCOPE("Graphics::DecodeImage");
+
+	if(nullptr == pFileName)
+	{
+		return D3DERR_INVALIDCALL;
+	}
+
+	std::string path = ResolveAssetPath(pFileName, s_pAssetPath);
+	FILE* pFile = fopen(path.c_str(), "rb");
+	if(nullptr == pFile)
+	{
+		return E_FAIL;
+	}
+
+	unsigned char signature[2] = { 0, 0 };
+	size_t iRead = fread(signature, 1, 2, pFile);
+	rewind(pFile);
+
+	bool bDecoded = false;
+	if(2 == iRead && 0x89 == signature[0] && 'P' == signature[1])
+	{
+#ifdef SPACEWAR_HAVE_PNG
+		bDecoded = DecodePNG(path.c_str(), iWidth, iHeight, pixels);
+#endif
+	}
+	else if(2 == iRead && 0xFF == signature[0] && 0xD8 == signature[1])
+	{
+#ifdef SPACEWAR_HAVE_JPEG
+		bDecoded = DecodeJPEG(pFile, iWidth, iHeight, pixels);
+#endif
+	}
+	fclose(pFile);
+
+	if(!bDecoded)
+	{
+		return E_FAIL;
+	}
+
+	// Same rule as the D3DX color key: an exact ARGB match becomes transparent black.
+	for(size_t i = 0; i < pixels.size(); ++i)
+	{
+		if(pixels[i] == transColor)
+		{
+			pixels[i] = 0;
+		}
+	}
+
+	return S_OK;
+}
+
+HRESULT Graphics::CreateTextureFromPixels(const COLOR_ARGB* pPixels, UINT iWidth, UINT iHeight, LP_TEXTURE& texture)
+{
+	PROFILE_SCOPE("Graphics::CreateTextureFromPixels");
+
+	if(nullptr == pPixels)
+	{
+		texture = nullptr;
+		return D3DERR_INVALIDCALL;
+	}
+
+	texture = new HeadlessTexture;
+	texture->iWidth = iWidth;
+	texture->iHeight = iHeight;
+	texture->pixels.assign(pPixels, pPixels + (size_t)iWidth * iHeight);
+	return S_OK;
+}
+
+HRESULT Graphics::ShowBackBuffer(void)
+{
+	return S_OK;
+}
+
+void Graphics::DrawSprite(const SpriteData& spriteData, COLOR_ARGB color /* = GraphicsNS::WHITE */)
+{
+	PROFILE_SCOPE("Graphics::DrawSprite");
+
+	if(nullptr == spriteData.texture)
+	{
+		return;
+	}
+
+	++m_iSpritesDrawn;
+	if(m_pRaster)
+	{
+		float matrix[SpriteTransformNS::ELEMENT_COUNT];
+		SpriteTransform::Compute(spriteData, matrix);
+		m_pRaster->Draw(spriteData.texture, spriteData.rect, matrix, color);
+	}
+}
+
+// Matrices are computed as on Direct3D so the cost shows up in headless profiles.
+void Graphics::DrawSpriteBatch(SpriteBatch& batch)
+{
+	PROFILE_SCOPE("Graphics::DrawSpriteBatch");
+
+	batch.ComputeTransforms();
+	for(int i = 0; i < batch.GetCount(); ++i)
+	{
+		if(nullptr == batch.GetTexture(i))
+		{
+			continue;
+		}
+
+		++m_iSpritesDrawn;
+		if(m_pRaster)
+		{
+			float matrix[SpriteTransformNS::ELEMENT_COUNT];
+			for(int e = 0; e < SpriteTransformNS::ELEMENT_COUNT; ++e)
+			{
+				matrix[e] = batch.GetMatrix(i, (SpriteTransformNS::ELEMENT)e);
+			}
+			m_pRaster->Draw(batch.GetTexture(i), batch.GetRect(i), matrix, batch.GetColor(i));
+		}
+	}
+}
+
+void Graphics::ChangeDisplayMode(GraphicsNS::DISPLAY_MODE mode /* = GraphicsNS::TOGGLE */)
+{
+	switch(mode)
+	{
+		case GraphicsNS::FULLSCREEN:
+			m_bFullScreen = true;
+			break;
+
+		case GraphicsNS::WINDOW:
+			m_bFullScreen = false;
+			break;
+
+		default:
+			m_bFullScreen = !m_bFullScreen;
+	}
+}
+
+// Test for lost device. The headless device is never lost.
+HRESULT Graphics::GetDeviceState(void)
+{
+	return S_OK;
+}
+
+HRESULT Graphics::Reset(void)
+{
+	return S_OK;
+}
+
+HRESULT Graphics::BeginScene(void)
+{
+	m_iSpritesDrawn = 0;
+	if(m_pRaster)
+	{
+		m_pRaster->Clear(m_BackColor);
+	}
+	return S_OK;
+}
+
+HRESULT Graphics::EndScene(void)
+{
+	return S_OK;
+}
+
+void Graphics::SpriteBegin(void)
+{
+
+}
+
+void Graphics::SpriteEnd(void)
+{
+
+}
+
+#endif
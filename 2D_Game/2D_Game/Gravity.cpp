@@ -0,0 +1,259 @@
+#include "Gravity.h"
+
+#include <cmath>
+
+namespace
+{
+	// Return a difference of two positions the short way around, given it is within
+	// one and a half periods.
+	inline float WrapDelta(float fDelta, float fPeriod)
+	{
+		float fHalf = fPeriod * .5f;
+		return (fDelta > fHalf) ? fDelta - fPeriod : ((fDelta < -fHalf) ? fDelta + fPeriod : fDelta);
+	}
+
+	// Return a position moved into [0, fPeriod).
+	inline float WrapPosition(float fX, float fPeriod)
+	{
+		fX -= fPeriod * floorf(fX / fPeriod);
+		return (fX >= fPeriod) ? 0.0f : fX;
+	}
+}
+
+// Constructor.
+Gravity::Gravity()
+	: m_fWorldWidth(1.0f)
+	, m_fWorldHeight(1.0f)
+	, m_fSoftening(1.0f)
+	, m_fRange(1.0f)
+	, m_fInverseTheta(1.0f / GravityNS::DEFAULT_THETA)
+{
+}
+
+void Gravity::Initialize(float fWorldWidth, float fWorldHeight, float fSoftening, float fRange)
+{
+	float fHalf = ((fWorldWidth < fWorldHeight) ? fWorldWidth : fWorldHeight) * .5f;
+	fRange = (fRange < fHalf) ? fRange : fHalf;
+	m_fWorldWidth = fWorldWidth;
+	m_fWorldHeight = fWorldHeight;
+	m_fSoftening = fSoftening * fSoftening;
+	m_fRange = fRange * fRange;
+	m_Bodies.clear();
+	m_Nodes.clear();
+}
+
+inline float Gravity::GetPull(float fMass, float fDistance) const
+{
+	// Inverse square, softened, times (1 - (r / range)^2)^2 out to the range.
+	float fInverse = 1.0f / sqrtf(fDistance + m_fSoftening);
+	float fFade = 1.0f - fDistance / m_fRange;
+	fFade = (fFade > 0.0f) ? fFade * fFade : 0.0f;
+	return fMass * fInverse * fInverse * fInverse * fFade;
+}
+
+void Gravity::Build(const float* pX, const float* pY, const float* pMass, int iCount)
+{
+	m_Bodies.resize(iCount);
+	for(int i = 0; i < iCount; ++i)
+	{
+		m_Bodies[i].fX = WrapPosition(pX[i], m_fWorldWidth);
+		m_Bodies[i].fY = WrapPosition(pY[i], m_fWorldHeight);
+		m_Bodies[i].fMass = pMass[i];
+	}
+
+	m_Nodes.resize(1);
+	BuildNode(0, 0, iCount, 0.0f, 0.0f, m_fWorldWidth, m_fWorldHeight, 0);
+}
+
+void Gravity::BuildNode(int iNode, int iBegin, int iEnd, float fLeft, float fTop, float fWidth, float fHeight, int iDepth)
+{
+	float fMass = 0.0f;
+	float fX = 0.0f;
+	float fY = 0.0f;
+	for(int i = iBegin; i < iEnd; ++i)
+	{
+		fMass += m_Bodies[i].fMass;
+		fX += m_Bodies[i].fX * m_Bodies[i].fMass;
+		fY += m_Bodies[i].fY * m_Bodies[i].fMass;
+	}
+
+	// A node never wraps, so its bodies average like any others.
+	Node& node = m_Nodes[iNode];
+	node.fMass = fMass;
+	node.fX = (fMass > 0.0f) ? fX / fMass : fLeft + fWidth * .5f;
+	node.fY = (fMass > 0.0f) ? fY / fMass : fTop + fHeight * .5f;
+	node.fMidX = fLeft + fWidth * .5f;
+	node.fMidY = fTop + fHeight * .5f;
+	node.fHalfWidth = fWidth * .5f;
+	node.fHalfHeight = fHeight * .5f;
+	node.fSize = (fWidth > fHeight) ? fWidth : fHeight;
+	node.fOffset = sqrtf((node.fX - node.fMidX) * (node.fX - node.fMidX) + (node.fY - node.fMidY) * (node.fY - node.fMidY));
+	node.iChild = -1;
+	node.iBegin = iBegin;
+	node.iEnd = iEnd;
+	if(iEnd - iBegin <= GravityNS::LEAF_BODIES || iDepth >= GravityNS::MAX_DEPTH)
+	{
+		return;
+	}
+
+	// Split top from bottom, then each half left from right.
+	float fMidX = fLeft + fWidth * .5f;
+	float fMidY = fTop + fHeight * .5f;
+	int iSplit[5] = { iBegin, 0, 0, 0, iEnd };
+	int iLow = iBegin;
+	int iHigh = iEnd;
+	while(iLow < iHigh)
+	{
+		if(m_Bodies[iLow].fY < fMidY)
+		{
+			++iLow;
+		}
+		else
+		{
+			Body swap = m_Bodies[iLow];
+			m_Bodies[iLow] = m_Bodies[--iHigh];
+			m_Bodies[iHigh] = swap;
+		}
+	}
+	iSplit[2] = iLow;
+
+	for(int iHalf = 0; iHalf < 2; ++iHalf)
+	{
+		iLow = iSplit[iHalf * 2];
+		iHigh = iSplit[iHalf * 2 + 2];
+		while(iLow < iHigh)
+		{
+			if(m_Bodies[iLow].fX < fMidX)
+			{
+				++iLow;
+			}
+			else
+			{
+				Body swap = m_Bodies[iLow];
+				m_Bodies[iLow] = m_Bodies[--iHigh];
+				m_Bodies[iHigh] = swap;
+			}
+		}
+		iSplit[iHalf * 2 + 1] = iLow;
+	}
+
+	// Children are added together, so node is out of date once m_Nodes grows.
+	int iChild = (int)m_Nodes.size();
+	m_Nodes[iNode].iChild = iChild;
+	m_Nodes.resize(iChild + 4);
+	float fHalfWidth = fWidth * .5f;
+	float fHalfHeight = fHeight * .5f;
+	for(int i = 0; i < 4; ++i)
+	{
+		BuildNode(iChild + i, iSplit[i], iSplit[i + 1], fLeft + (i & 1) * fHalfWidth, fTop + (i >> 1) * fHalfHeight,
+			fHalfWidth, fHalfHeight, iDepth + 1);
+	}
+}
+
+void Gravity::GetAcceleration(float fX, float fY, float& fAccelerationX, float& fAccelerationY) const
+{
+	fAccelerationX = 0.0f;
+	fAccelerationY = 0.0f;
+	if(m_Nodes.empty())
+	{
+		return;
+	}
+
+	// Each node opened swaps one entry for four.
+	int iStack[GravityNS::MAX_DEPTH * 3 + 2];
+	int iTop = 0;
+	iStack[iTop++] = 0;
+	while(iTop > 0)
+	{
+		const Node& node = m_Nodes[iStack[--iTop]];
+		if(node.fMass <= 0.0f)
+		{
+			continue;
+		}
+
+		// Skip the node if all of it is out of range.
+		float fNearX = fabsf(WrapDelta(node.fMidX - fX, m_fWorldWidth));
+		float fNearY = fabsf(WrapDelta(node.fMidY - fY, m_fWorldHeight));
+		fNearX = (fNearX > node.fHalfWidth) ? fNearX - node.fHalfWidth : 0.0f;
+		fNearY = (fNearY > node.fHalfHeight) ? fNearY - node.fHalfHeight : 0.0f;
+		if(fNearX * fNearX + fNearY * fNearY >= m_fRange)
+		{
+			continue;
+		}
+
+		float fDX = WrapDelta(node.fX - fX, m_fWorldWidth);
+		float fDY = WrapDelta(node.fY - fY, m_fWorldHeight);
+		float fDistance = fDX * fDX + fDY * fDY;
+		float fOpen = node.fSize * m_fInverseTheta + node.fOffset;
+		if(node.iChild >= 0 && fDistance < fOpen * fOpen)
+		{
+			// Too close for its size, look inside.
+			iStack[iTop++] = node.iChild;
+			iStack[iTop++] = node.iChild + 1;
+			iStack[iTop++] = node.iChild + 2;
+			iStack[iTop++] = node.iChild + 3;
+			continue;
+		}
+
+		if(node.iChild >= 0)
+		{
+			float fPull = GetPull(node.fMass, fDistance);
+			fAccelerationX += fDX * fPull;
+			fAccelerationY += fDY * fPull;
+			continue;
+		}
+
+		// A leaf near enough to matter, take its bodies one by one.
+		for(int i = node.iBegin; i < node.iEnd; ++i)
+		{
+			const Body& body = m_Bodies[i];
+			fDX = WrapDelta(body.fX - fX, m_fWorldWidth);
+			fDY = WrapDelta(body.fY - fY, m_fWorldHeight);
+			float fPull = GetPull(body.fMass, fDX * fDX + fDY * fDY);
+			fAccelerationX += fDX * fPull;
+			fAccelerationY += fDY * fPull;
+		}
+	}
+}
+
+void Gravity::Accelerate(const float* pX, const float* pY, float fOffsetX, float fOffsetY, int iCount,
+	float* pVelocityX, float* pVelocityY, float fTime) const
+{
+	for(int i = 0; i < iCount; ++i)
+	{
+		float fAccelerationX, fAccelerationY;
+		GetAcceleration(pX[i] + fOffsetX, pY[i] + fOffsetY, fAccelerationX, fAccelerationY);
+		pVelocityX[i] += fAccelerationX * fTime;
+		pVelocityY[i] += fAccelerationY * fTime;
+	}
+}
+
+void Gravity::PullToward(float fMassX, float fMassY, float fMass, const float* pX, const float* pY, float fOffsetX, float fOffsetY,
+	int iCount, float* pVelocityX, float* pVelocityY, float fTime) const
+{
+	// Selects rather than branches, so the loop vectorizes.
+	fMass *= fTime;
+	for(int i = 0; i < iCount; ++i)
+	{
+		float fDX = WrapDelta(fMassX - fOffsetX - pX[i], m_fWorldWidth);
+		float fDY = WrapDelta(fMassY - fOffsetY - pY[i], m_fWorldHeight);
+		float fScale = GetPull(fMass, fDX * fDX + fDY * fDY);
+		pVelocityX[i] += fDX * fScale;
+		pVelocityY[i] += fDY * fScale;
+	}
+}
+
+void Gravity::GetAccelerationDirect(float fX, float fY, float& fAccelerationX, float& fAccelerationY) const
+{
+	fAccelerationX = 0.0f;
+	fAccelerationY = 0.0f;
+	for(size_t i = 0; i < m_Bodies.size(); ++i)
+	{
+		const Body& body = m_Bodies[i];
+		float fDX = WrapDelta(body.fX - fX, m_fWorldWidth);
+		float fDY = WrapDelta(body.fY - fY, m_fWorldHeight);
+		float fPull = GetPull(body.fMass, fDX * fDX + fDY * fDY);
+		fAccelerationX += fDX * fPull;
+		fAccelerationY += fDY * fPull;
+	}
+}
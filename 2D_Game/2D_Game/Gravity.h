@@ -0,0 +1,107 @@
+#ifndef GRAVITY_H_
+#define GRAVITY_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <vector>
+
+namespace GravityNS
+{
+	const float DEFAULT_THETA = .5f;		// Opening angle: a node this wide per unit of distance counts as one body.
+	const int LEAF_BODIES = 8;				// Most bodies in a node before it splits.
+	const int MAX_DEPTH = 20;				// Deepest split, so bodies piled on one spot still end in a leaf.
+}
+
+// Gravity: Pulls bodies toward point masses in a world that wraps at its edges.
+// Masses are G times the mass, so a body at distance r from mass m speeds up by
+// m / r^2 pixels per second per second. Softening adds a minimum distance so the
+// pull stays finite close in, and a body exerts no pull on itself. The pull fades
+// smoothly to nothing at a range of at most half the world, so a mass halfway around
+// doesn't pull one way and then, a pixel later, the other.
+// Mutual attraction uses a Barnes-Hut quadtree: Build sorts the bodies into it, and
+// a node far enough away for its size is taken as one body at its center of mass,
+// so pulling n bodies costs O(n log n). Far enough is size / theta plus however far
+// the center of mass is off the middle of the node, which keeps lopsided nodes, like
+// one holding a clump near a corner, from being taken whole by bodies just outside.
+// Nodes wholly out of range are skipped. One reaching halfway around the world from a
+// body is taken whole like any other: its bodies are near the end of the range, where
+// the pull has all but faded.
+class Gravity
+{
+private:
+
+	float					m_fWorldWidth;		// Wrap period.
+	float					m_fWorldHeight;
+	float					m_fSoftening;		// Squared.
+	float					m_fRange;			// Squared.
+	float					m_fInverseTheta;
+
+	// A body as Build saw it, moved into the world.
+	struct Body
+	{
+		float	fX;
+		float	fY;
+		float	fMass;
+	};
+	std::vector<Body>		m_Bodies;			// In tree order, so each node's bodies are contiguous.
+
+	// A square or rectangular region of the world and the bodies in it.
+	struct Node
+	{
+		float	fX;					// Center of mass.
+		float	fY;
+		float	fMass;
+		float	fMidX;				// Middle of the region.
+		float	fMidY;
+		float	fHalfWidth;
+		float	fHalfHeight;
+		float	fSize;				// Longer side.
+		float	fOffset;			// From the middle to the center of mass.
+		int		iChild;				// First of four children, -1 for a leaf.
+		int		iBegin;				// Bodies in m_Bodies.
+		int		iEnd;
+	};
+	std::vector<Node>		m_Nodes;			// Root first.
+
+	// Return the pull of mass fMass at squared distance fDistance, per pixel of offset.
+	float GetPull(float fMass, float fDistance) const;
+
+	// Fill in node iNode for bodies iBegin..iEnd inside the given rectangle, splitting it if it holds too many.
+	void BuildNode(int iNode, int iBegin, int iEnd, float fLeft, float fTop, float fWidth, float fHeight, int iDepth);
+
+public:
+
+	// Constructor.
+	Gravity();
+
+	// Set the world size, which positions wrap at, the softening distance, and the range
+	// the pull fades out over, in pixels. The range is cut to half the narrower side.
+	void Initialize(float fWorldWidth, float fWorldHeight, float fSoftening, float fRange);
+
+	// Set the opening angle. 0 opens every node and matches summing every body.
+	void SetTheta(float fTheta) { m_fInverseTheta = (fTheta > 0.0f) ? 1.0f / fTheta : 1e30f; }
+
+	// Sort iCount bodies into the quadtree. The positions and masses are copied.
+	void Build(const float* pX, const float* pY, const float* pMass, int iCount);
+
+	// Return the number of bodies and nodes in the tree.
+	int GetBodyCount(void) const { return (int)m_Bodies.size(); }
+	int GetNodeCount(void) const { return (int)m_Nodes.size(); }
+
+	// Work out the pull of the tree's bodies on a point.
+	void GetAcceleration(float fX, float fY, float& fAccelerationX, float& fAccelerationY) const;
+
+	// Speed up iCount bodies at (pX[i] + fOffsetX, pY[i] + fOffsetY) toward the tree's bodies for fTime seconds.
+	void Accelerate(const float* pX, const float* pY, float fOffsetX, float fOffsetY, int iCount,
+		float* pVelocityX, float* pVelocityY, float fTime) const;
+
+	// Speed up iCount bodies toward one mass at (fMassX, fMassY) for fTime seconds.
+	void PullToward(float fMassX, float fMassY, float fMass, const float* pX, const float* pY, float fOffsetX, float fOffsetY,
+		int iCount, float* pVelocityX, float* pVelocityY, float fTime) const;
+
+	// Work out the pull of every body in the tree on a point by summing them one by one.
+	// The reference for testing GetAcceleration.
+	void GetAccelerationDirect(float fX, float fY, float& fAccelerationX, float& fAccelerationY) const;
+};
+
+#endif
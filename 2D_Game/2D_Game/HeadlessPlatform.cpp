@@ -0,0 +1,48 @@
+#include "HeadlessPlatform.h"
+#include "Input.h"
+
+// Constructor.
+ScriptedInputSource::ScriptedInputSource(uint32_t iSeed /* = 1 */, int iHoldFrames /* = 30 */)
+	: m_iSeed(iSeed ? iSeed : 1)
+	, m_iHoldFrames(iHoldFrames > 0 ? iHoldFrames : 1)
+	, m_iFrame(0)
+	, m_iHeldCount(0)
+{
+
+}
+
+// xorshift32.
+uint32_t ScriptedInputSource::NextRandom(void)
+{
+	m_iSeed ^= m_iSeed << 13;
+	m_iSeed ^= m_iSeed >> 17;
+	m_iSeed ^= m_iSeed << 5;
+	return m_iSeed;
+}
+
+void ScriptedInputSource::Poll(Input* pInput)
+{
+	if(m_iFrame++ % m_iHoldFrames != 0)
+	{
+		return;
+	}
+
+	// Release the previous combination.
+	for(int i = 0; i < m_iHeldCount; ++i)
+	{
+		pInput->KeyUp(m_HeldKeys[i]);
+	}
+	m_iHeldCount = 0;
+
+	// Press a new one, each ship key held with even odds.
+	const UCHAR keys[4] = { SHIP_LEFT_KEY, SHIP_RIGHT_KEY, SHIP_UP_KEY, SHIP_DOWN_KEY };
+	uint32_t iBits = NextRandom();
+	for(int i = 0; i < 4; ++i)
+	{
+		if(iBits & (1u << i))
+		{
+			m_HeldKeys[m_iHeldCount++] = keys[i];
+			pInput->KeyDown(keys[i]);
+		}
+	}
+}
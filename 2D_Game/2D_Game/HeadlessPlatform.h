@@ -0,0 +1,73 @@
+#ifndef HEADLESS_PLATFORM_H_
+#define HEADLESS_PLATFORM_H_
+
+#include "PlatformLayer.h"
+#include "Clock.h"
+
+// HeadlessWindow: Stand-in window for running without a display.
+class HeadlessWindow : public PlatformWindow
+{
+private:
+
+	bool	m_bExitRequested;		// True once RequestExit has been called.
+
+public:
+
+	// Constructor.
+	HeadlessWindow() : m_bExitRequested(false) {}
+
+	virtual HWND GetHandle(void) const { return nullptr; }
+
+	virtual bool ProcessMessages(void) { return !m_bExitRequested; }
+
+	virtual void RequestExit(void) { m_bExitRequested = true; }
+};
+
+// ManualClock: Clock that only moves when told to.
+// Lets the simulation run at any speed with exact, repeatable frame times.
+class ManualClock : public Clock
+{
+private:
+
+	int64_t		m_iNow;			// Current time in nanoseconds.
+
+public:
+
+	// Constructor.
+	ManualClock() : m_iNow(0) {}
+
+	virtual int64_t GetTicks(void) const { return m_iNow; }
+
+	virtual int64_t GetFrequency(void) const { return 1000000000; }
+
+	// Sleeping just moves time forward.
+	virtual void SleepMs(unsigned int uMilliseconds) { m_iNow += (int64_t)uMilliseconds * 1000000; }
+
+	// Move time forward by iTicks nanoseconds.
+	void Advance(int64_t iTicks) { m_iNow += iTicks; }
+};
+
+// ScriptedInputSource: Repeatable pseudo-random ship controls.
+// Holds a random combination of the ship keys for a few frames at a time.
+class ScriptedInputSource : public InputSource
+{
+private:
+
+	uint32_t	m_iSeed;			// Random state.
+	int			m_iHoldFrames;		// Frames each combination is held for.
+	int			m_iFrame;			// Frames polled so far.
+	UCHAR		m_HeldKeys[4];		// Keys currently held down.
+	int			m_iHeldCount;		// Number of entries in m_HeldKeys.
+
+	// Return the next pseudo-random number.
+	uint32_t NextRandom(void);
+
+public:
+
+	// Constructor.
+	ScriptedInputSource(uint32_t iSeed = 1, int iHoldFrames = 30);
+
+	virtual void Poll(Input* pInput);
+};
+
+#endif
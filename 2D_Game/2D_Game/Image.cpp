@@ -1,15 +1,24 @@
 #include "Image.h"
+#include "Profiler.h"
+
+#include <cmath>
 
 // Constructor.
 Image::Image()
 	: m_bInitialized(false)
 	, m_iCols(1)
 	, m_pTextureManager(nullptr)
+	, m_pAnimations(nullptr)
+	, m_iAnimTrack(AnimationSystemNS::INVALID_TRACK)
 	, m_iStartFrame(0)
 	, m_iEndFrame(0)
 	, m_iCurrentFrame(0)
 	, m_fFrameDelay(1.0f)			// Default to 1 second per frame of animation
 	, m_fAnimTimer(0.0f)
+	, m_fPrevX(0.0f)
+	, m_fPrevY(0.0f)
+	, m_fPrevAngle(0.0f)
+	, m_fPrevScale(1.0f)
 	, m_bVisible(true)
 	, m_bLoop(true)
 	, m_bAnimComplete(false)
@@ -34,7 +43,7 @@ Image::Image()
 // Destructor
 Image::~Image()
 {
-
+	SetAnimationSystem(nullptr);
 }
 
 // Initialize the image.
@@ -117,8 +126,64 @@ void Image::Draw(SpriteData sd, COLOR_ARGB color /* = GraphicsNS::WHITE */)
 	}
 }
 
+void Image::StorePreviousState(void)
+{
+	m_fPrevX = m_SpriteData.fX;
+	m_fPrevY = m_SpriteData.fY;
+	m_fPrevAngle = m_SpriteData.fAngle;
+	m_fPrevScale = m_SpriteData.fScale;
+}
+
+void Image::DrawInterpolated(float fAlpha, COLOR_ARGB color /* = GraphicsNS::WHITE */)
+{
+	SpriteData sd = m_SpriteData;
+
+	// Don't blend across a screen wrap or a reset, the sprite would sweep across the screen.
+	if(fabsf(sd.fX - m_fPrevX) < GAME_WIDTH * .5f && fabsf(sd.fY - m_fPrevY) < GAME_HEIGHT * .5f)
+	{
+		sd.fX = m_fPrevX + (sd.fX - m_fPrevX) * fAlpha;
+		sd.fY = m_fPrevY + (sd.fY - m_fPrevY) * fAlpha;
+		sd.fAngle = m_fPrevAngle + (sd.fAngle - m_fPrevAngle) * fAlpha;
+		sd.fScale = m_fPrevScale + (sd.fScale - m_fPrevScale) * fAlpha;
+	}
+
+	Draw(sd, color);
+}
+
+void Image::AddToSnapshot(RenderSnapshot& snapshot, COLOR_ARGB color /* = GraphicsNS::WHITE */) const
+{
+	if(!m_bVisible || nullptr == m_pTextureManager)
+	{
+		return;
+	}
+
+	SpriteSnapshot& sprite = snapshot.AddSprite();
+	sprite.fX = m_SpriteData.fX;
+	sprite.fY = m_SpriteData.fY;
+	sprite.fScale = m_SpriteData.fScale;
+	sprite.fAngle = m_SpriteData.fAngle;
+	sprite.fPrevX = m_fPrevX;
+	sprite.fPrevY = m_fPrevY;
+	sprite.fPrevScale = m_fPrevScale;
+	sprite.fPrevAngle = m_fPrevAngle;
+	sprite.iWidth = m_SpriteData.iWidth;
+	sprite.iHeight = m_SpriteData.iHeight;
+	sprite.rect = m_SpriteData.rect;
+	sprite.iTextureId = m_pTextureManager->GetId();
+	sprite.color = (GraphicsNS::FILTER == color) ? m_ColorFilter : color;
+	sprite.bFlipHorizontal = m_SpriteData.bFlipHorizontal;
+	sprite.bFlipVertical = m_SpriteData.bFlipVertical;
+}
+
 void Image::Update(float fFrameTime)
 {
+	PROFILE_SCOPE("Image::Update");
+
+	if(m_pAnimations)
+	{
+		return;
+	}
+
 	if(m_iEndFrame - m_iStartFrame > 0)			// If animated spite.
 	{
 		m_fAnimTimer += fFrameTime;
@@ -149,15 +214,125 @@ void Image::SetCurrentFrame(int iFrame)
 	{
 		m_iCurrentFrame = iFrame;
 		m_bAnimComplete = false;
+		if(m_pAnimations)
+		{
+			m_pAnimations->SetFrame(m_iAnimTrack, iFrame);
+		}
 		SetRect();
 	}
 }
 
+void Image::SetAnimationComplete(bool bComp)
+{
+	m_bAnimComplete = bComp;
+	if(m_pAnimations)
+	{
+		m_pAnimations->SetComplete(m_iAnimTrack, bComp);
+	}
+}
+
+void Image::SetAnimationSystem(AnimationSystem* pAnimations)
+{
+	if(m_pAnimations)
+	{
+		// Carry on from where the track got to.
+		m_iCurrentFrame = m_pAnimations->GetFrame(m_iAnimTrack);
+		m_bAnimComplete = m_pAnimations->IsComplete(m_iAnimTrack);
+		m_pAnimations->RemoveTrack(m_iAnimTrack);
+		m_iAnimTrack = AnimationSystemNS::INVALID_TRACK;
+	}
+
+	m_pAnimations = pAnimations;
+	if(m_pAnimations)
+	{
+		m_iAnimTrack = m_pAnimations->AddTrack(0, &m_SpriteData.rect);
+		SyncAnimation();
+		m_pAnimations->SetFrame(m_iAnimTrack, m_iCurrentFrame);
+		m_pAnimations->SetComplete(m_iAnimTrack, m_bAnimComplete);
+	}
+}
+
+// Give the track a frame table covering the texture and the animation range.
+// The current frame and timer are left alone.
+void Image::SyncAnimation(void)
+{
+	if(nullptr == m_pAnimations)
+	{
+		return;
+	}
+
+	int iFrameCount = m_iEndFrame + 1;
+	if(m_pTextureManager && m_SpriteData.iHeight > 0)
+	{
+		int iTextureFrames = m_iCols * (int)(m_pTextureManager->GetHeight() / m_SpriteData.iHeight);
+		iFrameCount = iTextureFrames > iFrameCount ? iTextureFrames : iFrameCount;
+	}
+
+	m_pAnimations->SetLayout(m_iAnimTrack, m_pAnimations->GetLayout(m_SpriteData.iWidth, m_SpriteData.iHeight, m_iCols, iFrameCount));
+	m_pAnimations->SetAnimation(m_iAnimTrack, m_iStartFrame, m_iEndFrame, m_fFrameDelay, m_bLoop);
+}
+
 // Set m_SpriteData.rect to draw CurrentFrame.
 inline void Image::SetRect(void)
 {
+	if(m_pAnimations)
+	{
+		m_SpriteData.rect = m_pAnimations->GetRect(m_iAnimTrack);
+		return;
+	}
+
 	m_SpriteData.rect.left = (m_iCurrentFrame % m_iCols) * m_SpriteData.iWidth;
 	m_SpriteData.rect.right = m_SpriteData.rect.left + m_SpriteData.iWidth;
 	m_SpriteData.rect.top = (m_iCurrentFrame / m_iCols) * m_SpriteData.iHeight;
 	m_SpriteData.rect.bottom = m_SpriteData.rect.top + m_SpriteData.iHeight;
-}
\ No newline at end of file
+}
+
+void Image::SaveState(StateBuffer& state) const
+{
+	// The track holds the animation when there is one.
+	int iFrame = m_pAnimations ? m_pAnimations->GetFrame(m_iAnimTrack) : m_iCurrentFrame;
+	float fTimer = m_pAnimations ? m_pAnimations->GetTimer(m_iAnimTrack) : m_fAnimTimer;
+	bool bComplete = m_pAnimations ? m_pAnimations->IsComplete(m_iAnimTrack) : m_bAnimComplete;
+
+	state.Write(m_SpriteData.fX);
+	state.Write(m_SpriteData.fY);
+	state.Write(m_SpriteData.fScale);
+	state.Write(m_SpriteData.fAngle);
+	state.Write(m_SpriteData.rect);
+	state.Write(m_SpriteData.bFlipHorizontal);
+	state.Write(m_SpriteData.bFlipVertical);
+	state.Write(m_fPrevX);
+	state.Write(m_fPrevY);
+	state.Write(m_fPrevAngle);
+	state.Write(m_fPrevScale);
+	state.Write(iFrame);
+	state.Write(fTimer);
+	state.Write(bComplete);
+	state.Write(m_bVisible);
+}
+
+bool Image::LoadState(StateBuffer& state)
+{
+	state.Read(m_SpriteData.fX);
+	state.Read(m_SpriteData.fY);
+	state.Read(m_SpriteData.fScale);
+	state.Read(m_SpriteData.fAngle);
+	state.Read(m_SpriteData.rect);
+	state.Read(m_SpriteData.bFlipHorizontal);
+	state.Read(m_SpriteData.bFlipVertical);
+	state.Read(m_fPrevX);
+	state.Read(m_fPrevY);
+	state.Read(m_fPrevAngle);
+	state.Read(m_fPrevScale);
+	state.Read(m_iCurrentFrame);
+	state.Read(m_fAnimTimer);
+	state.Read(m_bAnimComplete);
+	state.Read(m_bVisible);
+	if(m_pAnimations)
+	{
+		m_pAnimations->SetFrame(m_iAnimTrack, m_iCurrentFrame);
+		m_pAnimations->SetTimer(m_iAnimTrack, m_fAnimTimer);
+		m_pAnimations->SetComplete(m_iAnimTrack, m_bAnimComplete);
+	}
+	return state.IsGood();
+}
@@ -4,6 +4,9 @@
 #define WIN32_LEAN_AND_MEAN
 
 #include "TextureManager.h"
+#include "RenderSnapshot.h"
+#include "AnimationSystem.h"
+#include "StateBuffer.h"
 
 class Image
 {
@@ -12,6 +15,8 @@ protected:
 	// Image properties.
 	Graphics*			m_pGraphics;			// Pointer to graphics.
 	TextureManager*		m_pTextureManager;		// Pointer to texture manager;
+	AnimationSystem*	m_pAnimations;			// Advances the animation when set, instead of Update.
+	int					m_iAnimTrack;			// Track in m_pAnimations.
 	SpriteData			m_SpriteData;			// SpriteData contains the data reqiured to draw the image by Graphics::DrawSprite
 	COLOR_ARGB			m_ColorFilter;			// Applied as color filter (use WHITE for no color change)
 	int					m_iCols;				// Number of cols (1 to n) in multi-frame sprite.
@@ -20,12 +25,19 @@ protected:
 	int					m_iCurrentFrame;		// Current frame of animation.
 	float				m_fFrameDelay;			// How long between frames of animation.
 	float				m_fAnimTimer;			// Animation Timer;
+	float				m_fPrevX;				// Position, angle and scale at the start of the last tick.
+	float				m_fPrevY;				// Used to interpolate drawing between ticks.
+	float				m_fPrevAngle;
+	float				m_fPrevScale;
 	HRESULT				m_Result;				// Standard return type.
 	bool				m_bLoop;				// True to loop frames.
 	bool				m_bVisible;				// True when visible.
 	bool				m_bInitialized;			// True when successfully initialized.
 	bool				m_bAnimComplete;		// True when loop is false and end frame has finished displaying.
 
+	// Copy the animation settings to the m_pAnimations track.
+	void SyncAnimation(void);
+
 public:
 
 	// Constructor.
@@ -51,6 +63,10 @@ public:
 	// Return Scale factor.
 	virtual float GetScale(void) const { return m_SpriteData.fScale; }
 
+	// Return the position at the start of the last tick.
+	virtual float GetPrevX(void) const { return m_fPrevX; }
+	virtual float GetPrevY(void) const { return m_fPrevY; }
+
 	// Return width;
 	virtual int GetWidth(void) const { return m_SpriteData.iWidth; }
 
@@ -79,13 +95,13 @@ public:
 	virtual int GetEndFrame(void) const { return m_iEndFrame; }
 
 	// Return the current frame
-	virtual int GetCurrentFrame(void) const { return m_iEndFrame; }
+	virtual int GetCurrentFrame(void) const { return m_pAnimations ? m_pAnimations->GetFrame(m_iAnimTrack) : m_iCurrentFrame; }
 
 	// Return RECT structure of Image.
 	virtual RECT GetSpriteDataRect(void) const { return m_SpriteData.rect; }
 
 	// Return state of animation.
-	virtual bool HasAnimationCompleted(void) const { return m_bAnimComplete; }
+	virtual bool HasAnimationCompleted(void) const { return m_pAnimations ? m_pAnimations->IsComplete(m_iAnimTrack) : m_bAnimComplete; }
 
 	// Return colorFilter
 	virtual COLOR_ARGB GetColorFilter(void) const { return m_ColorFilter; }
@@ -111,10 +127,10 @@ public:
 	virtual void SetVisible(bool bFlag) { m_bVisible = bFlag; }
 
 	// Set delay between frames of animation.
-	virtual void SetFrameDelay(float fD) { m_fFrameDelay = fD; }
+	virtual void SetFrameDelay(float fD) { m_fFrameDelay = fD; SyncAnimation(); }
 
 	// Set starting and ending frames of animation.
-	virtual void SetFrames(int iStart, int iEnd) { m_iStartFrame = iStart; m_iEndFrame = iEnd; }
+	virtual void SetFrames(int iStart, int iEnd) { m_iStartFrame = iStart; m_iEndFrame = iEnd; SyncAnimation(); }
 
 	// Set current frame of animation.
 	virtual void SetCurrentFrame(int iCurrent);
@@ -126,10 +142,10 @@ public:
 	virtual void SetSpriteDataRect(RECT r) { m_SpriteData.rect = r; }
 
 	// Set animation loop.
-	virtual void SetLoop(bool bLoop) { m_bLoop = bLoop; }
+	virtual void SetLoop(bool bLoop) { m_bLoop = bLoop; SyncAnimation(); }
 
 	// Set animation complete.
-	virtual void SetAnimationComplete(bool bComp) { m_bAnimComplete = bComp; }
+	virtual void SetAnimationComplete(bool bComp);
 
 	// Set color filter.
 	virtual void SetColorFilter(COLOR_ARGB color) { m_ColorFilter = color; }
@@ -155,7 +171,27 @@ public:
 	// Draw this image using the specified SpriteData	
 	virtual void Draw(SpriteData sd, COLOR_ARGB color = GraphicsNS::WHITE);
 
+	// Save position, angle and scale as the previous state for interpolation.
+	virtual void StorePreviousState(void);
+
+	// Draw Image blended fAlpha (0..1) of the way from the previous state to the current one.
+	virtual void DrawInterpolated(float fAlpha, COLOR_ARGB color = GraphicsNS::WHITE);
+
+	// Append this image to a render snapshot, if visible.
+	// Color is handled as in Draw.
+	virtual void AddToSnapshot(RenderSnapshot& snapshot, COLOR_ARGB color = GraphicsNS::WHITE) const;
+
+	// Append the position, previous position and animation state to state, or take them back.
+	// Returns false if state ran out.
+	void SaveState(StateBuffer& state) const;
+	bool LoadState(StateBuffer& state);
+
+	// Hand the animation to pAnimations, which then advances it in place of Update.
+	// Call after Initialize. Pass null to go back to Update.
+	virtual void SetAnimationSystem(AnimationSystem* pAnimations);
+
 	// Update animation. FrameTime is used to regulate the speed.
+	// Does nothing once the image belongs to an AnimationSystem.
 	virtual void Update(float fFrameTime);
 };
 #endif
\ No newline at end of file
@@ -3,7 +3,7 @@
 // Constructor.
 Input::Input()
 	: m_bNewLine(true)
-	, m_TextIn("")
+	, m_iTextInLength(0)
 	, m_charIn(0)
 	, m_iMouseX(0)
 	, m_iMouseY(0)
@@ -14,17 +14,17 @@ Input::Input()
 	, m_bMouseRButton(false)
 	, m_bMouseX1Button(false)
 	, m_bMouseX2Button(false)
+	, m_bMouseCaptured(false)
+	, m_pJournal(nullptr)
+	, m_iEventsDropped(0)
 {
-	// Clear key down array.
-	for(size_t i = 0; i < InputNS::KEYS_ARRAY_LEN; ++i)
-	{
-		m_bKeysDown[i] = false;
-	}
+	m_TextIn[0] = '\0';
 
-	// Clear key pressed array.
-	for(size_t i = 0; i < InputNS::KEYS_ARRAY_LEN; ++i)
+	// Clear key down and pressed bits.
+	for(int i = 0; i < InputNS::KEY_WORDS; ++i)
 	{
-		m_bKeysPressed[i] = false;
+		m_KeysDown[i] = 0;
+		m_KeysPressed[i] = 0;
 	}
 
 	for(size_t i = 0; i <  MAX_CONTROLLERS; ++i)
@@ -39,10 +39,12 @@ Input::Input()
 // Destructor.
 Input::~Input()
 {
+#ifdef _WIN32
 	if(m_bMouseCaptured)
 	{
 		ReleaseCapture();				// Release mouse.
 	}
+#endif
 }
 
 // Initialize mouse and controller input.
@@ -54,12 +56,14 @@ void Input::Initialize(HWND hWnd, bool bCaptured)
 	{
 		m_bMouseCaptured = bCaptured;
 
+#ifdef _WIN32
 		// Register high-definition mouse.
 		m_Rid[0].usUsagePage = HID_USAGE_PAGE_GENERIC;
 		m_Rid[0].usUsage = HID_USAGE_GENERIC_MOUSE;
 		m_Rid[0].dwFlags = RIDEV_INPUTSINK;
 		m_Rid[0].hwndTarget = hWnd;
 		RegisterRawInputDevices(m_Rid, 1, sizeof(m_Rid[0]));
+#endif
 
 		// Clear controllers state.
 		ZeroMemory(m_Controllers, sizeof(ControllerState) * MAX_CONTROLLERS);
@@ -72,40 +76,75 @@ void Input::Initialize(HWND hWnd, bool bCaptured)
 
 void Input::KeyDown(WPARAM wParam)
 {
-	// Make sure key code is within buffer range.
-	if(wParam < InputNS::KEYS_ARRAY_LEN)
+	if(m_pJournal)
 	{
-		m_bKeysDown[wParam] = true;
-		m_bKeysPressed[wParam] = true;
+		m_pJournal->RecordKeyDown(wParam);
 	}
+
+	SetKey(wParam, true);
 }
 
 void Input::KeyUp(WPARAM wParam)
 {
+	if(m_pJournal)
+	{
+		m_pJournal->RecordKeyUp(wParam);
+	}
+
+	SetKey(wParam, false);
+}
+
+void Input::SetKey(WPARAM wParam, bool bDown)
+{
+	// Make sure key code is within buffer range.
 	if(wParam < InputNS::KEYS_ARRAY_LEN)
 	{
-		m_bKeysDown[wParam] = false;
+		uint64_t iBit = 1ULL << (wParam & 63);
+		if(bDown)
+		{
+			m_KeysDown[wParam >> 6] |= iBit;
+			m_KeysPressed[wParam >> 6] |= iBit;
+		}
+		else
+		{
+			m_KeysDown[wParam >> 6] &= ~iBit;
+		}
 	}
 }
 
 void Input::KeyIn(WPARAM wParam)
+{
+	if(m_pJournal)
+	{
+		m_pJournal->RecordKeyIn(wParam);
+	}
+
+	AddText(wParam);
+}
+
+void Input::AddText(WPARAM wParam)
 {
 	if(m_bNewLine)
 	{
-		m_TextIn.clear();
+		ClearTextIn();
 		m_bNewLine = false;
 	}
 
 	if('\b' == wParam)
 	{
-		if(m_TextIn.length() > 0)
+		if(m_iTextInLength > 0)
 		{
-			m_TextIn.erase(m_TextIn.size() - 1);
+			m_TextIn[--m_iTextInLength] = '\0';
 		}
 	}
 	else
 	{
-		m_TextIn += wParam;
+		// Characters past the end of the buffer are dropped.
+		if(m_iTextInLength < InputNS::TEXT_IN_LENGTH - 1)
+		{
+			m_TextIn[m_iTextInLength++] = (char)wParam;
+			m_TextIn[m_iTextInLength] = '\0';
+		}
 		m_charIn = wParam;
 	}
 
@@ -115,66 +154,147 @@ void Input::KeyIn(WPARAM wParam)
 	}
 }
 
+// Every UCHAR is in range of the 256 key bits.
 bool Input::IsKeyDown(UCHAR vKey) const
 {
-	if(vKey < InputNS::KEYS_ARRAY_LEN)
-	{
-		return m_bKeysDown[vKey];
-	}
-	else
+	return 0 != ((m_KeysDown[vKey >> 6] >> (vKey & 63)) & 1);
+}
+
+bool Input::WasKeyPressed(UCHAR vKey) const
+{
+	return 0 != ((m_KeysPressed[vKey >> 6] >> (vKey & 63)) & 1);
+}
+
+bool Input::AnyKeyPressed(void) const
+{
+	uint64_t iAny = 0;
+	for(int i = 0; i < InputNS::KEY_WORDS; ++i)
 	{
-		return false;
+		iAny |= m_KeysPressed[i];
 	}
+
+	return 0 != iAny;
 }
 
-bool Input::WasKeyPressed(UCHAR vKey) const
+void Input::ClearKeyPress(UCHAR vKey)
+{
+	m_KeysPressed[vKey >> 6] &= ~(1ULL << (vKey & 63));
+}
+
+bool Input::PostEvent(InputNS::EVENT type, int iA, int iB, int64_t iTime)
 {
-	if(vKey < InputNS::KEYS_ARRAY_LEN)
+	if(m_pJournal)
 	{
-		return m_bKeysPressed[vKey];
+		m_pJournal->RecordPosted((int)type, iA, iB, iTime);
 	}
-	else
+
+	InputEvent event;
+	event.iTime = iTime;
+	event.iA = iA;
+	event.iB = iB;
+	event.type = type;
+	if(!m_Events.Push(event))
 	{
+		m_iEventsDropped.fetch_add(1, std::memory_order_relaxed);
 		return false;
 	}
+	return true;
 }
 
-bool Input::AnyKeyPressed(void) const
+bool Input::PostMouseRawIn(LPARAM lParam, int64_t iTime)
 {
-	for(size_t i = 0; i < InputNS::KEYS_ARRAY_LEN; ++i)
+	int iX = 0, iY = 0;
+	return ReadMouseRaw(lParam, iX, iY) && PostEvent(InputNS::EVENT_MOUSE_RAW, iX, iY, iTime);
+}
+
+int Input::ApplyEvents(int64_t iTime)
+{
+	int iApplied = 0;
+	for(const InputEvent* pEvent = m_Events.Front(); pEvent && pEvent->iTime <= iTime; pEvent = m_Events.Front())
 	{
-		if(m_bKeysPressed[i] == true)
-		{
-			return true;
-		}
+		ApplyEvent(*pEvent);
+		m_Events.Pop();
+		++iApplied;
 	}
-
-	return false;
+	return iApplied;
 }
 
-void Input::ClearKeyPress(UCHAR vKey)
+void Input::ApplyEvent(const InputEvent& event)
 {
-	if(vKey < InputNS::KEYS_ARRAY_LEN)
+	switch(event.type)
 	{
-		m_bKeysPressed[vKey] = false;
+		case InputNS::EVENT_KEY_DOWN:
+		case InputNS::EVENT_KEY_UP:
+
+			SetKey((WPARAM)event.iA, InputNS::EVENT_KEY_DOWN == event.type);
+			break;
+
+		case InputNS::EVENT_KEY_IN:
+
+			AddText((WPARAM)event.iA);
+			break;
+
+		case InputNS::EVENT_MOUSE:
+
+			m_iMouseX = event.iA;
+			m_iMouseY = event.iB;
+			break;
+
+		case InputNS::EVENT_MOUSE_RAW:
+
+			m_iMouseRawX = event.iA;
+			m_iMouseRawY = event.iB;
+			break;
+
+		case InputNS::EVENT_MOUSE_BUTTONS:
+
+			m_bMouseLButton = (event.iA & InputNS::BUTTON_LEFT) ? 0 != (event.iB & InputNS::BUTTON_LEFT) : m_bMouseLButton;
+			m_bMouseMButton = (event.iA & InputNS::BUTTON_MIDDLE) ? 0 != (event.iB & InputNS::BUTTON_MIDDLE) : m_bMouseMButton;
+			m_bMouseRButton = (event.iA & InputNS::BUTTON_RIGHT) ? 0 != (event.iB & InputNS::BUTTON_RIGHT) : m_bMouseRButton;
+			m_bMouseX1Button = (event.iA & InputNS::BUTTON_X1) ? 0 != (event.iB & InputNS::BUTTON_X1) : m_bMouseX1Button;
+			m_bMouseX2Button = (event.iA & InputNS::BUTTON_X2) ? 0 != (event.iB & InputNS::BUTTON_X2) : m_bMouseX2Button;
+			break;
 	}
 }
 
+void Input::SaveState(StateBuffer& state) const
+{
+	state.Write(m_KeysDown);
+	state.Write(m_KeysPressed);
+	state.Write(m_bMouseLButton);
+	state.Write(m_bMouseMButton);
+	state.Write(m_bMouseRButton);
+	state.Write(m_bMouseX1Button);
+	state.Write(m_bMouseX2Button);
+}
+
+bool Input::LoadState(StateBuffer& state)
+{
+	state.Read(m_KeysDown);
+	state.Read(m_KeysPressed);
+	state.Read(m_bMouseLButton);
+	state.Read(m_bMouseMButton);
+	state.Read(m_bMouseRButton);
+	state.Read(m_bMouseX1Button);
+	state.Read(m_bMouseX2Button);
+	return state.IsGood();
+}
+
 void Input::Clear(UCHAR what)
 {
 	if(what & InputNS::KEYS_DOWN)
 	{
-		for(size_t i = 0; i < InputNS::KEYS_ARRAY_LEN; ++i)
+		for(int i = 0; i < InputNS::KEY_WORDS; ++i)
 		{
-			m_bKeysDown[i] = false;
+			m_KeysDown[i] = 0;
 		}
 	}
 
 	if(what & InputNS::KEYS_PRESSED)
 	{
-		for(size_t i = 0; i < InputNS::KEYS_ARRAY_LEN; ++i)
+		for(int i = 0; i < InputNS::KEY_WORDS; ++i)
 		{
-			m_bKeysPressed[i] = false;
+			m_KeysPressed[i] = 0;
 		}
 	}
 
@@ -196,10 +316,35 @@ void Input::MouseIn(LPARAM lParam)
 {
 	m_iMouseX = GET_X_LPARAM(lParam);
 	m_iMouseY = GET_Y_LPARAM(lParam);
+	if(m_pJournal)
+	{
+		m_pJournal->RecordMouse(m_iMouseX, m_iMouseY);
+	}
+}
+
+void Input::RecordMouseButtons(void)
+{
+	if(m_pJournal)
+	{
+		m_pJournal->RecordMouseButtons((uint8_t)((m_bMouseLButton ? InputNS::BUTTON_LEFT : 0) |
+			(m_bMouseMButton ? InputNS::BUTTON_MIDDLE : 0) | (m_bMouseRButton ? InputNS::BUTTON_RIGHT : 0) |
+			(m_bMouseX1Button ? InputNS::BUTTON_X1 : 0) | (m_bMouseX2Button ? InputNS::BUTTON_X2 : 0)));
+	}
 }
 
 void Input::MouseRawIn(LPARAM lParam)
 {
+	int iX = 0, iY = 0;
+	if(ReadMouseRaw(lParam, iX, iY))
+	{
+		m_iMouseRawX = iX;
+		m_iMouseRawY = iY;
+	}
+}
+
+bool Input::ReadMouseRaw(LPARAM lParam, int& iX, int& iY)
+{
+#ifdef _WIN32
 	UINT dwSize = 40;
 	static BYTE lpb[40];
 
@@ -209,9 +354,16 @@ void Input::MouseRawIn(LPARAM lParam)
 
 	if(raw->header.dwType == RIM_TYPEMOUSE)
 	{
-		m_iMouseRawX = raw->data.mouse.lLastX;
-		m_iMouseRawY = raw->data.mouse.lLastY;
+		iX = raw->data.mouse.lLastX;
+		iY = raw->data.mouse.lLastY;
+		return true;
 	}
+#else
+	(void)lParam;
+	(void)iX;
+	(void)iY;
+#endif
+	return false;
 }
 
 
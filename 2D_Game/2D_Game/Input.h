@@ -5,13 +5,20 @@
 
 class Input;
 
-#include <Windows.h>
+#include <atomic>
+
+#include "Platform.h"
+
+#ifdef _WIN32
 #include <WindowsX.h>
-#include <string>
 #include <XInput.h>
+#endif
 
 #include "Constants.h"
 #include "GameError.h"
+#include "StateBuffer.h"
+#include "InputJournal.h"
+#include "SpscQueue.h"
 
 // For HD mouse.
 #ifndef HID_USAGE_PAGE_GENERIC
@@ -25,14 +32,45 @@ class Input;
 namespace InputNS
 {
 	const int KEYS_ARRAY_LEN = 256;
+	const int KEY_WORDS = KEYS_ARRAY_LEN / 64;		// 64 keys per word of a key bitset.
 
 	const UCHAR KEYS_DOWN = 1;
 	const UCHAR KEYS_PRESSED = 2;
 	const UCHAR MOUSE = 4;
 	const UCHAR TEXT_IN = 8;
 	const UCHAR KEYS_MOUSE_TEXT = KEYS_DOWN + KEYS_PRESSED + MOUSE+ TEXT_IN;
+	const int TEXT_IN_LENGTH = 256;					// Longest line of text input, terminator included.
+	const int EVENT_QUEUE_SIZE = 1024;				// Posted events waiting for their tick, a power of two.
+
+	// Mouse button bits, for EVENT_MOUSE_BUTTONS and the input journal.
+	const int BUTTON_LEFT = 1;
+	const int BUTTON_MIDDLE = 2;
+	const int BUTTON_RIGHT = 4;
+	const int BUTTON_X1 = 8;
+	const int BUTTON_X2 = 16;
+
+	// Posted event types.
+	enum EVENT
+	{
+		EVENT_KEY_DOWN,				// A: key code.
+		EVENT_KEY_UP,				// A: key code.
+		EVENT_KEY_IN,				// A: character.
+		EVENT_MOUSE,				// A, B: screen position.
+		EVENT_MOUSE_RAW,			// A, B: HD mouse movement.
+		EVENT_MOUSE_BUTTONS,		// A: buttons changed, B: their new state.
+		EVENT_COUNT
+	};
 }
 
+// One posted input event, stamped with the game clock when it happened.
+struct InputEvent
+{
+	int64_t		iTime;
+	int32_t		iA;
+	int32_t		iB;
+	int32_t		type;					// InputNS::EVENT.
+};
+
 const DWORD GAMEPAD_THUMBSTICK_DEADZONE = (DWORD)(0.20f * 0X7FFF);		// default as 20% of range as deadzone
 const DWORD GAMEPAD_TRIGGER_DEADZONE = 30;								// Trigger range 0-255
 const DWORD MAX_CONTROLLERS = 4;
@@ -66,15 +104,18 @@ class Input
 {
 private:
 
-	bool m_bKeysDown[InputNS::KEYS_ARRAY_LEN];			// True for the specified key, if down.
-	bool m_bKeysPressed[InputNS::KEYS_ARRAY_LEN];		// True for the specified key, if pressed.
-	std::string m_TextIn;								// user entered text.
+	uint64_t m_KeysDown[InputNS::KEY_WORDS];			// Bit set for the specified key, if down.
+	uint64_t m_KeysPressed[InputNS::KEY_WORDS];			// Bit set for the specified key, if pressed.
+	char m_TextIn[InputNS::TEXT_IN_LENGTH];				// user entered text, fixed size so typing never allocates.
+	int m_iTextInLength;								// Characters in m_TextIn.
 	char m_charIn;										// Last character entered.
 	bool m_bNewLine;									// True on start of new line.
 	
 	int m_iMouseX, m_iMouseY;							// Mouse screen coordinates.
 	int m_iMouseRawX, m_iMouseRawY;						// HD mouse input.
+#ifdef _WIN32
 	RAWINPUTDEVICE m_Rid[1];							// For HD mouse.
+#endif
 	
 	bool m_bMouseCaptured;								// True if mouse captured.
 	bool m_bMouseLButton;								// True if mouse's left button is down.
@@ -83,6 +124,24 @@ private:
 	bool m_bMouseX1Button;								// True if X1 mouse button is down.
 	bool m_bMouseX2Button;								// True if X2 mouse button is down.
 	ControllerState m_Controllers[MAX_CONTROLLERS];		// State of controllers.
+	InputJournal* m_pJournal;							// Records every event, if set.
+	SpscQueue<InputEvent, InputNS::EVENT_QUEUE_SIZE> m_Events;	// Posted by the window thread, applied by the simulation.
+	std::atomic<int64_t> m_iEventsDropped;				// Posted while m_Events was full.
+
+	// Record the mouse buttons in the journal.
+	void RecordMouseButtons(void);
+
+	// Set or clear the specified key's down and pressed bits.
+	void SetKey(WPARAM wParam, bool bDown);
+
+	// Add a character to the text input.
+	void AddText(WPARAM wParam);
+
+	// Change the input state as event says.
+	void ApplyEvent(const InputEvent& event);
+
+	// Read HD mouse movement from a WM_INPUT message. Returns false if it isn't the mouse.
+	static bool ReadMouseRaw(LPARAM lParam, int& iX, int& iY);
 
 public:
 
@@ -122,6 +181,29 @@ public:
 	// KEYS_DOWN, KEYS_PRESSED, MOUSE< TEXT_IN, or KEYS_MOUSE_TEXT
 	void Clear(UCHAR what);
 
+	// Producer: queue an event that happened at iTime on the game clock, to be applied by
+	// ApplyEvents on the simulation's thread. Safe from one thread while another applies.
+	// Returns false, and drops the event, if EVENT_QUEUE_SIZE are already waiting.
+	bool PostEvent(InputNS::EVENT type, int iA, int iB, int64_t iTime);
+
+	// Producer: queue the HD mouse movement from a WM_INPUT message.
+	bool PostMouseRawIn(LPARAM lParam, int64_t iTime);
+
+	// Consumer: apply, in order, the posted events that happened at or before iTime.
+	// Returns the number applied.
+	int ApplyEvents(int64_t iTime);
+
+	// Return the events posted and not yet applied, and those dropped because the queue was full.
+	int GetQueuedEventCount(void) const { return m_Events.GetCount(); }
+	int64_t GetDroppedEventCount(void) const { return m_iEventsDropped.load(std::memory_order_relaxed); }
+
+	// Record every key, character and mouse event in pJournal, nullptr to stop. Not owned by Input.
+	void SetJournal(InputJournal* pJournal) { m_pJournal = pJournal; }
+
+	// Append the keys down and pressed, and the mouse buttons, to state, or take them back.
+	void SaveState(StateBuffer& state) const;
+	bool LoadState(StateBuffer& state);
+
 	// Clear key, mouse and text input data.
 	void ClearAll(void)
 	{
@@ -131,11 +213,12 @@ public:
 	// Clear text input buffer.
 	void ClearTextIn(void) 
 	{
-		m_TextIn.clear();
+		m_iTextInLength = 0;
+		m_TextIn[0] = '\0';
 	}
 
 	// Returns text input as a string.
-	std::string GetTextInt(void)
+	const char* GetTextInt(void) const
 	{
 		return m_TextIn;
 	}
@@ -156,18 +239,21 @@ public:
 	void SetMouseLButton(bool b)
 	{
 		m_bMouseLButton = b;
+		RecordMouseButtons();
 	}
 
 	// save state of mouse button.
 	void SetMouseMButton(bool b)
 	{
 		m_bMouseMButton = b;
+		RecordMouseButtons();
 	}
 
 	// save state of mouse button.
 	void SetMouseRButton(bool b)
 	{
 		m_bMouseRButton = b;
+		RecordMouseButtons();
 	}
 
 	// Save state of mouse button.
@@ -175,6 +261,7 @@ public:
 	{
 		m_bMouseX1Button = (wParam & MK_XBUTTON1) ? true : false;
 		m_bMouseX2Button = (wParam & MK_XBUTTON2) ? true : false;
+		RecordMouseButtons();
 	}
 
 	// Return mouse X position.
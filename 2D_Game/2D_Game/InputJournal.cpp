@@ -0,0 +1,389 @@
+#include "InputJournal.h"
+
+#include <stdio.h>
+
+#include "Input.h"
+
+using namespace InputJournalNS;
+
+namespace
+{
+	uint64_t ZigZag(int64_t iValue) { return ((uint64_t)iValue << 1) ^ (uint64_t)(iValue >> 63); }
+	int64_t UnZigZag(uint64_t iValue) { return (int64_t)(iValue >> 1) ^ -(int64_t)(iValue & 1); }
+}
+
+InputJournal::InputJournal()
+	: m_pClock(nullptr)
+	, m_iOrigin(0)
+	, m_iFrequency(0)
+	, m_iLastTime(0)
+	, m_iRecordStart(0)
+	, m_iFrames(0)
+	, m_iEvents(0)
+	, m_bEnded(false)
+{
+}
+
+void InputJournal::PutVarint(uint64_t iValue)
+{
+	while(iValue >= 0x80)
+	{
+		m_Bytes.push_back((uint8_t)(iValue | 0x80));
+		iValue >>= 7;
+	}
+	m_Bytes.push_back((uint8_t)iValue);
+}
+
+void InputJournal::Put(RECORD type, int64_t iTime)
+{
+	PutVarint((ZigZag(iTime - m_iLastTime) << RECORD_BITS) | type);
+	m_iLastTime = iTime;
+}
+
+void InputJournal::Begin(const Clock* pClock, int64_t iOrigin)
+{
+	m_pClock = pClock;
+	m_iOrigin = iOrigin;
+	m_iFrequency = pClock->GetFrequency();
+	m_iLastTime = 0;
+	m_iFrames = 0;
+	m_iEvents = 0;
+	m_bEnded = false;
+
+	m_Bytes.clear();
+	m_Bytes.reserve(INITIAL_SIZE);
+	for(int i = 0; i < 4; ++i)
+	{
+		m_Bytes.push_back((uint8_t)(MAGIC >> (8 * i)));
+	}
+	PutVarint((uint64_t)m_iFrequency);
+	PutVarint(m_Settings.GetSize());
+	m_Bytes.insert(m_Bytes.end(), m_Settings.GetData(), m_Settings.GetData() + m_Settings.GetSize());
+	m_iRecordStart = m_Bytes.size();
+}
+
+void InputJournal::RecordKeyDown(WPARAM wParam)
+{
+	if(IsRecording())
+	{
+		Put(KEY_DOWN, m_pClock->GetTicks() - m_iOrigin);
+		PutVarint(wParam);
+		++m_iEvents;
+	}
+}
+
+void InputJournal::RecordKeyUp(WPARAM wParam)
+{
+	if(IsRecording())
+	{
+		Put(KEY_UP, m_pClock->GetTicks() - m_iOrigin);
+		PutVarint(wParam);
+		++m_iEvents;
+	}
+}
+
+void InputJournal::RecordKeyIn(WPARAM wParam)
+{
+	if(IsRecording())
+	{
+		Put(KEY_IN, m_pClock->GetTicks() - m_iOrigin);
+		PutVarint(wParam);
+		++m_iEvents;
+	}
+}
+
+void InputJournal::RecordMouse(int iX, int iY)
+{
+	if(IsRecording())
+	{
+		Put(MOUSE, m_pClock->GetTicks() - m_iOrigin);
+		PutVarint(ZigZag(iX));
+		PutVarint(ZigZag(iY));
+		++m_iEvents;
+	}
+}
+
+void InputJournal::RecordMouseButtons(uint8_t iButtons)
+{
+	if(IsRecording())
+	{
+		Put(MOUSE_BUTTONS, m_pClock->GetTicks() - m_iOrigin);
+		m_Bytes.push_back(iButtons);
+		++m_iEvents;
+	}
+}
+
+void InputJournal::RecordPosted(int type, int iA, int iB, int64_t iTime)
+{
+	if(IsRecording())
+	{
+		Put(POSTED, iTime - m_iOrigin);
+		PutVarint((uint64_t)type);
+		PutVarint(ZigZag(iA));
+		PutVarint(ZigZag(iB));
+		++m_iEvents;
+	}
+}
+
+void InputJournal::RecordFrame(int64_t iTime)
+{
+	if(IsRecording())
+	{
+		Put(FRAME, iTime - m_iOrigin);
+		++m_iFrames;
+	}
+}
+
+void InputJournal::End(int64_t iTicks, uint64_t iChecksum)
+{
+	if(IsRecording())
+	{
+		Put(END, m_iLastTime);
+		PutVarint((uint64_t)iTicks);
+		for(int i = 0; i < 8; ++i)
+		{
+			m_Bytes.push_back((uint8_t)(iChecksum >> (8 * i)));
+		}
+		m_bEnded = true;
+	}
+}
+
+bool InputJournal::Save(const char* pFile) const
+{
+	FILE* pOut = fopen(pFile, "wb");
+	if(!pOut)
+	{
+		return false;
+	}
+	bool bWritten = m_Bytes.empty() || 1 == fwrite(m_Bytes.data(), m_Bytes.size(), 1, pOut);
+	return 0 == fclose(pOut) && bWritten;
+}
+
+bool InputJournal::Load(const char* pFile)
+{
+	FILE* pIn = fopen(pFile, "rb");
+	if(!pIn)
+	{
+		return false;
+	}
+	m_Bytes.clear();
+	uint8_t buffer[4096];
+	for(size_t iRead = fread(buffer, 1, sizeof(buffer), pIn); iRead > 0; iRead = fread(buffer, 1, sizeof(buffer), pIn))
+	{
+		m_Bytes.insert(m_Bytes.end(), buffer, buffer + iRead);
+	}
+	fclose(pIn);
+
+	// Header.
+	m_pClock = nullptr;
+	m_Settings.Clear();
+	if(m_Bytes.size() < 4 || (m_Bytes[0] | (m_Bytes[1] << 8) | (m_Bytes[2] << 16) | ((uint32_t)m_Bytes[3] << 24)) != MAGIC)
+	{
+		m_Bytes.clear();
+		return false;
+	}
+	size_t iOffset = 4;
+	uint64_t iHeader[2] = { 0, 0 };
+	for(int i = 0; i < 2; ++i)
+	{
+		for(int iShift = 0; iOffset < m_Bytes.size() && iShift < 64; iShift += 7)
+		{
+			uint8_t iByte = m_Bytes[iOffset++];
+			iHeader[i] |= (uint64_t)(iByte & 0x7F) << iShift;
+			if(0 == (iByte & 0x80))
+			{
+				break;
+			}
+		}
+	}
+	if(0 == iHeader[0] || iHeader[1] > m_Bytes.size() - iOffset)
+	{
+		m_Bytes.clear();
+		return false;
+	}
+	m_iFrequency = (int64_t)iHeader[0];
+	m_Settings.Write(m_Bytes.data() + iOffset, (size_t)iHeader[1]);
+	m_iRecordStart = iOffset + (size_t)iHeader[1];
+	m_bEnded = true;
+	return true;
+}
+
+JournalPlayer::JournalPlayer()
+{
+	Initialize(nullptr);
+}
+
+void JournalPlayer::Initialize(const InputJournal* pJournal)
+{
+	m_pJournal = pJournal;
+	m_pNext = pJournal ? pJournal->GetRecords() : nullptr;
+	m_pEnd = pJournal ? m_pNext + pJournal->GetRecordSize() : nullptr;
+	m_pEvents = m_pEventsEnd = m_pNext;
+	m_iEventsTime = 0;
+	m_iTime = 0;
+	m_iNow = 0;
+	m_iFrames = 0;
+	m_bEnded = false;
+	m_iEndTicks = 0;
+	m_iEndChecksum = 0;
+	m_bBad = false;
+}
+
+int64_t JournalPlayer::GetFrequency(void) const
+{
+	return (m_pJournal && m_pJournal->GetFrequency() > 0) ? m_pJournal->GetFrequency() : 1000000000;
+}
+
+bool JournalPlayer::GetVarint(const uint8_t*& p, uint64_t& iValue) const
+{
+	iValue = 0;
+	for(int iShift = 0; p < m_pEnd && iShift < 64; iShift += 7)
+	{
+		uint8_t iByte = *p++;
+		iValue |= (uint64_t)(iByte & 0x7F) << iShift;
+		if(0 == (iByte & 0x80))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool JournalPlayer::GetRecord(const uint8_t*& p, RECORD& type, int64_t& iTime, int64_t iLastTime) const
+{
+	uint64_t iValue = 0;
+	if(!GetVarint(p, iValue))
+	{
+		return false;
+	}
+	type = (RECORD)(iValue & ((1 << RECORD_BITS) - 1));
+	iTime = iLastTime + UnZigZag(iValue >> RECORD_BITS);
+	return type < RECORD_COUNT;
+}
+
+bool JournalPlayer::ReadPayload(const uint8_t*& p, RECORD type, int64_t iTime, Input* pInput)
+{
+	uint64_t iA = 0, iB = 0, iType = 0;
+	switch(type)
+	{
+		case KEY_DOWN:
+		case KEY_UP:
+		case KEY_IN:
+			if(!GetVarint(p, iA))
+			{
+				return false;
+			}
+			if(pInput && KEY_DOWN == type)
+			{
+				pInput->KeyDown((WPARAM)iA);
+			}
+			else if(pInput && KEY_UP == type)
+			{
+				pInput->KeyUp((WPARAM)iA);
+			}
+			else if(pInput)
+			{
+				pInput->KeyIn((WPARAM)iA);
+			}
+			return true;
+
+		case MOUSE:
+			if(!GetVarint(p, iA) || !GetVarint(p, iB))
+			{
+				return false;
+			}
+			if(pInput)
+			{
+				int iX = (int)UnZigZag(iA), iY = (int)UnZigZag(iB);
+				pInput->MouseIn((LPARAM)(((iY & 0xFFFF) << 16) | (iX & 0xFFFF)));
+			}
+			return true;
+
+		case MOUSE_BUTTONS:
+			if(p >= m_pEnd)
+			{
+				return false;
+			}
+			if(pInput)
+			{
+				pInput->SetMouseLButton(0 != (*p & InputNS::BUTTON_LEFT));
+				pInput->SetMouseMButton(0 != (*p & InputNS::BUTTON_MIDDLE));
+				pInput->SetMouseRButton(0 != (*p & InputNS::BUTTON_RIGHT));
+				pInput->SetMouseXButton(((*p & InputNS::BUTTON_X1) ? MK_XBUTTON1 : 0) | ((*p & InputNS::BUTTON_X2) ? MK_XBUTTON2 : 0));
+			}
+			++p;
+			return true;
+
+		case POSTED:
+			if(!GetVarint(p, iType) || !GetVarint(p, iA) || !GetVarint(p, iB) || iType >= InputNS::EVENT_COUNT)
+			{
+				return false;
+			}
+			if(pInput)
+			{
+				pInput->PostEvent((InputNS::EVENT)iType, (int)UnZigZag(iA), (int)UnZigZag(iB), iTime);
+			}
+			return true;
+
+		case END:
+			if(!GetVarint(p, iA) || m_pEnd - p < 8)
+			{
+				return false;
+			}
+			m_iEndTicks = (int64_t)iA;
+			m_iEndChecksum = 0;
+			for(int i = 0; i < 8; ++i)
+			{
+				m_iEndChecksum |= (uint64_t)p[i] << (8 * i);
+			}
+			p += 8;
+			m_bEnded = true;
+			return true;
+
+		default:
+			return true;
+	}
+}
+
+bool JournalPlayer::NextFrame(void)
+{
+	// Find the next FRAME, checking the events before it, to be applied by Poll.
+	m_pEvents = m_pNext;
+	m_iEventsTime = m_iTime;
+	while(m_pNext < m_pEnd && !m_bEnded)
+	{
+		const uint8_t* pRecord = m_pNext;
+		RECORD type;
+		int64_t iTime = 0;
+		if(!GetRecord(m_pNext, type, iTime, m_iTime) || !ReadPayload(m_pNext, type, iTime, nullptr))
+		{
+			m_bBad = true;
+			break;
+		}
+		m_iTime = iTime;
+		if(FRAME == type)
+		{
+			m_pEventsEnd = pRecord;
+			m_iNow = iTime;
+			++m_iFrames;
+			return true;
+		}
+	}
+	m_pEvents = m_pEventsEnd = m_pNext;
+	return false;
+}
+
+void JournalPlayer::Poll(Input* pInput)
+{
+	// Records were checked by NextFrame.
+	int64_t iTime = m_iEventsTime;
+	for(const uint8_t* p = m_pEvents; p < m_pEventsEnd; )
+	{
+		RECORD type;
+		if(!GetRecord(p, type, iTime, iTime) || !ReadPayload(p, type, iTime, pInput))
+		{
+			break;
+		}
+	}
+	m_pEvents = m_pEventsEnd;
+}
@@ -0,0 +1,176 @@
+#ifndef INPUT_JOURNAL_H_
+#define INPUT_JOURNAL_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stdint.h>
+#include <vector>
+
+#include "Platform.h"
+#include "PlatformLayer.h"
+#include "Clock.h"
+#include "StateBuffer.h"
+
+class Input;
+
+namespace InputJournalNS
+{
+	const uint32_t MAGIC = 0x314A5753;			// "SWJ1", first four bytes of a journal file.
+	const size_t INITIAL_SIZE = 64 * 1024;		// Bytes reserved by Begin.
+
+	// Record types, the low bits of each record's first varint.
+	enum RECORD
+	{
+		FRAME,					// Game::Run read the clock. No payload.
+		KEY_DOWN,				// Key code.
+		KEY_UP,					// Key code.
+		KEY_IN,					// Character.
+		MOUSE,					// X and Y, zigzag.
+		MOUSE_BUTTONS,			// InputNS::BUTTON_ bits.
+		END,					// Ticks run, then the state checksum, 8 bytes.
+		POSTED,					// InputNS::EVENT, then its A and B, zigzag. Timed when it happened, not recorded.
+		RECORD_COUNT
+	};
+	const int RECORD_BITS = 3;				// Holds every RECORD.
+}
+
+// InputJournal: What drove a session, compact enough to keep: every key, character and
+// mouse event given to Input, or posted to it for a later tick, and the clock time of
+// every frame, in order. Replaying it through Input and Game::Run with JournalPlayer runs
+// the same ticks on the same input,
+// so any captured session becomes a repeatable benchmark, and END carries the final
+// state checksum to check the replay against.
+// Each record is a varint holding its type in the low RECORD_BITS and, above them, the
+// zigzagged change in time since the previous record, in ticks of the recording clock,
+// then its payload. File: MAGIC, varint clock frequency, varint settings size and the
+// settings, then the records.
+class InputJournal
+{
+private:
+
+	std::vector<uint8_t>	m_Bytes;
+	const Clock*			m_pClock;		// Timestamps events while recording.
+	int64_t					m_iOrigin;		// Clock ticks at time 0.
+	int64_t					m_iFrequency;	// Ticks per second of the recording clock.
+	int64_t					m_iLastTime;	// Time of the last record written.
+	size_t					m_iRecordStart;	// Offset of the first record.
+	StateBuffer				m_Settings;		// Whatever the game needs to set up a replay the same.
+	int64_t					m_iFrames;
+	int64_t					m_iEvents;
+	bool					m_bEnded;
+
+	// Append a record at iTime.
+	void Put(InputJournalNS::RECORD type, int64_t iTime);
+	void PutVarint(uint64_t iValue);
+
+public:
+
+	// Constructor.
+	InputJournal();
+
+	// Start recording, timing events by pClock from iOrigin. Clears the journal, but not the settings.
+	void Begin(const Clock* pClock, int64_t iOrigin);
+
+	// Return the settings, to be filled in before recording or read after loading.
+	StateBuffer& GetSettings(void) { return m_Settings; }
+
+	// Append an event, at the time it happens.
+	void RecordKeyDown(WPARAM wParam);
+	void RecordKeyUp(WPARAM wParam);
+	void RecordKeyIn(WPARAM wParam);
+	void RecordMouse(int iX, int iY);
+	void RecordMouseButtons(uint8_t iButtons);
+
+	// Append an event posted to Input, which happened at iTime on the recording clock.
+	void RecordPosted(int type, int iA, int iB, int64_t iTime);
+
+	// Append the start of a frame that read the clock at iTime.
+	void RecordFrame(int64_t iTime);
+
+	// Append the end of the session, after iTicks ticks with the state checksum iChecksum. Nothing is recorded after it.
+	void End(int64_t iTicks, uint64_t iChecksum);
+
+	// Write the journal to, or read it from, pFile. Return false on failure or, for Load, if pFile isn't a journal.
+	bool Save(const char* pFile) const;
+	bool Load(const char* pFile);
+
+	// Return true if recording.
+	bool IsRecording(void) const { return m_pClock != nullptr && !m_bEnded; }
+
+	// Return frames and other events recorded, and the size of the journal.
+	int64_t GetFrameCount(void) const { return m_iFrames; }
+	int64_t GetEventCount(void) const { return m_iEvents; }
+	size_t GetSize(void) const { return m_Bytes.size(); }
+
+	// Return the ticks per second of the recording clock.
+	int64_t GetFrequency(void) const { return m_iFrequency; }
+
+	// Return the records.
+	const uint8_t* GetRecords(void) const { return m_Bytes.data() + m_iRecordStart; }
+	size_t GetRecordSize(void) const { return m_Bytes.size() - m_iRecordStart; }
+};
+
+// JournalPlayer: Plays an InputJournal back into a game. It is the game's clock, stopped at
+// the time the current frame read, and its input source, which gives Input the events
+// recorded before that frame, posting the posted ones again with the times they happened.
+// Call NextFrame before each Game::Run.
+class JournalPlayer : public Clock, public InputSource
+{
+private:
+
+	const InputJournal*		m_pJournal;
+	const uint8_t*			m_pNext;		// Next record to read.
+	const uint8_t*			m_pEnd;
+	const uint8_t*			m_pEvents;		// Events for the current frame, up to its FRAME record.
+	const uint8_t*			m_pEventsEnd;
+	int64_t					m_iEventsTime;	// Time of the record before m_pEvents.
+	int64_t					m_iTime;		// Time of the last record read.
+	int64_t					m_iNow;			// Time of the current frame.
+	int64_t					m_iFrames;
+	bool					m_bEnded;		// END has been read.
+	int64_t					m_iEndTicks;
+	uint64_t				m_iEndChecksum;
+	bool					m_bBad;			// A record ran past the end or had an unknown type.
+
+	// Read one varint, or one record's type and time. Return false at the end.
+	bool GetVarint(const uint8_t*& p, uint64_t& iValue) const;
+	bool GetRecord(const uint8_t*& p, InputJournalNS::RECORD& type, int64_t& iTime, int64_t iLastTime) const;
+
+	// Skip or apply the payload of a record at iTime. Returns false if it runs past the end.
+	bool ReadPayload(const uint8_t*& p, InputJournalNS::RECORD type, int64_t iTime, Input* pInput);
+
+public:
+
+	// Constructor.
+	JournalPlayer();
+
+	// Play pJournal from the start.
+	void Initialize(const InputJournal* pJournal);
+
+	// Move to the next frame. Returns false when there are no more.
+	bool NextFrame(void);
+
+	// Return frames played so far.
+	int64_t GetFrameCount(void) const { return m_iFrames; }
+
+	// Return true, and the ticks and checksum recorded at the end, if the journal has an END record and it was reached.
+	bool GetEnd(int64_t& iTicks, uint64_t& iChecksum) const
+	{
+		iTicks = m_iEndTicks;
+		iChecksum = m_iEndChecksum;
+		return m_bEnded;
+	}
+
+	// Return true if the journal was malformed.
+	bool IsBad(void) const { return m_bBad; }
+
+	// Clock. Time only moves with NextFrame.
+	virtual int64_t GetTicks(void) const { return m_iNow; }
+	virtual int64_t GetFrequency(void) const;
+	virtual void SleepMs(unsigned int) {}
+
+	// InputSource. Gives pInput the current frame's events.
+	virtual void Poll(Input* pInput);
+};
+
+#endif
@@ -0,0 +1,341 @@
+#include "JobSystem.h"
+#include "GameError.h"
+#include "Profiler.h"
+
+namespace
+{
+	// Queue index of the calling thread. 0 for the thread that owns the job system.
+	thread_local int t_iQueueIndex = 0;
+}
+
+// Constructor.
+JobSystem::JobSystem()
+	: m_pJobs(nullptr)
+	, m_iNextJob(0)
+	, m_pQueues(nullptr)
+	, m_iWorkerCount(0)
+	, m_bRunning(false)
+	, m_iQueued(0)
+{
+
+}
+
+// Destructor.
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+void JobSystem::Initialize(int iWorkers)
+{
+	Shutdown();
+
+	if(iWorkers < 0)
+	{
+		iWorkers = (int)std::thread::hardware_concurrency() - 1;
+	}
+	if(iWorkers < 0)
+	{
+		iWorkers = 0;
+	}
+
+	m_iWorkerCount = iWorkers;
+	m_pJobs = new Job[JobSystemNS::MAX_JOBS];
+	for(int i = 0; i < JobSystemNS::MAX_JOBS; ++i)
+	{
+		m_pJobs[i].iUnfinished.store(0, std::memory_order_relaxed);
+	}
+	m_pQueues = new WorkerQueue[m_iWorkerCount + 1];
+	for(int i = 0; i <= m_iWorkerCount; ++i)
+	{
+		m_pQueues[i].iHead = 0;
+		m_pQueues[i].iTail = 0;
+	}
+
+	m_bRunning = true;
+	for(int i = 1; i <= m_iWorkerCount; ++i)
+	{
+		m_Workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+void JobSystem::Shutdown(void)
+{
+	if(m_bRunning)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_WakeLock);
+			m_bRunning = false;
+		}
+		m_WakeCondition.notify_all();
+
+		for(size_t i = 0; i < m_Workers.size(); ++i)
+		{
+			m_Workers[i].join();
+		}
+		m_Workers.clear();
+	}
+
+	delete [] m_pQueues;
+	m_pQueues = nullptr;
+	delete [] m_pJobs;
+	m_pJobs = nullptr;
+	m_iWorkerCount = 0;
+}
+
+Job* JobSystem::TryAllocateJob(void)
+{
+	Job* pJob = &m_pJobs[m_iNextJob.fetch_add(1, std::memory_order_relaxed) % JobSystemNS::MAX_JOBS];
+	if(!IsDone(pJob))
+	{
+		return nullptr;
+	}
+
+	pJob->pFunction = nullptr;
+	pJob->pData = nullptr;
+	pJob->iBegin = 0;
+	pJob->iEnd = 0;
+	pJob->iGrain = 0;
+	pJob->pParent = nullptr;
+	pJob->iUnfinished.store(1, std::memory_order_relaxed);
+	pJob->iDependencies.store(1, std::memory_order_relaxed);		// Released by Submit.
+	pJob->iContinuationCount.store(0, std::memory_order_relaxed);
+	return pJob;
+}
+
+Job* JobSystem::AllocateJob(void)
+{
+	Job* pJob = TryAllocateJob();
+	if(nullptr == pJob)
+	{
+		throw(GameError(GameErrorNS::FATAL_ERROR, "Too many jobs in flight!"));
+	}
+	return pJob;
+}
+
+Job* JobSystem::CreateJob(JobFunction pFunction, void* pData, int iBegin /* = 0 */, int iEnd /* = 0 */)
+{
+	Job* pJob = AllocateJob();
+	pJob->pFunction = pFunction;
+	pJob->pData = pData;
+	pJob->iBegin = iBegin;
+	pJob->iEnd = iEnd;
+	return pJob;
+}
+
+Job* JobSystem::CreateParallelFor(JobFunction pFunction, void* pData, int iCount, int iGrain /* = JobSystemNS::DEFAULT_GRAIN */)
+{
+	Job* pJob = CreateJob(pFunction, pData, 0, iCount);
+	pJob->iGrain = (iGrain > 0) ? iGrain : 1;
+	return pJob;
+}
+
+void JobSystem::AddDependency(Job* pJob, Job* pPrerequisite)
+{
+	int iSlot = pPrerequisite->iContinuationCount.fetch_add(1, std::memory_order_relaxed);
+	if(iSlot >= JobSystemNS::MAX_CONTINUATIONS)
+	{
+		pPrerequisite->iContinuationCount.fetch_sub(1, std::memory_order_relaxed);
+		throw(GameError(GameErrorNS::FATAL_ERROR, "Too many jobs waiting on one job!"));
+	}
+
+	pPrerequisite->pContinuations[iSlot] = pJob;
+	pJob->iDependencies.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobSystem::Submit(Job* pJob)
+{
+	if(pJob->iDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		Push(pJob);
+		WakeWorkers();
+	}
+}
+
+void JobSystem::Push(Job* pJob)
+{
+	WorkerQueue& queue = m_pQueues[t_iQueueIndex];
+	{
+		std::lock_guard<std::mutex> lock(queue.lock);
+		queue.jobs[queue.iTail % JobSystemNS::MAX_JOBS] = pJob;
+		++queue.iTail;
+	}
+	m_iQueued.fetch_add(1, std::memory_order_release);
+}
+
+void JobSystem::WakeWorkers(void)
+{
+	if(0 == m_iWorkerCount)
+	{
+		return;
+	}
+
+	// Taking the lock orders this wake against a worker about to sleep.
+	{
+		std::lock_guard<std::mutex> lock(m_WakeLock);
+	}
+	m_WakeCondition.notify_all();
+}
+
+Job* JobSystem::FindJob(void)
+{
+	int iSelf = t_iQueueIndex;
+	int iQueues = m_iWorkerCount + 1;
+
+	// Newest job from our own queue, it is most likely still in cache.
+	{
+		WorkerQueue& queue = m_pQueues[iSelf];
+		std::lock_guard<std::mutex> lock(queue.lock);
+		if(queue.iTail != queue.iHead)
+		{
+			--queue.iTail;
+			m_iQueued.fetch_sub(1, std::memory_order_relaxed);
+			return queue.jobs[queue.iTail % JobSystemNS::MAX_JOBS];
+		}
+	}
+
+	// Oldest job from someone else, usually the biggest piece of work.
+	for(int i = 1; i < iQueues; ++i)
+	{
+		WorkerQueue& queue = m_pQueues[(iSelf + i) % iQueues];
+		std::lock_guard<std::mutex> lock(queue.lock);
+		if(queue.iTail != queue.iHead)
+		{
+			Job* pJob = queue.jobs[queue.iHead % JobSystemNS::MAX_JOBS];
+			++queue.iHead;
+			m_iQueued.fetch_sub(1, std::memory_order_relaxed);
+			return pJob;
+		}
+	}
+
+	return nullptr;
+}
+
+void JobSystem::Execute(Job* pJob)
+{
+	int iCount = pJob->iEnd - pJob->iBegin;
+	if(pJob->iGrain > 0 && iCount > pJob->iGrain)
+	{
+		// Chunk boundaries depend only on the range and grain. A chunk that finds the ring
+		// full runs here, since this may be a worker with no one to catch a throw.
+		for(int iBegin = pJob->iBegin; iBegin < pJob->iEnd; iBegin += pJob->iGrain)
+		{
+			int iEnd = (iBegin + pJob->iGrain < pJob->iEnd) ? iBegin + pJob->iGrain : pJob->iEnd;
+			Job* pChild = TryAllocateJob();
+			if(nullptr == pChild)
+			{
+				pJob->pFunction(pJob->pData, iBegin, iEnd);
+				continue;
+			}
+			pChild->pFunction = pJob->pFunction;
+			pChild->pData = pJob->pData;
+			pChild->iBegin = iBegin;
+			pChild->iEnd = iEnd;
+			pChild->pParent = pJob;
+			pChild->iDependencies.store(0, std::memory_order_relaxed);
+			pJob->iUnfinished.fetch_add(1, std::memory_order_relaxed);
+			Push(pChild);
+		}
+		WakeWorkers();
+	}
+	else if(pJob->pFunction)
+	{
+		pJob->pFunction(pJob->pData, pJob->iBegin, pJob->iEnd);
+	}
+
+	Finish(pJob);
+}
+
+void JobSystem::Finish(Job* pJob)
+{
+	// Once iUnfinished reaches 0 the slot can be handed out again, so copy what is needed
+	// from it while our count still holds it. A submitted job gains no continuations.
+	Job* pParent = pJob->pParent;
+	Job* pContinuations[JobSystemNS::MAX_CONTINUATIONS];
+	int iContinuations = pJob->iContinuationCount.load(std::memory_order_acquire);
+	for(int i = 0; i < iContinuations; ++i)
+	{
+		pContinuations[i] = pJob->pContinuations[i];
+	}
+
+	if(pJob->iUnfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+
+	if(pParent)
+	{
+		Finish(pParent);
+	}
+
+	// Release jobs that were waiting on this one.
+	bool bPushed = false;
+	for(int i = 0; i < iContinuations; ++i)
+	{
+		Job* pNext = pContinuations[i];
+		if(pNext->iDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			Push(pNext);
+			bPushed = true;
+		}
+	}
+
+	if(bPushed)
+	{
+		WakeWorkers();
+	}
+}
+
+void JobSystem::Wait(Job* pJob)
+{
+	while(!IsDone(pJob))
+	{
+		Job* pNext = FindJob();
+		if(pNext)
+		{
+			Execute(pNext);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::ParallelFor(JobFunction pFunction, void* pData, int iCount, int iGrain /* = JobSystemNS::DEFAULT_GRAIN */)
+{
+	if(iCount <= 0)
+	{
+		return;
+	}
+
+	// Small ranges are not worth a trip through the queues.
+	if(0 == m_iWorkerCount || iCount <= iGrain)
+	{
+		pFunction(pData, 0, iCount);
+		return;
+	}
+
+	Job* pJob = CreateParallelFor(pFunction, pData, iCount, iGrain);
+	Submit(pJob);
+	Wait(pJob);
+}
+
+void JobSystem::WorkerLoop(int iIndex)
+{
+	t_iQueueIndex = iIndex;
+	PROFILE_THREAD_NAME("Worker");
+
+	while(m_bRunning)
+	{
+		Job* pJob = FindJob();
+		if(pJob)
+		{
+			Execute(pJob);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_WakeLock);
+		m_WakeCondition.wait(lock, [this]() { return !m_bRunning || m_iQueued.load(std::memory_order_acquire) > 0; });
+	}
+}
@@ -0,0 +1,130 @@
+#ifndef JOB_SYSTEM_H_
+#define JOB_SYSTEM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace JobSystemNS
+{
+	const int MAX_JOBS = 16384;				// Job ring size. Jobs are recycled after this many allocations.
+	const int MAX_CONTINUATIONS = 8;		// Jobs that may depend on one job.
+	const int DEFAULT_GRAIN = 256;			// Items per chunk for ParallelFor.
+}
+
+// Work function. Processes items [iBegin, iEnd) of pData.
+typedef void (*JobFunction)(void* pData, int iBegin, int iEnd);
+
+// Job: A unit of work, optionally a range that is split into chunks when run.
+struct Job
+{
+	JobFunction			pFunction;
+	void*				pData;
+	int					iBegin;
+	int					iEnd;
+	int					iGrain;				// Split into chunks of this size when > 0.
+	Job*				pParent;			// Finishes after this job does.
+	std::atomic<int>	iUnfinished;		// This job plus unfinished children.
+	std::atomic<int>	iDependencies;		// Prerequisites still running.
+	std::atomic<int>	iContinuationCount;
+	Job*				pContinuations[JobSystemNS::MAX_CONTINUATIONS];	// Jobs waiting on this one.
+};
+
+// JobSystem: Work-stealing scheduler.
+// Each thread has its own deque. Owners push and pop at the back, idle threads steal from the front.
+// ParallelFor chunks depend only on the item count and grain, never on the number of threads,
+// so per-chunk results can be combined in the same order on any machine.
+class JobSystem
+{
+private:
+
+	// Fixed ring of runnable jobs, guarded by a short lock.
+	struct WorkerQueue
+	{
+		std::mutex			lock;
+		Job*				jobs[JobSystemNS::MAX_JOBS];
+		unsigned int		iHead;			// Oldest job, stolen first.
+		unsigned int		iTail;			// One past the newest job, popped by the owner.
+	};
+
+	Job*						m_pJobs;			// Ring of MAX_JOBS jobs.
+	std::atomic<unsigned int>	m_iNextJob;			// Next ring slot to hand out.
+	WorkerQueue*				m_pQueues;			// One per thread, index 0 is the thread that owns the system.
+	std::vector<std::thread>	m_Workers;
+	int							m_iWorkerCount;		// Worker threads, not counting the owner.
+	std::atomic<bool>			m_bRunning;
+	std::atomic<int>			m_iQueued;			// Jobs sitting in queues.
+	std::mutex					m_WakeLock;
+	std::condition_variable		m_WakeCondition;	// Idle workers sleep here.
+
+	// Take a job slot from the ring. Returns nullptr if the slot's last job hasn't finished,
+	// which means MAX_JOBS are in flight.
+	Job* TryAllocateJob(void);
+
+	// Take a job slot from the ring. Throws if it is still in use.
+	Job* AllocateJob(void);
+
+	// Queue a runnable job on the calling thread's deque.
+	void Push(Job* pJob);
+
+	// Wake sleeping workers after jobs were pushed.
+	void WakeWorkers(void);
+
+	// Pop from our own deque, or steal from another. Returns nullptr if there is no work.
+	Job* FindJob(void);
+
+	// Run a job: split it into children or call its function.
+	void Execute(Job* pJob);
+
+	// Mark a job done, release its parent and continuations once nothing is left.
+	void Finish(Job* pJob);
+
+	// Worker thread body.
+	void WorkerLoop(int iIndex);
+
+public:
+
+	// Constructor.
+	JobSystem();
+
+	// Destructor.
+	~JobSystem();
+
+	// Start iWorkers worker threads. With 0 workers every job runs on the calling thread.
+	// A negative count uses one worker per extra hardware thread.
+	void Initialize(int iWorkers);
+
+	// Stop and join the worker threads.
+	void Shutdown(void);
+
+	// Return number of worker threads, not counting the owner.
+	int GetWorkerCount(void) const { return m_iWorkerCount; }
+
+	// Create a job that calls pFunction(pData, iBegin, iEnd) once.
+	// Not started until Submit.
+	Job* CreateJob(JobFunction pFunction, void* pData, int iBegin = 0, int iEnd = 0);
+
+	// Create a job that calls pFunction over [0, iCount) in chunks of iGrain, spread across threads.
+	// Not started until Submit.
+	Job* CreateParallelFor(JobFunction pFunction, void* pData, int iCount, int iGrain = JobSystemNS::DEFAULT_GRAIN);
+
+	// Make pJob wait for pPrerequisite. Both must not have been submitted yet.
+	// Throws if MAX_CONTINUATIONS jobs already wait on pPrerequisite.
+	void AddDependency(Job* pJob, Job* pPrerequisite);
+
+	// Start a job. It runs once all its prerequisites have finished.
+	void Submit(Job* pJob);
+
+	// Help run jobs until pJob has finished.
+	void Wait(Job* pJob);
+
+	// Run pFunction over [0, iCount) in parallel and wait for it.
+	void ParallelFor(JobFunction pFunction, void* pData, int iCount, int iGrain = JobSystemNS::DEFAULT_GRAIN);
+
+	// Return true once pJob and its children have finished.
+	static bool IsDone(const Job* pJob) { return pJob->iUnfinished.load(std::memory_order_acquire) == 0; }
+};
+
+#endif
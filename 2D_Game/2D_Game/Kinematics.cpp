@@ -0,0 +1,40 @@
+#include "Kinematics.h"
+
+namespace
+{
+	// Move one axis of iCount bodies by their velocity plus thrust, and wrap them.
+	void Step(float* pX, const float* pVelocity, const float* pThrust, int iCount, float fSpeed, float fDelta,
+		float fLow, float fHigh)
+	{
+		for(int i = 0; i < iCount; ++i)
+		{
+			pX[i] = Kinematics::Wrap(pX[i] + (pVelocity[i] + pThrust[i] * fSpeed) * fDelta, fLow, fHigh);
+		}
+	}
+}
+
+void Kinematics::Move(float* pX, float* pY, const float* pVelocityX, const float* pVelocityY, int iCount, float fDelta,
+	float fWidth, float fHeight, float fWorldWidth, float fWorldHeight)
+{
+	for(int i = 0; i < iCount; ++i)
+	{
+		pX[i] = Wrap(pX[i] + pVelocityX[i] * fDelta, -fWidth, fWorldWidth);
+		pY[i] = Wrap(pY[i] + pVelocityY[i] * fDelta, -fHeight, fWorldHeight);
+	}
+}
+
+void Kinematics::Integrate(const KinematicBodies& bodies, int iCount, float fDelta, float fSpeed, float fTurnRate,
+	float fWidth, float fHeight, float fWorldWidth, float fWorldHeight)
+{
+	// One array written per loop keeps the compiler's aliasing checks few enough to vectorize.
+	Step(bodies.pX, bodies.pVelocityX, bodies.pThrustX, iCount, fSpeed, fDelta, -fWidth, fWorldWidth);
+	Step(bodies.pY, bodies.pVelocityY, bodies.pThrustY, iCount, fSpeed, fDelta, -fHeight, fWorldHeight);
+
+	float* pAngle = bodies.pAngle;
+	const float* pTurn = bodies.pTurn;
+	float fTurn = fTurnRate * fDelta;
+	for(int i = 0; i < iCount; ++i)
+	{
+		pAngle[i] += pTurn[i] * fTurn;
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef KINEMATICS_H_
+#define KINEMATICS_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+// Arrays Kinematics::Integrate steps through together, one entry per body.
+struct KinematicBodies
+{
+	float*			pX;				// Top left corner.
+	float*			pY;
+	float*			pAngle;			// Radians.
+	const float*	pVelocityX;		// Pixels per second the body keeps, like drift.
+	const float*	pVelocityY;
+	const float*	pThrustX;		// Intents, -1 to 1 along each axis.
+	const float*	pThrustY;
+	const float*	pTurn;			// Intent, -1 (left) to 1 (right).
+};
+
+// Kinematics: Moves bodies around a world that wraps at its edges. Input and AI
+// only set intents; every body then goes through the same arithmetic, with no
+// branches, so the loops vectorize. A body is on screen while its top left corner
+// is between minus its size and the world size, and one that leaves by one edge
+// comes back by the other, keeping however far past the edge it went.
+class Kinematics
+{
+public:
+
+	// Return fX moved back into [fLow, fHigh] if it is less than a period outside.
+	static float Wrap(float fX, float fLow, float fHigh)
+	{
+		return fX + (fHigh - fLow) * ((float)(fX < fLow) - (float)(fX > fHigh));
+	}
+
+	// Move iCount bodies by their velocity for fDelta seconds and wrap them in a world
+	// fWorldWidth by fWorldHeight. Bodies are fWidth by fHeight.
+	static void Move(float* pX, float* pY, const float* pVelocityX, const float* pVelocityY, int iCount, float fDelta,
+		float fWidth, float fHeight, float fWorldWidth, float fWorldHeight);
+
+	// Move and turn iCount bodies for fDelta seconds: full thrust adds fSpeed pixels per
+	// second to the velocity and full turn fTurnRate radians per second to the angle.
+	static void Integrate(const KinematicBodies& bodies, int iCount, float fDelta, float fSpeed, float fTurnRate,
+		float fWidth, float fHeight, float fWorldWidth, float fWorldHeight);
+};
+
+#endif
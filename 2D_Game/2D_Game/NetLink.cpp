@@ -0,0 +1,236 @@
+#include "NetLink.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+	typedef SOCKET SocketHandle;
+
+	// Start Winsock once, for the life of the process.
+	bool StartSockets(void)
+	{
+		static bool bStarted = false;
+		if(!bStarted)
+		{
+			WSADATA data;
+			bStarted = (0 == WSAStartup(MAKEWORD(2, 2), &data));
+		}
+		return bStarted;
+	}
+
+	void CloseSocket(intptr_t socket) { closesocket((SocketHandle)socket); }
+#else
+	typedef int SocketHandle;
+
+	bool StartSockets(void) { return true; }
+
+	void CloseSocket(intptr_t socket) { close((int)socket); }
+#endif
+}
+
+UdpLink::UdpLink()
+	: m_Socket(-1)
+	, m_iPeerAddress(0)
+	, m_iPeerPort(0)
+	, m_iLocalPort(0)
+{
+}
+
+UdpLink::~UdpLink()
+{
+	Close();
+}
+
+void UdpLink::Open(uint16_t iLocalPort)
+{
+	Close();
+	if(!StartSockets())
+	{
+		throw(GameError(GameErrorNS::FATAL_ERROR, "Error starting network sockets!"));
+	}
+
+#ifdef _WIN32
+	SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if(INVALID_SOCKET == handle)
+	{
+		throw(GameError(GameErrorNS::FATAL_ERROR, "Error creating UDP socket!"));
+	}
+	m_Socket = (intptr_t)handle;
+	u_long iNonBlocking = 1;
+	bool bNonBlocking = (0 == ioctlsocket(handle, FIONBIO, &iNonBlocking));
+#else
+	int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if(handle < 0)
+	{
+		throw(GameError(GameErrorNS::FATAL_ERROR, "Error creating UDP socket!"));
+	}
+	m_Socket = handle;
+	bool bNonBlocking = (0 == fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK));
+#endif
+	if(!bNonBlocking)
+	{
+		Close();
+		throw(GameError(GameErrorNS::FATAL_ERROR, "Error making UDP socket non-blocking!"));
+	}
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(iLocalPort);
+	socklen_t iLength = sizeof(address);
+	if(0 != bind(handle, (const sockaddr*)&address, sizeof(address)) ||
+		0 != getsockname(handle, (sockaddr*)&address, &iLength))
+	{
+		Close();
+		throw(GameError(GameErrorNS::FATAL_ERROR, "Error binding UDP socket!"));
+	}
+	m_iLocalPort = ntohs(address.sin_port);
+}
+
+void UdpLink::Close(void)
+{
+	if(m_Socket != -1)
+	{
+		CloseSocket(m_Socket);
+		m_Socket = -1;
+	}
+}
+
+bool UdpLink::SetPeer(const char* pAddress, uint16_t iPort)
+{
+	in_addr address;
+	if(1 != inet_pton(AF_INET, pAddress, &address))
+	{
+		return false;
+	}
+	m_iPeerAddress = address.s_addr;
+	m_iPeerPort = htons(iPort);
+	return true;
+}
+
+bool UdpLink::Send(const void* pData, int iSize)
+{
+	if(-1 == m_Socket || 0 == m_iPeerPort)
+	{
+		return false;
+	}
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = m_iPeerAddress;
+	address.sin_port = m_iPeerPort;
+	return iSize == (int)sendto((SocketHandle)m_Socket, (const char*)pData, iSize, 0, (const sockaddr*)&address, sizeof(address));
+}
+
+int UdpLink::Receive(void* pData, int iSize)
+{
+	if(-1 == m_Socket)
+	{
+		return 0;
+	}
+
+	// Skip anything not from the peer. Errors, including the peer's port being closed, read as nothing yet.
+	for(;;)
+	{
+		sockaddr_in address;
+		socklen_t iLength = sizeof(address);
+		int iReceived = (int)recvfrom((SocketHandle)m_Socket, (char*)pData, iSize, 0, (sockaddr*)&address, &iLength);
+		if(iReceived < 0)
+		{
+			return 0;
+		}
+		if(address.sin_addr.s_addr == m_iPeerAddress && address.sin_port == m_iPeerPort && iReceived > 0)
+		{
+			return iReceived;
+		}
+	}
+}
+
+LossyLink::LossyLink()
+	: m_pLink(nullptr)
+	, m_pClock(nullptr)
+	, m_iLatency(0)
+	, m_iJitter(0)
+	, m_iLoss(0)
+	, m_iRandom(1)
+	, m_iQueued(0)
+	, m_iSent(0)
+	, m_iDropped(0)
+{
+}
+
+void LossyLink::Initialize(NetLink* pLink, const Clock* pClock, float fLatency, float fJitter, float fLoss, uint32_t iSeed)
+{
+	m_pLink = pLink;
+	m_pClock = pClock;
+	m_iLatency = pClock->FromSeconds(fLatency < 0.0f ? 0.0f : fLatency);
+	m_iJitter = pClock->FromSeconds(fJitter < 0.0f ? 0.0f : fJitter);
+	fLoss = (fLoss < 0.0f) ? 0.0f : ((fLoss > 1.0f) ? 1.0f : fLoss);
+	m_iLoss = (fLoss >= 1.0f) ? 0xFFFFFFFFu : (uint32_t)(fLoss * 4294967296.0);
+	m_iRandom = iSeed ? iSeed : 1;
+	m_Queue.resize(NetLinkNS::QUEUE_CAPACITY);
+	m_iQueued = 0;
+	m_iSent = 0;
+	m_iDropped = 0;
+}
+
+uint32_t LossyLink::NextRandom(void)
+{
+	m_iRandom ^= m_iRandom << 13;
+	m_iRandom ^= m_iRandom >> 17;
+	m_iRandom ^= m_iRandom << 5;
+	return m_iRandom;
+}
+
+bool LossyLink::Send(const void* pData, int iSize)
+{
+	++m_iSent;
+	if(NextRandom() < m_iLoss || m_iQueued == (int)m_Queue.size() || iSize > NetLinkNS::MAX_PACKET)
+	{
+		++m_iDropped;
+		return true;
+	}
+
+	Packet& packet = m_Queue[m_iQueued++];
+	packet.iDue = m_pClock->GetTicks() + m_iLatency + (m_iJitter > 0 ? (int64_t)(NextRandom() % (uint64_t)(m_iJitter + 1)) : 0);
+	packet.iSize = iSize;
+	memcpy(packet.data, pData, iSize);
+	return true;
+}
+
+void LossyLink::Flush(void)
+{
+	int64_t iNow = m_pClock->GetTicks();
+	for(int i = 0; i < m_iQueued; )
+	{
+		if(m_Queue[i].iDue <= iNow)
+		{
+			m_pLink->Send(m_Queue[i].data, m_Queue[i].iSize);
+			m_Queue[i] = m_Queue[--m_iQueued];
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+int LossyLink::Receive(void* pData, int iSize)
+{
+	Flush();
+	return m_pLink->Receive(pData, iSize);
+}
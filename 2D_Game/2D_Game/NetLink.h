@@ -0,0 +1,118 @@
+#ifndef NET_LINK_H_
+#define NET_LINK_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stdint.h>
+#include <vector>
+
+#include "Clock.h"
+#include "GameError.h"
+
+namespace NetLinkNS
+{
+	const int MAX_PACKET = 512;					// Largest datagram sent or received.
+	const int QUEUE_CAPACITY = 1024;			// Most datagrams LossyLink holds back at once.
+}
+
+// NetLink: An unreliable, unordered datagram pipe to one peer.
+class NetLink
+{
+public:
+
+	// Destructor.
+	virtual ~NetLink() {}
+
+	// Send iSize bytes as one datagram. Returns false if it couldn't be sent.
+	virtual bool Send(const void* pData, int iSize) = 0;
+
+	// Take the next datagram that has arrived into pData. Returns its size, or 0 if none
+	// has. Datagrams longer than iSize are dropped.
+	virtual int Receive(void* pData, int iSize) = 0;
+};
+
+// UdpLink: A non-blocking UDP socket. Only datagrams from the peer are received.
+class UdpLink : public NetLink
+{
+private:
+
+	intptr_t	m_Socket;				// -1 when closed.
+	uint32_t	m_iPeerAddress;			// IPv4, network byte order.
+	uint16_t	m_iPeerPort;			// Network byte order.
+	uint16_t	m_iLocalPort;			// Host byte order.
+
+public:
+
+	// Constructor.
+	UdpLink();
+
+	// Destructor.
+	virtual ~UdpLink();
+
+	// Bind to iLocalPort on every interface, 0 for any free port.
+	// Throws GameError.
+	void Open(uint16_t iLocalPort);
+
+	// Close the socket.
+	void Close(void);
+
+	// Send to pAddress, a dotted IPv4 address, at iPort. Returns false if pAddress isn't one.
+	bool SetPeer(const char* pAddress, uint16_t iPort);
+
+	// Return the port the socket is bound to.
+	uint16_t GetLocalPort(void) const { return m_iLocalPort; }
+
+	virtual bool Send(const void* pData, int iSize);
+	virtual int Receive(void* pData, int iSize);
+};
+
+// LossyLink: Puts a bad network in front of another link, for testing on one machine.
+// Each datagram sent is dropped with the loss chance, or held back for the latency plus
+// up to the jitter, so datagrams arrive late and out of order. Time is read from a Clock,
+// so a ManualClock makes a run repeatable. Storage is allocated once, by Initialize.
+class LossyLink : public NetLink
+{
+private:
+
+	// A datagram held back.
+	struct Packet
+	{
+		int64_t		iDue;				// Clock ticks when it goes out.
+		int			iSize;
+		uint8_t		data[NetLinkNS::MAX_PACKET];
+	};
+
+	NetLink*			m_pLink;
+	const Clock*		m_pClock;
+	int64_t				m_iLatency;			// Clock ticks.
+	int64_t				m_iJitter;
+	uint32_t			m_iLoss;			// Chance of a drop, out of 2^32.
+	uint32_t			m_iRandom;			// xorshift32 state.
+	std::vector<Packet>	m_Queue;			// First m_iQueued in use, in no order.
+	int					m_iQueued;
+	int64_t				m_iSent;
+	int64_t				m_iDropped;			// By the loss chance or a full queue.
+
+	// Return the next pseudo-random number.
+	uint32_t NextRandom(void);
+
+public:
+
+	// Constructor.
+	LossyLink();
+
+	// Send through pLink after fLatency plus up to fJitter seconds of pClock, dropping fLoss of datagrams.
+	void Initialize(NetLink* pLink, const Clock* pClock, float fLatency, float fJitter, float fLoss, uint32_t iSeed);
+
+	// Send the datagrams that are due.
+	void Flush(void);
+
+	// Return datagrams passed to Send and how many of them were dropped.
+	int64_t GetSentCount(void) const { return m_iSent; }
+	int64_t GetDroppedCount(void) const { return m_iDropped; }
+
+	virtual bool Send(const void* pData, int iSize);
+	virtual int Receive(void* pData, int iSize);
+};
+
+#endif
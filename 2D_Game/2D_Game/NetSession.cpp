@@ -0,0 +1,209 @@
+#include "NetSession.h"
+
+#include <string.h>
+
+using namespace NetSessionNS;
+
+namespace
+{
+	const int MASK = INPUT_RING - 1;
+
+	void Put16(uint8_t* p, uint16_t i) { p[0] = (uint8_t)i; p[1] = (uint8_t)(i >> 8); }
+	void Put32(uint8_t* p, uint32_t i) { Put16(p, (uint16_t)i); Put16(p + 2, (uint16_t)(i >> 16)); }
+	uint16_t Get16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+	uint32_t Get32(const uint8_t* p) { return Get16(p) | ((uint32_t)Get16(p + 2) << 16); }
+}
+
+NetSession::NetSession()
+	: m_pLink(nullptr)
+	, m_iLocal(0)
+	, m_iInputDelay(0)
+	, m_iMaxRollback(0)
+{
+	Initialize(nullptr, 0, 0, 0);
+}
+
+void NetSession::Initialize(NetLink* pLink, int iLocalPlayer, int iInputDelay, int iMaxRollback)
+{
+	// Input has to stay in the ring until both peers are done with it.
+	const int MAX_DELAY = INPUT_RING / 4;
+
+	m_pLink = pLink;
+	m_iLocal = (iLocalPlayer != 0) ? 1 : 0;
+	m_iInputDelay = (iInputDelay < 0) ? 0 : ((iInputDelay > MAX_DELAY) ? MAX_DELAY : iInputDelay);
+	m_iMaxRollback = (iMaxRollback < 0) ? 0 : ((iMaxRollback > MAX_DELAY) ? MAX_DELAY : iMaxRollback);
+	memset(m_Inputs, 0, sizeof(m_Inputs));
+
+	// Nobody presses anything during the delay at the start.
+	m_iLocalTick = m_iInputDelay - 1;
+	m_iRemoteTick = m_iInputDelay - 1;
+	m_iPredictedTick = -1;
+	m_iAckedTick = m_iInputDelay - 1;
+	m_iRollbackTick = -1;
+	m_iSendSequence = 0;
+	m_iReceiveSequence = 0;
+	m_bReceived = false;
+
+	m_iPacketsSent = 0;
+	m_iPacketsReceived = 0;
+	m_iPacketsLost = 0;
+	m_iPacketsLate = 0;
+	m_iPacketsBad = 0;
+	m_iPredictions = 0;
+	m_iMispredictions = 0;
+	m_iRollbacks = 0;
+	m_iResimulatedTicks = 0;
+	m_iWorstRollback = 0;
+	m_dResimulateSeconds = 0.0;
+	m_iStalls = 0;
+}
+
+void NetSession::AddLocalInput(int64_t iTick, uint8_t iInput)
+{
+	uint8_t iLast = m_Inputs[m_iLocal][m_iLocalTick & MASK];
+	for(int64_t i = m_iLocalTick + 1; i < iTick; ++i)
+	{
+		m_Inputs[m_iLocal][i & MASK] = iLast;
+	}
+	if(iTick > m_iLocalTick)
+	{
+		m_Inputs[m_iLocal][iTick & MASK] = iInput;
+		m_iLocalTick = iTick;
+	}
+}
+
+void NetSession::SendInputs(void)
+{
+	if(!m_pLink)
+	{
+		return;
+	}
+
+	int64_t iFirst = m_iAckedTick + 1;
+	int64_t iCount = m_iLocalTick - m_iAckedTick;
+	iCount = (iCount > MAX_INPUTS) ? MAX_INPUTS : iCount;
+
+	Put16(m_Packet, MAGIC);
+	m_Packet[2] = (uint8_t)m_iLocal;
+	m_Packet[3] = (uint8_t)iCount;
+	Put32(m_Packet + 4, ++m_iSendSequence);
+	Put32(m_Packet + 8, (uint32_t)m_iRemoteTick);
+	Put32(m_Packet + 12, (uint32_t)iFirst);
+	for(int64_t i = 0; i < iCount; ++i)
+	{
+		m_Packet[HEADER_SIZE + i] = m_Inputs[m_iLocal][(iFirst + i) & MASK];
+	}
+
+	if(m_pLink->Send(m_Packet, HEADER_SIZE + (int)iCount))
+	{
+		++m_iPacketsSent;
+	}
+}
+
+void NetSession::Poll(void)
+{
+	if(!m_pLink)
+	{
+		return;
+	}
+
+	for(int iSize = m_pLink->Receive(m_Packet, sizeof(m_Packet)); iSize > 0; iSize = m_pLink->Receive(m_Packet, sizeof(m_Packet)))
+	{
+		ReadPacket(iSize);
+	}
+}
+
+void NetSession::ReadPacket(int iSize)
+{
+	int iRemote = 1 - m_iLocal;
+	if(iSize < HEADER_SIZE || Get16(m_Packet) != MAGIC || m_Packet[2] != iRemote || iSize != HEADER_SIZE + m_Packet[3])
+	{
+		++m_iPacketsBad;
+		return;
+	}
+	++m_iPacketsReceived;
+
+	// Sequence numbers only feed the statistics. Inputs are tick stamped, so even a late packet is used.
+	uint32_t iSequence = Get32(m_Packet + 4);
+	if(!m_bReceived || iSequence > m_iReceiveSequence)
+	{
+		m_iPacketsLost += m_bReceived ? iSequence - m_iReceiveSequence - 1 : iSequence - 1;
+		m_iReceiveSequence = iSequence;
+		m_bReceived = true;
+	}
+	else
+	{
+		++m_iPacketsLate;
+		m_iPacketsLost -= (m_iPacketsLost > 0) ? 1 : 0;
+	}
+
+	int64_t iAck = (int32_t)Get32(m_Packet + 8);
+	if(iAck > m_iAckedTick && iAck <= m_iLocalTick)
+	{
+		m_iAckedTick = iAck;
+	}
+
+	// The peer sends from the last tick we acknowledged, so its inputs carry on from ours.
+	int64_t iFirst = (int32_t)Get32(m_Packet + 12);
+	int iCount = m_Packet[3];
+	for(int i = 0; i < iCount; ++i)
+	{
+		int64_t iTick = iFirst + i;
+		if(iTick != m_iRemoteTick + 1)
+		{
+			continue;
+		}
+
+		uint8_t iInput = m_Packet[HEADER_SIZE + i];
+		uint8_t& iStored = m_Inputs[iRemote][iTick & MASK];
+		if(iTick <= m_iPredictedTick && iStored != iInput)
+		{
+			++m_iMispredictions;
+			if(m_iRollbackTick < 0 || iTick < m_iRollbackTick)
+			{
+				m_iRollbackTick = iTick;
+			}
+		}
+		iStored = iInput;
+		m_iRemoteTick = iTick;
+	}
+}
+
+uint8_t NetSession::GetInput(int64_t iTick, int iPlayer)
+{
+	if(iPlayer == m_iLocal || iTick <= m_iRemoteTick)
+	{
+		return m_Inputs[iPlayer][iTick & MASK];
+	}
+
+	// Predict the last input received, and remember what was used to check it later.
+	uint8_t iPredicted = m_Inputs[iPlayer][m_iRemoteTick & MASK];
+	m_Inputs[iPlayer][iTick & MASK] = iPredicted;
+	if(iTick > m_iPredictedTick)
+	{
+		m_iPredictedTick = iTick;
+		++m_iPredictions;
+	}
+	return iPredicted;
+}
+
+bool NetSession::CanAdvance(int64_t iTick) const
+{
+	// Don't predict too far, or get so far ahead of the peer's acknowledgements that unsent input wraps the ring.
+	return iTick - m_iRemoteTick <= m_iMaxRollback && iTick + m_iInputDelay - m_iAckedTick < INPUT_RING / 2;
+}
+
+int64_t NetSession::TakeRollbackTick(void)
+{
+	int64_t iTick = m_iRollbackTick;
+	m_iRollbackTick = -1;
+	return iTick;
+}
+
+void NetSession::RecordRollback(int iTicks, double dSeconds)
+{
+	++m_iRollbacks;
+	m_iResimulatedTicks += iTicks;
+	m_iWorstRollback = (iTicks > m_iWorstRollback) ? iTicks : m_iWorstRollback;
+	m_dResimulateSeconds += dSeconds;
+}
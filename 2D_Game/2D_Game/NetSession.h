@@ -0,0 +1,128 @@
+#ifndef NET_SESSION_H_
+#define NET_SESSION_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stdint.h>
+
+#include "NetLink.h"
+
+namespace NetSessionNS
+{
+	const int PLAYERS = 2;
+	const int INPUT_RING = 256;					// Ticks of input kept per player, a power of two.
+	const int MAX_INPUTS = 128;					// Most inputs in one packet, the oldest unacknowledged first.
+	const int HEADER_SIZE = 16;					// Bytes before the inputs in a packet.
+	const uint16_t MAGIC = 0x5753;				// First two bytes of every packet.
+
+	// Input bits, one byte per player per tick.
+	const uint8_t LEFT = 1;
+	const uint8_t RIGHT = 2;
+	const uint8_t UP = 4;
+	const uint8_t DOWN = 8;
+	const uint8_t FIRE = 16;
+}
+
+// NetSession: Two players' input, one byte per tick each, kept in step over a NetLink.
+// Local input is stamped with the tick it applies to, iInputDelay ticks after the one
+// it was read on, which hides that much latency. Every packet carries the local inputs
+// the peer hasn't acknowledged yet, so a lost packet is covered by the next one, along
+// with a sequence number and the last tick of the peer's input received.
+// Remote input that hasn't arrived is predicted to repeat the last that has. When it
+// arrives and differs from what was used, GetRollbackTick reports the first tick that
+// has to be simulated again. The game stalls rather than predict more than iMaxRollback
+// ticks ahead, which bounds how far it ever rolls back.
+// Packet: magic u16, player u8, input count u8, sequence u32, ack tick i32, first tick i32,
+// then the inputs for first tick onward. Little endian.
+class NetSession
+{
+private:
+
+	NetLink*	m_pLink;
+	int			m_iLocal;					// Player index of this peer, 0 or 1.
+	int			m_iInputDelay;
+	int			m_iMaxRollback;
+	uint8_t		m_Inputs[NetSessionNS::PLAYERS][NetSessionNS::INPUT_RING];	// Ring by tick. Remote past m_iRemoteTick is what was predicted.
+	int64_t		m_iLocalTick;				// Last tick with local input.
+	int64_t		m_iRemoteTick;				// Last tick with remote input, every tick before it received too.
+	int64_t		m_iPredictedTick;			// Last tick remote input was predicted for.
+	int64_t		m_iAckedTick;				// Last local tick the peer has.
+	int64_t		m_iRollbackTick;			// First mispredicted tick, -1 for none.
+	uint32_t	m_iSendSequence;
+	uint32_t	m_iReceiveSequence;			// Highest received.
+	bool		m_bReceived;				// A packet has arrived.
+	uint8_t		m_Packet[NetLinkNS::MAX_PACKET];
+
+	// Statistics.
+	int64_t		m_iPacketsSent;
+	int64_t		m_iPacketsReceived;
+	int64_t		m_iPacketsLost;				// Gaps in the sequence numbers received.
+	int64_t		m_iPacketsLate;				// Arrived after a later one.
+	int64_t		m_iPacketsBad;				// Malformed, or from the wrong player.
+	int64_t		m_iPredictions;				// Ticks whose remote input was predicted.
+	int64_t		m_iMispredictions;
+	int64_t		m_iRollbacks;
+	int64_t		m_iResimulatedTicks;
+	int			m_iWorstRollback;			// Most ticks simulated again at once.
+	double		m_dResimulateSeconds;
+	int64_t		m_iStalls;					// Ticks held back waiting for the peer.
+
+	// Take in one packet.
+	void ReadPacket(int iSize);
+
+public:
+
+	// Constructor.
+	NetSession();
+
+	// Exchange input over pLink as player iLocalPlayer.
+	void Initialize(NetLink* pLink, int iLocalPlayer, int iInputDelay, int iMaxRollback);
+
+	// Set local input for tick iTick. Ticks skipped since the last call repeat the last input.
+	void AddLocalInput(int64_t iTick, uint8_t iInput);
+
+	// Send the local inputs the peer hasn't acknowledged.
+	void SendInputs(void);
+
+	// Take in every packet that has arrived.
+	void Poll(void);
+
+	// Return player iPlayer's input for tick iTick, predicting remote input that hasn't arrived.
+	uint8_t GetInput(int64_t iTick, int iPlayer);
+
+	// Return true if tick iTick can be simulated without predicting too far ahead.
+	bool CanAdvance(int64_t iTick) const;
+
+	// Return the first tick simulated with a misprediction, and forget it. -1 if there is none.
+	int64_t TakeRollbackTick(void);
+
+	// Count iTicks simulated again, in dSeconds, or a tick held back.
+	void RecordRollback(int iTicks, double dSeconds);
+	void RecordStall(void) { ++m_iStalls; }
+
+	// Return this peer's player, and the input delay.
+	int GetLocalPlayer(void) const { return m_iLocal; }
+	int GetInputDelay(void) const { return m_iInputDelay; }
+	int GetMaxRollback(void) const { return m_iMaxRollback; }
+
+	// Return the last tick with local input, the last with remote input, and the last the peer has acknowledged.
+	int64_t GetLocalTick(void) const { return m_iLocalTick; }
+	int64_t GetRemoteTick(void) const { return m_iRemoteTick; }
+	int64_t GetAckedTick(void) const { return m_iAckedTick; }
+
+	// Return statistics.
+	int64_t GetPacketsSent(void) const { return m_iPacketsSent; }
+	int64_t GetPacketsReceived(void) const { return m_iPacketsReceived; }
+	int64_t GetPacketsLost(void) const { return m_iPacketsLost; }
+	int64_t GetPacketsLate(void) const { return m_iPacketsLate; }
+	int64_t GetPacketsBad(void) const { return m_iPacketsBad; }
+	int64_t GetPredictionCount(void) const { return m_iPredictions; }
+	int64_t GetMispredictionCount(void) const { return m_iMispredictions; }
+	int64_t GetRollbackCount(void) const { return m_iRollbacks; }
+	int64_t GetResimulatedTicks(void) const { return m_iResimulatedTicks; }
+	int GetWorstRollback(void) const { return m_iWorstRollback; }
+	double GetResimulateSeconds(void) const { return m_dResimulateSeconds; }
+	int64_t GetStallCount(void) const { return m_iStalls; }
+};
+
+#endif
@@ -0,0 +1,254 @@
+#include "ParticleSystem.h"
+
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PARTICLE_SYSTEM_X86 1
+#include <immintrin.h>
+#else
+#define PARTICLE_SYSTEM_X86 0
+#endif
+
+// GCC and Clang only emit AVX2 instructions in functions marked for it.
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+using namespace SpriteTransformNS;
+
+namespace
+{
+	// Arrays Update steps through together.
+	struct ParticleArrays
+	{
+		float*		pX;
+		float*		pY;
+		float*		pVelocityX;
+		float*		pVelocityY;
+		float*		pLife;
+		const float*	pFade;
+		COLOR_ARGB*	pColors;
+	};
+
+	// Step particles iBegin..iEnd one at a time. Returns the first dead one, or iEnd.
+	int RunScalar(const ParticleArrays& p, int iBegin, int iEnd, float fDelta, float fDamp)
+	{
+		int iFirstDead = iEnd;
+		for(int i = iBegin; i < iEnd; ++i)
+		{
+			float fVelocityX = p.pVelocityX[i] * fDamp;
+			float fVelocityY = p.pVelocityY[i] * fDamp;
+			p.pVelocityX[i] = fVelocityX;
+			p.pVelocityY[i] = fVelocityY;
+			p.pX[i] += fVelocityX * fDelta;
+			p.pY[i] += fVelocityY * fDelta;
+
+			float fLife = p.pLife[i] - fDelta;
+			p.pLife[i] = fLife;
+			float fAlpha = fLife * p.pFade[i];
+			fAlpha = (fAlpha > 0.0f) ? ((fAlpha < 255.0f) ? fAlpha : 255.0f) : 0.0f;
+			p.pColors[i] = (p.pColors[i] & 0x00FFFFFF) | ((COLOR_ARGB)(int)fAlpha << 24);
+			if(fLife <= 0.0f && iFirstDead == iEnd)
+			{
+				iFirstDead = i;
+			}
+		}
+		return iFirstDead;
+	}
+
+#if PARTICLE_SYSTEM_X86
+	// Four particles per step. Returns the first group holding a dead one, or the end of the body.
+	int RunSSE2(const ParticleArrays& p, int iCount, float fDelta, float fDamp)
+	{
+		const __m128 delta = _mm_set1_ps(fDelta);
+		const __m128 damp = _mm_set1_ps(fDamp);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 opaque = _mm_set1_ps(255.0f);
+		const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+		int iFirstDead = iCount;
+		for(int i = 0; i < iCount; i += 4)
+		{
+			__m128 velocityX = _mm_mul_ps(_mm_loadu_ps(p.pVelocityX + i), damp);
+			__m128 velocityY = _mm_mul_ps(_mm_loadu_ps(p.pVelocityY + i), damp);
+			_mm_storeu_ps(p.pVelocityX + i, velocityX);
+			_mm_storeu_ps(p.pVelocityY + i, velocityY);
+			_mm_storeu_ps(p.pX + i, _mm_add_ps(_mm_loadu_ps(p.pX + i), _mm_mul_ps(velocityX, delta)));
+			_mm_storeu_ps(p.pY + i, _mm_add_ps(_mm_loadu_ps(p.pY + i), _mm_mul_ps(velocityY, delta)));
+
+			__m128 life = _mm_sub_ps(_mm_loadu_ps(p.pLife + i), delta);
+			_mm_storeu_ps(p.pLife + i, life);
+			__m128 alpha = _mm_max_ps(_mm_min_ps(_mm_mul_ps(life, _mm_loadu_ps(p.pFade + i)), opaque), zero);
+			__m128i color = _mm_and_si128(_mm_loadu_si128((const __m128i*)(p.pColors + i)), rgb);
+			color = _mm_or_si128(color, _mm_slli_epi32(_mm_cvttps_epi32(alpha), 24));
+			_mm_storeu_si128((__m128i*)(p.pColors + i), color);
+			if(iFirstDead == iCount && _mm_movemask_ps(_mm_cmple_ps(life, zero)))
+			{
+				iFirstDead = i;
+			}
+		}
+		return iFirstDead;
+	}
+
+	// Eight particles per step.
+	TARGET_AVX2 int RunAVX2(const ParticleArrays& p, int iCount, float fDelta, float fDamp)
+	{
+		const __m256 delta = _mm256_set1_ps(fDelta);
+		const __m256 damp = _mm256_set1_ps(fDamp);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 opaque = _mm256_set1_ps(255.0f);
+		const __m256i rgb = _mm256_set1_epi32(0x00FFFFFF);
+		int iFirstDead = iCount;
+		for(int i = 0; i < iCount; i += 8)
+		{
+			__m256 velocityX = _mm256_mul_ps(_mm256_loadu_ps(p.pVelocityX + i), damp);
+			__m256 velocityY = _mm256_mul_ps(_mm256_loadu_ps(p.pVelocityY + i), damp);
+			_mm256_storeu_ps(p.pVelocityX + i, velocityX);
+			_mm256_storeu_ps(p.pVelocityY + i, velocityY);
+			_mm256_storeu_ps(p.pX + i, _mm256_add_ps(_mm256_loadu_ps(p.pX + i), _mm256_mul_ps(velocityX, delta)));
+			_mm256_storeu_ps(p.pY + i, _mm256_add_ps(_mm256_loadu_ps(p.pY + i), _mm256_mul_ps(velocityY, delta)));
+
+			__m256 life = _mm256_sub_ps(_mm256_loadu_ps(p.pLife + i), delta);
+			_mm256_storeu_ps(p.pLife + i, life);
+			__m256 alpha = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(life, _mm256_loadu_ps(p.pFade + i)), opaque), zero);
+			__m256i color = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(p.pColors + i)), rgb);
+			color = _mm256_or_si256(color, _mm256_slli_epi32(_mm256_cvttps_epi32(alpha), 24));
+			_mm256_storeu_si256((__m256i*)(p.pColors + i), color);
+			if(iFirstDead == iCount && _mm256_movemask_ps(_mm256_cmp_ps(life, zero, _CMP_LE_OQ)))
+			{
+				iFirstDead = i;
+			}
+		}
+		return iFirstDead;
+	}
+#endif
+}
+
+// Constructor.
+ParticleSystem::ParticleSystem()
+	: m_iCapacity(0)
+	, m_iCount(0)
+	, m_fDrag(0.0f)
+	, m_iRandom(1)
+	, m_iEmitted(0)
+	, m_iDropped(0)
+{
+}
+
+void ParticleSystem::Initialize(int iCapacity, float fDrag, uint32_t iSeed)
+{
+	m_iCapacity = (iCapacity < 0) ? 0 : iCapacity;
+	m_iCount = 0;
+	m_fX.assign(m_iCapacity, 0.0f);
+	m_fY.assign(m_iCapacity, 0.0f);
+	m_fVelocityX.assign(m_iCapacity, 0.0f);
+	m_fVelocityY.assign(m_iCapacity, 0.0f);
+	m_fLife.assign(m_iCapacity, 0.0f);
+	m_fFade.assign(m_iCapacity, 0.0f);
+	m_Colors.assign(m_iCapacity, 0);
+	m_fDrag = fDrag;
+	m_iRandom = iSeed ? iSeed : 1;
+	m_iEmitted = 0;
+	m_iDropped = 0;
+}
+
+float ParticleSystem::Random(void)
+{
+	m_iRandom ^= m_iRandom << 13;
+	m_iRandom ^= m_iRandom >> 17;
+	m_iRandom ^= m_iRandom << 5;
+	return (m_iRandom & 0xFFFFFF) / 16777216.0f;
+}
+
+void ParticleSystem::Emit(float fX, float fY, float fVelocityX, float fVelocityY, float fSpread, float fLifetime, COLOR_ARGB color, int iCount)
+{
+	for(int i = 0; i < iCount; ++i)
+	{
+		if(m_iCount >= m_iCapacity)
+		{
+			m_iDropped += iCount - i;
+			return;
+		}
+
+		// Even over the disk of radius fSpread.
+		float fAngle = Random() * 2.0f * (float)PI;
+		float fSpeed = sqrtf(Random()) * fSpread;
+		float fLife = fLifetime * (.5f + .5f * Random());
+
+		int iNew = m_iCount++;
+		m_fX[iNew] = fX;
+		m_fY[iNew] = fY;
+		m_fVelocityX[iNew] = fVelocityX + cosf(fAngle) * fSpeed;
+		m_fVelocityY[iNew] = fVelocityY + sinf(fAngle) * fSpeed;
+		m_fLife[iNew] = fLife;
+		m_fFade[iNew] = (fLife > 0.0f) ? 255.0f / fLife : 0.0f;
+		m_Colors[iNew] = color | 0xFF000000;
+		++m_iEmitted;
+	}
+}
+
+void ParticleSystem::Update(float fDelta, KERNEL kernel /* = BEST */)
+{
+	if(BEST == kernel)
+	{
+		kernel = SpriteTransform::GetBestKernel();
+	}
+
+	float fDamp = 1.0f - m_fDrag * fDelta;
+	fDamp = (fDamp > 0.0f) ? fDamp : 0.0f;
+	ParticleArrays arrays = { m_fX.data(), m_fY.data(), m_fVelocityX.data(), m_fVelocityY.data(), m_fLife.data(), m_fFade.data(), m_Colors.data() };
+
+	// The SIMD kernels take whole steps, the scalar loop the rest. All do the same
+	// arithmetic in the same order, so a particle ends up the same whichever runs it.
+	int iBody = 0;
+	int iFirstDead = m_iCount;
+#if PARTICLE_SYSTEM_X86
+	if(SSE2 == kernel || AVX2 == kernel)
+	{
+		int iLanes = (AVX2 == kernel) ? 8 : 4;
+		iBody = m_iCount - m_iCount % iLanes;
+		iFirstDead = (AVX2 == kernel) ? RunAVX2(arrays, iBody, fDelta, fDamp) : RunSSE2(arrays, iBody, fDelta, fDamp);
+	}
+#endif
+
+	int iTailDead = RunScalar(arrays, iBody, m_iCount, fDelta, fDamp);
+	iFirstDead = (iFirstDead < iBody) ? iFirstDead : iTailDead;
+	Compact(iFirstDead);
+}
+
+void ParticleSystem::Compact(int iFirst)
+{
+	int i = iFirst;
+	while(i < m_iCount)
+	{
+#if PARTICLE_SYSTEM_X86
+		// Skip four live particles at a time.
+		const __m128 zero = _mm_setzero_ps();
+		while(i + 4 <= m_iCount && 0 == _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(m_fLife.data() + i), zero)))
+		{
+			i += 4;
+		}
+		if(i >= m_iCount)
+		{
+			break;
+		}
+#endif
+
+		if(m_fLife[i] > 0.0f)
+		{
+			++i;
+			continue;
+		}
+
+		// Move the last particle into the hole and look at it next.
+		int iLast = --m_iCount;
+		m_fX[i] = m_fX[iLast];
+		m_fY[i] = m_fY[iLast];
+		m_fVelocityX[i] = m_fVelocityX[iLast];
+		m_fVelocityY[i] = m_fVelocityY[iLast];
+		m_fLife[i] = m_fLife[iLast];
+		m_fFade[i] = m_fFade[iLast];
+		m_Colors[i] = m_Colors[iLast];
+	}
+}
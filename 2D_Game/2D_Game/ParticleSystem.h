@@ -0,0 +1,81 @@
+#ifndef PARTICLE_SYSTEM_H_
+#define PARTICLE_SYSTEM_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stdint.h>
+#include <vector>
+
+#include "Constants.h"
+#include "SpriteTransform.h"
+
+// ParticleSystem: Short lived points, like exhaust and explosion sparks, kept one
+// component per array so Update can step several at once with SSE2 or AVX2.
+// Each tick a particle moves, slows by the drag, and loses life; its color keeps its
+// RGB and fades its alpha with the life left. Dead particles are swapped out for the
+// last live one, so the live ones are always the first GetCount() entries, in no
+// particular order. Storage is allocated once, by Initialize. Particles are only
+// for show, so they are left out of saved state and carry on through a rollback.
+class ParticleSystem
+{
+private:
+
+	int						m_iCapacity;
+	int						m_iCount;
+	std::vector<float>		m_fX;
+	std::vector<float>		m_fY;
+	std::vector<float>		m_fVelocityX;
+	std::vector<float>		m_fVelocityY;
+	std::vector<float>		m_fLife;			// Seconds left.
+	std::vector<float>		m_fFade;			// Alpha per second of life, 255 / lifetime.
+	std::vector<COLOR_ARGB>	m_Colors;			// Alpha follows the life left.
+	float					m_fDrag;			// Share of speed lost per second.
+	uint32_t				m_iRandom;			// xorshift32 state for emission.
+	int64_t					m_iEmitted;			// Particles added since Initialize.
+	int64_t					m_iDropped;			// Particles refused for want of room.
+
+	// Return a random number in [0, 1).
+	float Random(void);
+
+	// Swap the dead particles out from iFirst on. Every particle before iFirst is alive.
+	void Compact(int iFirst);
+
+public:
+
+	// Constructor.
+	ParticleSystem();
+
+	// Allocate room for iCapacity particles and empty the system.
+	void Initialize(int iCapacity, float fDrag, uint32_t iSeed);
+
+	// Remove every particle.
+	void Clear(void) { m_iCount = 0; }
+
+	// Add iCount particles at (fX, fY), moving at (fVelocityX, fVelocityY) plus a random
+	// speed of up to fSpread in a random direction, each living between half and all of
+	// fLifetime seconds. Particles past the capacity are dropped.
+	void Emit(float fX, float fY, float fVelocityX, float fVelocityY, float fSpread, float fLifetime, COLOR_ARGB color, int iCount);
+
+	// Move, slow, age and fade every particle by fDelta seconds, then remove the dead.
+	void Update(float fDelta, SpriteTransformNS::KERNEL kernel = SpriteTransformNS::BEST);
+
+	// Return the number of live particles.
+	int GetCount(void) const { return m_iCount; }
+
+	// Return the most particles alive at once.
+	int GetCapacity(void) const { return m_iCapacity; }
+
+	// Return particles added and refused since Initialize.
+	int64_t GetEmittedTotal(void) const { return m_iEmitted; }
+	int64_t GetDroppedTotal(void) const { return m_iDropped; }
+
+	// Component arrays, GetCount() entries each.
+	const float* GetX(void) const { return m_fX.data(); }
+	const float* GetY(void) const { return m_fY.data(); }
+	const float* GetVelocityX(void) const { return m_fVelocityX.data(); }
+	const float* GetVelocityY(void) const { return m_fVelocityY.data(); }
+	const float* GetLife(void) const { return m_fLife.data(); }
+	const COLOR_ARGB* GetColors(void) const { return m_Colors.data(); }
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+
+#else
+
+// The subset of Win32 types, constants and macros the engine uses,
+// so the simulation and the headless backend build on other platforms.
+
+#include <stdint.h>
+#include <string.h>
+
+typedef void*			HWND;
+typedef int32_t			HRESULT;
+typedef int32_t			LONG;
+typedef uint32_t		DWORD;
+typedef unsigned int	UINT;
+typedef int				BOOL;
+typedef unsigned char	UCHAR;
+typedef unsigned char	BYTE;
+typedef unsigned short	USHORT;
+typedef unsigned short	WORD;
+typedef short			SHORT;
+typedef uintptr_t		WPARAM;
+typedef intptr_t		LPARAM;
+typedef intptr_t		LRESULT;
+
+struct RECT
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+};
+
+#ifndef TRUE
+#define TRUE	1
+#define FALSE	0
+#endif
+
+#define S_OK			((HRESULT)0)
+#define E_FAIL			((HRESULT)0x80004005)
+#define SUCCEEDED(hr)	(((HRESULT)(hr)) >= 0)
+#define FAILED(hr)		(((HRESULT)(hr)) < 0)
+
+#define ZeroMemory(p, n)	memset((p), 0, (n))
+
+#define GET_X_LPARAM(lp)	((int)(short)((lp) & 0xffff))
+#define GET_Y_LPARAM(lp)	((int)(short)(((lp) >> 16) & 0xffff))
+
+// Virtual key codes.
+#define VK_RETURN	0x0D
+#define VK_MENU		0x12
+#define VK_ESCAPE	0x1B
+#define VK_SPACE	0x20
+#define VK_LEFT		0x25
+#define VK_UP		0x26
+#define VK_RIGHT	0x27
+#define VK_DOWN		0x28
+
+// Mouse button flags in WPARAM.
+#define MK_XBUTTON1	0x0020
+#define MK_XBUTTON2	0x0040
+
+// XInput controller state.
+struct XINPUT_GAMEPAD
+{
+	WORD	wButtons;
+	BYTE	bLeftTrigger;
+	BYTE	bRightTrigger;
+	SHORT	sThumbLX;
+	SHORT	sThumbLY;
+	SHORT	sThumbRX;
+	SHORT	sThumbRY;
+};
+
+struct XINPUT_STATE
+{
+	DWORD			dwPacketNumber;
+	XINPUT_GAMEPAD	Gamepad;
+};
+
+struct XINPUT_VIBRATION
+{
+	WORD	wLeftMotorSpeed;
+	WORD	wRightMotorSpeed;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef PLATFORM_LAYER_H_
+#define PLATFORM_LAYER_H_
+
+#include "Platform.h"
+
+class Input;
+
+// PlatformWindow: The window (or stand-in) the game runs in.
+class PlatformWindow
+{
+public:
+
+	// Destructor.
+	virtual ~PlatformWindow() {}
+
+	// Return the native window handle, nullptr when there is no window.
+	virtual HWND GetHandle(void) const = 0;
+
+	// Dispatch pending window messages.
+	// Returns false once the window has been asked to quit.
+	virtual bool ProcessMessages(void) = 0;
+
+	// Ask the window to close. ProcessMessages returns false afterwards.
+	virtual void RequestExit(void) = 0;
+};
+
+// InputSource: Feeds input that does not arrive through window messages.
+class InputSource
+{
+public:
+
+	// Destructor.
+	virtual ~InputSource() {}
+
+	// Push this frame's input into pInput. Called once per frame before the simulation runs.
+	virtual void Poll(Input* pInput) = 0;
+};
+
+#endif
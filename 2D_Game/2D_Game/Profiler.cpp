@@ -0,0 +1,192 @@
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <mutex>
+#include <vector>
+
+#include "Clock.h"
+
+namespace
+{
+	// Events recorded by one thread.
+	struct ThreadBuffer
+	{
+		ProfileEvent*	pEvents;		// Ring of EVENTS_PER_THREAD events.
+		uint64_t		iWritten;		// Total events recorded, ring index is iWritten % size.
+		int				iThreadId;		// Trace tid.
+		const char*		pName;			// Thread name, may be null.
+		bool			bInUse;			// False once its thread has exited.
+	};
+
+	std::mutex					g_BufferLock;		// Guards g_Buffers.
+	std::vector<ThreadBuffer*>	g_Buffers;			// Every buffer handed out, in use or not.
+
+	// Hands the calling thread's buffer back when the thread exits.
+	struct ThreadBufferOwner
+	{
+		ThreadBuffer*	pBuffer;
+
+		ThreadBufferOwner() : pBuffer(nullptr) {}
+
+		~ThreadBufferOwner()
+		{
+			if(pBuffer)
+			{
+				std::lock_guard<std::mutex> lock(g_BufferLock);
+				pBuffer->bInUse = false;
+			}
+		}
+	};
+
+	thread_local ThreadBufferOwner	t_Owner;
+
+	// Profiler time base, shared by all threads.
+	const HighResClock& GetClock(void)
+	{
+		static HighResClock clock;
+		static bool bInitialized = clock.Initialize();
+		(void)bInitialized;
+		return clock;
+	}
+
+	// Return the calling thread's buffer. On first use, take over one an exited thread
+	// left behind, dropping its zones, or create one.
+	ThreadBuffer* GetThreadBuffer(void)
+	{
+		if(nullptr == t_Owner.pBuffer)
+		{
+			std::lock_guard<std::mutex> lock(g_BufferLock);
+			ThreadBuffer* pBuffer = nullptr;
+			for(size_t i = 0; i < g_Buffers.size() && nullptr == pBuffer; ++i)
+			{
+				if(!g_Buffers[i]->bInUse)
+				{
+					pBuffer = g_Buffers[i];
+				}
+			}
+			if(nullptr == pBuffer)
+			{
+				pBuffer = new ThreadBuffer;
+				pBuffer->pEvents = new ProfileEvent[ProfilerNS::EVENTS_PER_THREAD];
+				pBuffer->iThreadId = (int)g_Buffers.size() + 1;
+				g_Buffers.push_back(pBuffer);
+			}
+			pBuffer->iWritten = 0;
+			pBuffer->pName = nullptr;
+			pBuffer->bInUse = true;
+			t_Owner.pBuffer = pBuffer;
+		}
+
+		return t_Owner.pBuffer;
+	}
+
+	// Write a string with JSON escaping.
+	void WriteJsonString(FILE* pOut, const char* pText)
+	{
+		fputc('"', pOut);
+		for(const char* p = pText; *p; ++p)
+		{
+			if('"' == *p || '\\' == *p)
+			{
+				fputc('\\', pOut);
+			}
+			fputc(*p, pOut);
+		}
+		fputc('"', pOut);
+	}
+}
+
+int64_t Profiler::Now(void)
+{
+	return GetClock().GetTicks();
+}
+
+void Profiler::Record(const char* pName, int64_t iStart, int64_t iEnd)
+{
+	ThreadBuffer* pBuffer = GetThreadBuffer();
+
+	ProfileEvent& event = pBuffer->pEvents[pBuffer->iWritten % ProfilerNS::EVENTS_PER_THREAD];
+	event.pName = pName;
+	event.iStart = iStart;
+	event.iEnd = iEnd;
+	++pBuffer->iWritten;
+}
+
+void Profiler::SetThreadName(const char* pName)
+{
+	GetThreadBuffer()->pName = pName;
+}
+
+bool Profiler::WriteTrace(const char* pFile)
+{
+#if PROFILER_ENABLED
+	FILE* pOut = fopen(pFile, "w");
+	if(nullptr == pOut)
+	{
+		return false;
+	}
+
+	const HighResClock& clock = GetClock();
+	const double dToMicro = 1e6 / (double)clock.GetFrequency();
+
+	std::lock_guard<std::mutex> lock(g_BufferLock);
+
+	// Trace timestamps start at the earliest buffered zone.
+	int64_t iOrigin = INT64_MAX;
+	for(size_t i = 0; i < g_Buffers.size(); ++i)
+	{
+		const ThreadBuffer* pBuffer = g_Buffers[i];
+		uint64_t iFirst = (pBuffer->iWritten > (uint64_t)ProfilerNS::EVENTS_PER_THREAD) ? pBuffer->iWritten - ProfilerNS::EVENTS_PER_THREAD : 0;
+		for(uint64_t j = iFirst; j < pBuffer->iWritten; ++j)
+		{
+			const ProfileEvent& event = pBuffer->pEvents[j % ProfilerNS::EVENTS_PER_THREAD];
+			if(event.iStart < iOrigin)
+			{
+				iOrigin = event.iStart;
+			}
+		}
+	}
+
+	fprintf(pOut, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool bFirst = true;
+	for(size_t i = 0; i < g_Buffers.size(); ++i)
+	{
+		const ThreadBuffer* pBuffer = g_Buffers[i];
+
+		if(pBuffer->pName)
+		{
+			fprintf(pOut, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", bFirst ? "" : ",\n", pBuffer->iThreadId);
+			WriteJsonString(pOut, pBuffer->pName);
+			fprintf(pOut, "}}");
+			bFirst = false;
+		}
+
+		uint64_t iFirst = (pBuffer->iWritten > (uint64_t)ProfilerNS::EVENTS_PER_THREAD) ? pBuffer->iWritten - ProfilerNS::EVENTS_PER_THREAD : 0;
+		for(uint64_t j = iFirst; j < pBuffer->iWritten; ++j)
+		{
+			const ProfileEvent& event = pBuffer->pEvents[j % ProfilerNS::EVENTS_PER_THREAD];
+			fprintf(pOut, "%s{\"name\":", bFirst ? "" : ",\n");
+			WriteJsonString(pOut, event.pName);
+			fprintf(pOut, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				pBuffer->iThreadId, (event.iStart - iOrigin) * dToMicro, (event.iEnd - event.iStart) * dToMicro);
+			bFirst = false;
+		}
+	}
+	fprintf(pOut, "\n]}\n");
+
+	fclose(pOut);
+	return true;
+#else
+	(void)pFile;
+	return false;
+#endif
+}
+
+void Profiler::Clear(void)
+{
+	std::lock_guard<std::mutex> lock(g_BufferLock);
+	for(size_t i = 0; i < g_Buffers.size(); ++i)
+	{
+		g_Buffers[i]->iWritten = 0;
+	}
+}
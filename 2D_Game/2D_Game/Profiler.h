@@ -0,0 +1,83 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <stdint.h>
+
+// Set PROFILER_ENABLED to 0 to compile every PROFILE_SCOPE and PROFILE_THREAD_NAME out of the build.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+namespace ProfilerNS
+{
+	const int EVENTS_PER_THREAD = 1 << 18;		// Ring size per thread, the oldest zones are overwritten.
+}
+
+// ProfileEvent: One completed zone.
+struct ProfileEvent
+{
+	const char*		pName;		// Zone name. Must be a string literal or otherwise outlive the profiler.
+	int64_t			iStart;		// Clock ticks at zone entry.
+	int64_t			iEnd;		// Clock ticks at zone exit.
+};
+
+// Profiler: Collects timed zones into per-thread buffers and writes them
+// as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+// Recording takes no locks. WriteTrace should be called once the other threads are idle.
+// A thread's buffer is handed back when it exits and given, emptied, to the next new thread.
+class Profiler
+{
+public:
+
+	// Return the current time in profiler clock ticks.
+	static int64_t Now(void);
+
+	// Record a completed zone for the calling thread.
+	static void Record(const char* pName, int64_t iStart, int64_t iEnd);
+
+	// Name the calling thread in the trace.
+	static void SetThreadName(const char* pName);
+
+	// Write every buffered zone to pFile. Returns false if nothing could be written.
+	static bool WriteTrace(const char* pFile);
+
+	// Drop all buffered zones.
+	static void Clear(void);
+};
+
+// ProfileZone: Records the lifetime of a scope as a zone.
+class ProfileZone
+{
+private:
+
+	const char*		m_pName;
+	int64_t			m_iStart;
+
+public:
+
+	// Constructor. Marks the zone entry.
+	explicit ProfileZone(const char* pName)
+		: m_pName(pName)
+		, m_iStart(Profiler::Now())
+	{
+
+	}
+
+	// Destructor. Marks the zone exit.
+	~ProfileZone()
+	{
+		Profiler::Record(m_pName, m_iStart, Profiler::Now());
+	}
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD_NAME(name)
+#endif
+
+#endif
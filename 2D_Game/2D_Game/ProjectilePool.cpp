@@ -0,0 +1,183 @@
+#include "ProjectilePool.h"
+#include "Constants.h"
+#include "Kinematics.h"
+
+#include <string.h>
+
+// Constructor.
+ProjectilePool::ProjectilePool()
+	: m_iCapacity(0)
+	, m_iCount(0)
+	, m_iWidth(0)
+	, m_iHeight(0)
+	, m_iSpawnCount(0)
+	, m_iSpawned(0)
+	, m_iDropped(0)
+{
+
+}
+
+void ProjectilePool::Initialize(int iCapacity, int iWidth, int iHeight)
+{
+	m_iCapacity = (iCapacity < 0) ? 0 : iCapacity;
+	m_iWidth = iWidth;
+	m_iHeight = iHeight;
+
+	m_fX.assign(m_iCapacity, 0.0f);
+	m_fY.assign(m_iCapacity, 0.0f);
+	m_fPrevX.assign(m_iCapacity, 0.0f);
+	m_fPrevY.assign(m_iCapacity, 0.0f);
+	m_fVelocityX.assign(m_iCapacity, 0.0f);
+	m_fVelocityY.assign(m_iCapacity, 0.0f);
+	m_fLife.assign(m_iCapacity, 0.0f);
+	m_iOwner.assign(m_iCapacity, 0);
+	m_Spawns.resize(m_iCapacity);
+
+	m_iSpawned = 0;
+	m_iDropped = 0;
+	Clear();
+}
+
+bool ProjectilePool::Spawn(float fX, float fY, float fVelocityX, float fVelocityY, float fLife, int iOwner)
+{
+	if(m_iSpawnCount >= m_iCapacity)
+	{
+		++m_iDropped;
+		return false;
+	}
+
+	SpawnRequest& spawn = m_Spawns[m_iSpawnCount++];
+	spawn.fX = fX;
+	spawn.fY = fY;
+	spawn.fVelocityX = fVelocityX;
+	spawn.fVelocityY = fVelocityY;
+	spawn.fLife = fLife;
+	spawn.iOwner = iOwner;
+	return true;
+}
+
+void ProjectilePool::Update(float fDelta, int iBegin, int iEnd)
+{
+	float* pX = m_fX.data();
+	float* pY = m_fY.data();
+	float* pLife = m_fLife.data();
+	const float* pVelocityX = m_fVelocityX.data();
+	const float* pVelocityY = m_fVelocityY.data();
+	Kinematics::Move(pX + iBegin, pY + iBegin, pVelocityX + iBegin, pVelocityY + iBegin, iEnd - iBegin, fDelta,
+		(float)m_iWidth, (float)m_iHeight, (float)GAME_WIDTH, (float)GAME_HEIGHT);
+	for(int i = iBegin; i < iEnd; ++i)
+	{
+		pLife[i] -= fDelta;
+	}
+}
+
+void ProjectilePool::Flush(void)
+{
+	// Walk down so the entry swapped into a hole has already been checked.
+	for(int i = m_iCount - 1; i >= 0; --i)
+	{
+		if(m_fLife[i] > 0.0f)
+		{
+			continue;
+		}
+
+		int iLast = --m_iCount;
+		m_fX[i] = m_fX[iLast];
+		m_fY[i] = m_fY[iLast];
+		m_fPrevX[i] = m_fPrevX[iLast];
+		m_fPrevY[i] = m_fPrevY[iLast];
+		m_fVelocityX[i] = m_fVelocityX[iLast];
+		m_fVelocityY[i] = m_fVelocityY[iLast];
+		m_fLife[i] = m_fLife[iLast];
+		m_iOwner[i] = m_iOwner[iLast];
+	}
+
+	for(int i = 0; i < m_iSpawnCount; ++i)
+	{
+		if(m_iCount >= m_iCapacity)
+		{
+			m_iDropped += m_iSpawnCount - i;
+			break;
+		}
+
+		const SpawnRequest& spawn = m_Spawns[i];
+		int iNew = m_iCount++;
+		m_fX[iNew] = m_fPrevX[iNew] = spawn.fX;
+		m_fY[iNew] = m_fPrevY[iNew] = spawn.fY;
+		m_fVelocityX[iNew] = spawn.fVelocityX;
+		m_fVelocityY[iNew] = spawn.fVelocityY;
+		m_fLife[iNew] = spawn.fLife;
+		m_iOwner[iNew] = spawn.iOwner;
+		++m_iSpawned;
+	}
+	m_iSpawnCount = 0;
+}
+
+void ProjectilePool::StorePreviousState(void)
+{
+	if(m_iCount > 0)
+	{
+		memcpy(m_fPrevX.data(), m_fX.data(), m_iCount * sizeof(float));
+		memcpy(m_fPrevY.data(), m_fY.data(), m_iCount * sizeof(float));
+	}
+}
+
+void ProjectilePool::Clear(void)
+{
+	m_iCount = 0;
+	m_iSpawnCount = 0;
+}
+
+void ProjectilePool::SaveState(StateBuffer& state) const
+{
+	state.Write(m_iCount);
+	state.Write(m_fX.data(), m_iCount * sizeof(float));
+	state.Write(m_fY.data(), m_iCount * sizeof(float));
+	state.Write(m_fPrevX.data(), m_iCount * sizeof(float));
+	state.Write(m_fPrevY.data(), m_iCount * sizeof(float));
+	state.Write(m_fVelocityX.data(), m_iCount * sizeof(float));
+	state.Write(m_fVelocityY.data(), m_iCount * sizeof(float));
+	state.Write(m_fLife.data(), m_iCount * sizeof(float));
+	state.Write(m_iOwner.data(), m_iCount * sizeof(int));
+	state.Write(m_iSpawnCount);
+	state.Write(m_Spawns.data(), m_iSpawnCount * sizeof(SpawnRequest));
+	state.Write(m_iSpawned);
+	state.Write(m_iDropped);
+}
+
+bool ProjectilePool::LoadState(StateBuffer& state)
+{
+	// Storage is fixed at Initialize, so counts are checked before anything is read into it.
+	int iCount = 0;
+	if(!state.Read(iCount) || iCount < 0 || iCount > m_iCapacity)
+	{
+		Clear();
+		return false;
+	}
+	m_iCount = iCount;
+	state.Read(m_fX.data(), iCount * sizeof(float));
+	state.Read(m_fY.data(), iCount * sizeof(float));
+	state.Read(m_fPrevX.data(), iCount * sizeof(float));
+	state.Read(m_fPrevY.data(), iCount * sizeof(float));
+	state.Read(m_fVelocityX.data(), iCount * sizeof(float));
+	state.Read(m_fVelocityY.data(), iCount * sizeof(float));
+	state.Read(m_fLife.data(), iCount * sizeof(float));
+	state.Read(m_iOwner.data(), iCount * sizeof(int));
+
+	int iSpawnCount = 0;
+	if(!state.Read(iSpawnCount) || iSpawnCount < 0 || iSpawnCount > (int)m_Spawns.size())
+	{
+		Clear();
+		return false;
+	}
+	m_iSpawnCount = iSpawnCount;
+	state.Read(m_Spawns.data(), iSpawnCount * sizeof(SpawnRequest));
+	state.Read(m_iSpawned);
+	state.Read(m_iDropped);
+	if(!state.IsGood())
+	{
+		Clear();
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,107 @@
+#ifndef PROJECTILE_POOL_H_
+#define PROJECTILE_POOL_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stdint.h>
+#include <vector>
+
+#include "StateBuffer.h"
+
+// ProjectilePool: Fixed capacity store for short lived projectiles such as torpedoes.
+// Live projectiles are packed into [0, GetCount()) as parallel arrays. Spawn and Kill only
+// queue their change, and Flush applies the queue at the end of the tick, so systems can
+// walk the arrays for a whole tick without entries moving under them.
+// All memory is taken by Initialize; nothing is allocated afterwards.
+class ProjectilePool
+{
+private:
+
+	// A queued spawn.
+	struct SpawnRequest
+	{
+		float	fX;
+		float	fY;
+		float	fVelocityX;
+		float	fVelocityY;
+		float	fLife;
+		int		iOwner;
+	};
+
+	int						m_iCapacity;		// Most projectiles alive at once.
+	int						m_iCount;			// Live projectiles.
+	int						m_iWidth;			// Size used to wrap at the screen edges.
+	int						m_iHeight;
+	std::vector<float>		m_fX;				// Top left corner, like SpriteData.
+	std::vector<float>		m_fY;
+	std::vector<float>		m_fPrevX;			// Position at the start of the tick, for interpolation.
+	std::vector<float>		m_fPrevY;
+	std::vector<float>		m_fVelocityX;		// Pixels per second.
+	std::vector<float>		m_fVelocityY;
+	std::vector<float>		m_fLife;			// Seconds left. Killed at Flush once it reaches 0.
+	std::vector<int>		m_iOwner;			// Who fired it.
+	std::vector<SpawnRequest>	m_Spawns;		// Spawns queued this tick, m_iSpawnCount used.
+	int						m_iSpawnCount;
+	int64_t					m_iSpawned;			// Projectiles added since Initialize.
+	int64_t					m_iDropped;			// Spawns refused because the pool or queue was full.
+
+public:
+
+	// Constructor.
+	ProjectilePool();
+
+	// Allocate room for iCapacity projectiles of iWidth by iHeight pixels and empty the pool.
+	void Initialize(int iCapacity, int iWidth, int iHeight);
+
+	// Queue a projectile. Returns false, and counts a drop, if the queue is full.
+	// Not thread safe, queue from one job at a time.
+	bool Spawn(float fX, float fY, float fVelocityX, float fVelocityY, float fLife, int iOwner);
+
+	// Queue the removal of live projectile iIndex.
+	void Kill(int iIndex) { m_fLife[iIndex] = 0.0f; }
+
+	// Move, wrap and age projectiles [iBegin, iEnd) by fDelta seconds.
+	// Touches only those entries, so ranges can run as parallel jobs.
+	void Update(float fDelta, int iBegin, int iEnd);
+
+	// Remove dead projectiles, then add the queued spawns.
+	// Call once at the end of the tick. Changes the indices of live projectiles.
+	void Flush(void);
+
+	// Save positions for interpolation.
+	void StorePreviousState(void);
+
+	// Remove every projectile and queued spawn.
+	void Clear(void);
+
+	// Append the live projectiles, queued spawns and totals to state, or take them back.
+	// Returns false, and empties the pool, if state was malformed or holds more than fit.
+	void SaveState(StateBuffer& state) const;
+	bool LoadState(StateBuffer& state);
+
+	// Return number of live projectiles.
+	int GetCount(void) const { return m_iCount; }
+
+	// Return the pool size.
+	int GetCapacity(void) const { return m_iCapacity; }
+
+	// Return projectiles added since Initialize.
+	int64_t GetSpawnedTotal(void) const { return m_iSpawned; }
+
+	// Return spawns refused since Initialize.
+	int64_t GetDroppedTotal(void) const { return m_iDropped; }
+
+	// Component arrays, GetCount() entries each.
+	const float* GetX(void) const { return m_fX.data(); }
+	const float* GetY(void) const { return m_fY.data(); }
+	const float* GetPrevX(void) const { return m_fPrevX.data(); }
+	const float* GetPrevY(void) const { return m_fPrevY.data(); }
+	const float* GetVelocityX(void) const { return m_fVelocityX.data(); }
+	const float* GetVelocityY(void) const { return m_fVelocityY.data(); }
+	float* GetVelocityX(void) { return m_fVelocityX.data(); }
+	float* GetVelocityY(void) { return m_fVelocityY.data(); }
+	const float* GetLife(void) const { return m_fLife.data(); }
+	const int* GetOwner(void) const { return m_iOwner.data(); }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "RenderSnapshot.h"
+#include "TextureManager.h"
+#include "Profiler.h"
+
+#include <cmath>
+
+// Constructor.
+RenderSnapshot::RenderSnapshot()
+	: m_iTick(0)
+	, m_iPublishTime(0)
+{
+	m_Sprites.reserve(RenderSnapshotNS::RESERVE_SPRITES);
+}
+
+void RenderSnapshot::Draw(Graphics* pGraphics, float fAlpha, SpriteBatch& batch) const
+{
+	PROFILE_SCOPE("RenderSnapshot::Draw");
+
+	SpriteData sd;
+	batch.Clear();
+	for(size_t i = 0; i < m_Sprites.size(); ++i)
+	{
+		const SpriteSnapshot& sprite = m_Sprites[i];
+
+		TextureManager* pTexture = TextureManager::FromId(sprite.iTextureId);
+		if(nullptr == pTexture)
+		{
+			continue;
+		}
+
+		sd.iWidth = sprite.iWidth;
+		sd.iHeight = sprite.iHeight;
+		sd.rect = sprite.rect;
+		sd.texture = pTexture->GetTexture();
+		sd.bFlipHorizontal = sprite.bFlipHorizontal;
+		sd.bFlipVertical = sprite.bFlipVertical;
+
+		// Same blend as Image::DrawInterpolated, never across a screen wrap.
+		if(fabsf(sprite.fX - sprite.fPrevX) < GAME_WIDTH * .5f && fabsf(sprite.fY - sprite.fPrevY) < GAME_HEIGHT * .5f)
+		{
+			sd.fX = sprite.fPrevX + (sprite.fX - sprite.fPrevX) * fAlpha;
+			sd.fY = sprite.fPrevY + (sprite.fY - sprite.fPrevY) * fAlpha;
+			sd.fAngle = sprite.fPrevAngle + (sprite.fAngle - sprite.fPrevAngle) * fAlpha;
+			sd.fScale = sprite.fPrevScale + (sprite.fScale - sprite.fPrevScale) * fAlpha;
+		}
+		else
+		{
+			sd.fX = sprite.fX;
+			sd.fY = sprite.fY;
+			sd.fAngle = sprite.fAngle;
+			sd.fScale = sprite.fScale;
+		}
+
+		batch.Add(sd, sprite.color);
+	}
+
+	pGraphics->DrawSpriteBatch(batch);
+}
@@ -0,0 +1,85 @@
+#ifndef RENDER_SNAPSHOT_H_
+#define RENDER_SNAPSHOT_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stdint.h>
+#include <vector>
+
+#include "Graphics.h"
+#include "SpriteTransform.h"
+
+namespace RenderSnapshotNS
+{
+	const int RESERVE_SPRITES = 1024;		// Initial capacity, grows if a tick draws more.
+}
+
+// SpriteSnapshot: Everything needed to draw one sprite, copied out of an Image.
+// Holds the transform at the start and end of the tick for interpolation.
+struct SpriteSnapshot
+{
+	float			fX;				// Current transform.
+	float			fY;
+	float			fScale;
+	float			fAngle;
+	float			fPrevX;			// Transform at the start of the tick.
+	float			fPrevY;
+	float			fPrevScale;
+	float			fPrevAngle;
+	int				iWidth;			// Frame size in pixels.
+	int				iHeight;
+	RECT			rect;			// Frame within the texture.
+	int				iTextureId;		// TextureManager id.
+	COLOR_ARGB		color;			// Color filter.
+	bool			bFlipHorizontal;
+	bool			bFlipVertical;
+};
+
+// RenderSnapshot: Immutable picture of one simulation tick, produced by the simulation
+// thread and drawn by the render thread.
+class RenderSnapshot
+{
+private:
+
+	int64_t						m_iTick;			// Simulation tick this snapshot shows.
+	int64_t						m_iPublishTime;		// Clock ticks when the tick finished.
+	std::vector<SpriteSnapshot>	m_Sprites;			// Draw order.
+
+public:
+
+	// Constructor.
+	RenderSnapshot();
+
+	// Start a new snapshot for tick iTick. Keeps the allocated capacity.
+	void Begin(int64_t iTick, int64_t iPublishTime)
+	{
+		m_iTick = iTick;
+		m_iPublishTime = iPublishTime;
+		m_Sprites.clear();
+	}
+
+	// Append a sprite and return it for filling in.
+	SpriteSnapshot& AddSprite(void)
+	{
+		m_Sprites.push_back(SpriteSnapshot());
+		return m_Sprites.back();
+	}
+
+	// Return the simulation tick.
+	int64_t GetTick(void) const { return m_iTick; }
+
+	// Return the clock ticks when the snapshot was made.
+	int64_t GetPublishTime(void) const { return m_iPublishTime; }
+
+	// Return number of sprites.
+	int GetSpriteCount(void) const { return (int)m_Sprites.size(); }
+
+	// Return sprite i.
+	const SpriteSnapshot& GetSprite(int i) const { return m_Sprites[i]; }
+
+	// Draw every sprite fAlpha (0..1) of the way from its previous to its current transform.
+	// Sprites are gathered into batch and drawn together. Call between SpriteBegin and SpriteEnd.
+	void Draw(Graphics* pGraphics, float fAlpha, SpriteBatch& batch) const;
+};
+
+#endif
@@ -1,20 +1,61 @@
 #include "Spacewar.h"
 
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
 Spacewar::Spacewar()
+	: m_iDroneSheet(0)
+	, m_iDroneCount(DRONE_COUNT)
+	, m_pDroneHits(nullptr)
+	, m_pSweeps(nullptr)
+	, m_pSweepMasks(nullptr)
+	, m_iDroneHitTotal(0)
+	, m_iAIBudget(AI_BUDGET)
+	, m_iAIQuota(AI_QUOTA)
+	, m_fAvoidX(0.0f)
+	, m_fAvoidY(0.0f)
+	, m_fAvoidRadius(0.0f)
+	, m_fShip2AimX(0.0f)
+	, m_fShip2AimY(0.0f)
+	, m_iTorpedoRate(0)
+	, m_fStressShots(0.0f)
+	, m_fStressAngle(0.0f)
+	, m_iTorpedoHits(0)
+	, m_iPairsTested(0)
+	, m_iPairsTouching(0)
+	, m_iPlanetMask(0)
+	, m_iTorpedoMask(0)
+	, m_bMutualGravity(false)
 {
-
+	m_fTargetX[0] = m_fTargetX[1] = 0.0f;
+	m_fTargetY[0] = m_fTargetY[1] = 0.0f;
+	m_fTargetVelocityX[0] = m_fTargetVelocityX[1] = 0.0f;
+	m_fTargetVelocityY[0] = m_fTargetVelocityY[1] = 0.0f;
+	m_iShipHits[0] = m_iShipHits[1] = 0;
+	m_iShipMask[0] = m_iShipMask[1] = 0;
+	m_fShipDriftX[0] = m_fShipDriftX[1] = 0.0f;
+	m_fShipDriftY[0] = m_fShipDriftY[1] = 0.0f;
+	m_fShipThrustX[0] = m_fShipThrustX[1] = 0.0f;
+	m_fShipThrustY[0] = m_fShipThrustY[1] = 0.0f;
+	m_fShipTurn[0] = m_fShipTurn[1] = 0.0f;
+	m_fExhaustOwed[0] = m_fExhaustOwed[1] = 0.0f;
+	m_fFireTimer[0] = m_fFireTimer[1] = 0.0f;
+	m_bShipFire[0] = m_bShipFire[1] = false;
 }
 
 Spacewar::~Spacewar()
 {
+	// Stop the simulation thread before the game objects go away.
+	SetThreaded(false);
 	ReleaseAll();
 }
 
 
-void Spacewar::Initialize(HWND hWnd)
+void Spacewar::Initialize(PlatformWindow* pWindow)
 {
 	// Initialize 'Game' parent class
-	Game::Initialize(hWnd);
+	Game::Initialize(pWindow);
 	m_pGraphics->SetBackColor(GraphicsNS::WHITE);
 
 	// Nebula Texture.
@@ -57,6 +98,7 @@ void Spacewar::Initialize(HWND hWnd)
 	{
 		throw(GameError(GameErrorNS::FATAL_ERROR, "Error initializing ship 1!"));
 	}
+	m_Ship1.SetAnimationSystem(&m_Animations);
 	m_Ship1.SetX(GAME_WIDTH / 4);
 	m_Ship1.SetY(GAME_HEIGHT / 4);
 	m_Ship1.SetFrames(SHIP_START_FRAME, SHIP_END_FRAME);
@@ -75,106 +117,1240 @@ void Spacewar::Initialize(HWND hWnd)
 		throw(GameError(GameErrorNS::FATAL_ERROR, "Error initializing ship 2!"));
 	}
 
+	m_Ship2.SetAnimationSystem(&m_Animations);
 	m_Ship2.SetX(GAME_WIDTH / 1.5f);
 	m_Ship2.SetY(GAME_HEIGHT / 4);
 	m_Ship2.SetFrames(SHIP_START_FRAME, SHIP_END_FRAME);
 	m_Ship2.SetCurrentFrame(SHIP_START_FRAME);
 	m_Ship2.SetFrameDelay(SHIP_ANIMATION_DELAY);
 	m_Ship2.SetRotationInDegrees(145);
+
+	// Torpedo texture.
+	if(!m_TorpedoTexture.Initialize(m_pGraphics, TORPEDO_IMAGE))
+	{
+		throw(GameError(GameErrorNS::FATAL_ERROR, "Error initializing torpedo texture!"));
+	}
+	m_Torpedoes.Initialize(TORPEDO_CAPACITY, TORPEDO_WIDTH, TORPEDO_HEIGHT);
+	m_Particles.Initialize(PARTICLE_CAPACITY, PARTICLE_DRAG, PARTICLE_SEED);
+	m_AI.Initialize(GetAIBudgetInUse(), m_iAIQuota);
+	m_Collisions.Initialize((float)GAME_WIDTH, (float)GAME_HEIGHT, COLLISION_CELL_SIZE);
+	m_Gravity.Initialize((float)GAME_WIDTH, (float)GAME_HEIGHT, GRAVITY_SOFTENING, GRAVITY_RANGE);
+
+	// Collision masks. Ships turn and Ship 2 shrinks, so theirs come pre-rotated and scaled.
+	MaskLayout shipMask = { SHIP_WIDTH, SHIP_HEIGHT, SHIP_COLS, SHIP_END_FRAME + 1, MASK_ROTATIONS, MASK_MIN_SCALE, MASK_MAX_SCALE, MASK_SCALES };
+	MaskLayout plainMask = { 0, 0, 0, 0, 0, 1.0f, 1.0f, 0 };
+	m_iShipMask[0] = m_ShipTexture.CreateCollisionMask(shipMask);
+	m_iShipMask[1] = m_Ship2Texture.CreateCollisionMask(shipMask);
+	m_iPlanetMask = m_PlanetTexture.CreateCollisionMask(plainMask);
+	m_iTorpedoMask = m_TorpedoTexture.CreateCollisionMask(plainMask);
+
+	SpawnDrones();
+
+	// Start interpolation from the initial placement.
+	StorePreviousState();
 	return;
 }
 
+// Save state for render interpolation.
+void Spacewar::StorePreviousState(void)
+{
+	m_Drones.StorePreviousState();
+	m_Torpedoes.StorePreviousState();
+	m_Nebula.StorePreviousState();
+	m_Planet.StorePreviousState();
+	m_Ship1.StorePreviousState();
+	m_Ship2.StorePreviousState();
+}
+
+// Same draw order as Render.
+void Spacewar::BuildSnapshot(RenderSnapshot& snapshot)
+{
+	m_Nebula.AddToSnapshot(snapshot);
+	m_Planet.AddToSnapshot(snapshot);
+
+	const float* pX = m_Drones.GetX();
+	const float* pY = m_Drones.GetY();
+	const float* pAngle = m_Drones.GetAngle();
+	const float* pScale = m_Drones.GetScale();
+	const float* pPrevX = m_Drones.GetPrevX();
+	const float* pPrevY = m_Drones.GetPrevY();
+	const float* pPrevAngle = m_Drones.GetPrevAngle();
+	const float* pPrevScale = m_Drones.GetPrevScale();
+	const int* pFrame = m_Drones.GetFrame();
+	const int* pSheet = m_Drones.GetSheetIndex();
+	for(int i = 0; i < m_Drones.GetCount(); ++i)
+	{
+		const SpriteSheet& sheet = m_Drones.GetSheet(pSheet[i]);
+		SpriteSnapshot& sprite = snapshot.AddSprite();
+		sprite.fX = pX[i];
+		sprite.fY = pY[i];
+		sprite.fScale = pScale[i];
+		sprite.fAngle = pAngle[i];
+		sprite.fPrevX = pPrevX[i];
+		sprite.fPrevY = pPrevY[i];
+		sprite.fPrevScale = pPrevScale[i];
+		sprite.fPrevAngle = pPrevAngle[i];
+		sprite.iWidth = sheet.iWidth;
+		sprite.iHeight = sheet.iHeight;
+		sprite.rect = m_Animations.GetFrameRect(sheet.iLayout, pFrame[i]);
+		sprite.iTextureId = sheet.iTextureId;
+		sprite.color = GraphicsNS::WHITE;
+		sprite.bFlipHorizontal = false;
+		sprite.bFlipVertical = false;
+	}
+
+	const float* pTorpedoX = m_Torpedoes.GetX();
+	const float* pTorpedoY = m_Torpedoes.GetY();
+	const float* pTorpedoPrevX = m_Torpedoes.GetPrevX();
+	const float* pTorpedoPrevY = m_Torpedoes.GetPrevY();
+	for(int i = 0; i < m_Torpedoes.GetCount(); ++i)
+	{
+		SpriteSnapshot& sprite = snapshot.AddSprite();
+		sprite.fX = pTorpedoX[i];
+		sprite.fY = pTorpedoY[i];
+		sprite.fScale = sprite.fPrevScale = 1.0f;
+		sprite.fAngle = sprite.fPrevAngle = 0.0f;
+		sprite.fPrevX = pTorpedoPrevX[i];
+		sprite.fPrevY = pTorpedoPrevY[i];
+		sprite.iWidth = TORPEDO_WIDTH;
+		sprite.iHeight = TORPEDO_HEIGHT;
+		sprite.rect.left = 0;
+		sprite.rect.top = 0;
+		sprite.rect.right = TORPEDO_WIDTH;
+		sprite.rect.bottom = TORPEDO_HEIGHT;
+		sprite.iTextureId = m_TorpedoTexture.GetId();
+		sprite.color = GraphicsNS::WHITE;
+		sprite.bFlipHorizontal = false;
+		sprite.bFlipVertical = false;
+	}
+
+	// Particles don't keep where they were, so step them back by their velocity.
+	float fParticleOffset = TORPEDO_WIDTH * PARTICLE_SCALE * .5f;
+	const float* pParticleX = m_Particles.GetX();
+	const float* pParticleY = m_Particles.GetY();
+	const float* pParticleVelocityX = m_Particles.GetVelocityX();
+	const float* pParticleVelocityY = m_Particles.GetVelocityY();
+	const COLOR_ARGB* pParticleColors = m_Particles.GetColors();
+	for(int i = 0; i < m_Particles.GetCount(); ++i)
+	{
+		SpriteSnapshot& sprite = snapshot.AddSprite();
+		sprite.fX = pParticleX[i] - fParticleOffset;
+		sprite.fY = pParticleY[i] - fParticleOffset;
+		sprite.fScale = sprite.fPrevScale = PARTICLE_SCALE;
+		sprite.fAngle = sprite.fPrevAngle = 0.0f;
+		sprite.fPrevX = sprite.fX - pParticleVelocityX[i] * m_fTickTime;
+		sprite.fPrevY = sprite.fY - pParticleVelocityY[i] * m_fTickTime;
+		sprite.iWidth = TORPEDO_WIDTH;
+		sprite.iHeight = TORPEDO_HEIGHT;
+		sprite.rect.left = 0;
+		sprite.rect.top = 0;
+		sprite.rect.right = TORPEDO_WIDTH;
+		sprite.rect.bottom = TORPEDO_HEIGHT;
+		sprite.iTextureId = m_TorpedoTexture.GetId();
+		sprite.color = pParticleColors[i];
+		sprite.bFlipHorizontal = false;
+		sprite.bFlipVertical = false;
+	}
+
+	m_Ship1.AddToSnapshot(snapshot);
+	m_Ship2.AddToSnapshot(snapshot);
+}
+
+// Drones start spread over the screen with a random heading.
+void Spacewar::SpawnDrones(void)
+{
+	SpriteSheet sheet;
+	sheet.iTextureId = m_Ship2Texture.GetId();
+	sheet.iWidth = SHIP_WIDTH;
+	sheet.iHeight = SHIP_HEIGHT;
+	sheet.iCols = SHIP_COLS;
+	sheet.iStartFrame = SHIP_START_FRAME;
+	sheet.iEndFrame = SHIP_END_FRAME;
+	sheet.fFrameDelay = SHIP_ANIMATION_DELAY;
+	sheet.iLayout = m_Animations.GetLayout(SHIP_WIDTH, SHIP_HEIGHT, SHIP_COLS, SHIP_END_FRAME + 1);
+	m_iDroneSheet = m_Drones.AddSheet(sheet);
+
+	m_Drones.Clear();
+	m_Drones.Reserve(m_iDroneCount);
+	m_iDroneHitTotal = 0;
+
+	// xorshift32, so every run and every platform spawns the same drones.
+	uint32_t iState = DRONE_SEED;
+	for(int i = 0; i < m_iDroneCount; ++i)
+	{
+		float fRandom[3];
+		for(int j = 0; j < 3; ++j)
+		{
+			iState ^= iState << 13;
+			iState ^= iState >> 17;
+			iState ^= iState << 5;
+			fRandom[j] = (iState & 0xFFFFFF) / (float)0x1000000;
+		}
+
+		m_Drones.Create(m_iDroneSheet, fRandom[0] * GAME_WIDTH, fRandom[1] * GAME_HEIGHT);
+		float fAngle = fRandom[2] * 2.0f * (float)PI;
+		m_Drones.GetAngle()[i] = fAngle;
+		m_Drones.GetVelocityX()[i] = sinf(fAngle) * DRONE_SPEED;
+		m_Drones.GetVelocityY()[i] = -cosf(fAngle) * DRONE_SPEED;
+		m_Drones.GetAimX()[i] = m_Drones.GetVelocityX()[i];
+		m_Drones.GetAimY()[i] = m_Drones.GetVelocityY()[i];
+		m_Drones.GetFrame()[i] = SHIP_START_FRAME + i % (SHIP_END_FRAME - SHIP_START_FRAME + 1);
+	}
+	m_Drones.StorePreviousState();
+}
+
+void Spacewar::UpdateShipsJob(void* pData, int, int)
+{
+	((Spacewar*)pData)->UpdateShips();
+}
+
+// Move, wrap and animate a range of drones.
+void Spacewar::UpdateDronesJob(void* pData, int iBegin, int iEnd)
+{
+	Spacewar* pGame = (Spacewar*)pData;
+	EntityStore& drones = pGame->m_Drones;
+	float fTickTime = pGame->m_fTickTime;
+
+	float* pX = drones.GetX();
+	float* pY = drones.GetY();
+	float* pVelocityX = drones.GetVelocityX();
+	float* pVelocityY = drones.GetVelocityY();
+	pGame->ApplyGravity(pX + iBegin, pY + iBegin, SHIP_WIDTH * .5f, SHIP_HEIGHT * .5f, iEnd - iBegin,
+		pVelocityX + iBegin, pVelocityY + iBegin);
+	Kinematics::Move(pX + iBegin, pY + iBegin, pVelocityX + iBegin, pVelocityY + iBegin, iEnd - iBegin, fTickTime,
+		(float)SHIP_WIDTH, (float)SHIP_HEIGHT, (float)GAME_WIDTH, (float)GAME_HEIGHT);
+
+	float* pAngle = drones.GetAngle();
+	for(int i = iBegin; i < iEnd; ++i)
+	{
+		pAngle[i] = atan2f(pVelocityX[i], -pVelocityY[i]);
+	}
+
+	// Every drone is drawn from the drone sheet, so they all step alike.
+	const SpriteSheet& sheet = drones.GetSheet(pGame->m_iDroneSheet);
+	AnimationSystem::AdvanceLooping(drones.GetAnimTimer() + iBegin, drones.GetFrame() + iBegin, iEnd - iBegin,
+		fTickTime, sheet.fFrameDelay, sheet.iStartFrame, sheet.iEndFrame);
+}
+
+void Spacewar::UpdateTorpedoesJob(void* pData, int iBegin, int iEnd)
+{
+	Spacewar* pGame = (Spacewar*)pData;
+	ProjectilePool& torpedoes = pGame->m_Torpedoes;
+	pGame->ApplyGravity(torpedoes.GetX() + iBegin, torpedoes.GetY() + iBegin, TORPEDO_WIDTH * .5f, TORPEDO_HEIGHT * .5f,
+		iEnd - iBegin, torpedoes.GetVelocityX() + iBegin, torpedoes.GetVelocityY() + iBegin);
+	torpedoes.Update(pGame->m_fTickTime, iBegin, iEnd);
+}
+
+// The whole system in one job, since removing the dead reorders it.
+void Spacewar::UpdateParticlesJob(void* pData, int, int)
+{
+	Spacewar* pGame = (Spacewar*)pData;
+	pGame->m_Particles.Update(pGame->m_fTickTime);
+}
+
+// Turn a range of drones toward the velocity the AI last chose for them.
+// Each drone only writes itself, so the order of chunks doesn't matter.
+void Spacewar::SteerDronesJob(void* pData, int iBegin, int iEnd)
+{
+	Spacewar* pGame = (Spacewar*)pData;
+	float fBlend = DRONE_STEER_RATE * pGame->m_fTickTime;
+	if(fBlend > 1.0f)
+	{
+		fBlend = 1.0f;
+	}
+
+	const float* pAimX = pGame->m_Drones.GetAimX();
+	const float* pAimY = pGame->m_Drones.GetAimY();
+	float* pVelocityX = pGame->m_Drones.GetVelocityX();
+	float* pVelocityY = pGame->m_Drones.GetVelocityY();
+	for(int i = iBegin; i < iEnd; ++i)
+	{
+		pVelocityX[i] += (pAimX[i] - pVelocityX[i]) * fBlend;
+		pVelocityY[i] += (pAimY[i] - pVelocityY[i]) * fBlend;
+	}
+}
+
+// Decide bots [iBegin, iEnd). Run by the AI scheduler, on the main thread.
+void Spacewar::DecideBotsJob(void* pData, int iBegin, int iEnd)
+{
+	Spacewar* pGame = (Spacewar*)pData;
+	if(0 == iBegin)
+	{
+		pGame->Decide(pGame->m_Ship2.GetCenterX(), pGame->m_Ship2.GetCenterY(), SHIP_SPEED, 1,
+			pGame->m_fShip2AimX, pGame->m_fShip2AimY);
+		++iBegin;
+	}
+
+	const float* pX = pGame->m_Drones.GetX();
+	const float* pY = pGame->m_Drones.GetY();
+	float* pAimX = pGame->m_Drones.GetAimX();
+	float* pAimY = pGame->m_Drones.GetAimY();
+	for(int i = iBegin - 1; i < iEnd - 1; ++i)
+	{
+		pGame->Decide(pX[i] + SHIP_WIDTH * .5f, pY[i] + SHIP_HEIGHT * .5f, DRONE_SPEED, -1, pAimX[i], pAimY[i]);
+	}
+}
+
+// Push a range of drones out of the planet and bounce them off it.
+// Hits are counted per chunk and summed in chunk order afterwards.
+void Spacewar::CollideDronesJob(void* pData, int iBegin, int iEnd)
+{
+	Spacewar* pGame = (Spacewar*)pData;
+	const Image& planet = pGame->m_Planet;
+	float fPlanetX = planet.GetX() + planet.GetWidth() * .5f;
+	float fPlanetY = planet.GetY() + planet.GetHeight() * .5f;
+	float fRadius = (planet.GetWidth() + SHIP_WIDTH) * .5f;
+
+	float* pX = pGame->m_Drones.GetX();
+	float* pY = pGame->m_Drones.GetY();
+	float* pVelocityX = pGame->m_Drones.GetVelocityX();
+	float* pVelocityY = pGame->m_Drones.GetVelocityY();
+	int iHits = 0;
+	for(int i = iBegin; i < iEnd; ++i)
+	{
+		float fDX = pX[i] + SHIP_WIDTH * .5f - fPlanetX;
+		float fDY = pY[i] + SHIP_HEIGHT * .5f - fPlanetY;
+		float fDistanceSq = fDX * fDX + fDY * fDY;
+		if(fDistanceSq >= fRadius * fRadius || fDistanceSq <= 0.0f)
+		{
+			continue;
+		}
+
+		float fDistance = sqrtf(fDistanceSq);
+		float fNormalX = fDX / fDistance;
+		float fNormalY = fDY / fDistance;
+		pX[i] += fNormalX * (fRadius - fDistance);
+		pY[i] += fNormalY * (fRadius - fDistance);
+
+		float fInward = pVelocityX[i] * fNormalX + pVelocityY[i] * fNormalY;
+		if(fInward < 0.0f)
+		{
+			pVelocityX[i] -= 2.0f * fInward * fNormalX;
+			pVelocityY[i] -= 2.0f * fInward * fNormalY;
+		}
+		++iHits;
+	}
+
+	pGame->m_pDroneHits[iBegin / JobSystemNS::DEFAULT_GRAIN] = iHits;
+}
+
+// Player ships and drones don't touch each other's state, so they run side by side.
 void Spacewar::Update(void)
 {
-	// Update ship 1
+	PROFILE_SCOPE("Spacewar::Update");
+
+	// Everything is pulled toward where the others started the tick.
+	if(m_bMutualGravity)
+	{
+		BuildGravity();
+	}
+
+	Job* pShips = m_Jobs.CreateJob(UpdateShipsJob, this);
+	Job* pDrones = m_Jobs.CreateParallelFor(UpdateDronesJob, this, m_Drones.GetCount());
+	Job* pTorpedoes = m_Jobs.CreateParallelFor(UpdateTorpedoesJob, this, m_Torpedoes.GetCount());
+	Job* pDone = m_Jobs.CreateJob(nullptr, nullptr);
+	m_Jobs.AddDependency(pDone, pShips);
+	m_Jobs.AddDependency(pDone, pDrones);
+	m_Jobs.AddDependency(pDone, pTorpedoes);
+
+	// Particles aren't saved, so ticks run again after a rollback leave them where they are.
+	Job* pParticles = nullptr;
+	if(!IsResimulating())
+	{
+		pParticles = m_Jobs.CreateJob(UpdateParticlesJob, this);
+		m_Jobs.AddDependency(pDone, pParticles);
+	}
+
+	// The ships queue new torpedoes while the pool is being moved, Collisions adds them.
+	m_Jobs.Submit(pShips);
+	m_Jobs.Submit(pDrones);
+	m_Jobs.Submit(pTorpedoes);
+	if(pParticles)
+	{
+		m_Jobs.Submit(pParticles);
+	}
+	m_Jobs.Submit(pDone);
+	m_Jobs.Wait(pDone);
+
+	// New exhaust starts moving next tick.
+	EmitExhaust(m_Ship1, 0);
+	EmitExhaust(m_Ship2, 1);
+}
+
+// Player 1's ship keys, sent to the remote peer.
+uint8_t Spacewar::GetNetInput(void)
+{
+	using namespace NetSessionNS;
+	return (m_pInput->IsKeyDown(SHIP_LEFT_KEY) ? LEFT : 0) | (m_pInput->IsKeyDown(SHIP_RIGHT_KEY) ? RIGHT : 0) |
+		(m_pInput->IsKeyDown(SHIP_UP_KEY) ? UP : 0) | (m_pInput->IsKeyDown(SHIP_DOWN_KEY) ? DOWN : 0) |
+		(m_pInput->IsKeyDown(SHIP_FIRE_KEY) ? FIRE : 0);
+}
+
+void Spacewar::SetShipIntents(void)
+{
+	if(m_pNetSession)
 	{
-		// Update the ship movement based on player's input from keyboard
-		if(m_pInput->IsKeyDown(SHIP_RIGHT_KEY))
+		using namespace NetSessionNS;
+		for(int i = 0; i < 2; ++i)
 		{
-			// Rotate the ship.
-			m_Ship1.SetRotationInDegrees(m_Ship1.GetRotationInDegrees() + m_fFrameTime * ROTATION_RATE);
-			if(m_Ship1.GetX() > GAME_WIDTH)
-			{
-				m_Ship1.SetX((float)-m_Ship1.GetWidth());
-			}
+			uint8_t iInput = m_pNetSession->GetInput(m_iTickCount, i);
+			m_fShipThrustX[i] = 0.0f;
+			m_fShipThrustY[i] = (float)(0 != (iInput & DOWN)) - (float)(0 != (iInput & UP));
+			m_fShipTurn[i] = (float)(0 != (iInput & RIGHT)) - (float)(0 != (iInput & LEFT));
+			m_bShipFire[i] = 0 != (iInput & FIRE);
 		}
+		return;
+	}
+
+	m_fShipThrustX[0] = 0.0f;
+	m_fShipThrustY[0] = (float)m_pInput->IsKeyDown(SHIP_DOWN_KEY) - (float)m_pInput->IsKeyDown(SHIP_UP_KEY);
+	m_fShipTurn[0] = (float)m_pInput->IsKeyDown(SHIP_RIGHT_KEY) - (float)m_pInput->IsKeyDown(SHIP_LEFT_KEY);
+	m_bShipFire[0] = m_pInput->IsKeyDown(SHIP_FIRE_KEY);
+	m_bShipFire[1] = false;
 
-		if(m_pInput->IsKeyDown(SHIP_LEFT_KEY))
+	// Ship 2 flies where it last decided to, nose first.
+	m_fShipThrustX[1] = m_fShip2AimX / SHIP_SPEED;
+	m_fShipThrustY[1] = m_fShip2AimY / SHIP_SPEED;
+	float fTurn = 0.0f;
+	if(m_fShip2AimX != 0.0f || m_fShip2AimY != 0.0f)
+	{
+		// Full turn until a tick of it would overshoot the heading.
+		float fHeading = atan2f(m_fShip2AimX, -m_fShip2AimY);
+		float fError = fmodf(fHeading - m_Ship2.GetRotationInRadians(), 2.0f * (float)PI);
+		fError += (fError > (float)PI) ? -2.0f * (float)PI : ((fError < -(float)PI) ? 2.0f * (float)PI : 0.0f);
+		fTurn = fError / (ROTATION_RATE * ((float)PI / 180.0f) * m_fTickTime);
+		fTurn = (fTurn > 1.0f) ? 1.0f : ((fTurn < -1.0f) ? -1.0f : fTurn);
+	}
+	m_fShipTurn[1] = fTurn;
+}
+
+// Update ships 1 and 2.
+void Spacewar::UpdateShips(void)
+{
+	DriftShip(m_Ship1, 0);
+	DriftShip(m_Ship2, 1);
+	SetShipIntents();
+
+	// Both ships move as one batch.
+	Image* pShips[2] = { &m_Ship1, &m_Ship2 };
+	float fX[2], fY[2], fAngle[2];
+	for(int i = 0; i < 2; ++i)
+	{
+		fX[i] = pShips[i]->GetX();
+		fY[i] = pShips[i]->GetY();
+		fAngle[i] = pShips[i]->GetRotationInRadians();
+	}
+
+	KinematicBodies ships = { fX, fY, fAngle, m_fShipDriftX, m_fShipDriftY, m_fShipThrustX, m_fShipThrustY, m_fShipTurn };
+	Kinematics::Integrate(ships, 2, m_fTickTime, SHIP_SPEED, ROTATION_RATE * ((float)PI / 180.0f),
+		(float)SHIP_WIDTH, (float)SHIP_HEIGHT, (float)GAME_WIDTH, (float)GAME_HEIGHT);
+	for(int i = 0; i < 2; ++i)
+	{
+		pShips[i]->SetX(fX[i]);
+		pShips[i]->SetY(fY[i]);
+		pShips[i]->SetAngleInRadians(fAngle[i]);
+	}
+
+	// Fire from the nose.
+	for(int i = 0; i < 2; ++i)
+	{
+		if(m_fFireTimer[i] > 0.0f)
 		{
-			// Rotate the ship.
-			m_Ship1.SetRotationInDegrees(m_Ship1.GetRotationInDegrees() + m_fFrameTime * -ROTATION_RATE);
-			if(m_Ship1.GetX() < - m_Ship1.GetWidth())
-			{
-				m_Ship1.SetX((float)GAME_WIDTH);
-			}
+			m_fFireTimer[i] -= m_fTickTime;
+		}
+		if(m_bShipFire[i] && m_fFireTimer[i] <= 0.0f)
+		{
+			FireTorpedo(*pShips[i], i, pShips[i]->GetRotationInRadians());
+			m_fFireTimer[i] = TORPEDO_FIRE_DELAY;
 		}
+	}
 
-		if(m_pInput->IsKeyDown(SHIP_UP_KEY))
+	// Stress test. The ships take turns firing, each shot turned by the golden angle.
+	if(m_iTorpedoRate > 0)
+	{
+		int iShot = 0;
+		for(m_fStressShots += m_iTorpedoRate * m_fTickTime; m_fStressShots >= 1.0f; m_fStressShots -= 1.0f, ++iShot)
 		{
-			m_Ship1.SetY(m_Ship1.GetY() - m_fFrameTime * SHIP_SPEED);
-			if(m_Ship1.GetY() < -m_Ship1.GetHeight())
-			{
-				m_Ship1.SetY((float)GAME_HEIGHT);
-			}
+			m_fStressAngle = fmodf(m_fStressAngle + 2.3999632f, 2.0f * (float)PI);
+			bool bShip2 = 0 != ((m_iTickCount + iShot) & 1);
+			FireTorpedo(bShip2 ? m_Ship2 : m_Ship1, bShip2 ? 1 : 0, m_fStressAngle);
+		}
+	}
+}
+
+void Spacewar::BuildGravity(void)
+{
+	PROFILE_SCOPE("Spacewar::BuildGravity");
+
+	int iCount = 2 + m_Drones.GetCount() + m_Torpedoes.GetCount();
+	float* pX = GetTickArena()->AllocateArray<float>(iCount);
+	float* pY = GetTickArena()->AllocateArray<float>(iCount);
+	float* pMass = GetTickArena()->AllocateArray<float>(iCount);
+
+	const Image* pShips[2] = { &m_Ship1, &m_Ship2 };
+	for(int i = 0; i < 2; ++i)
+	{
+		pX[i] = pShips[i]->GetX() + (float)(pShips[i]->GetWidth() / 2) * pShips[i]->GetScale();
+		pY[i] = pShips[i]->GetY() + (float)(pShips[i]->GetHeight() / 2) * pShips[i]->GetScale();
+		pMass[i] = SHIP_GRAVITY;
+	}
+
+	// Centers as ApplyGravity sees them, so nothing pulls on itself.
+	int iBody = 2;
+	const float* pDroneX = m_Drones.GetX();
+	const float* pDroneY = m_Drones.GetY();
+	for(int i = 0; i < m_Drones.GetCount(); ++i, ++iBody)
+	{
+		pX[iBody] = pDroneX[i] + SHIP_WIDTH * .5f;
+		pY[iBody] = pDroneY[i] + SHIP_HEIGHT * .5f;
+		pMass[iBody] = DRONE_GRAVITY;
+	}
+
+	const float* pTorpedoX = m_Torpedoes.GetX();
+	const float* pTorpedoY = m_Torpedoes.GetY();
+	for(int i = 0; i < m_Torpedoes.GetCount(); ++i, ++iBody)
+	{
+		pX[iBody] = pTorpedoX[i] + TORPEDO_WIDTH * .5f;
+		pY[iBody] = pTorpedoY[i] + TORPEDO_HEIGHT * .5f;
+		pMass[iBody] = TORPEDO_GRAVITY;
+	}
+
+	m_Gravity.Build(pX, pY, pMass, iCount);
+}
+
+void Spacewar::ApplyGravity(const float* pX, const float* pY, float fOffsetX, float fOffsetY, int iCount,
+	float* pVelocityX, float* pVelocityY) const
+{
+	float fPlanetX = m_Planet.GetX() + m_Planet.GetWidth() * .5f;
+	float fPlanetY = m_Planet.GetY() + m_Planet.GetHeight() * .5f;
+	m_Gravity.PullToward(fPlanetX, fPlanetY, PLANET_GRAVITY, pX, pY, fOffsetX, fOffsetY, iCount, pVelocityX, pVelocityY, m_fTickTime);
+	if(m_bMutualGravity)
+	{
+		m_Gravity.Accelerate(pX, pY, fOffsetX, fOffsetY, iCount, pVelocityX, pVelocityY, m_fTickTime);
+	}
+}
+
+// Ships steer by hand, so gravity adds a drift on top rather than steering them.
+// Runs before the controls move the ship, while it is still where BuildGravity saw it.
+void Spacewar::DriftShip(const Image& ship, int iShip)
+{
+	float fX = ship.GetX();
+	float fY = ship.GetY();
+	float fHalfWidth = (float)(ship.GetWidth() / 2) * ship.GetScale();
+	float fHalfHeight = (float)(ship.GetHeight() / 2) * ship.GetScale();
+	ApplyGravity(&fX, &fY, fHalfWidth, fHalfHeight, 1, &m_fShipDriftX[iShip], &m_fShipDriftY[iShip]);
+
+	float fSpeed = sqrtf(m_fShipDriftX[iShip] * m_fShipDriftX[iShip] + m_fShipDriftY[iShip] * m_fShipDriftY[iShip]);
+	if(fSpeed > SHIP_MAX_DRIFT)
+	{
+		m_fShipDriftX[iShip] *= SHIP_MAX_DRIFT / fSpeed;
+		m_fShipDriftY[iShip] *= SHIP_MAX_DRIFT / fSpeed;
+	}
+}
+
+void Spacewar::FireTorpedo(const Image& ship, int iOwner, float fAngle)
+{
+	float fX = ship.GetCenterX() - TORPEDO_WIDTH * .5f;
+	float fY = ship.GetCenterY() - TORPEDO_HEIGHT * .5f;
+	m_Torpedoes.Spawn(fX, fY, sinf(fAngle) * TORPEDO_SPEED, -cosf(fAngle) * TORPEDO_SPEED, TORPEDO_LIFETIME, iOwner);
+}
+
+void Spacewar::EmitExhaust(const Image& ship, int iShip)
+{
+	// Which way the ship went this tick, the short way around the screen.
+	float fDX = SweptCollision::Wrap(ship.GetX() - ship.GetPrevX(), (float)GAME_WIDTH);
+	float fDY = SweptCollision::Wrap(ship.GetY() - ship.GetPrevY(), (float)GAME_HEIGHT);
+	float fDistance = sqrtf(fDX * fDX + fDY * fDY);
+	if(fDistance <= 0.0f)
+	{
+		m_fExhaustOwed[iShip] = 0.0f;
+		return;
+	}
+
+	m_fExhaustOwed[iShip] += EXHAUST_RATE * m_fTickTime;
+	int iCount = (int)m_fExhaustOwed[iShip];
+	m_fExhaustOwed[iShip] -= (float)iCount;
+
+	// What is owed is saved, but the sparks went out the first time through the tick.
+	if(IsResimulating())
+	{
+		return;
+	}
+
+	// Out of the back of the ship, away from where it is heading.
+	float fBackX = -fDX / fDistance;
+	float fBackY = -fDY / fDistance;
+	float fHalfWidth = (float)(ship.GetWidth() / 2) * ship.GetScale();
+	m_Particles.Emit(ship.GetCenterX() + fBackX * fHalfWidth, ship.GetCenterY() + fBackY * fHalfWidth,
+		fBackX * EXHAUST_SPEED, fBackY * EXHAUST_SPEED, EXHAUST_SPREAD, EXHAUST_LIFETIME, EXHAUST_COLOR, iCount);
+}
+
+void Spacewar::EmitExplosion(int iTorpedo, float fTime)
+{
+	// The first time through the tick already set this one off.
+	if(IsResimulating())
+	{
+		return;
+	}
+
+	const SweptCircle& torpedo = m_pSweeps[SpacewarNS::FIRST_DRONE_ID + m_Drones.GetCount() + iTorpedo];
+	m_Particles.Emit(torpedo.fX + torpedo.fDX * fTime, torpedo.fY + torpedo.fDY * fTime, 0.0f, 0.0f,
+		EXPLOSION_SPEED, EXPLOSION_LIFETIME, EXPLOSION_COLOR, EXPLOSION_PARTICLES);
+}
+
+void Spacewar::AI(void)
+{
+	// Chase the ships as they are at the end of Update.
+	const Image* pShips[2] = { &m_Ship1, &m_Ship2 };
+	for(int i = 0; i < 2; ++i)
+	{
+		m_fTargetX[i] = pShips[i]->GetCenterX();
+		m_fTargetY[i] = pShips[i]->GetCenterY();
+		m_fTargetVelocityX[i] = SweptCollision::Wrap(pShips[i]->GetX() - pShips[i]->GetPrevX(), (float)GAME_WIDTH) / m_fTickTime;
+		m_fTargetVelocityY[i] = SweptCollision::Wrap(pShips[i]->GetY() - pShips[i]->GetPrevY(), (float)GAME_HEIGHT) / m_fTickTime;
+	}
+	m_fAvoidX = m_Planet.GetCenterX();
+	m_fAvoidY = m_Planet.GetCenterY();
+	m_fAvoidRadius = (m_Planet.GetWidth() * m_Planet.GetScale() + SHIP_WIDTH) * .5f + AI_PLANET_MARGIN;
+
+	// Some bots think this tick, the rest keep to their last decision.
+	m_AI.RunSlice(DecideBotsJob, this, m_Drones.GetCount() + 1);
+	m_Jobs.ParallelFor(SteerDronesJob, this, m_Drones.GetCount());
+}
+
+void Spacewar::Decide(float fX, float fY, float fSpeed, int iSelf, float& fAimX, float& fAimY) const
+{
+	// The nearest ship, the short way around.
+	int iTarget = (1 == iSelf) ? 0 : 1;
+	float fBest = -1.0f;
+	float fToX = 0.0f;
+	float fToY = 0.0f;
+	for(int j = 0; j < 2; ++j)
+	{
+		float fDX = SweptCollision::Wrap(m_fTargetX[j] - fX, (float)GAME_WIDTH);
+		float fDY = SweptCollision::Wrap(m_fTargetY[j] - fY, (float)GAME_HEIGHT);
+		float fDistance = fDX * fDX + fDY * fDY;
+		if(j != iSelf && (fBest < 0.0f || fDistance < fBest))
+		{
+			fBest = fDistance;
+			iTarget = j;
+			fToX = fDX;
+			fToY = fDY;
 		}
+	}
 
-		if(m_pInput->IsKeyDown(SHIP_DOWN_KEY))
+	// Intercept: the soonest t with |to + velocity * t| = speed * t.
+	float fVX = m_fTargetVelocityX[iTarget];
+	float fVY = m_fTargetVelocityY[iTarget];
+	float fA = fVX * fVX + fVY * fVY - fSpeed * fSpeed;
+	float fB = 2.0f * (fToX * fVX + fToY * fVY);
+	float fC = fToX * fToX + fToY * fToY;
+	float fTime = 0.0f;
+	if(fabsf(fA) < 1e-3f)
+	{
+		fTime = (fB < 0.0f) ? -fC / fB : 0.0f;
+	}
+	else
+	{
+		float fRoot = fB * fB - 4.0f * fA * fC;
+		if(fRoot >= 0.0f)
 		{
-			m_Ship1.SetY(m_Ship1.GetY() + m_fFrameTime * SHIP_SPEED);
-			if(m_Ship1.GetY() > GAME_HEIGHT)
+			fRoot = sqrtf(fRoot);
+			float fEarly = (-fB - fRoot) / (2.0f * fA);
+			float fLate = (-fB + fRoot) / (2.0f * fA);
+			float fFirst = (fEarly < fLate) ? fEarly : fLate;
+			float fSecond = (fEarly < fLate) ? fLate : fEarly;
+			fTime = (fFirst > 0.0f) ? fFirst : ((fSecond > 0.0f) ? fSecond : 0.0f);
+		}
+	}
+	fTime = (fTime < AI_LOOKAHEAD) ? fTime : AI_LOOKAHEAD;
+	float fWayX = fToX + fVX * fTime;
+	float fWayY = fToY + fVY * fTime;
+	float fLength = sqrtf(fWayX * fWayX + fWayY * fWayY);
+	if(fLength <= 0.0f)
+	{
+		fAimX = 0.0f;
+		fAimY = 0.0f;
+		return;
+	}
+	fWayX /= fLength;
+	fWayY /= fLength;
+
+	// Evasion: if the way passes too close to the planet, lean away from it, harder the closer.
+	float fPlanetX = SweptCollision::Wrap(m_fAvoidX - fX, (float)GAME_WIDTH);
+	float fPlanetY = SweptCollision::Wrap(m_fAvoidY - fY, (float)GAME_HEIGHT);
+	float fAlong = fPlanetX * fWayX + fPlanetY * fWayY;
+	if(fAlong > 0.0f && fAlong < fLength + m_fAvoidRadius)
+	{
+		// From the planet to the nearest point on the way.
+		float fOffX = fWayX * fAlong - fPlanetX;
+		float fOffY = fWayY * fAlong - fPlanetY;
+		float fOff = sqrtf(fOffX * fOffX + fOffY * fOffY);
+		if(fOff < m_fAvoidRadius)
+		{
+			if(fOff <= 0.0f)
 			{
-				m_Ship1.SetY((float)-m_Ship1.GetHeight());
+				fOffX = -fWayY;
+				fOffY = fWayX;
+				fOff = 1.0f;
 			}
+			float fPush = 2.0f * (1.0f - fOff / m_fAvoidRadius) / fOff;
+			fWayX += fOffX * fPush;
+			fWayY += fOffY * fPush;
+			fLength = sqrtf(fWayX * fWayX + fWayY * fWayY);
+			fWayX /= fLength;
+			fWayY /= fLength;
+		}
+	}
+
+	fAimX = fWayX * fSpeed;
+	fAimY = fWayY * fSpeed;
+}
+
+void Spacewar::Collisions(void)
+{
+	if(m_Drones.GetCount() > 0)
+	{
+		int iChunks = m_Drones.GetCount() / JobSystemNS::DEFAULT_GRAIN + 1;
+		m_pDroneHits = GetTickArena()->AllocateArray<int>(iChunks);
+		memset(m_pDroneHits, 0, iChunks * sizeof(int));
+		m_Jobs.ParallelFor(CollideDronesJob, this, m_Drones.GetCount());
+		for(int i = 0; i < iChunks; ++i)
+		{
+			m_iDroneHitTotal += m_pDroneHits[i];
+		}
+		m_pDroneHits = nullptr;
+	}
+
+	CollideObjects();
+
+	// End of the tick, apply the spawns and kills queued during it.
+	m_Torpedoes.Flush();
+}
+
+// Ids in m_Collisions: the two ships, the planet, then the drones, then the torpedoes.
+// Pairs come lowest id first, so each pair below is matched in that order.
+void Spacewar::CollideObjects(void)
+{
+	using namespace SpacewarNS;
+
+	int iFirstDrone = FIRST_DRONE_ID;
+	int iFirstTorpedo = iFirstDrone + m_Drones.GetCount();
+	int iCount = iFirstTorpedo + m_Torpedoes.GetCount();
+	m_Collisions.SetObjectCount(iCount);
+	m_pSweeps = GetTickArena()->AllocateArray<SweptCircle>(iCount);
+	m_pSweepMasks = GetTickArena()->AllocateArray<const MaskFrame*>(iCount);
+
+	// Where each center ended the tick and how far it came. Sprites scale about their
+	// centers, and scales change slowly, so a center moves with the sprite's corner.
+	float fCenterX, fCenterY, fExtentX, fExtentY;
+	const Image* pShips[2] = { &m_Ship1, &m_Ship2 };
+	for(int i = 0; i < 2; ++i)
+	{
+		SpatialHash::GetBounds(pShips[i]->GetSpriteInfo(), fCenterX, fCenterY, fExtentX, fExtentY);
+		m_pSweeps[i].fX = fCenterX;
+		m_pSweeps[i].fY = fCenterY;
+		m_pSweeps[i].fDX = pShips[i]->GetX() - pShips[i]->GetPrevX();
+		m_pSweeps[i].fDY = pShips[i]->GetY() - pShips[i]->GetPrevY();
+	}
+
+	SpatialHash::GetBounds(m_Planet.GetSpriteInfo(), fCenterX, fCenterY, fExtentX, fExtentY);
+	m_pSweeps[PLANET_ID].fX = fCenterX;
+	m_pSweeps[PLANET_ID].fY = fCenterY;
+	m_pSweeps[PLANET_ID].fDX = 0.0f;
+	m_pSweeps[PLANET_ID].fDY = 0.0f;
+
+	const float* pX = m_Drones.GetX();
+	const float* pY = m_Drones.GetY();
+	const float* pPrevX = m_Drones.GetPrevX();
+	const float* pPrevY = m_Drones.GetPrevY();
+	const float* pScale = m_Drones.GetScale();
+	for(int i = 0; i < m_Drones.GetCount(); ++i)
+	{
+		SweptCircle& sweep = m_pSweeps[iFirstDrone + i];
+		sweep.fX = pX[i] + (float)(SHIP_WIDTH / 2) * pScale[i];
+		sweep.fY = pY[i] + (float)(SHIP_HEIGHT / 2) * pScale[i];
+		sweep.fDX = pX[i] - pPrevX[i];
+		sweep.fDY = pY[i] - pPrevY[i];
+	}
+
+	const float* pTorpedoX = m_Torpedoes.GetX();
+	const float* pTorpedoY = m_Torpedoes.GetY();
+	const float* pTorpedoPrevX = m_Torpedoes.GetPrevX();
+	const float* pTorpedoPrevY = m_Torpedoes.GetPrevY();
+	for(int i = 0; i < m_Torpedoes.GetCount(); ++i)
+	{
+		SweptCircle& sweep = m_pSweeps[iFirstTorpedo + i];
+		sweep.fX = pTorpedoX[i] + TORPEDO_WIDTH * .5f;
+		sweep.fY = pTorpedoY[i] + TORPEDO_HEIGHT * .5f;
+		sweep.fDX = pTorpedoX[i] - pTorpedoPrevX[i];
+		sweep.fDY = pTorpedoY[i] - pTorpedoPrevY[i];
+	}
+
+	// Take the motion the short way around the screen and wind the centers back to
+	// the start of the tick. Each box covers the mask, which Place can put half a pixel
+	// either way, along the whole path; the circle is the one around that.
+	for(int i = 0; i < iCount; ++i)
+	{
+		SweptCircle& sweep = m_pSweeps[i];
+		sweep.fDX = SweptCollision::Wrap(sweep.fDX, (float)GAME_WIDTH);
+		sweep.fDY = SweptCollision::Wrap(sweep.fDY, (float)GAME_HEIGHT);
+		sweep.fX -= sweep.fDX;
+		sweep.fY -= sweep.fDY;
+
+		const MaskFrame* pMask = &GetCollisionMask(i, iFirstTorpedo);
+		m_pSweepMasks[i] = pMask;
+		fExtentX = pMask->iWidth * .5f + .5f;
+		fExtentY = pMask->iHeight * .5f + .5f;
+		sweep.fRadius = sqrtf(fExtentX * fExtentX + fExtentY * fExtentY);
+
+		uint32_t iCategory = COLLIDE_TORPEDO;
+		uint32_t iMask = COLLIDE_SHIP | COLLIDE_DRONE | COLLIDE_PLANET;
+		if(i < PLANET_ID)
+		{
+			iCategory = COLLIDE_SHIP;
+			iMask = COLLIDE_DRONE | COLLIDE_TORPEDO;
 		}
-		m_Ship1.Update(m_fFrameTime);
+		else if(PLANET_ID == i)
+		{
+			// Drones bounce off the planet in CollideDronesJob, only torpedoes hit it here.
+			iCategory = COLLIDE_PLANET;
+			iMask = COLLIDE_TORPEDO;
+		}
+		else if(i < iFirstTorpedo)
+		{
+			iCategory = COLLIDE_DRONE;
+			iMask = COLLIDE_SHIP | COLLIDE_TORPEDO;
+		}
+
+		m_Collisions.SetBounds(i, sweep.fX + sweep.fDX * .5f, sweep.fY + sweep.fDY * .5f,
+			fExtentX + fabsf(sweep.fDX) * .5f, fExtentY + fabsf(sweep.fDY) * .5f, iCategory, iMask);
 	}
 
-	// Update ship 2
+	m_Collisions.FindPairs();
+
+	const float* pLife = m_Torpedoes.GetLife();
+	const std::vector<CollisionPair>& pairs = m_Collisions.GetPairs();
+	SweepHit* pHits = GetTickArena()->AllocateArray<SweepHit>(pairs.size() + 1);
+	int iHits = 0;
+	for(size_t i = 0; i < pairs.size(); ++i)
 	{
-		m_Ship2.Update(m_fFrameTime);
-		
-		m_Ship2.SetRotationInDegrees((m_Ship2.GetRotationInDegrees() + m_fFrameTime * -ROTATION_RATE));
+		int iFirst = (int)pairs[i].iFirst;
+		int iSecond = (int)pairs[i].iSecond;
+		if(iSecond >= iFirstTorpedo && pLife[iSecond - iFirstTorpedo] <= 0.0f)
+		{
+			// Spent before the tick.
+			continue;
+		}
 
-		// Move ship downwards.
-		m_Ship2.SetY(m_Ship2.GetY() + m_fFrameTime * SHIP_SPEED);
+		// Paths' boxes overlap, find when the pixels first do.
+		++m_iPairsTested;
+		float fTime;
+		if(!FirstTouch(iFirst, iSecond, fTime))
+		{
+			continue;
+		}
+		++m_iPairsTouching;
 
-		// Change the size of ship.
-		m_Ship2.SetScale(m_Ship2.GetScale() - m_fFrameTime * SCALE_RATE);
-		if(m_Ship2.GetY() > GAME_HEIGHT)
+		SweepHit& hit = pHits[iHits++];
+		hit.fTime = fTime;
+		hit.iFirst = (uint32_t)iFirst;
+		hit.iSecond = (uint32_t)iSecond;
+	}
+
+	// Respond in the order things happened, so a torpedo is spent on the first thing in its way.
+	// Ties go by id, keeping the order repeatable.
+	std::sort(pHits, pHits + iHits);
+	for(int i = 0; i < iHits; ++i)
+	{
+		int iSecond = (int)pHits[i].iSecond;
+		if(iSecond >= iFirstTorpedo && pLife[iSecond - iFirstTorpedo] <= 0.0f)
 		{
-			m_Ship2.SetY((float)-m_Ship2.GetHeight());
-			m_Ship2.SetScale(SHIP_SCALE);
+			// Already spent on something it reached earlier.
+			continue;
 		}
+
+		Collide(pHits[i], iFirstTorpedo);
 	}
+
+	m_pSweeps = nullptr;
+	m_pSweepMasks = nullptr;
 }
 
-void Spacewar::AI(void)
+void Spacewar::Collide(const SweepHit& hit, int iFirstTorpedo)
+{
+	using namespace SpacewarNS;
+
+	int iFirst = (int)hit.iFirst;
+	int iSecond = (int)hit.iSecond;
+	int iTorpedo = iSecond - iFirstTorpedo;
+	float* pVelocityX = m_Drones.GetVelocityX();
+	float* pVelocityY = m_Drones.GetVelocityY();
+
+	if(PLANET_ID == iFirst)
+	{
+		// Torpedoes burn up in the planet.
+		m_Torpedoes.Kill(iTorpedo);
+	}
+	else if(iFirst < PLANET_ID && iSecond >= iFirstTorpedo)
+	{
+		// Torpedo hits a ship, other than the one that fired it.
+		if(m_Torpedoes.GetOwner()[iTorpedo] != iFirst)
+		{
+			EmitExplosion(iTorpedo, hit.fTime);
+			m_Torpedoes.Kill(iTorpedo);
+			++m_iShipHits[iFirst];
+		}
+	}
+	else if(iFirst < PLANET_ID)
+	{
+		// Ship meets a drone. Bounce the drone off where they met, the short way around the screen.
+		int iDrone = iSecond - FIRST_DRONE_ID;
+		const SweptCircle& ship = m_pSweeps[iFirst];
+		const SweptCircle& drone = m_pSweeps[iSecond];
+		float fDX = SweptCollision::Wrap(drone.fX - ship.fX, (float)GAME_WIDTH) + (drone.fDX - ship.fDX) * hit.fTime;
+		float fDY = SweptCollision::Wrap(drone.fY - ship.fY, (float)GAME_HEIGHT) + (drone.fDY - ship.fDY) * hit.fTime;
+		float fDistance = sqrtf(fDX * fDX + fDY * fDY);
+		if(fDistance > 0.0f)
+		{
+			float fNormalX = fDX / fDistance;
+			float fNormalY = fDY / fDistance;
+			float fInward = pVelocityX[iDrone] * fNormalX + pVelocityY[iDrone] * fNormalY;
+			if(fInward < 0.0f)
+			{
+				pVelocityX[iDrone] -= 2.0f * fInward * fNormalX;
+				pVelocityY[iDrone] -= 2.0f * fInward * fNormalY;
+			}
+		}
+	}
+	else
+	{
+		// Torpedo hits a drone and knocks it along.
+		int iDrone = iFirst - FIRST_DRONE_ID;
+		pVelocityX[iDrone] += m_Torpedoes.GetVelocityX()[iTorpedo] * DRONE_HIT_PUSH;
+		pVelocityY[iDrone] += m_Torpedoes.GetVelocityY()[iTorpedo] * DRONE_HIT_PUSH;
+		EmitExplosion(iTorpedo, hit.fTime);
+		m_Torpedoes.Kill(iTorpedo);
+		++m_iTorpedoHits;
+	}
+}
+
+const MaskFrame& Spacewar::GetCollisionMask(int iId, int iFirstTorpedo) const
 {
+	using namespace SpacewarNS;
+
+	if(iId < PLANET_ID)
+	{
+		const Image& ship = (0 == iId) ? m_Ship1 : m_Ship2;
+		const TextureManager& texture = (0 == iId) ? m_ShipTexture : m_Ship2Texture;
+		const SpriteData& sd = ship.GetSpriteInfo();
+		return texture.GetCollisionMask(m_iShipMask[iId])->Get(ship.GetCurrentFrame(), sd.fAngle, sd.fScale);
+	}
+
+	if(PLANET_ID == iId)
+	{
+		return m_PlanetTexture.GetCollisionMask(m_iPlanetMask)->Get(0, 0.0f, 1.0f);
+	}
+
+	if(iId < iFirstTorpedo)
+	{
+		int iDrone = iId - FIRST_DRONE_ID;
+		return m_Ship2Texture.GetCollisionMask(m_iShipMask[1])->Get(m_Drones.GetFrame()[iDrone],
+			m_Drones.GetAngle()[iDrone], m_Drones.GetScale()[iDrone]);
+	}
 
+	return m_TorpedoTexture.GetCollisionMask(m_iTorpedoMask)->Get(0, 0.0f, 1.0f);
 }
 
-void Spacewar::Collisions(void)
+bool Spacewar::PixelsOverlap(int iA, int iB, float fTime) const
+{
+	// Bring B next to A if they start the tick across the edge of the screen from each other.
+	const SweptCircle& a = m_pSweeps[iA];
+	const SweptCircle& b = m_pSweeps[iB];
+	float fAX = a.fX + a.fDX * fTime;
+	float fAY = a.fY + a.fDY * fTime;
+	float fBX = fAX + SweptCollision::Wrap(b.fX - a.fX, (float)GAME_WIDTH) + (b.fDX - a.fDX) * fTime;
+	float fBY = fAY + SweptCollision::Wrap(b.fY - a.fY, (float)GAME_HEIGHT) + (b.fDY - a.fDY) * fTime;
+
+	// The masks are the ones for the end of the tick; a tick turns a sprite very little.
+	const MaskFrame& maskA = *m_pSweepMasks[iA];
+	const MaskFrame& maskB = *m_pSweepMasks[iB];
+	int iAX, iAY, iBX, iBY;
+	CollisionMask::Place(maskA, fAX, fAY, iAX, iAY);
+	CollisionMask::Place(maskB, fBX, fBY, iBX, iBY);
+	return CollisionMask::Overlap(maskA, iAX, iAY, maskB, iBX, iBY);
+}
+
+bool Spacewar::FirstTouch(int iA, int iB, float& fTime) const
 {
+	using namespace SpacewarNS;
+
+	// Nothing touches before the circles around the masks do.
+	float fStart;
+	if(!SweptCollision::FirstContact(m_pSweeps[iA], m_pSweeps[iB], (float)GAME_WIDTH, (float)GAME_HEIGHT, fStart))
+	{
+		return false;
+	}
+
+	// From there to the end of the tick, test the pixels at least every SWEEP_STEP pixels of closing.
+	float fDX = m_pSweeps[iB].fDX - m_pSweeps[iA].fDX;
+	float fDY = m_pSweeps[iB].fDY - m_pSweeps[iA].fDY;
+	int iSteps = (int)ceilf(sqrtf(fDX * fDX + fDY * fDY) * (1.0f - fStart) / SWEEP_STEP);
+	iSteps = (iSteps < 1) ? 1 : ((iSteps > SWEEP_MAX_STEPS) ? SWEEP_MAX_STEPS : iSteps);
+	// The first test is a step in: at fStart the circles only just touch.
+	for(int i = 1; i <= iSteps; ++i)
+	{
+		float fStep = fStart + (1.0f - fStart) * i / iSteps;
+		if(PixelsOverlap(iA, iB, fStep))
+		{
+			fTime = fStep;
+			return true;
+		}
+	}
 
+	return false;
 }
 
 void Spacewar::Render(void)
 {
+	PROFILE_SCOPE("Spacewar::Render");
+
 	m_pGraphics->SpriteBegin();
 
 	m_Nebula.Draw();
 	m_Planet.Draw();
-	m_Ship1.Draw();
-	m_Ship2.Draw();
+	SpriteData sd;
+	m_SpriteBatch.Clear();
+	for(int i = 0; i < m_Drones.GetCount(); ++i)
+	{
+		GetDroneSprite(i, m_fInterpolation, sd);
+		m_SpriteBatch.Add(sd);
+	}
+	for(int i = 0; i < m_Torpedoes.GetCount(); ++i)
+	{
+		GetTorpedoSprite(i, m_fInterpolation, sd);
+		m_SpriteBatch.Add(sd);
+	}
+	for(int i = 0; i < m_Particles.GetCount(); ++i)
+	{
+		GetParticleSprite(i, m_fInterpolation, sd);
+		m_SpriteBatch.Add(sd, m_Particles.GetColors()[i]);
+	}
+	m_pGraphics->DrawSpriteBatch(m_SpriteBatch);
+	m_Ship1.DrawInterpolated(m_fInterpolation);
+	m_Ship2.DrawInterpolated(m_fInterpolation);
 	m_pGraphics->SpriteEnd();
 }
 
+void Spacewar::GetDroneSprite(int iIndex, float fAlpha, SpriteData& sd) const
+{
+	const SpriteSheet& sheet = m_Drones.GetSheet(m_Drones.GetSheetIndex()[iIndex]);
+	int iFrame = m_Drones.GetFrame()[iIndex];
+	TextureManager* pTexture = TextureManager::FromId(sheet.iTextureId);
+
+	sd.iWidth = sheet.iWidth;
+	sd.iHeight = sheet.iHeight;
+	sd.fX = m_Drones.GetX()[iIndex];
+	sd.fY = m_Drones.GetY()[iIndex];
+	sd.fScale = m_Drones.GetScale()[iIndex];
+	sd.fAngle = m_Drones.GetAngle()[iIndex];
+	sd.rect = m_Animations.GetFrameRect(sheet.iLayout, iFrame);
+	sd.texture = pTexture ? pTexture->GetTexture() : nullptr;
+	sd.bFlipHorizontal = false;
+	sd.bFlipVertical = false;
+
+	// Don't blend across a screen wrap.
+	float fPrevX = m_Drones.GetPrevX()[iIndex];
+	float fPrevY = m_Drones.GetPrevY()[iIndex];
+	if(fabsf(sd.fX - fPrevX) < GAME_WIDTH * .5f && fabsf(sd.fY - fPrevY) < GAME_HEIGHT * .5f)
+	{
+		float fPrevAngle = m_Drones.GetPrevAngle()[iIndex];
+		float fPrevScale = m_Drones.GetPrevScale()[iIndex];
+		sd.fX = fPrevX + (sd.fX - fPrevX) * fAlpha;
+		sd.fY = fPrevY + (sd.fY - fPrevY) * fAlpha;
+		sd.fAngle = fPrevAngle + (sd.fAngle - fPrevAngle) * fAlpha;
+		sd.fScale = fPrevScale + (sd.fScale - fPrevScale) * fAlpha;
+	}
+}
+
+void Spacewar::GetTorpedoSprite(int iIndex, float fAlpha, SpriteData& sd) const
+{
+	sd.iWidth = TORPEDO_WIDTH;
+	sd.iHeight = TORPEDO_HEIGHT;
+	sd.fX = m_Torpedoes.GetX()[iIndex];
+	sd.fY = m_Torpedoes.GetY()[iIndex];
+	sd.fScale = 1.0f;
+	sd.fAngle = 0.0f;
+	sd.rect.left = 0;
+	sd.rect.top = 0;
+	sd.rect.right = TORPEDO_WIDTH;
+	sd.rect.bottom = TORPEDO_HEIGHT;
+	sd.texture = m_TorpedoTexture.GetTexture();
+	sd.bFlipHorizontal = false;
+	sd.bFlipVertical = false;
+
+	// Don't blend across a screen wrap.
+	float fPrevX = m_Torpedoes.GetPrevX()[iIndex];
+	float fPrevY = m_Torpedoes.GetPrevY()[iIndex];
+	if(fabsf(sd.fX - fPrevX) < GAME_WIDTH * .5f && fabsf(sd.fY - fPrevY) < GAME_HEIGHT * .5f)
+	{
+		sd.fX = fPrevX + (sd.fX - fPrevX) * fAlpha;
+		sd.fY = fPrevY + (sd.fY - fPrevY) * fAlpha;
+	}
+}
+
+// Particles are small torpedoes, centered on the particle.
+void Spacewar::GetParticleSprite(int iIndex, float fAlpha, SpriteData& sd) const
+{
+	float fOffset = TORPEDO_WIDTH * PARTICLE_SCALE * .5f;
+	sd.iWidth = TORPEDO_WIDTH;
+	sd.iHeight = TORPEDO_HEIGHT;
+	sd.fScale = PARTICLE_SCALE;
+	sd.fAngle = 0.0f;
+	sd.rect.left = 0;
+	sd.rect.top = 0;
+	sd.rect.right = TORPEDO_WIDTH;
+	sd.rect.bottom = TORPEDO_HEIGHT;
+	sd.texture = m_TorpedoTexture.GetTexture();
+	sd.bFlipHorizontal = false;
+	sd.bFlipVertical = false;
+
+	// Back from where it is now by the part of the tick still to come.
+	float fBack = (fAlpha - 1.0f) * m_fTickTime;
+	sd.fX = m_Particles.GetX()[iIndex] + m_Particles.GetVelocityX()[iIndex] * fBack - fOffset;
+	sd.fY = m_Particles.GetY()[iIndex] + m_Particles.GetVelocityY()[iIndex] * fBack - fOffset;
+}
+
+void Spacewar::SaveSettings(StateBuffer& settings) const
+{
+	Game::SaveSettings(settings);
+	settings.Write(m_iDroneCount);
+	settings.Write(m_iTorpedoRate);
+	settings.Write(m_bMutualGravity);
+	settings.Write(GetAIBudgetInUse());
+	settings.Write(m_iAIQuota);
+}
+
+bool Spacewar::LoadSettings(StateBuffer& settings)
+{
+	int iDrones = 0, iTorpedoRate = 0, iAIBudget = 0, iAIQuota = 0;
+	bool bMutualGravity = false;
+	bool bGood = Game::LoadSettings(settings);
+	settings.Read(iDrones);
+	settings.Read(iTorpedoRate);
+	settings.Read(bMutualGravity);
+	settings.Read(iAIBudget);
+	settings.Read(iAIQuota);
+	if(!bGood || !settings.IsGood())
+	{
+		return false;
+	}
+	SetDroneCount(iDrones);
+	SetTorpedoRate(iTorpedoRate);
+	SetMutualGravity(bMutualGravity);
+	SetAIBudget(iAIBudget, iAIQuota);
+	return true;
+}
+
+void Spacewar::SaveState(StateBuffer& state) const
+{
+	Game::SaveState(state);
+	m_Ship1.SaveState(state);
+	m_Ship2.SaveState(state);
+	m_Planet.SaveState(state);
+	m_Drones.SaveState(state);
+	m_Torpedoes.SaveState(state);
+	m_AI.SaveState(state);
+
+	state.Write(m_iDroneHitTotal);
+	state.Write(m_iShipHits);
+	state.Write(m_iTorpedoHits);
+	state.Write(m_iPairsTested);
+	state.Write(m_iPairsTouching);
+	state.Write(m_fFireTimer);
+	state.Write(m_fStressShots);
+	state.Write(m_fStressAngle);
+	state.Write(m_fShipDriftX);
+	state.Write(m_fShipDriftY);
+	state.Write(m_fShipThrustX);
+	state.Write(m_fShipThrustY);
+	state.Write(m_fShipTurn);
+	state.Write(m_fShip2AimX);
+	state.Write(m_fShip2AimY);
+	state.Write(m_fExhaustOwed);
+}
+
+bool Spacewar::LoadState(StateBuffer& state)
+{
+	// Each part checks its counts against what Initialize allocated before reading into it.
+	bool bGood = Game::LoadState(state);
+	bGood = m_Ship1.LoadState(state) && bGood;
+	bGood = m_Ship2.LoadState(state) && bGood;
+	bGood = m_Planet.LoadState(state) && bGood;
+	bGood = m_Drones.LoadState(state) && bGood;
+	bGood = m_Torpedoes.LoadState(state) && bGood;
+	bGood = m_AI.LoadState(state) && bGood;
+
+	state.Read(m_iDroneHitTotal);
+	state.Read(m_iShipHits);
+	state.Read(m_iTorpedoHits);
+	state.Read(m_iPairsTested);
+	state.Read(m_iPairsTouching);
+	state.Read(m_fFireTimer);
+	state.Read(m_fStressShots);
+	state.Read(m_fStressAngle);
+	state.Read(m_fShipDriftX);
+	state.Read(m_fShipDriftY);
+	state.Read(m_fShipThrustX);
+	state.Read(m_fShipThrustY);
+	state.Read(m_fShipTurn);
+	state.Read(m_fShip2AimX);
+	state.Read(m_fShip2AimY);
+	state.Read(m_fExhaustOwed);
+	return bGood && state.IsGood();
+}
+
+// FNV-1a over the bits of everything the simulation moves.
+uint64_t Spacewar::GetStateChecksum(void) const
+{
+	uint64_t iHash = 14695981039346656037ULL;
+	auto mix = [&iHash](const void* pData, size_t iSize)
+	{
+		const unsigned char* pBytes = (const unsigned char*)pData;
+		for(size_t i = 0; i < iSize; ++i)
+		{
+			iHash = (iHash ^ pBytes[i]) * 1099511628211ULL;
+		}
+	};
+
+	float fShips[6] = { m_Ship1.GetX(), m_Ship1.GetY(), m_Ship1.GetRotationInRadians(),
+		m_Ship2.GetX(), m_Ship2.GetY(), m_Ship2.GetRotationInRadians() };
+	mix(fShips, sizeof(fShips));
+	mix(&m_iDroneHitTotal, sizeof(m_iDroneHitTotal));
+	mix(m_iShipHits, sizeof(m_iShipHits));
+	mix(&m_iTorpedoHits, sizeof(m_iTorpedoHits));
+	size_t iBytes = m_Drones.GetCount() * sizeof(float);
+	mix(m_Drones.GetX(), iBytes);
+	mix(m_Drones.GetY(), iBytes);
+	mix(m_Drones.GetVelocityX(), iBytes);
+	mix(m_Drones.GetVelocityY(), iBytes);
+	mix(m_Drones.GetAngle(), iBytes);
+	mix(m_Drones.GetFrame(), m_Drones.GetCount() * sizeof(int));
+	iBytes = m_Torpedoes.GetCount() * sizeof(float);
+	mix(m_Torpedoes.GetX(), iBytes);
+	mix(m_Torpedoes.GetY(), iBytes);
+	mix(m_Torpedoes.GetLife(), iBytes);
+
+	return iHash;
+}
+
 void Spacewar::ReleaseAll(void)
 {
 	m_ShipTexture.OnLostDevice();
 	m_Ship2Texture.OnLostDevice();
 	m_NebulaTexture.OnLostDevice();
 	m_PlanetTexture.OnLostDevice();
+	m_TorpedoTexture.OnLostDevice();
 	Game::ReleaseAll();
 	return;
 }
@@ -185,6 +1361,7 @@ void Spacewar::ResetAll(void)
 	m_Ship2Texture.OnResetDevice();
 	m_PlanetTexture.OnResetDevice();
 	m_NebulaTexture.OnResetDevice();
+	m_TorpedoTexture.OnResetDevice();
 	Game::ResetAll();
 	return;
 }
\ No newline at end of file
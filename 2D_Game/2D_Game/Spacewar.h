@@ -6,6 +6,29 @@
 #include "Game.h"
 #include "TextureManager.h"
 #include "Image.h"
+#include "Profiler.h"
+#include "EntityStore.h"
+#include "ProjectilePool.h"
+#include "SpatialHash.h"
+#include "SweptCollision.h"
+#include "Gravity.h"
+#include "Kinematics.h"
+#include "ParticleSystem.h"
+#include "AIScheduler.h"
+
+
+namespace SpacewarNS
+{
+	// Collision categories.
+	const uint32_t COLLIDE_SHIP = 1;
+	const uint32_t COLLIDE_DRONE = 2;
+	const uint32_t COLLIDE_TORPEDO = 4;
+	const uint32_t COLLIDE_PLANET = 8;
+
+	// Ids in the collision broadphase. Drones follow the planet, then torpedoes.
+	const int PLANET_ID = 2;
+	const int FIRST_DRONE_ID = 3;
+}
 
 // Main game.
 class Spacewar : public Game
@@ -17,10 +40,155 @@ private:
 	TextureManager	m_Ship2Texture;
 	TextureManager	m_PlanetTexture;
 	TextureManager	m_NebulaTexture;
+	TextureManager	m_TorpedoTexture;
 	Image			m_Planet, m_Nebula;
 	Image			m_Ship1;
 	Image			m_Ship2;
 
+	// Drones.
+	EntityStore			m_Drones;				// Every drone, one component per array.
+	int					m_iDroneSheet;			// Sprite sheet the drones are drawn from.
+	int					m_iDroneCount;			// Drones spawned by Initialize.
+	int*				m_pDroneHits;			// Planet hits per ParallelFor chunk this tick, in the tick arena.
+	SweptCircle*		m_pSweeps;				// Each broadphase object's path this tick, in the tick arena.
+	const MaskFrame**	m_pSweepMasks;			// And its collision mask variant.
+	int64_t				m_iDroneHitTotal;		// Planet hits since Initialize.
+
+	// AI. Bot 0 is ship 2, bot i + 1 is drone i.
+	AIScheduler			m_AI;					// Spreads bot decisions over ticks.
+	int					m_iAIBudget;			// Microseconds per tick, 0 for no limit.
+	int					m_iAIQuota;				// Bots per tick, 0 for no limit.
+	float				m_fTargetX[2];			// Ship centers the bots chase, captured before AI.
+	float				m_fTargetY[2];
+	float				m_fTargetVelocityX[2];	// And how fast they are going.
+	float				m_fTargetVelocityY[2];
+	float				m_fAvoidX;				// Planet center and how wide a berth to give it.
+	float				m_fAvoidY;
+	float				m_fAvoidRadius;
+	float				m_fShip2AimX;			// Velocity ship 2 last chose, flown toward between decisions.
+	float				m_fShip2AimY;
+
+	// Torpedoes.
+	ProjectilePool		m_Torpedoes;			// Every torpedo in flight.
+	float				m_fFireTimer[2];		// Time until each ship may fire again.
+	int					m_iTorpedoRate;			// Stress test shots per second, 0 for none.
+	float				m_fStressShots;			// Stress test shots owed, fired as they reach 1.
+	float				m_fStressAngle;			// Direction of the next stress test shot.
+
+	// Collisions.
+	SpatialHash			m_Collisions;			// Broadphase over ships, drones and torpedoes.
+	int64_t				m_iShipHits[2];			// Torpedo hits taken by each ship.
+	int64_t				m_iTorpedoHits;			// Torpedo hits on drones.
+	int64_t				m_iPairsTested;			// Broadphase pairs given a pixel test.
+	int64_t				m_iPairsTouching;		// Pairs whose pixels overlapped.
+	int					m_iShipMask[2];			// Collision masks in each ship texture. Drones use ship 2's.
+	int					m_iPlanetMask;
+	int					m_iTorpedoMask;
+
+	// Gravity.
+	Gravity				m_Gravity;				// The planet's pull, and the bodies' on each other when mutual.
+	bool				m_bMutualGravity;		// Every ship, drone and torpedo pulls on the others.
+	float				m_fShipDriftX[2];		// Velocity gravity has given each ship.
+	float				m_fShipDriftY[2];
+	float				m_fShipThrustX[2];		// Intents from input and AI, -1 to 1.
+	float				m_fShipThrustY[2];
+	float				m_fShipTurn[2];
+	bool				m_bShipFire[2];
+
+	// Particles.
+	ParticleSystem		m_Particles;			// Exhaust and explosion sparks.
+	float				m_fExhaustOwed[2];		// Exhaust particles owed by each ship, emitted as they reach 1.
+
+	// Return the AI time budget to run with: 0 when the run has to be repeatable.
+	int GetAIBudgetInUse(void) const { return (m_pNetSession || m_pJournal) ? 0 : m_iAIBudget; }
+
+	// Place m_iDroneCount drones at repeatable positions.
+	void SpawnDrones(void);
+
+	// Fill in SpriteData for drone iIndex fAlpha of the way through the tick.
+	void GetDroneSprite(int iIndex, float fAlpha, SpriteData& sd) const;
+
+	// Fill in SpriteData for torpedo iIndex fAlpha of the way through the tick.
+	void GetTorpedoSprite(int iIndex, float fAlpha, SpriteData& sd) const;
+
+	// Queue a torpedo leaving the center of ship, heading fAngle radians.
+	void FireTorpedo(const Image& ship, int iOwner, float fAngle);
+
+	// Trail exhaust behind ship iShip if it moved this tick.
+	void EmitExhaust(const Image& ship, int iShip);
+
+	// Burst torpedo iTorpedo into sparks fTime of the way through the tick.
+	void EmitExplosion(int iTorpedo, float fTime);
+
+	// Fill in SpriteData for particle iIndex fAlpha of the way through the tick.
+	void GetParticleSprite(int iIndex, float fAlpha, SpriteData& sd) const;
+
+	// Job functions. pData is the Spacewar, [iBegin, iEnd) a range of dense m_Drones indices.
+	static void UpdateShipsJob(void* pData, int iBegin, int iEnd);
+	static void UpdateDronesJob(void* pData, int iBegin, int iEnd);
+	static void SteerDronesJob(void* pData, int iBegin, int iEnd);
+	static void DecideBotsJob(void* pData, int iBegin, int iEnd);
+	static void CollideDronesJob(void* pData, int iBegin, int iEnd);
+	static void UpdateTorpedoesJob(void* pData, int iBegin, int iEnd);
+	static void UpdateParticlesJob(void* pData, int iBegin, int iEnd);
+
+	// A pair whose pixels first touch fTime of the way through the tick.
+	struct SweepHit
+	{
+		float		fTime;
+		uint32_t	iFirst;
+		uint32_t	iSecond;
+
+		// Earlier first, ties by ids.
+		bool operator<(const SweepHit& other) const
+		{
+			if(fTime != other.fTime)
+			{
+				return fTime < other.fTime;
+			}
+			return (iFirst != other.iFirst) ? iFirst < other.iFirst : iSecond < other.iSecond;
+		}
+	};
+
+	// Load the paths of ships, the planet, drones and torpedoes into m_Collisions, and
+	// respond to the pairs whose pixels touch, earliest first.
+	void CollideObjects(void);
+
+	// Respond to a pair whose pixels touch.
+	void Collide(const SweepHit& hit, int iFirstTorpedo);
+
+	// Return the collision mask variant of broadphase object iId.
+	const MaskFrame& GetCollisionMask(int iId, int iFirstTorpedo) const;
+
+	// Return true if the opaque pixels of two broadphase objects overlap fTime of the way
+	// along their paths, the short way around the screen.
+	bool PixelsOverlap(int iA, int iB, float fTime) const;
+
+	// Find when the pixels of two broadphase objects first touch this tick. Returns false if they don't.
+	bool FirstTouch(int iA, int iB, float& fTime) const;
+
+	// Player ships, run as one job alongside the drones.
+	void UpdateShips(void);
+
+	// Load every ship, drone and torpedo into m_Gravity for mutual gravity.
+	void BuildGravity(void);
+
+	// Speed up iCount bodies centered at (pX[i] + fOffsetX, pY[i] + fOffsetY) by a tick of gravity.
+	void ApplyGravity(const float* pX, const float* pY, float fOffsetX, float fOffsetY, int iCount,
+		float* pVelocityX, float* pVelocityY) const;
+
+	// Speed up ship iShip's drift by a tick of gravity.
+	void DriftShip(const Image& ship, int iShip);
+
+	// Set each ship's thrust, turn and fire, player 1 from the keyboard and player 2 from its
+	// last decision, or both from the network session when playing over the network.
+	void SetShipIntents(void);
+
+	// Choose the velocity for a bot centered at (fX, fY) that flies at fSpeed: toward where
+	// the nearest ship other than iSelf will be when the bot gets there, the short way
+	// around the screen, bending around the planet if it is in the way.
+	void Decide(float fX, float fY, float fSpeed, int iSelf, float& fAimX, float& fAimY) const;
+
 
 public:
 
@@ -31,13 +199,66 @@ public:
 	virtual ~Spacewar(void);
 
 	// Initialize the game.
-	void Initialize(HWND hWnd);
+	void Initialize(PlatformWindow* pWindow);
+	void StorePreviousState(void);
+	void BuildSnapshot(RenderSnapshot& snapshot);
 	void Update(void);
 	void AI(void);
 	void Collisions(void);
 	void Render(void);
 	void ReleaseAll(void);
 	void ResetAll(void);
+
+	// Return the ship keys held down as NetSessionNS bits.
+	uint8_t GetNetInput(void);
+
+	// Set the AI's time per tick in microseconds and most bots per tick, 0 for no limit. Call before Initialize.
+	// Networked and journaled play ignore the time budget, which decides a different number of bots
+	// per tick on every run, and go by the quota alone.
+	void SetAIBudget(int iMicroseconds, int iQuota) { m_iAIBudget = iMicroseconds; m_iAIQuota = iQuota; }
+
+	// Return the AI scheduler.
+	const AIScheduler* GetAI(void) const { return &m_AI; }
+
+	// Set the number of drones. Call before Initialize.
+	void SetDroneCount(int iCount) { m_iDroneCount = (iCount < 0) ? 0 : iCount; }
+
+	// Return the number of drones.
+	int GetDroneCount(void) const { return m_Drones.GetCount(); }
+
+	// Return the drone store.
+	EntityStore* GetDrones(void) { return &m_Drones; }
+
+	// Have both ships fire iShotsPerSecond torpedoes between them, for stress testing.
+	void SetTorpedoRate(int iShotsPerSecond) { m_iTorpedoRate = (iShotsPerSecond < 0) ? 0 : iShotsPerSecond; }
+
+	// Have every ship, drone and torpedo pull on the others, not just the planet on them.
+	void SetMutualGravity(bool bMutual) { m_bMutualGravity = bMutual; }
+
+	// Return the torpedo pool.
+	const ProjectilePool* GetTorpedoes(void) const { return &m_Torpedoes; }
+
+	// Return the particle system.
+	const ParticleSystem* GetParticles(void) const { return &m_Particles; }
+
+	// Return torpedo hits on drones, and on either ship.
+	int64_t GetDroneTorpedoHits(void) const { return m_iTorpedoHits; }
+	int64_t GetShipTorpedoHits(void) const { return m_iShipHits[0] + m_iShipHits[1]; }
+
+	// Return broadphase pairs tested pixel by pixel, and how many of them touched.
+	int64_t GetPairsTested(void) const { return m_iPairsTested; }
+	int64_t GetPairsTouching(void) const { return m_iPairsTouching; }
+
+	// Append the drone count, torpedo rate, gravity and AI limits to settings, or take them back.
+	void SaveSettings(StateBuffer& settings) const;
+	bool LoadSettings(StateBuffer& settings);
+
+	// Append the ships, planet, drones, torpedoes, AI and counters to state, or take them back.
+	void SaveState(StateBuffer& state) const;
+	bool LoadState(StateBuffer& state);
+
+	// Return a hash of the simulation state. Equal hashes mean identical runs.
+	uint64_t GetStateChecksum(void) const;
 };
 
 #endif
\ No newline at end of file
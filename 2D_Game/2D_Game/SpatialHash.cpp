@@ -0,0 +1,343 @@
+#include "SpatialHash.h"
+#include "Graphics.h"
+#include "Profiler.h"
+
+#include <cmath>
+
+namespace
+{
+	// Reserve at least iCount, growing geometrically so a count that creeps up each tick
+	// doesn't reallocate each tick.
+	template<typename T>
+	void ReserveAtLeast(std::vector<T>& items, size_t iCount)
+	{
+		if(items.capacity() < iCount)
+		{
+			items.reserve(iCount > items.capacity() * 2 ? iCount : items.capacity() * 2);
+		}
+	}
+}
+
+// Constructor.
+SpatialHash::SpatialHash()
+	: m_fWorldWidth(1.0f)
+	, m_fWorldHeight(1.0f)
+	, m_fCellWidth(1.0f)
+	, m_fCellHeight(1.0f)
+	, m_iCols(1)
+	, m_iRows(1)
+	, m_fInvCellWidth(1.0f)
+	, m_fInvCellHeight(1.0f)
+	, m_iFreeNode(-1)
+	, m_iMoving(0)
+	, m_iMoved(0)
+{
+
+}
+
+void SpatialHash::Initialize(float fWorldWidth, float fWorldHeight, float fCellSize)
+{
+	m_fWorldWidth = fWorldWidth;
+	m_fWorldHeight = fWorldHeight;
+
+	// Round to whole cells so the grid wraps exactly where the world does.
+	m_iCols = (int)(fWorldWidth / fCellSize + .5f);
+	m_iRows = (int)(fWorldHeight / fCellSize + .5f);
+	m_iCols = (m_iCols < 1) ? 1 : m_iCols;
+	m_iRows = (m_iRows < 1) ? 1 : m_iRows;
+	m_fCellWidth = fWorldWidth / m_iCols;
+	m_fCellHeight = fWorldHeight / m_iRows;
+	m_fInvCellWidth = 1.0f / m_fCellWidth;
+	m_fInvCellHeight = 1.0f / m_fCellHeight;
+
+	m_iCellHead.assign(m_iCols * m_iRows, -1);
+	m_Nodes.clear();
+	m_iFreeNode = -1;
+	for(size_t i = 0; i < m_Boxes.size(); ++i)
+	{
+		m_Boxes[i].iSpanCols = 0;
+		m_Boxes[i].iSpanRows = 0;
+		m_iFirstNode[i] = -1;
+	}
+	m_Pairs.clear();
+	m_iMoving = 0;
+	m_iMoved = 0;
+}
+
+void SpatialHash::SetObjectCount(int iCount)
+{
+	for(int i = iCount; i < GetObjectCount(); ++i)
+	{
+		Remove(i);
+	}
+
+	Box empty = {};
+	m_Boxes.resize(iCount, empty);
+	m_iFirstNode.resize(iCount, -1);
+
+	// A cell never holds more than every object, so FindPairs needn't grow m_Grouped,
+	// and a pair per object is plenty for a game tick. Objects up to a cell across cover
+	// at most four cells, and a grid's worth more takes in a big one like the planet.
+	ReserveAtLeast(m_Nodes, (size_t)iCount * SpatialHashNS::NODES_PER_OBJECT + (size_t)(m_iCols * m_iRows));
+	ReserveAtLeast(m_Grouped, (size_t)iCount);
+	ReserveAtLeast(m_Pairs, (size_t)iCount);
+}
+
+void SpatialHash::SetBounds(int iId, float fCenterX, float fCenterY, float fExtentX, float fExtentY, uint32_t iCategory, uint32_t iMask)
+{
+	Box& box = m_Boxes[iId];
+	bool bSameCategory = (iCategory == box.iCategory && iMask == box.iMask);
+	box.fCenterX = fCenterX;
+	box.fCenterY = fCenterY;
+	box.fExtentX = fExtentX;
+	box.fExtentY = fExtentY;
+	box.iCategory = iCategory;
+	box.iMask = iMask;
+
+	int iLeft = (int)floorf((fCenterX - fExtentX) * m_fInvCellWidth);
+	int iTop = (int)floorf((fCenterY - fExtentY) * m_fInvCellHeight);
+	int iSpanCols = (int)floorf((fCenterX + fExtentX) * m_fInvCellWidth) - iLeft + 1;
+	int iSpanRows = (int)floorf((fCenterY + fExtentY) * m_fInvCellHeight) - iTop + 1;
+	iSpanCols = (iSpanCols > m_iCols) ? m_iCols : iSpanCols;
+	iSpanRows = (iSpanRows > m_iRows) ? m_iRows : iSpanRows;
+	int iFirstCol = ((iLeft % m_iCols) + m_iCols) % m_iCols;
+	int iFirstRow = ((iTop % m_iRows) + m_iRows) % m_iRows;
+
+	if(bSameCategory && iFirstCol == box.iFirstCol && iFirstRow == box.iFirstRow && iSpanCols == box.iSpanCols && iSpanRows == box.iSpanRows)
+	{
+		return;
+	}
+
+	Remove(iId);
+	box.iFirstCol = (int16_t)iFirstCol;
+	box.iFirstRow = (int16_t)iFirstRow;
+	box.iSpanCols = (int16_t)iSpanCols;
+	box.iSpanRows = (int16_t)iSpanRows;
+	Insert(iId);
+	++m_iMoving;
+}
+
+void SpatialHash::Insert(uint32_t iId)
+{
+	const Box& box = m_Boxes[iId];
+	for(int r = 0; r < box.iSpanRows; ++r)
+	{
+		int iRow = (box.iFirstRow + r) % m_iRows;
+		for(int c = 0; c < box.iSpanCols; ++c)
+		{
+			int iCell = iRow * m_iCols + (box.iFirstCol + c) % m_iCols;
+
+			int iNode = m_iFreeNode;
+			if(iNode >= 0)
+			{
+				m_iFreeNode = m_Nodes[iNode].iNextOfObject;
+			}
+			else
+			{
+				iNode = (int)m_Nodes.size();
+				m_Nodes.push_back(Node());
+			}
+
+			Node& node = m_Nodes[iNode];
+			node.iId = iId;
+			node.iCategory = box.iCategory;
+			node.iMask = box.iMask;
+			node.iCell = iCell;
+			node.iPrev = -1;
+			node.iNext = m_iCellHead[iCell];
+			node.iNextOfObject = m_iFirstNode[iId];
+			if(node.iNext >= 0)
+			{
+				m_Nodes[node.iNext].iPrev = iNode;
+			}
+			m_iCellHead[iCell] = iNode;
+			m_iFirstNode[iId] = iNode;
+		}
+	}
+}
+
+void SpatialHash::Remove(uint32_t iId)
+{
+	int iNode = m_iFirstNode[iId];
+	while(iNode >= 0)
+	{
+		Node& node = m_Nodes[iNode];
+		if(node.iPrev >= 0)
+		{
+			m_Nodes[node.iPrev].iNext = node.iNext;
+		}
+		else
+		{
+			m_iCellHead[node.iCell] = node.iNext;
+		}
+		if(node.iNext >= 0)
+		{
+			m_Nodes[node.iNext].iPrev = node.iPrev;
+		}
+
+		int iNextOfObject = node.iNextOfObject;
+		node.iNextOfObject = m_iFreeNode;
+		m_iFreeNode = iNode;
+		iNode = iNextOfObject;
+	}
+
+	m_iFirstNode[iId] = -1;
+	m_Boxes[iId].iSpanCols = 0;
+	m_Boxes[iId].iSpanRows = 0;
+}
+
+int SpatialHash::SharedStart(int iFirstA, int iSpanA, int iFirstB, int iSize)
+{
+	// Either B starts inside A, or A starts inside B.
+	int iOffset = iFirstB - iFirstA;
+	iOffset += (iOffset < 0) ? iSize : 0;
+	return (iOffset < iSpanA) ? iFirstB : iFirstA;
+}
+
+bool SpatialHash::Overlaps(uint32_t iA, uint32_t iB) const
+{
+	const Box& a = m_Boxes[iA];
+	const Box& b = m_Boxes[iB];
+	float fDX = fabsf(a.fCenterX - b.fCenterX);
+	fDX = (fDX > m_fWorldWidth) ? fmodf(fDX, m_fWorldWidth) : fDX;
+	fDX = (fDX > m_fWorldWidth - fDX) ? m_fWorldWidth - fDX : fDX;
+	if(fDX >= a.fExtentX + b.fExtentX)
+	{
+		return false;
+	}
+
+	float fDY = fabsf(a.fCenterY - b.fCenterY);
+	fDY = (fDY > m_fWorldHeight) ? fmodf(fDY, m_fWorldHeight) : fDY;
+	fDY = (fDY > m_fWorldHeight - fDY) ? m_fWorldHeight - fDY : fDY;
+	return fDY < a.fExtentY + b.fExtentY;
+}
+
+void SpatialHash::FindPairs(void)
+{
+	PROFILE_SCOPE("SpatialHash::FindPairs");
+
+	m_Pairs.clear();
+	m_iMoved = m_iMoving;
+	m_iMoving = 0;
+
+	for(int iRow = 0; iRow < m_iRows; ++iRow)
+	{
+		for(int iCol = 0; iCol < m_iCols; ++iCol)
+		{
+			int iHead = m_iCellHead[iRow * m_iCols + iCol];
+			if(iHead < 0 || m_Nodes[iHead].iNext < 0)
+			{
+				continue;
+			}
+
+			// Sort the cell by category, noting what each group is and can hit.
+			uint32_t iCategory[SpatialHashNS::MAX_GROUPS];
+			uint32_t iMask[SpatialHashNS::MAX_GROUPS];
+			int iStart[SpatialHashNS::MAX_GROUPS + 1];
+			int iGroup[SpatialHashNS::MAX_GROUPS];
+			int iGroups = 0;
+			for(int iNode = iHead; iNode >= 0; iNode = m_Nodes[iNode].iNext)
+			{
+				const Node& node = m_Nodes[iNode];
+				int g = 0;
+				while(g < iGroups && iCategory[g] != node.iCategory)
+				{
+					++g;
+				}
+				if(g == iGroups && iGroups < SpatialHashNS::MAX_GROUPS)
+				{
+					iCategory[iGroups] = node.iCategory;
+					iMask[iGroups] = 0;
+					iStart[iGroups] = 0;
+					++iGroups;
+				}
+				g = (g < iGroups) ? g : iGroups - 1;
+				iCategory[g] |= node.iCategory;
+				iMask[g] |= node.iMask;
+				++iStart[g];
+			}
+
+			// Counts to offsets, then place each id.
+			int iOffset = 0;
+			for(int g = 0; g < iGroups; ++g)
+			{
+				int iCount = iStart[g];
+				iStart[g] = iGroup[g] = iOffset;
+				iOffset += iCount;
+			}
+			iStart[iGroups] = iOffset;
+			m_Grouped.resize(iOffset);
+			for(int iNode = iHead; iNode >= 0; iNode = m_Nodes[iNode].iNext)
+			{
+				const Node& node = m_Nodes[iNode];
+				int g = 0;
+				while(g < iGroups - 1 && iCategory[g] != node.iCategory)
+				{
+					++g;
+				}
+				m_Grouped[iGroup[g]++] = node.iId;
+			}
+
+			// Only groups that can hit each other are paired up.
+			for(int a = 0; a < iGroups; ++a)
+			{
+				for(int b = a; b < iGroups; ++b)
+				{
+					if(0 != ((iCategory[a] & iMask[b]) | (iCategory[b] & iMask[a])))
+					{
+						AddPairs(iCol, iRow, iStart[a], iStart[a + 1], iStart[b], iStart[b + 1]);
+					}
+				}
+			}
+		}
+	}
+}
+
+void SpatialHash::AddPairs(int iCol, int iRow, int iBeginA, int iEndA, int iBeginB, int iEndB)
+{
+	bool bSame = (iBeginA == iBeginB);
+	for(int i = iBeginA; i < iEndA; ++i)
+	{
+		uint32_t iA = m_Grouped[i];
+		const Box& a = m_Boxes[iA];
+		for(int j = bSame ? i + 1 : iBeginB; j < iEndB; ++j)
+		{
+			uint32_t iB = m_Grouped[j];
+			const Box& b = m_Boxes[iB];
+			if(0 == ((a.iCategory & b.iMask) | (b.iCategory & a.iMask)) || !Overlaps(iA, iB))
+			{
+				continue;
+			}
+
+			// A pair sharing several cells is only reported from the corner where they start to overlap.
+			if(iCol != SharedStart(a.iFirstCol, a.iSpanCols, b.iFirstCol, m_iCols)
+				|| iRow != SharedStart(a.iFirstRow, a.iSpanRows, b.iFirstRow, m_iRows))
+			{
+				continue;
+			}
+
+			CollisionPair pair = { iA < iB ? iA : iB, iA < iB ? iB : iA };
+			m_Pairs.push_back(pair);
+		}
+	}
+}
+
+void SpatialHash::GetBounds(float fX, float fY, int iWidth, int iHeight, float fScale, float fAngle,
+	float& fCenterX, float& fCenterY, float& fExtentX, float& fExtentY)
+{
+	// Graphics rotates about the center of the scaled sprite.
+	fCenterX = fX + (float)(iWidth / 2) * fScale;
+	fCenterY = fY + (float)(iHeight / 2) * fScale;
+
+	float fHalfWidth = iWidth * fScale * .5f;
+	float fHalfHeight = iHeight * fScale * .5f;
+	float fCos = fabsf(cosf(fAngle));
+	float fSin = fabsf(sinf(fAngle));
+	fExtentX = fCos * fHalfWidth + fSin * fHalfHeight;
+	fExtentY = fSin * fHalfWidth + fCos * fHalfHeight;
+}
+
+void SpatialHash::GetBounds(const SpriteData& sd, float& fCenterX, float& fCenterY, float& fExtentX, float& fExtentY)
+{
+	GetBounds(sd.fX, sd.fY, sd.iWidth, sd.iHeight, sd.fScale, sd.fAngle, fCenterX, fCenterY, fExtentX, fExtentY);
+}
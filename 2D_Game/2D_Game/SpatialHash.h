@@ -0,0 +1,138 @@
+#ifndef SPATIAL_HASH_H_
+#define SPATIAL_HASH_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stdint.h>
+#include <vector>
+
+struct SpriteData;
+
+namespace SpatialHashNS
+{
+	const int MAX_GROUPS = 8;				// Categories sorted apart within one cell, the rest share the last group.
+	const int NODES_PER_OBJECT = 4;			// Cell entries reserved per object, enough for one straddling a corner.
+}
+
+// A candidate collision, iFirst < iSecond.
+struct CollisionPair
+{
+	uint32_t	iFirst;
+	uint32_t	iSecond;
+};
+
+// SpatialHash: Collision broadphase over a uniform grid that wraps at the world edges.
+// Objects are ids 0..n-1 with an axis aligned box, a category and a mask of the categories
+// they collide with. Each tick the caller sets every box; an object is only moved between
+// cells when the range of cells it covers changes, so a slow moving crowd costs little.
+// FindPairs lists each pair of boxes that overlap, measured the short way around the
+// world, exactly once. Within a cell objects are grouped by category first, so a crowd
+// that can't hit itself, like drones swarming a ship, costs one test per drone.
+class SpatialHash
+{
+private:
+
+	float							m_fWorldWidth;		// Wrap period.
+	float							m_fWorldHeight;
+	float							m_fCellWidth;		// The world divides into whole cells.
+	float							m_fCellHeight;
+	int								m_iCols;
+	int								m_iRows;
+	float							m_fInvCellWidth;
+	float							m_fInvCellHeight;
+
+	// An object's entry in one cell. Entries are pooled and linked both ways within
+	// their cell, and through m_iNextOfObject to the object's other entries, so an
+	// object leaves its cells without searching them.
+	struct Node
+	{
+		uint32_t	iId;
+		uint32_t	iCategory;			// Copies of the object's, so sorting a cell stays in m_Nodes.
+		uint32_t	iMask;
+		int			iPrev;				// Within the cell, -1 at the ends.
+		int			iNext;
+		int			iNextOfObject;		// Also links the free list.
+		int			iCell;
+	};
+	std::vector<Node>				m_Nodes;
+	std::vector<int>				m_iCellHead;		// First entry of each cell, row major, -1 if empty.
+	int								m_iFreeNode;
+
+	// An object's box and the cells it covers. Kept together because the pair tests
+	// read objects in no particular order, and one fetch then brings in all of it.
+	struct Box
+	{
+		float		fCenterX;
+		float		fCenterY;
+		float		fExtentX;			// Half size of the box.
+		float		fExtentY;
+		uint32_t	iCategory;
+		uint32_t	iMask;
+		int16_t		iFirstCol;			// Cells covered, wrapped. Span 0 when not in the grid.
+		int16_t		iFirstRow;
+		int16_t		iSpanCols;
+		int16_t		iSpanRows;
+	};
+	std::vector<Box>				m_Boxes;			// Indexed by id.
+	std::vector<int>				m_iFirstNode;		// Head of the object's entries, -1 if none.
+
+	std::vector<CollisionPair>		m_Pairs;
+	std::vector<uint32_t>			m_Grouped;			// One cell's ids, sorted by category.
+	int								m_iMoving;			// Objects moved between cells since the last FindPairs.
+	int								m_iMoved;			// m_iMoving as of the last FindPairs.
+
+	// Add or take an object out of every cell it covers.
+	void Insert(uint32_t iId);
+	void Remove(uint32_t iId);
+
+	// Add the pairs of cell (iCol, iRow) between ids iBeginA..iEndA and iBeginB..iEndB of m_Grouped.
+	// Equal ranges pair each id with those after it.
+	void AddPairs(int iCol, int iRow, int iBeginA, int iEndA, int iBeginB, int iEndB);
+
+	// Return where two overlapping wrapped ranges on an axis of size iSize start to overlap.
+	static int SharedStart(int iFirstA, int iSpanA, int iFirstB, int iSize);
+
+public:
+
+	// Constructor.
+	SpatialHash();
+
+	// Set the world size and approximate cell size, at most 32767 cells a side. Empties the grid.
+	void Initialize(float fWorldWidth, float fWorldHeight, float fCellSize);
+
+	// Set the number of objects. Ids at or past iCount leave the grid.
+	void SetObjectCount(int iCount);
+
+	// Return the number of objects.
+	int GetObjectCount(void) const { return (int)m_Boxes.size(); }
+
+	// Set the box of object iId. Moves it between cells only if it now covers different ones,
+	// or its category or mask changed.
+	void SetBounds(int iId, float fCenterX, float fCenterY, float fExtentX, float fExtentY, uint32_t iCategory, uint32_t iMask);
+
+	// Find every overlapping pair whose categories and masks allow a collision.
+	void FindPairs(void);
+
+	// Return the pairs from the last FindPairs, in a repeatable order.
+	const std::vector<CollisionPair>& GetPairs(void) const { return m_Pairs; }
+
+	// Return objects that moved between cells before the last FindPairs.
+	int GetMovedCount(void) const { return m_iMoved; }
+
+	// Return the center of an object's box.
+	float GetCenterX(int iId) const { return m_Boxes[iId].fCenterX; }
+	float GetCenterY(int iId) const { return m_Boxes[iId].fCenterY; }
+
+	// Return true if the boxes of two objects overlap, the short way around the world.
+	bool Overlaps(uint32_t iA, uint32_t iB) const;
+
+	// Work out the box around a sprite drawn iWidth by iHeight at (fX, fY), scaled and
+	// rotated about its center the way Graphics draws it.
+	static void GetBounds(float fX, float fY, int iWidth, int iHeight, float fScale, float fAngle,
+		float& fCenterX, float& fCenterY, float& fExtentX, float& fExtentY);
+
+	// GetBounds for a SpriteData.
+	static void GetBounds(const SpriteData& sd, float& fCenterX, float& fCenterY, float& fExtentX, float& fExtentY);
+};
+
+#endif
@@ -0,0 +1,451 @@
+#include "SpriteRaster.h"
+#include "Profiler.h"
+
+#ifndef _WIN32
+
+#include <cmath>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define SPRITE_RASTER_X86 1
+#include <immintrin.h>
+#else
+#define SPRITE_RASTER_X86 0
+#endif
+
+// GCC and Clang only emit AVX2 instructions in functions marked for it.
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+using namespace SpriteTransformNS;
+
+namespace
+{
+	const int FIXED_SHIFT = 16;							// Texture coordinates are 16.16 fixed point.
+	const float FIXED_ONE = 65536.0f;
+	const float MAX_TEXELS_PER_PIXEL = 1024.0f;			// Smaller sprites are skipped, their coordinates would overflow.
+	const UINT MAX_TEXTURE_SIZE = 32767;				// Texel rows and columns must fit in 16 bits for indexing with madd.
+	const int SPAN_MULTIPLE = 8;						// Pixels per step of the widest kernel. Spans are rounded up to it.
+
+	// One row of a sprite. Texel coordinates step by fixed point, so every kernel samples the same texels.
+	struct Span
+	{
+		const COLOR_ARGB*	pTexels;		// Top left texel of the source rect.
+		int					iPitch;			// Texels per texture row.
+		int					iWidth;			// Source rect size, fixed point.
+		int					iHeight;
+		int					iDuDx;			// Texel step per pixel, fixed point.
+		int					iDvDx;
+		COLOR_ARGB			color;			// Color filter.
+	};
+
+	// Exact x / 255, rounded, for x up to 255 * 255.
+	inline uint32_t Div255(uint32_t x)
+	{
+		x += 128;
+		return (x + (x >> 8)) >> 8;
+	}
+
+	// Widen the channels of an ARGB color to 16 bits each, and back.
+	inline uint64_t Spread(COLOR_ARGB color)
+	{
+		return (color & 0x00FF00FF) | ((uint64_t)(color & 0xFF00FF00) << 24);
+	}
+
+	inline COLOR_ARGB Pack(uint64_t iChannels)
+	{
+		return (COLOR_ARGB)((iChannels & 0x00FF00FF) | ((iChannels >> 24) & 0xFF00FF00));
+	}
+
+	// Div255 of each 16 bit channel.
+	inline uint64_t Div255x4(uint64_t x)
+	{
+		x += 0x0080008000800080ull;
+		return ((x + ((x >> 8) & 0x00FF00FF00FF00FFull)) >> 8) & 0x00FF00FF00FF00FFull;
+	}
+
+	// Filter a texel by color, then blend it over dst by its alpha.
+	inline COLOR_ARGB Shade(COLOR_ARGB texel, COLOR_ARGB color, COLOR_ARGB dst)
+	{
+		if(color != GraphicsNS::WHITE)
+		{
+			COLOR_ARGB filtered = 0;
+			for(int iShift = 0; iShift < 32; iShift += 8)
+			{
+				filtered |= Div255(((texel >> iShift) & 0xFF) * ((color >> iShift) & 0xFF)) << iShift;
+			}
+			texel = filtered;
+		}
+
+		// Exact at both ends: the blend gives back dst at alpha 0 and the texel at 255.
+		uint32_t iAlpha = texel >> 24;
+		if(0 == iAlpha)
+		{
+			return dst;
+		}
+		if(255 == iAlpha)
+		{
+			return texel;
+		}
+		return Pack(Div255x4(Spread(texel) * iAlpha + Spread(dst) * (255 - iAlpha)));
+	}
+
+	// Reference: one pixel at a time.
+	void ClearScalar(COLOR_ARGB* pDst, int iCount, COLOR_ARGB color)
+	{
+		for(int i = 0; i < iCount; ++i)
+		{
+			pDst[i] = color;
+		}
+	}
+
+	void SpanScalar(COLOR_ARGB* pDst, int iCount, int iU, int iV, const Span& span)
+	{
+		for(int i = 0; i < iCount; ++i, iU += span.iDuDx, iV += span.iDvDx)
+		{
+			if(iU >= 0 && iU < span.iWidth && iV >= 0 && iV < span.iHeight)
+			{
+				COLOR_ARGB texel = span.pTexels[(iV >> FIXED_SHIFT) * span.iPitch + (iU >> FIXED_SHIFT)];
+				pDst[i] = Shade(texel, span.color, pDst[i]);
+			}
+		}
+	}
+
+#if SPRITE_RASTER_X86
+	// Exact x / 255 of 8 unsigned 16 bit values, as Div255.
+	inline __m128i Div255x8(__m128i x)
+	{
+		x = _mm_add_epi16(x, _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+	}
+
+	// Shade for 2 pixels widened to 16 bits a channel. color16 is the filter widened the same way.
+	inline __m128i Shade2(__m128i source, __m128i dest, __m128i color16, bool bFilter)
+	{
+		if(bFilter)
+		{
+			source = Div255x8(_mm_mullo_epi16(source, color16));
+		}
+		__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(source, 0xFF), 0xFF);
+		__m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+		return Div255x8(_mm_add_epi16(_mm_mullo_epi16(source, alpha), _mm_mullo_epi16(dest, inverse)));
+	}
+
+	// Shade for 4 pixels.
+	inline __m128i Shade4(__m128i texels, __m128i dst, __m128i color16, bool bFilter)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i lo = Shade2(_mm_unpacklo_epi8(texels, zero), _mm_unpacklo_epi8(dst, zero), color16, bFilter);
+		__m128i hi = Shade2(_mm_unpackhi_epi8(texels, zero), _mm_unpackhi_epi8(dst, zero), color16, bFilter);
+		return _mm_packus_epi16(lo, hi);
+	}
+
+	void ClearSSE2(COLOR_ARGB* pDst, int iCount, COLOR_ARGB color)
+	{
+		__m128i fill = _mm_set1_epi32((int)color);
+		int i = 0;
+		for(; i + 4 <= iCount; i += 4)
+		{
+			_mm_storeu_si128((__m128i*)(pDst + i), fill);
+		}
+		ClearScalar(pDst + i, iCount - i, color);
+	}
+
+	// 4 pixels per step. SSE2 has no gather, texels are fetched one at a time.
+	void SpanSSE2(COLOR_ARGB* pDst, int iCount, int iU, int iV, const Span& span)
+	{
+		const __m128i minusOne = _mm_set1_epi32(-1);
+		const __m128i width = _mm_set1_epi32(span.iWidth);
+		const __m128i height = _mm_set1_epi32(span.iHeight);
+		const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+		const __m128i stepU = _mm_set1_epi32(span.iDuDx * 4);
+		const __m128i stepV = _mm_set1_epi32(span.iDvDx * 4);
+		const __m128i color16 = _mm_unpacklo_epi8(_mm_set1_epi32((int)span.color), _mm_setzero_si128());
+		const __m128i rowMask = _mm_set1_epi32((int)0xFFFF0000);
+		const __m128i pitch = _mm_set1_epi32((span.iPitch << 16) | 1);
+		const bool bFilter = span.color != GraphicsNS::WHITE;
+
+		__m128i u = _mm_setr_epi32(iU, iU + span.iDuDx, iU + span.iDuDx * 2, iU + span.iDuDx * 3);
+		__m128i v = _mm_setr_epi32(iV, iV + span.iDvDx, iV + span.iDvDx * 2, iV + span.iDvDx * 3);
+		int i = 0;
+		for(; i + 4 <= iCount; i += 4, u = _mm_add_epi32(u, stepU), v = _mm_add_epi32(v, stepV))
+		{
+			__m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(u, minusOne), _mm_cmplt_epi32(u, width)),
+				_mm_and_si128(_mm_cmpgt_epi32(v, minusOne), _mm_cmplt_epi32(v, height)));
+			int iInside = _mm_movemask_ps(_mm_castsi128_ps(inside));
+			if(0 == iInside)
+			{
+				continue;
+			}
+
+			// Texel row in the high half of each lane, column in the low half, so one madd makes the index.
+			__m128i texel = _mm_or_si128(_mm_and_si128(v, rowMask), _mm_srli_epi32(u, FIXED_SHIFT));
+			__m128i index = _mm_and_si128(_mm_madd_epi16(texel, pitch), inside);
+			const COLOR_ARGB* pTexels = span.pTexels;
+			__m128i texels = _mm_setr_epi32((int)pTexels[_mm_cvtsi128_si32(index)],
+				(int)pTexels[_mm_cvtsi128_si32(_mm_shuffle_epi32(index, 1))],
+				(int)pTexels[_mm_cvtsi128_si32(_mm_shuffle_epi32(index, 2))],
+				(int)pTexels[_mm_cvtsi128_si32(_mm_shuffle_epi32(index, 3))]);
+			texels = _mm_and_si128(texels, inside);
+
+			// Opaque and unfiltered replaces what is there.
+			COLOR_ARGB* p = pDst + i;
+			if(!bFilter && 0xF == iInside && 0xFFFF == _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(texels, alphaMask), alphaMask)))
+			{
+				_mm_storeu_si128((__m128i*)p, texels);
+				continue;
+			}
+			_mm_storeu_si128((__m128i*)p, Shade4(texels, _mm_loadu_si128((const __m128i*)p), color16, bFilter));
+		}
+		SpanScalar(pDst + i, iCount - i, iU + span.iDuDx * i, iV + span.iDvDx * i, span);
+	}
+
+	// Div255x8, 16 wide.
+	TARGET_AVX2 inline __m256i Div255x16(__m256i x)
+	{
+		x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+		return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+	}
+
+	// Shade2, 4 pixels.
+	TARGET_AVX2 inline __m256i Shade4x2(__m256i source, __m256i dest, __m256i color16, bool bFilter)
+	{
+		if(bFilter)
+		{
+			source = Div255x16(_mm256_mullo_epi16(source, color16));
+		}
+		__m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(source, 0xFF), 0xFF);
+		__m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+		return Div255x16(_mm256_add_epi16(_mm256_mullo_epi16(source, alpha), _mm256_mullo_epi16(dest, inverse)));
+	}
+
+	TARGET_AVX2 void ClearAVX2(COLOR_ARGB* pDst, int iCount, COLOR_ARGB color)
+	{
+		__m256i fill = _mm256_set1_epi32((int)color);
+		int i = 0;
+		for(; i + 8 <= iCount; i += 8)
+		{
+			_mm256_storeu_si256((__m256i*)(pDst + i), fill);
+		}
+		_mm256_zeroupper();
+		ClearScalar(pDst + i, iCount - i, color);
+	}
+
+	// 8 pixels per step, texels gathered.
+	TARGET_AVX2 void SpanAVX2(COLOR_ARGB* pDst, int iCount, int iU, int iV, const Span& span)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i minusOne = _mm256_set1_epi32(-1);
+		const __m256i width = _mm256_set1_epi32(span.iWidth);
+		const __m256i height = _mm256_set1_epi32(span.iHeight);
+		const __m256i rowMask = _mm256_set1_epi32((int)0xFFFF0000);
+		const __m256i pitch = _mm256_set1_epi32((span.iPitch << 16) | 1);
+		const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+		const __m256i stepU = _mm256_set1_epi32(span.iDuDx * 8);
+		const __m256i stepV = _mm256_set1_epi32(span.iDvDx * 8);
+		const __m256i color16 = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)span.color), zero);
+		const bool bFilter = span.color != GraphicsNS::WHITE;
+
+		const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		__m256i u = _mm256_add_epi32(_mm256_set1_epi32(iU), _mm256_mullo_epi32(lane, _mm256_set1_epi32(span.iDuDx)));
+		__m256i v = _mm256_add_epi32(_mm256_set1_epi32(iV), _mm256_mullo_epi32(lane, _mm256_set1_epi32(span.iDvDx)));
+		int i = 0;
+		for(; i + 8 <= iCount; i += 8, u = _mm256_add_epi32(u, stepU), v = _mm256_add_epi32(v, stepV))
+		{
+			__m256i inside = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(u, minusOne), _mm256_cmpgt_epi32(width, u)),
+				_mm256_and_si256(_mm256_cmpgt_epi32(v, minusOne), _mm256_cmpgt_epi32(height, v)));
+			if(_mm256_testz_si256(inside, inside))
+			{
+				continue;
+			}
+
+			__m256i index = _mm256_madd_epi16(_mm256_or_si256(_mm256_and_si256(v, rowMask), _mm256_srli_epi32(u, FIXED_SHIFT)), pitch);
+			__m256i texels = _mm256_mask_i32gather_epi32(zero, (const int*)span.pTexels, index, inside, 4);
+
+			// Opaque and unfiltered replaces what is there.
+			COLOR_ARGB* p = pDst + i;
+			if(!bFilter && -1 == _mm256_movemask_epi8(_mm256_and_si256(inside, _mm256_cmpeq_epi32(_mm256_and_si256(texels, alphaMask), alphaMask))))
+			{
+				_mm256_storeu_si256((__m256i*)p, texels);
+				continue;
+			}
+
+			// Widening and packing both work within 128 bit lanes, so pixels come back in order.
+			__m256i dst = _mm256_loadu_si256((const __m256i*)p);
+			__m256i lo = Shade4x2(_mm256_unpacklo_epi8(texels, zero), _mm256_unpacklo_epi8(dst, zero), color16, bFilter);
+			__m256i hi = Shade4x2(_mm256_unpackhi_epi8(texels, zero), _mm256_unpackhi_epi8(dst, zero), color16, bFilter);
+			_mm256_storeu_si256((__m256i*)p, _mm256_packus_epi16(lo, hi));
+		}
+
+		// The scalar tail and the caller are not VEX encoded. GCC leaves this out before a tail call.
+		_mm256_zeroupper();
+		SpanScalar(pDst + i, iCount - i, iU + span.iDuDx * i, iV + span.iDvDx * i, span);
+	}
+#endif
+
+	// Narrow [fLo, fHi) to where fStart + x * fStep lies in [0, fEnd).
+	void ClipRange(float fStart, float fStep, float fEnd, float& fLo, float& fHi)
+	{
+		if(0.0f == fStep)
+		{
+			if(fStart < 0.0f || fStart >= fEnd)
+			{
+				fHi = fLo;
+			}
+			return;
+		}
+
+		float fA = -fStart / fStep;
+		float fB = (fEnd - fStart) / fStep;
+		fLo = fmaxf(fLo, fminf(fA, fB));
+		fHi = fminf(fHi, fmaxf(fA, fB));
+	}
+}
+
+SpriteRaster::SpriteRaster()
+	: m_iWidth(0)
+	, m_iHeight(0)
+	, m_Kernel(SCALAR)
+	, m_iPixelsDrawn(0)
+{
+	SetKernel(BEST);
+}
+
+void SpriteRaster::Initialize(int iWidth, int iHeight)
+{
+	m_iWidth = (iWidth > 0) ? iWidth : 0;
+	m_iHeight = (iHeight > 0) ? iHeight : 0;
+	m_Pixels.assign((size_t)m_iWidth * m_iHeight, 0);
+}
+
+void SpriteRaster::SetKernel(KERNEL kernel)
+{
+	// Fall back to what the processor has.
+	KERNEL best = SpriteTransform::GetBestKernel();
+	m_Kernel = (BEST == kernel || kernel > best) ? best : kernel;
+#if !SPRITE_RASTER_X86
+	m_Kernel = SCALAR;
+#endif
+}
+
+void SpriteRaster::Clear(COLOR_ARGB color)
+{
+	PROFILE_SCOPE("SpriteRaster::Clear");
+
+	m_iPixelsDrawn = 0;
+	int iCount = (int)m_Pixels.size();
+#if SPRITE_RASTER_X86
+	if(AVX2 == m_Kernel)
+	{
+		ClearAVX2(m_Pixels.data(), iCount, color);
+		return;
+	}
+	if(SSE2 == m_Kernel)
+	{
+		ClearSSE2(m_Pixels.data(), iCount, color);
+		return;
+	}
+#endif
+	ClearScalar(m_Pixels.data(), iCount, color);
+}
+
+void SpriteRaster::Draw(const HeadlessTexture* pTexture, const RECT& rect, const float matrix[ELEMENT_COUNT], COLOR_ARGB color)
+{
+	if(nullptr == pTexture || pTexture->pixels.size() < (size_t)pTexture->iWidth * pTexture->iHeight ||
+		pTexture->iWidth > MAX_TEXTURE_SIZE || pTexture->iHeight > MAX_TEXTURE_SIZE)
+	{
+		return;
+	}
+
+	// The part of the rect inside the texture.
+	int iLeft = (rect.left > 0) ? (int)rect.left : 0;
+	int iTop = (rect.top > 0) ? (int)rect.top : 0;
+	int iRight = (rect.right < (LONG)pTexture->iWidth) ? (int)rect.right : (int)pTexture->iWidth;
+	int iBottom = (rect.bottom < (LONG)pTexture->iHeight) ? (int)rect.bottom : (int)pTexture->iHeight;
+	if(iRight <= iLeft || iBottom <= iTop)
+	{
+		return;
+	}
+	float fWidth = (float)(iRight - iLeft);
+	float fHeight = (float)(iBottom - iTop);
+
+	// Screen to texel: the inverse of [u v 1] * matrix.
+	float fDeterminant = matrix[M11] * matrix[M22] - matrix[M12] * matrix[M21];
+	if(0.0f == fDeterminant)
+	{
+		return;
+	}
+	float fInverse = 1.0f / fDeterminant;
+	float fDuDx = matrix[M22] * fInverse;
+	float fDvDx = -matrix[M12] * fInverse;
+	float fDuDy = -matrix[M21] * fInverse;
+	float fDvDy = matrix[M11] * fInverse;
+	if(fabsf(fDuDx) > MAX_TEXELS_PER_PIXEL || fabsf(fDvDx) > MAX_TEXELS_PER_PIXEL)
+	{
+		return;
+	}
+
+	// Rows the corners span.
+	float fTop = matrix[DY], fBottom = matrix[DY];
+	const float corners[3][2] = { { fWidth, 0.0f }, { 0.0f, fHeight }, { fWidth, fHeight } };
+	for(int i = 0; i < 3; ++i)
+	{
+		float fY = corners[i][0] * matrix[M12] + corners[i][1] * matrix[M22] + matrix[DY];
+		fTop = fminf(fTop, fY);
+		fBottom = fmaxf(fBottom, fY);
+	}
+	int iFirstRow = (int)fmaxf(floorf(fTop), 0.0f);
+	int iLastRow = (int)fminf(ceilf(fBottom), (float)(m_iHeight - 1));
+
+	void (*pSpan)(COLOR_ARGB*, int, int, int, const Span&) = SpanScalar;
+#if SPRITE_RASTER_X86
+	pSpan = (AVX2 == m_Kernel) ? SpanAVX2 : ((SSE2 == m_Kernel) ? SpanSSE2 : SpanScalar);
+#endif
+
+	Span span;
+	span.pTexels = pTexture->pixels.data() + (size_t)iTop * pTexture->iWidth + iLeft;
+	span.iPitch = (int)pTexture->iWidth;
+	span.iWidth = (iRight - iLeft) << FIXED_SHIFT;
+	span.iHeight = (iBottom - iTop) << FIXED_SHIFT;
+	span.iDuDx = (int)(fDuDx * FIXED_ONE);
+	span.iDvDx = (int)(fDvDx * FIXED_ONE);
+	span.color = color;
+
+	for(int y = iFirstRow; y <= iLastRow; ++y)
+	{
+		// Texel coordinates at the center of pixel 0 of the row.
+		float fCenterY = (float)y + 0.5f - matrix[DY];
+		float fU = (0.5f - matrix[DX]) * fDuDx + fCenterY * fDuDy;
+		float fV = (0.5f - matrix[DX]) * fDvDx + fCenterY * fDvDy;
+
+		// Pixels whose centers fall inside the rect, give or take one. The kernels test each exactly.
+		float fLo = 0.0f, fHi = (float)m_iWidth;
+		ClipRange(fU, fDuDx, fWidth, fLo, fHi);
+		ClipRange(fV, fDvDx, fHeight, fLo, fHi);
+		if(fHi < fLo)
+		{
+			continue;
+		}
+		int iFirst = (int)fmaxf(floorf(fLo) - 1.0f, 0.0f);
+		int iLast = (int)fminf(ceilf(fHi) + 1.0f, (float)(m_iWidth - 1));
+		if(iLast < iFirst)
+		{
+			continue;
+		}
+
+		// Whole steps for the SIMD kernels, same span for every kernel. The extra pixels fail the inside test.
+		int iCount = (iLast - iFirst + SPAN_MULTIPLE) & ~(SPAN_MULTIPLE - 1);
+		iCount = (iCount < m_iWidth) ? iCount : m_iWidth;
+		iFirst = (iFirst + iCount <= m_iWidth) ? iFirst : m_iWidth - iCount;
+
+		float fX = (float)iFirst;
+		int iU = (int)floorf((fU + fX * fDuDx) * FIXED_ONE);
+		int iV = (int)floorf((fV + fX * fDvDx) * FIXED_ONE);
+		pSpan(m_Pixels.data() + (size_t)y * m_iWidth + iFirst, iCount, iU, iV, span);
+		m_iPixelsDrawn += iCount;
+	}
+}
+
+#endif
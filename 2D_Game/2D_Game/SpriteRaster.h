@@ -0,0 +1,61 @@
+#ifndef SPRITE_RASTER_H_
+#define SPRITE_RASTER_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <vector>
+
+#include "Graphics.h"
+#include "SpriteTransform.h"
+
+#ifndef _WIN32
+
+// SpriteRaster: Software stand-in for the Direct3D device and ID3DXSprite, for the headless
+// backend. Draws sprites into a 32 bit ARGB framebuffer in memory the way
+// ID3DXSprite::Draw does with D3DXSPRITE_ALPHABLEND: the source rect is placed at the
+// origin and transformed by the sprite matrix, each texel is multiplied by the color
+// filter, then blended over the framebuffer by its alpha. Texels are point sampled at
+// pixel centers.
+// The kernels differ only in width and give identical pixels, SCALAR being the reference.
+class SpriteRaster
+{
+private:
+
+	std::vector<COLOR_ARGB>		m_Pixels;		// Rows packed top to bottom.
+	int							m_iWidth;
+	int							m_iHeight;
+	SpriteTransformNS::KERNEL	m_Kernel;		// Never BEST.
+	int64_t						m_iPixelsDrawn;	// Pixels Draw visited since the last Clear.
+
+public:
+
+	// Constructor.
+	SpriteRaster();
+
+	// Size the framebuffer.
+	void Initialize(int iWidth, int iHeight);
+
+	// Choose the kernel for Clear and Draw. One the processor lacks falls back to the best it has.
+	void SetKernel(SpriteTransformNS::KERNEL kernel);
+
+	// Return the kernel in use.
+	SpriteTransformNS::KERNEL GetKernel(void) const { return m_Kernel; }
+
+	// Fill the framebuffer with color.
+	void Clear(COLOR_ARGB color);
+
+	// Draw rect of pTexture transformed by matrix, as made by SpriteTransform, filtered by color.
+	void Draw(const HeadlessTexture* pTexture, const RECT& rect, const float matrix[SpriteTransformNS::ELEMENT_COUNT], COLOR_ARGB color);
+
+	// Return the framebuffer.
+	const COLOR_ARGB* GetPixels(void) const { return m_Pixels.data(); }
+	int GetWidth(void) const { return m_iWidth; }
+	int GetHeight(void) const { return m_iHeight; }
+
+	// Return the pixels covered by sprites since the last Clear.
+	int64_t GetPixelsDrawn(void) const { return m_iPixelsDrawn; }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,465 @@
+#include "SpriteTransform.h"
+
+#include <cmath>
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define SPRITE_TRANSFORM_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define SPRITE_TRANSFORM_X86 0
+#endif
+
+// GCC and Clang only emit AVX2 instructions in functions marked for it.
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+using namespace SpriteTransformNS;
+
+namespace
+{
+	// Cephes single precision sine/cosine constants.
+	const float FOUR_OVER_PI = 1.27323954473516f;
+	const float MINUS_DP1 = -0.78515625f;
+	const float MINUS_DP2 = -2.4187564849853515625e-4f;
+	const float MINUS_DP3 = -3.77489497744594108e-8f;
+	const float SIN_P0 = -1.9515295891e-4f;
+	const float SIN_P1 = 8.3321608736e-3f;
+	const float SIN_P2 = -1.6666654611e-1f;
+	const float COS_P0 = 2.443315711809948e-5f;
+	const float COS_P1 = -1.388731625493765e-3f;
+	const float COS_P2 = 4.166664568298827e-2f;
+
+	// Multiply two 2D affine matrices in row vector form, 3 rows of 2.
+	void Multiply(const float a[3][2], const float b[3][2], float out[3][2])
+	{
+		float result[3][2];
+		result[0][0] = a[0][0] * b[0][0] + a[0][1] * b[1][0];
+		result[0][1] = a[0][0] * b[0][1] + a[0][1] * b[1][1];
+		result[1][0] = a[1][0] * b[0][0] + a[1][1] * b[1][0];
+		result[1][1] = a[1][0] * b[0][1] + a[1][1] * b[1][1];
+		result[2][0] = a[2][0] * b[0][0] + a[2][1] * b[1][0] + b[2][0];
+		result[2][1] = a[2][0] * b[0][1] + a[2][1] * b[1][1] + b[2][1];
+		memcpy(out, result, sizeof(result));
+	}
+
+	// Closed form of the D3DX composition, one sprite at a time.
+	void RunScalar(const SpriteTransformInput& input, int iCount, float* const pOut[ELEMENT_COUNT])
+	{
+		for(int i = 0; i < iCount; ++i)
+		{
+			float fScale = input.pScale[i];
+			float fScaleX = fScale, fScaleY = fScale;
+			float fCenterX = (float)(input.pWidth[i] / 2) * fScale;
+			float fCenterY = (float)(input.pHeight[i] / 2) * fScale;
+			float fX = input.pX[i];
+			float fY = input.pY[i];
+
+			if(input.pFlags[i] & FLIP_HORIZONTAL)
+			{
+				float fFlip = (float)input.pWidth[i] * fScale;
+				fScaleX = -fScaleX;
+				fCenterX -= fFlip;
+				fX += fFlip;
+			}
+
+			if(input.pFlags[i] & FLIP_VERTICAL)
+			{
+				float fFlip = (float)input.pHeight[i] * fScale;
+				fScaleY = -fScaleY;
+				fCenterY -= fFlip;
+				fY += fFlip;
+			}
+
+			float fSin = sinf(input.pAngle[i]);
+			float fCos = cosf(input.pAngle[i]);
+			pOut[M11][i] = fScaleX * fCos;
+			pOut[M12][i] = fScaleX * fSin;
+			pOut[M21][i] = -(fScaleY * fSin);
+			pOut[M22][i] = fScaleY * fCos;
+			pOut[DX][i] = fCenterX - (fCenterX * fCos - fCenterY * fSin) + fX;
+			pOut[DY][i] = fCenterY - (fCenterX * fSin + fCenterY * fCos) + fY;
+		}
+	}
+
+#if SPRITE_TRANSFORM_X86
+	// Sine and cosine of 4 angles, Cephes range reduction and polynomials.
+	inline void SinCos4(__m128 x, __m128& sine, __m128& cosine)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+
+		__m128 signSin = _mm_and_ps(x, signMask);
+		x = _mm_andnot_ps(signMask, x);
+
+		// Octant, rounded up to even.
+		__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+		octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		__m128 y = _mm_cvtepi32_ps(octant);
+
+		__m128 swapSignSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+		__m128 useCosPoly = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+		__m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		signSin = _mm_xor_ps(signSin, swapSignSin);
+
+		// Reduce to [-pi/4, pi/4] in three steps to keep precision.
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP1)));
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP2)));
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP3)));
+		__m128 z = _mm_mul_ps(x, x);
+
+		__m128 cosPoly = _mm_set1_ps(COS_P0);
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(COS_P1));
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(COS_P2));
+		cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+		cosPoly = _mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		cosPoly = _mm_add_ps(cosPoly, _mm_set1_ps(1.0f));
+
+		__m128 sinPoly = _mm_set1_ps(SIN_P0);
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(SIN_P1));
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(SIN_P2));
+		sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+		__m128 sinResult = _mm_or_ps(_mm_and_ps(useCosPoly, sinPoly), _mm_andnot_ps(useCosPoly, cosPoly));
+		__m128 cosResult = _mm_or_ps(_mm_and_ps(useCosPoly, cosPoly), _mm_andnot_ps(useCosPoly, sinPoly));
+		sine = _mm_xor_ps(sinResult, signSin);
+		cosine = _mm_xor_ps(cosResult, signCos);
+	}
+
+	// 4 sprites per step. iCount must be a multiple of 4.
+	void RunSSE2(const SpriteTransformInput& input, int iCount, float* const pOut[ELEMENT_COUNT])
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+		const __m128i flipH = _mm_set1_epi32(FLIP_HORIZONTAL);
+		const __m128i flipV = _mm_set1_epi32(FLIP_VERTICAL);
+
+		for(int i = 0; i < iCount; i += 4)
+		{
+			__m128 scale = _mm_loadu_ps(input.pScale + i);
+			__m128i width = _mm_loadu_si128((const __m128i*)(input.pWidth + i));
+			__m128i height = _mm_loadu_si128((const __m128i*)(input.pHeight + i));
+			__m128i flags = _mm_loadu_si128((const __m128i*)(input.pFlags + i));
+			__m128 x = _mm_loadu_ps(input.pX + i);
+			__m128 y = _mm_loadu_ps(input.pY + i);
+
+			__m128 centerX = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(width, 1)), scale);
+			__m128 centerY = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(height, 1)), scale);
+
+			// Flips as masks: negate the scale, move the center and the position by the sprite size.
+			__m128 maskH = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(flags, flipH), flipH));
+			__m128 maskV = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(flags, flipV), flipV));
+			__m128 flipX = _mm_and_ps(maskH, _mm_mul_ps(_mm_cvtepi32_ps(width), scale));
+			__m128 flipY = _mm_and_ps(maskV, _mm_mul_ps(_mm_cvtepi32_ps(height), scale));
+			__m128 scaleX = _mm_xor_ps(scale, _mm_and_ps(maskH, signMask));
+			__m128 scaleY = _mm_xor_ps(scale, _mm_and_ps(maskV, signMask));
+			centerX = _mm_sub_ps(centerX, flipX);
+			centerY = _mm_sub_ps(centerY, flipY);
+			x = _mm_add_ps(x, flipX);
+			y = _mm_add_ps(y, flipY);
+
+			__m128 sine, cosine;
+			SinCos4(_mm_loadu_ps(input.pAngle + i), sine, cosine);
+
+			_mm_storeu_ps(pOut[M11] + i, _mm_mul_ps(scaleX, cosine));
+			_mm_storeu_ps(pOut[M12] + i, _mm_mul_ps(scaleX, sine));
+			_mm_storeu_ps(pOut[M21] + i, _mm_xor_ps(_mm_mul_ps(scaleY, sine), signMask));
+			_mm_storeu_ps(pOut[M22] + i, _mm_mul_ps(scaleY, cosine));
+			__m128 rotatedX = _mm_sub_ps(_mm_mul_ps(centerX, cosine), _mm_mul_ps(centerY, sine));
+			__m128 rotatedY = _mm_add_ps(_mm_mul_ps(centerX, sine), _mm_mul_ps(centerY, cosine));
+			_mm_storeu_ps(pOut[DX] + i, _mm_add_ps(_mm_sub_ps(centerX, rotatedX), x));
+			_mm_storeu_ps(pOut[DY] + i, _mm_add_ps(_mm_sub_ps(centerY, rotatedY), y));
+		}
+	}
+
+	// SinCos4, 8 wide.
+	TARGET_AVX2 inline void SinCos8(__m256 x, __m256& sine, __m256& cosine)
+	{
+		const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+
+		__m256 signSin = _mm256_and_ps(x, signMask);
+		x = _mm256_andnot_ps(signMask, x);
+
+		__m256i octant = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(FOUR_OVER_PI)));
+		octant = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+		__m256 y = _mm256_cvtepi32_ps(octant);
+
+		__m256 swapSignSin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(4)), 29));
+		__m256 useCosPoly = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+		__m256 signCos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(octant, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+		signSin = _mm256_xor_ps(signSin, swapSignSin);
+
+		x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(MINUS_DP1)));
+		x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(MINUS_DP2)));
+		x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(MINUS_DP3)));
+		__m256 z = _mm256_mul_ps(x, x);
+
+		__m256 cosPoly = _mm256_set1_ps(COS_P0);
+		cosPoly = _mm256_add_ps(_mm256_mul_ps(cosPoly, z), _mm256_set1_ps(COS_P1));
+		cosPoly = _mm256_add_ps(_mm256_mul_ps(cosPoly, z), _mm256_set1_ps(COS_P2));
+		cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+		cosPoly = _mm256_sub_ps(cosPoly, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+		cosPoly = _mm256_add_ps(cosPoly, _mm256_set1_ps(1.0f));
+
+		__m256 sinPoly = _mm256_set1_ps(SIN_P0);
+		sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, z), _mm256_set1_ps(SIN_P1));
+		sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, z), _mm256_set1_ps(SIN_P2));
+		sinPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sinPoly, z), x), x);
+
+		__m256 sinResult = _mm256_blendv_ps(cosPoly, sinPoly, useCosPoly);
+		__m256 cosResult = _mm256_blendv_ps(sinPoly, cosPoly, useCosPoly);
+		sine = _mm256_xor_ps(sinResult, signSin);
+		cosine = _mm256_xor_ps(cosResult, signCos);
+	}
+
+	// 8 sprites per step. iCount must be a multiple of 8.
+	TARGET_AVX2 void RunAVX2(const SpriteTransformInput& input, int iCount, float* const pOut[ELEMENT_COUNT])
+	{
+		const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+		const __m256i flipH = _mm256_set1_epi32(FLIP_HORIZONTAL);
+		const __m256i flipV = _mm256_set1_epi32(FLIP_VERTICAL);
+
+		for(int i = 0; i < iCount; i += 8)
+		{
+			__m256 scale = _mm256_loadu_ps(input.pScale + i);
+			__m256i width = _mm256_loadu_si256((const __m256i*)(input.pWidth + i));
+			__m256i height = _mm256_loadu_si256((const __m256i*)(input.pHeight + i));
+			__m256i flags = _mm256_loadu_si256((const __m256i*)(input.pFlags + i));
+			__m256 x = _mm256_loadu_ps(input.pX + i);
+			__m256 y = _mm256_loadu_ps(input.pY + i);
+
+			__m256 centerX = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(width, 1)), scale);
+			__m256 centerY = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(height, 1)), scale);
+
+			__m256 maskH = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(flags, flipH), flipH));
+			__m256 maskV = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(flags, flipV), flipV));
+			__m256 flipX = _mm256_and_ps(maskH, _mm256_mul_ps(_mm256_cvtepi32_ps(width), scale));
+			__m256 flipY = _mm256_and_ps(maskV, _mm256_mul_ps(_mm256_cvtepi32_ps(height), scale));
+			__m256 scaleX = _mm256_xor_ps(scale, _mm256_and_ps(maskH, signMask));
+			__m256 scaleY = _mm256_xor_ps(scale, _mm256_and_ps(maskV, signMask));
+			centerX = _mm256_sub_ps(centerX, flipX);
+			centerY = _mm256_sub_ps(centerY, flipY);
+			x = _mm256_add_ps(x, flipX);
+			y = _mm256_add_ps(y, flipY);
+
+			__m256 sine, cosine;
+			SinCos8(_mm256_loadu_ps(input.pAngle + i), sine, cosine);
+
+			_mm256_storeu_ps(pOut[M11] + i, _mm256_mul_ps(scaleX, cosine));
+			_mm256_storeu_ps(pOut[M12] + i, _mm256_mul_ps(scaleX, sine));
+			_mm256_storeu_ps(pOut[M21] + i, _mm256_xor_ps(_mm256_mul_ps(scaleY, sine), signMask));
+			_mm256_storeu_ps(pOut[M22] + i, _mm256_mul_ps(scaleY, cosine));
+			__m256 rotatedX = _mm256_sub_ps(_mm256_mul_ps(centerX, cosine), _mm256_mul_ps(centerY, sine));
+			__m256 rotatedY = _mm256_add_ps(_mm256_mul_ps(centerX, sine), _mm256_mul_ps(centerY, cosine));
+			_mm256_storeu_ps(pOut[DX] + i, _mm256_add_ps(_mm256_sub_ps(centerX, rotatedX), x));
+			_mm256_storeu_ps(pOut[DY] + i, _mm256_add_ps(_mm256_sub_ps(centerY, rotatedY), y));
+		}
+	}
+
+	// Check the CPU and the OS for AVX2.
+	bool DetectAVX2(void)
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if(info[0] < 7)
+		{
+			return false;
+		}
+
+		// The OS must save the YMM registers.
+		__cpuid(info, 1);
+		bool bOSSaves = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+		__cpuidex(info, 7, 0);
+		return bOSSaves && (info[1] & (1 << 5));
+#else
+		return __builtin_cpu_supports("avx2") != 0;
+#endif
+	}
+#endif
+}
+
+void SpriteTransform::Compute(const SpriteData& spriteData, float matrix[ELEMENT_COUNT])
+{
+	float fCenterX = (float)(spriteData.iWidth / 2 * spriteData.fScale);
+	float fCenterY = (float)(spriteData.iHeight / 2 * spriteData.fScale);
+	float fX = spriteData.fX;
+	float fY = spriteData.fY;
+	float fScaleX = spriteData.fScale;
+	float fScaleY = spriteData.fScale;
+
+	if(spriteData.bFlipHorizontal)
+	{
+		fScaleX *= -1;
+		fCenterX -= (float)(spriteData.iWidth * spriteData.fScale);
+		fX += (float)(spriteData.iWidth * spriteData.fScale);
+	}
+
+	if(spriteData.bFlipVertical)
+	{
+		fScaleY *= -1;
+		fCenterY -= (float)(spriteData.iHeight * spriteData.fScale);
+		fY += (float)(spriteData.iHeight * spriteData.fScale);
+	}
+
+	// Scale, move the rotation center to the origin, rotate, move back, translate.
+	float fSin = sinf(spriteData.fAngle);
+	float fCos = cosf(spriteData.fAngle);
+	const float scaling[3][2] = { { fScaleX, 0.0f }, { 0.0f, fScaleY }, { 0.0f, 0.0f } };
+	const float toCenter[3][2] = { { 1.0f, 0.0f }, { 0.0f, 1.0f }, { -fCenterX, -fCenterY } };
+	const float rotation[3][2] = { { fCos, fSin }, { -fSin, fCos }, { 0.0f, 0.0f } };
+	const float fromCenter[3][2] = { { 1.0f, 0.0f }, { 0.0f, 1.0f }, { fCenterX + fX, fCenterY + fY } };
+
+	float result[3][2];
+	Multiply(scaling, toCenter, result);
+	Multiply(result, rotation, result);
+	Multiply(result, fromCenter, result);
+
+	matrix[M11] = result[0][0];
+	matrix[M12] = result[0][1];
+	matrix[M21] = result[1][0];
+	matrix[M22] = result[1][1];
+	matrix[DX] = result[2][0];
+	matrix[DY] = result[2][1];
+}
+
+void SpriteTransform::ComputeBatch(const SpriteTransformInput& input, int iCount, float* const pOut[ELEMENT_COUNT], KERNEL kernel /* = BEST */)
+{
+	if(BEST == kernel)
+	{
+		kernel = GetBestKernel();
+	}
+
+#if SPRITE_TRANSFORM_X86
+	if(SSE2 == kernel || AVX2 == kernel)
+	{
+		const int iLanes = (AVX2 == kernel) ? 8 : 4;
+		int iBody = iCount - iCount % iLanes;
+		if(AVX2 == kernel)
+		{
+			RunAVX2(input, iBody, pOut);
+		}
+		else
+		{
+			RunSSE2(input, iBody, pOut);
+		}
+
+		// Run the remainder through the same kernel, padded to a full step,
+		// so a sprite gets the same matrix wherever it sits in the batch.
+		int iTail = iCount - iBody;
+		if(iTail > 0)
+		{
+			float fX[8] = {}, fY[8] = {}, fScale[8] = {}, fAngle[8] = {};
+			int iWidth[8] = {}, iHeight[8] = {}, iFlags[8] = {};
+			float fOut[ELEMENT_COUNT][8];
+			float* pTailOut[ELEMENT_COUNT];
+			for(int i = 0; i < ELEMENT_COUNT; ++i)
+			{
+				pTailOut[i] = fOut[i];
+			}
+
+			for(int i = 0; i < iTail; ++i)
+			{
+				fX[i] = input.pX[iBody + i];
+				fY[i] = input.pY[iBody + i];
+				fScale[i] = input.pScale[iBody + i];
+				fAngle[i] = input.pAngle[iBody + i];
+				iWidth[i] = input.pWidth[iBody + i];
+				iHeight[i] = input.pHeight[iBody + i];
+				iFlags[i] = input.pFlags[iBody + i];
+			}
+
+			SpriteTransformInput tail = { fX, fY, fScale, fAngle, iWidth, iHeight, iFlags };
+			if(AVX2 == kernel)
+			{
+				RunAVX2(tail, 8, pTailOut);
+			}
+			else
+			{
+				RunSSE2(tail, 4, pTailOut);
+			}
+
+			for(int i = 0; i < ELEMENT_COUNT; ++i)
+			{
+				memcpy(pOut[i] + iBody, fOut[i], iTail * sizeof(float));
+			}
+		}
+		return;
+	}
+#endif
+
+	RunScalar(input, iCount, pOut);
+}
+
+KERNEL SpriteTransform::GetBestKernel(void)
+{
+#if SPRITE_TRANSFORM_X86
+	static const KERNEL best = DetectAVX2() ? AVX2 : SSE2;
+	return best;
+#else
+	return SCALAR;
+#endif
+}
+
+void SpriteBatch::Clear(void)
+{
+	m_fX.clear();
+	m_fY.clear();
+	m_fScale.clear();
+	m_fAngle.clear();
+	m_iWidth.clear();
+	m_iHeight.clear();
+	m_iFlags.clear();
+	m_Rects.clear();
+	m_Textures.clear();
+	m_Colors.clear();
+}
+
+void SpriteBatch::Reserve(size_t iCount)
+{
+	m_fX.reserve(iCount);
+	m_fY.reserve(iCount);
+	m_fScale.reserve(iCount);
+	m_fAngle.reserve(iCount);
+	m_iWidth.reserve(iCount);
+	m_iHeight.reserve(iCount);
+	m_iFlags.reserve(iCount);
+	m_Rects.reserve(iCount);
+	m_Textures.reserve(iCount);
+	m_Colors.reserve(iCount);
+	for(int i = 0; i < ELEMENT_COUNT; ++i)
+	{
+		m_fMatrix[i].reserve(iCount);
+	}
+}
+
+void SpriteBatch::Add(const SpriteData& spriteData, COLOR_ARGB color /* = GraphicsNS::WHITE */)
+{
+	m_fX.push_back(spriteData.fX);
+	m_fY.push_back(spriteData.fY);
+	m_fScale.push_back(spriteData.fScale);
+	m_fAngle.push_back(spriteData.fAngle);
+	m_iWidth.push_back(spriteData.iWidth);
+	m_iHeight.push_back(spriteData.iHeight);
+	m_iFlags.push_back((spriteData.bFlipHorizontal ? FLIP_HORIZONTAL : 0) | (spriteData.bFlipVertical ? FLIP_VERTICAL : 0));
+	m_Rects.push_back(spriteData.rect);
+	m_Textures.push_back(spriteData.texture);
+	m_Colors.push_back(color);
+}
+
+void SpriteBatch::ComputeTransforms(KERNEL kernel /* = BEST */)
+{
+	float* pOut[ELEMENT_COUNT];
+	for(int i = 0; i < ELEMENT_COUNT; ++i)
+	{
+		m_fMatrix[i].resize(m_fX.size());
+		pOut[i] = m_fMatrix[i].data();
+	}
+
+	SpriteTransformInput input = { m_fX.data(), m_fY.data(), m_fScale.data(), m_fAngle.data(), m_iWidth.data(), m_iHeight.data(), m_iFlags.data() };
+	SpriteTransform::ComputeBatch(input, GetCount(), pOut, kernel);
+}
@@ -0,0 +1,117 @@
+#ifndef SPRITE_TRANSFORM_H_
+#define SPRITE_TRANSFORM_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <vector>
+
+#include "Graphics.h"
+
+namespace SpriteTransformNS
+{
+	const int FLIP_HORIZONTAL = 1;		// Flag bits in SpriteTransformInput::pFlags.
+	const int FLIP_VERTICAL = 2;
+
+	// Matrix elements, in the order of D3DXMATRIX _11, _12, _21, _22, _41, _42.
+	enum ELEMENT
+	{
+		M11,
+		M12,
+		M21,
+		M22,
+		DX,
+		DY,
+		ELEMENT_COUNT
+	};
+
+	enum KERNEL
+	{
+		SCALAR,
+		SSE2,
+		AVX2,
+		BEST			// Widest kernel the CPU supports.
+	};
+
+	const char* const KERNEL_NAMES[] = { "scalar", "sse2", "avx2", "best" };
+}
+
+// SpriteTransformInput: Sprites to transform, one entry per sprite in each array.
+struct SpriteTransformInput
+{
+	const float*	pX;				// Top left corner.
+	const float*	pY;
+	const float*	pScale;
+	const float*	pAngle;			// Radians.
+	const int*		pWidth;			// Frame size in pixels, not negative.
+	const int*		pHeight;
+	const int*		pFlags;			// FLIP_ bits.
+};
+
+// SpriteTransform: Sprite matrices as Graphics::DrawSprite builds them with
+// D3DXMatrixTransformation2D: scale, rotate about the scaled center, translate.
+// Results are 2D affine matrices in row vector form, [x y 1] * M.
+class SpriteTransform
+{
+public:
+
+	// Reference: one sprite, composed matrix by matrix the way D3DX does it.
+	static void Compute(const SpriteData& spriteData, float matrix[SpriteTransformNS::ELEMENT_COUNT]);
+
+	// Transform iCount sprites. pOut holds ELEMENT_COUNT arrays of iCount floats.
+	// The SIMD kernels use a polynomial sine and cosine accurate to a few ulp for |angle| < 8192.
+	static void ComputeBatch(const SpriteTransformInput& input, int iCount, float* const pOut[SpriteTransformNS::ELEMENT_COUNT],
+		SpriteTransformNS::KERNEL kernel = SpriteTransformNS::BEST);
+
+	// Return the widest kernel this CPU can run.
+	static SpriteTransformNS::KERNEL GetBestKernel(void);
+};
+
+// SpriteBatch: Sprites gathered into arrays so their matrices can be computed together.
+// Fill with Add, then draw with Graphics::DrawSpriteBatch.
+class SpriteBatch
+{
+private:
+
+	std::vector<float>			m_fX;
+	std::vector<float>			m_fY;
+	std::vector<float>			m_fScale;
+	std::vector<float>			m_fAngle;
+	std::vector<int>			m_iWidth;
+	std::vector<int>			m_iHeight;
+	std::vector<int>			m_iFlags;
+	std::vector<RECT>			m_Rects;
+	std::vector<LP_TEXTURE>		m_Textures;
+	std::vector<COLOR_ARGB>		m_Colors;
+	std::vector<float>			m_fMatrix[SpriteTransformNS::ELEMENT_COUNT];	// Output of ComputeTransforms.
+
+public:
+
+	// Remove all sprites, keeping the memory.
+	void Clear(void);
+
+	// Make room for iCount sprites.
+	void Reserve(size_t iCount);
+
+	// Append a sprite drawn with a color filter.
+	void Add(const SpriteData& spriteData, COLOR_ARGB color = GraphicsNS::WHITE);
+
+	// Compute the matrix of every sprite.
+	void ComputeTransforms(SpriteTransformNS::KERNEL kernel = SpriteTransformNS::BEST);
+
+	// Return number of sprites.
+	int GetCount(void) const { return (int)m_fX.size(); }
+
+	// Return one element of sprite iIndex's matrix. Valid after ComputeTransforms.
+	float GetMatrix(int iIndex, SpriteTransformNS::ELEMENT element) const { return m_fMatrix[element][iIndex]; }
+
+	// Return the source rect of sprite iIndex.
+	const RECT& GetRect(int iIndex) const { return m_Rects[iIndex]; }
+
+	// Return the texture of sprite iIndex.
+	LP_TEXTURE GetTexture(int iIndex) const { return m_Textures[iIndex]; }
+
+	// Return the color filter of sprite iIndex.
+	COLOR_ARGB GetColor(int iIndex) const { return m_Colors[iIndex]; }
+};
+
+#endif
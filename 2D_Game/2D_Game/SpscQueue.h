@@ -0,0 +1,71 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <atomic>
+
+// SpscQueue: Lock-free single producer, single consumer ring of up to CAPACITY values,
+// a power of two. The producer calls Push, the consumer Front and Pop. Neither side ever
+// waits: Push fails when the ring is full, Front returns nullptr when it is empty. The
+// two indices sit on their own cache lines so the sides don't slow each other down.
+template <typename T, int CAPACITY>
+class SpscQueue
+{
+private:
+
+	static_assert(CAPACITY > 0 && 0 == (CAPACITY & (CAPACITY - 1)), "SpscQueue capacity must be a power of two");
+	static const unsigned int MASK = CAPACITY - 1;
+
+	T								m_Values[CAPACITY];
+	alignas(64) std::atomic<unsigned int>	m_iHead;		// Next to pop, written by the consumer.
+	alignas(64) std::atomic<unsigned int>	m_iTail;		// Next to push, written by the producer.
+
+public:
+
+	// Constructor.
+	SpscQueue()
+		: m_iHead(0)
+		, m_iTail(0)
+	{
+
+	}
+
+	// Producer: append value. Returns false, and drops it, if the ring is full.
+	bool Push(const T& value)
+	{
+		unsigned int iTail = m_iTail.load(std::memory_order_relaxed);
+		if(iTail - m_iHead.load(std::memory_order_acquire) >= (unsigned int)CAPACITY)
+		{
+			return false;
+		}
+
+		m_Values[iTail & MASK] = value;
+		m_iTail.store(iTail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer: return the oldest value, or nullptr if there is none. Good until Pop.
+	const T* Front(void) const
+	{
+		unsigned int iHead = m_iHead.load(std::memory_order_relaxed);
+		if(iHead == m_iTail.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+
+		return &m_Values[iHead & MASK];
+	}
+
+	// Consumer: drop the oldest value. Only after Front returned it.
+	void Pop(void)
+	{
+		m_iHead.store(m_iHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Return the number of values queued. Only a hint while the other side is running.
+	int GetCount(void) const
+	{
+		return (int)(m_iTail.load(std::memory_order_acquire) - m_iHead.load(std::memory_order_acquire));
+	}
+};
+
+#endif
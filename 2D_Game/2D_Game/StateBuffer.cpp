@@ -0,0 +1,44 @@
+#include "StateBuffer.h"
+
+void StateBuffer::Resize(size_t iSize)
+{
+	if(iSize > m_Bytes.size())
+	{
+		m_Bytes.resize(iSize);
+		++m_iGrowths;
+	}
+	m_iSize = iSize;
+	Rewind();
+}
+
+void StateBuffer::Write(const void* pData, size_t iSize)
+{
+	if(m_iSize + iSize > m_Bytes.size())
+	{
+		// Double, so a state that grows a little each tick doesn't reallocate each tick.
+		size_t iCapacity = m_Bytes.size() * 2;
+		m_Bytes.resize((iCapacity > m_iSize + iSize) ? iCapacity : m_iSize + iSize);
+		++m_iGrowths;
+	}
+	if(iSize > 0)
+	{
+		memcpy(m_Bytes.data() + m_iSize, pData, iSize);
+	}
+	m_iSize += iSize;
+}
+
+bool StateBuffer::Read(void* pData, size_t iSize)
+{
+	if(m_bBad || iSize > m_iSize - m_iRead)
+	{
+		m_bBad = true;
+		memset(pData, 0, iSize);
+		return false;
+	}
+	if(iSize > 0)
+	{
+		memcpy(pData, m_Bytes.data() + m_iRead, iSize);
+	}
+	m_iRead += iSize;
+	return true;
+}
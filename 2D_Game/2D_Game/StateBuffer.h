@@ -0,0 +1,96 @@
+#ifndef STATE_BUFFER_H_
+#define STATE_BUFFER_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+// StateBuffer: A flat byte image of game state. Objects append their members with
+// Write in SaveState and take them back in the same order with Read in LoadState,
+// so a snapshot is plain bytes that can be copied, compared, hashed or sent as is.
+// Only trivially copyable values go in. Storage grows to the largest state seen and
+// is kept, so saving every tick doesn't touch the heap once it has warmed up.
+// A Read past the end fails and leaves the buffer marked bad, so LoadState can read
+// everything and check once at the end.
+class StateBuffer
+{
+private:
+
+	std::vector<uint8_t>	m_Bytes;
+	size_t					m_iSize;			// Bytes written.
+	size_t					m_iRead;			// Next byte Read takes.
+	bool					m_bBad;				// A Read ran past the end.
+	int64_t					m_iGrowths;			// Times the storage had to be enlarged.
+
+public:
+
+	// Constructor.
+	StateBuffer() : m_iSize(0), m_iRead(0), m_bBad(false), m_iGrowths(0) {}
+
+	// Empty the buffer, keeping its storage.
+	void Clear(void) { m_iSize = 0; Rewind(); }
+
+	// Go back to reading from the start.
+	void Rewind(void) { m_iRead = 0; m_bBad = false; }
+
+	// Make the buffer iSize bytes long, for filling in through GetData. The contents are undefined.
+	void Resize(size_t iSize);
+
+	// Append iSize bytes.
+	void Write(const void* pData, size_t iSize);
+
+	// Take the next iSize bytes. Returns false, and zeroes pData, if there aren't that many.
+	bool Read(void* pData, size_t iSize);
+
+	// Append or take one value.
+	template <typename T>
+	void Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "state must be plain bytes");
+		Write(&value, sizeof(T));
+	}
+	template <typename T>
+	bool Read(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "state must be plain bytes");
+		return Read(&value, sizeof(T));
+	}
+
+	// Append iCount values and a count, or take them back into a vector. ReadArray refuses
+	// more than iMax values, so a bad buffer can't make it allocate without bound.
+	template <typename T>
+	void WriteArray(const T* pValues, int iCount)
+	{
+		Write(iCount);
+		Write(pValues, iCount * sizeof(T));
+	}
+	template <typename T>
+	bool ReadArray(std::vector<T>& values, int iMax)
+	{
+		int iCount = 0;
+		if(!Read(iCount) || iCount < 0 || iCount > iMax)
+		{
+			m_bBad = true;
+			return false;
+		}
+		values.resize(iCount);
+		return Read(values.data(), iCount * sizeof(T));
+	}
+
+	// Return the bytes written.
+	const uint8_t* GetData(void) const { return m_Bytes.data(); }
+	uint8_t* GetData(void) { return m_Bytes.data(); }
+	size_t GetSize(void) const { return m_iSize; }
+
+	// Return true if every Read so far found its bytes.
+	bool IsGood(void) const { return !m_bBad; }
+
+	// Return how many times Resize or Write had to enlarge the storage.
+	int64_t GetGrowthCount(void) const { return m_iGrowths; }
+};
+
+#endif
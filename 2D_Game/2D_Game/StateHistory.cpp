@@ -0,0 +1,276 @@
+#include "StateHistory.h"
+
+namespace
+{
+	void WriteVarint(StateBuffer& out, uint64_t iValue)
+	{
+		uint8_t bytes[10];
+		int iCount = 0;
+		while(iValue >= 0x80)
+		{
+			bytes[iCount++] = (uint8_t)(iValue | 0x80);
+			iValue >>= 7;
+		}
+		bytes[iCount++] = (uint8_t)iValue;
+		out.Write(bytes, iCount);
+	}
+
+	bool ReadVarint(const uint8_t* pData, size_t iSize, size_t& iAt, uint64_t& iValue)
+	{
+		iValue = 0;
+		for(int iShift = 0; iShift < 64 && iAt < iSize; iShift += 7)
+		{
+			uint8_t iByte = pData[iAt++];
+			iValue |= (uint64_t)(iByte & 0x7F) << iShift;
+			if(0 == (iByte & 0x80))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Byte i of a XOR b, with the shorter one read as zeros past its end.
+	inline uint8_t XorAt(const uint8_t* pA, size_t iSizeA, const uint8_t* pB, size_t iSizeB, size_t i)
+	{
+		return (uint8_t)(((i < iSizeA) ? pA[i] : 0) ^ ((i < iSizeB) ? pB[i] : 0));
+	}
+}
+
+// Constructor.
+StateHistory::StateHistory()
+	: m_iOldest(0)
+	, m_iCount(0)
+	, m_iLatestTick(-1)
+	, m_iPushes(0)
+	, m_iDeltaBytes(0)
+{
+}
+
+void StateHistory::Initialize(int iTicks)
+{
+	m_Entries.clear();
+	m_Entries.resize((iTicks > 1) ? iTicks - 1 : 0);
+	Clear();
+}
+
+void StateHistory::Clear(void)
+{
+	m_iOldest = 0;
+	m_iCount = 0;
+	m_iLatestTick = -1;
+	m_Latest.Clear();
+	m_iPushes = 0;
+	m_iDeltaBytes = 0;
+}
+
+void StateHistory::Push(int64_t iTick, const StateBuffer& state)
+{
+	if(m_iLatestTick >= 0 && !m_Entries.empty())
+	{
+		// The slot after the newest entry, or the oldest one's when full.
+		int iCapacity = (int)m_Entries.size();
+		int iSlot = (m_iOldest + m_iCount) % iCapacity;
+		if(m_iCount == iCapacity)
+		{
+			m_iOldest = (m_iOldest + 1) % iCapacity;
+		}
+		else
+		{
+			++m_iCount;
+		}
+
+		Entry& entry = m_Entries[iSlot];
+		entry.iTick = m_iLatestTick;
+		Encode(m_Latest, state, entry.delta);
+		m_iDeltaBytes += entry.delta.GetSize();
+	}
+
+	m_Latest.Resize(state.GetSize());
+	memcpy(m_Latest.GetData(), state.GetData(), state.GetSize());
+	m_iLatestTick = iTick;
+	++m_iPushes;
+}
+
+bool StateHistory::Restore(int64_t iTick, StateBuffer& state)
+{
+	if(m_iLatestTick < 0 || iTick > m_iLatestTick || iTick < GetOldestTick())
+	{
+		return false;
+	}
+
+	// Newest first, undo one tick at a time.
+	state.Resize(m_Latest.GetSize());
+	memcpy(state.GetData(), m_Latest.GetData(), m_Latest.GetSize());
+	int64_t iAt = m_iLatestTick;
+	int iCapacity = (int)m_Entries.size();
+	for(int i = m_iCount - 1; i >= 0; --i)
+	{
+		const Entry& entry = m_Entries[(m_iOldest + i) % iCapacity];
+		if(entry.iTick < iTick)
+		{
+			break;
+		}
+		if(!Apply(entry.delta, state))
+		{
+			return false;
+		}
+		iAt = entry.iTick;
+	}
+
+	// Ticks that were never pushed aren't kept.
+	return iAt == iTick;
+}
+
+bool StateHistory::Rewind(int64_t iTick, StateBuffer& state)
+{
+	if(!Restore(iTick, state))
+	{
+		return false;
+	}
+
+	// Drop the entries from iTick on, they lead to the states after it.
+	int iCapacity = (int)m_Entries.size();
+	while(m_iCount > 0 && m_Entries[(m_iOldest + m_iCount - 1) % iCapacity].iTick >= iTick)
+	{
+		--m_iCount;
+	}
+	m_Latest.Resize(state.GetSize());
+	memcpy(m_Latest.GetData(), state.GetData(), state.GetSize());
+	m_iLatestTick = iTick;
+	return true;
+}
+
+int64_t StateHistory::GetOldestTick(void) const
+{
+	if(m_iLatestTick < 0)
+	{
+		return -1;
+	}
+	return (m_iCount > 0) ? m_Entries[m_iOldest].iTick : m_iLatestTick;
+}
+
+size_t StateHistory::GetLastDeltaSize(void) const
+{
+	if(0 == m_iCount)
+	{
+		return 0;
+	}
+	return m_Entries[(m_iOldest + m_iCount - 1) % m_Entries.size()].delta.GetSize();
+}
+
+int64_t StateHistory::GetGrowthCount(void) const
+{
+	int64_t iGrowths = m_Latest.GetGrowthCount();
+	for(size_t i = 0; i < m_Entries.size(); ++i)
+	{
+		iGrowths += m_Entries[i].delta.GetGrowthCount();
+	}
+	return iGrowths;
+}
+
+void StateHistory::Encode(const StateBuffer& a, const StateBuffer& b, StateBuffer& delta)
+{
+	const uint8_t* pA = a.GetData();
+	const uint8_t* pB = b.GetData();
+	size_t iSizeA = a.GetSize();
+	size_t iSizeB = b.GetSize();
+	size_t iCommon = (iSizeA < iSizeB) ? iSizeA : iSizeB;
+	size_t iSize = (iSizeA > iSizeB) ? iSizeA : iSizeB;
+
+	// Room for the worst case up front, so a ring slot stops growing after its first
+	// delta instead of whenever a busier tick lands in it.
+	delta.Resize(iSize + iSize / 2 + 32);
+	delta.Clear();
+	WriteVarint(delta, iSizeA);
+	WriteVarint(delta, iSizeB);
+	size_t i = 0;
+	while(i < iSize)
+	{
+		// Skip equal bytes, eight at a time where both states have them.
+		size_t iStart = i;
+		while(i + 8 <= iCommon)
+		{
+			uint64_t iWordA, iWordB;
+			memcpy(&iWordA, pA + i, 8);
+			memcpy(&iWordB, pB + i, 8);
+			if(iWordA != iWordB)
+			{
+				break;
+			}
+			i += 8;
+		}
+		while(i < iSize && 0 == XorAt(pA, iSizeA, pB, iSizeB, i))
+		{
+			++i;
+		}
+		size_t iZeros = i - iStart;
+
+		// Then the bytes that differ, up to the next run of at least two equal bytes,
+		// which is where a new pair starts paying for itself.
+		size_t iLiteral = i;
+		while(iLiteral < iSize)
+		{
+			if(0 == XorAt(pA, iSizeA, pB, iSizeB, iLiteral)
+				&& (iLiteral + 1 >= iSize || 0 == XorAt(pA, iSizeA, pB, iSizeB, iLiteral + 1)))
+			{
+				break;
+			}
+			++iLiteral;
+		}
+
+		WriteVarint(delta, iZeros);
+		WriteVarint(delta, iLiteral - i);
+		for(; i < iLiteral; ++i)
+		{
+			uint8_t iByte = XorAt(pA, iSizeA, pB, iSizeB, i);
+			delta.Write(iByte);
+		}
+	}
+}
+
+bool StateHistory::Apply(const StateBuffer& delta, StateBuffer& state)
+{
+	const uint8_t* pDelta = delta.GetData();
+	size_t iDeltaSize = delta.GetSize();
+	size_t iAt = 0;
+	uint64_t iSizeA, iSizeB;
+	if(!ReadVarint(pDelta, iDeltaSize, iAt, iSizeA) || !ReadVarint(pDelta, iDeltaSize, iAt, iSizeB))
+	{
+		return false;
+	}
+	if(state.GetSize() != iSizeA && state.GetSize() != iSizeB)
+	{
+		return false;
+	}
+
+	// Work over the longer of the two, zero filled past the state's end.
+	size_t iFrom = state.GetSize();
+	size_t iTo = (iFrom == iSizeA) ? (size_t)iSizeB : (size_t)iSizeA;
+	size_t iSize = (iFrom > iTo) ? iFrom : iTo;
+	state.Resize(iSize);
+	uint8_t* pState = state.GetData();
+	if(iSize > iFrom)
+	{
+		memset(pState + iFrom, 0, iSize - iFrom);
+	}
+
+	size_t i = 0;
+	while(iAt < iDeltaSize)
+	{
+		uint64_t iZeros, iLiteral;
+		if(!ReadVarint(pDelta, iDeltaSize, iAt, iZeros) || !ReadVarint(pDelta, iDeltaSize, iAt, iLiteral)
+			|| iZeros > iSize - i || iLiteral > iSize - i - iZeros || iLiteral > iDeltaSize - iAt)
+		{
+			return false;
+		}
+		i += iZeros;
+		for(uint64_t j = 0; j < iLiteral; ++j)
+		{
+			pState[i++] ^= pDelta[iAt++];
+		}
+	}
+
+	state.Resize(iTo);
+	return true;
+}
@@ -0,0 +1,85 @@
+#ifndef STATE_HISTORY_H_
+#define STATE_HISTORY_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <stdint.h>
+#include <vector>
+
+#include "StateBuffer.h"
+
+// StateHistory: The last few ticks of game state, for rollback and desync hunting.
+// The newest state is kept whole. Each older tick is kept as its delta to the tick
+// after it: the two states XORed together, with the runs of zero bytes, where nothing
+// changed, squeezed out. XOR is its own inverse, so applying a tick's delta to the
+// state after it gives the tick back, and Restore walks back from the newest state one
+// delta at a time. Most of a state doesn't change from one tick to the next, so a
+// delta is a small fraction of a state.
+// Delta format: the sizes of the two states, then pairs of a zero run length and a
+// literal length, each a varint, the literal XOR bytes following their pair. States
+// of different sizes are XORed as if the shorter one ended in zeros.
+class StateHistory
+{
+private:
+
+	// One tick older than the newest.
+	struct Entry
+	{
+		int64_t		iTick;
+		StateBuffer	delta;				// To the state pushed after it.
+	};
+
+	std::vector<Entry>		m_Entries;		// Ring, oldest at m_iOldest.
+	int						m_iOldest;
+	int						m_iCount;		// Entries in use.
+	StateBuffer				m_Latest;		// Newest state, whole.
+	int64_t					m_iLatestTick;	// -1 before the first Push.
+	StateBuffer				m_Scratch;		// Restore works in here.
+	int64_t					m_iPushes;
+	int64_t					m_iDeltaBytes;	// Delta bytes written by every Push.
+
+public:
+
+	// Constructor.
+	StateHistory();
+
+	// Keep iTicks states: the newest and iTicks - 1 deltas before it.
+	void Initialize(int iTicks);
+
+	// Forget every state.
+	void Clear(void);
+
+	// Add the state at iTick, which must be later than the newest. The oldest is dropped
+	// once the history is full.
+	void Push(int64_t iTick, const StateBuffer& state);
+
+	// Copy the state at iTick into state. Returns false if it isn't kept.
+	bool Restore(int64_t iTick, StateBuffer& state);
+
+	// Make iTick the newest state, dropping the ones after it, and copy it into state.
+	// Returns false, and changes nothing, if it isn't kept.
+	bool Rewind(int64_t iTick, StateBuffer& state);
+
+	// Return the newest and oldest ticks kept, -1 if none.
+	int64_t GetLatestTick(void) const { return m_iLatestTick; }
+	int64_t GetOldestTick(void) const;
+
+	// Return the size of the newest state and of the delta the last Push wrote.
+	size_t GetLatestSize(void) const { return m_Latest.GetSize(); }
+	size_t GetLastDeltaSize(void) const;
+
+	// Return how many times the newest state and the deltas have had to enlarge their storage.
+	// Stops rising once every slot has held a delta as big as the ones still to come.
+	int64_t GetGrowthCount(void) const;
+
+	// Return the average delta size, in bytes.
+	double GetAverageDeltaSize(void) const { return (m_iPushes > 1) ? (double)m_iDeltaBytes / (m_iPushes - 1) : 0.0; }
+
+	// Write the delta between states a and b into delta.
+	static void Encode(const StateBuffer& a, const StateBuffer& b, StateBuffer& delta);
+
+	// Turn state, which is one side of delta, into the other. Returns false if delta is malformed.
+	static bool Apply(const StateBuffer& delta, StateBuffer& state);
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "SweptCollision.h"
+
+#include <cmath>
+
+float SweptCollision::Wrap(float fDelta, float fPeriod)
+{
+	return fDelta - fPeriod * floorf(fDelta / fPeriod + .5f);
+}
+
+bool SweptCollision::SegmentCircle(float fX, float fY, float fDX, float fDY, float fRadius, float& fTime)
+{
+	// Solve |p + d t| = r for the smaller root: a t^2 + 2 b t + c = 0.
+	float fC = fX * fX + fY * fY - fRadius * fRadius;
+	if(fC <= 0.0f)
+	{
+		fTime = 0.0f;
+		return true;
+	}
+
+	float fA = fDX * fDX + fDY * fDY;
+	float fB = fX * fDX + fY * fDY;
+	if(fB >= 0.0f || fA <= 0.0f)
+	{
+		// Outside and not closing in.
+		return false;
+	}
+
+	float fDiscriminant = fB * fB - fA * fC;
+	if(fDiscriminant < 0.0f)
+	{
+		return false;
+	}
+
+	// -b + sqrt is the far root; c / that is the near one without cancellation.
+	float fFar = -fB + sqrtf(fDiscriminant);
+	float fT = fC / fFar;
+	if(fT > 1.0f)
+	{
+		return false;
+	}
+
+	fTime = fT;
+	return true;
+}
+
+bool SweptCollision::FirstContact(const SweptCircle& a, const SweptCircle& b, float fWidth, float fHeight, float& fTime)
+{
+	// Work in A's frame: B starts the short way around from A and moves by the difference.
+	float fX = Wrap(b.fX - a.fX, fWidth);
+	float fY = Wrap(b.fY - a.fY, fHeight);
+	return SegmentCircle(fX, fY, b.fDX - a.fDX, b.fDY - a.fDY, a.fRadius + b.fRadius, fTime);
+}
@@ -0,0 +1,36 @@
+#ifndef SWEPT_COLLISION_H_
+#define SWEPT_COLLISION_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+// A circle moving in a straight line over one tick.
+struct SweptCircle
+{
+	float	fX;				// Center at the start of the tick.
+	float	fY;
+	float	fDX;			// Motion over the tick.
+	float	fDY;
+	float	fRadius;
+};
+
+// SweptCollision: Time of impact tests for objects that move a long way in one tick.
+// Two moving circles meet when the path of one, relative to the other, passes within
+// the sum of their radii of it: a capsule against a point. Positions wrap at the
+// world size, so objects are always compared the short way around.
+class SweptCollision
+{
+public:
+
+	// Return fDelta moved into [-fPeriod / 2, fPeriod / 2] by whole periods.
+	static float Wrap(float fDelta, float fPeriod);
+
+	// Find when a point moving from (fX, fY) by (fDX, fDY) over the tick first comes within
+	// fRadius of the origin. Returns false if it doesn't this tick. fTime runs 0 to 1,
+	// and is 0 if the point starts inside.
+	static bool SegmentCircle(float fX, float fY, float fDX, float fDY, float fRadius, float& fTime);
+
+	// Find when two circles first touch during the tick, in a world fWidth by fHeight.
+	static bool FirstContact(const SweptCircle& a, const SweptCircle& b, float fWidth, float fHeight, float& fTime);
+};
+
+#endif
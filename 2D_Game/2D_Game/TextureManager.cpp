@@ -1,4 +1,49 @@
 #include "TextureManager.h"
+#include "Profiler.h"
+
+TextureManager* TextureManager::s_Registry[TextureManagerNS::MAX_TEXTURES] = { nullptr };
+size_t TextureManager::s_iCacheBytes = 0;
+size_t TextureManager::s_iCacheBudget = TEXTURE_CACHE_BUDGET;
+uint64_t TextureManager::s_iUseClock = 0;
+int64_t TextureManager::s_iCacheHits = 0;
+int64_t TextureManager::s_iCacheMisses = 0;
+
+namespace
+{
+	// Pack pixels into (run length, color) pairs.
+	void PackRuns(const std::vector<COLOR_ARGB>& pixels, std::vector<COLOR_ARGB>& packed)
+	{
+		packed.clear();
+		for(size_t i = 0; i < pixels.size();)
+		{
+			size_t iRun = 1;
+			while(i + iRun < pixels.size() && pixels[i + iRun] == pixels[i])
+			{
+				++iRun;
+			}
+
+			packed.push_back((COLOR_ARGB)iRun);
+			packed.push_back(pixels[i]);
+			i += iRun;
+
+			// Not worth packing, stop early.
+			if(packed.size() >= pixels.size())
+			{
+				return;
+			}
+		}
+	}
+
+	// Expand (run length, color) pairs into pixels.
+	void UnpackRuns(const std::vector<COLOR_ARGB>& packed, std::vector<COLOR_ARGB>& pixels)
+	{
+		pixels.clear();
+		for(size_t i = 0; i + 1 < packed.size(); i += 2)
+		{
+			pixels.insert(pixels.end(), packed[i], packed[i + 1]);
+		}
+	}
+}
 
 // Default constructor.
 TextureManager::TextureManager()
@@ -7,26 +52,45 @@ TextureManager::TextureManager()
 	, m_iHeight(0)
 	, m_pGraphics(nullptr)
 	, m_bInitialized(false)
+	, m_iId(-1)
+	, m_bCachePacked(false)
+	, m_iLastUse(0)
+	, m_iOpacityStride(0)
 {
-
+	// Take the first free id.
+	for(int i = 0; i < TextureManagerNS::MAX_TEXTURES; ++i)
+	{
+		if(nullptr == s_Registry[i])
+		{
+			s_Registry[i] = this;
+			m_iId = i;
+			break;
+		}
+	}
 }
 
 // Destructor.
 TextureManager::~TextureManager()
 {
+	if(m_iId >= 0)
+	{
+		s_Registry[m_iId] = nullptr;
+	}
+
+	DropCache();
 	SAFE_RELEASE(m_Texture);
 }
 
 bool TextureManager::Initialize(Graphics *pGraphics, const char* pFile)
 {
+	PROFILE_SCOPE("TextureManager::Initialize");
+
 	try
 	{
 		m_pGraphics = pGraphics;
 		m_pFile = pFile;
 
-		m_Result = m_pGraphics->LoadTextures(m_pFile, TRANSCOLOR, m_iWidth, m_iHeight, m_Texture);
-
-		if(FAILED(m_Result))
+		if(!Load())
 		{
 			SAFE_RELEASE(m_Texture);
 			return false;
@@ -41,6 +105,119 @@ bool TextureManager::Initialize(Graphics *pGraphics, const char* pFile)
 	return true;
 }
 
+bool TextureManager::Load(void)
+{
+	std::vector<COLOR_ARGB> pixels;
+	m_Result = m_pGraphics->DecodeImage(m_pFile, TRANSCOLOR, m_iWidth, m_iHeight, pixels);
+	if(SUCCEEDED(m_Result))
+	{
+		m_Result = m_pGraphics->CreateTextureFromPixels(pixels.data(), m_iWidth, m_iHeight, m_Texture);
+		if(SUCCEEDED(m_Result))
+		{
+			StoreOpacity(pixels);
+			StoreCache(pixels);
+		}
+	}
+	else
+	{
+		// No decoder on this backend, let the device load the file.
+		m_Result = m_pGraphics->LoadTextures(m_pFile, TRANSCOLOR, m_iWidth, m_iHeight, m_Texture);
+	}
+
+	m_iLastUse = ++s_iUseClock;
+	return SUCCEEDED(m_Result);
+}
+
+void TextureManager::StoreOpacity(const std::vector<COLOR_ARGB>& pixels)
+{
+	m_iOpacityStride = (int)(m_iWidth + 63) / 64;
+	m_Opacity.assign((size_t)m_iOpacityStride * m_iHeight, 0);
+	for(UINT y = 0; y < m_iHeight; ++y)
+	{
+		uint64_t* pRow = m_Opacity.data() + (size_t)y * m_iOpacityStride;
+		for(UINT x = 0; x < m_iWidth; ++x)
+		{
+			if((pixels[y * m_iWidth + x] >> 24) >= TextureManagerNS::OPAQUE_ALPHA)
+			{
+				pRow[x >> 6] |= (uint64_t)1 << (x & 63);
+			}
+		}
+	}
+}
+
+int TextureManager::CreateCollisionMask(const MaskLayout& layout)
+{
+	PROFILE_SCOPE("TextureManager::CreateCollisionMask");
+
+	m_Masks.push_back(CollisionMask());
+	m_Masks.back().Build(layout, m_Opacity.empty() ? nullptr : m_Opacity.data(), m_iOpacityStride, m_iWidth, m_iHeight);
+	return (int)m_Masks.size() - 1;
+}
+
+void TextureManager::StoreCache(std::vector<COLOR_ARGB>& pixels)
+{
+	DropCache();
+
+	std::vector<COLOR_ARGB> packed;
+	PackRuns(pixels, packed);
+	m_bCachePacked = packed.size() < pixels.size();
+	if(m_bCachePacked)
+	{
+		packed.shrink_to_fit();
+		m_Cache.swap(packed);
+	}
+	else
+	{
+		m_Cache.swap(pixels);
+	}
+
+	// Bigger than the whole budget, this one always reloads from file.
+	if(GetCacheBytes() > s_iCacheBudget)
+	{
+		DropCache();
+		return;
+	}
+
+	s_iCacheBytes += GetCacheBytes();
+	TrimCaches(this);
+}
+
+void TextureManager::DropCache(void)
+{
+	s_iCacheBytes -= GetCacheBytes();
+	std::vector<COLOR_ARGB>().swap(m_Cache);
+	m_bCachePacked = false;
+}
+
+void TextureManager::TrimCaches(const TextureManager* pKeep)
+{
+	while(s_iCacheBytes > s_iCacheBudget)
+	{
+		TextureManager* pOldest = nullptr;
+		for(int i = 0; i < TextureManagerNS::MAX_TEXTURES; ++i)
+		{
+			TextureManager* pTexture = s_Registry[i];
+			if(pTexture && pTexture != pKeep && !pTexture->m_Cache.empty() && (nullptr == pOldest || pTexture->m_iLastUse < pOldest->m_iLastUse))
+			{
+				pOldest = pTexture;
+			}
+		}
+
+		if(nullptr == pOldest)
+		{
+			return;
+		}
+
+		pOldest->DropCache();
+	}
+}
+
+void TextureManager::SetCacheBudget(size_t iBytes)
+{
+	s_iCacheBudget = iBytes;
+	TrimCaches(nullptr);
+}
+
 void TextureManager::OnLostDevice(void)
 {
 	if(!m_bInitialized)
@@ -53,10 +230,32 @@ void TextureManager::OnLostDevice(void)
 
 void TextureManager::OnResetDevice(void)
 {
+	PROFILE_SCOPE("TextureManager::OnResetDevice");
+
 	if(!m_bInitialized)
 	{
 		return;
 	}
 
-	m_pGraphics->LoadTextures(m_pFile, TRANSCOLOR, m_iWidth, m_iHeight, m_Texture);
-}
\ No newline at end of file
+	if(m_Cache.empty())
+	{
+		++s_iCacheMisses;
+		Load();
+		return;
+	}
+
+	// Upload straight from the cache, no file I/O or decode.
+	++s_iCacheHits;
+	if(m_bCachePacked)
+	{
+		std::vector<COLOR_ARGB> pixels;
+		pixels.reserve(m_iWidth * m_iHeight);
+		UnpackRuns(m_Cache, pixels);
+		m_Result = m_pGraphics->CreateTextureFromPixels(pixels.data(), m_iWidth, m_iHeight, m_Texture);
+	}
+	else
+	{
+		m_Result = m_pGraphics->CreateTextureFromPixels(m_Cache.data(), m_iWidth, m_iHeight, m_Texture);
+	}
+	m_iLastUse = ++s_iUseClock;
+}
@@ -3,13 +3,33 @@
 
 #define WIN32_LEAN_AND_MEAN
 
+#include <stdint.h>
+#include <vector>
+
 #include "Graphics.h"
 #include "Constants.h"
+#include "CollisionMask.h"
+
+namespace TextureManagerNS
+{
+	const int MAX_TEXTURES = 256;		// Texture ids available.
+	const UINT OPAQUE_ALPHA = 128;		// Texels at or above this alpha are solid to collision masks.
+}
 
 class TextureManager
 {
 private:
 
+	// Live texture managers by id, so other threads can refer to textures by number.
+	static TextureManager*	s_Registry[TextureManagerNS::MAX_TEXTURES];
+
+	// Shadow cache accounting, shared by all texture managers.
+	static size_t			s_iCacheBytes;		// Bytes held by all caches.
+	static size_t			s_iCacheBudget;		// Least recently loaded caches are dropped above this.
+	static uint64_t			s_iUseClock;		// Incremented every load, orders m_iLastUse.
+	static int64_t			s_iCacheHits;		// Resets restored from a cache.
+	static int64_t			s_iCacheMisses;		// Resets that went back to the file.
+
 	// TextureManager properties.
 	UINT			m_iWidth;			// Width of texture in pixels
 	UINT			m_iHeight;			// Height of texture in pixels
@@ -18,6 +38,28 @@ private:
 	Graphics*		m_pGraphics;		// Pointer to graphics
 	bool			m_bInitialized;		// True when successfully initialized
 	HRESULT			m_Result;
+	int				m_iId;				// Index in s_Registry, -1 if the registry was full.
+	std::vector<COLOR_ARGB>	m_Cache;	// Decoded, color keyed pixels. Empty when dropped.
+	bool			m_bCachePacked;		// m_Cache holds (run length, color) pairs.
+	uint64_t		m_iLastUse;			// s_iUseClock when the texture was last loaded.
+	std::vector<uint64_t>	m_Opacity;	// One bit per texel, set where opaque. Empty without a decoder.
+	int				m_iOpacityStride;	// Words per row of m_Opacity.
+	std::vector<CollisionMask>	m_Masks;
+
+	// Keep which texels are opaque, for collision masks.
+	void StoreOpacity(const std::vector<COLOR_ARGB>& pixels);
+
+	// Decode the file, create the texture and cache the pixels.
+	bool Load(void);
+
+	// Keep pixels for the next reset, run-length packed if that is smaller.
+	void StoreCache(std::vector<COLOR_ARGB>& pixels);
+
+	// Free the cached pixels.
+	void DropCache(void);
+
+	// Drop least recently loaded caches, other than pKeep, until under budget.
+	static void TrimCaches(const TextureManager* pKeep);
 
 public:
 
@@ -35,6 +77,20 @@ public:
 	// Returns the texture height
 	UINT GetHeight(void) const { return m_iHeight; }
 
+	// Returns the texture id.
+	int GetId(void) const { return m_iId; }
+
+	// Returns the texture manager with the given id, or nullptr.
+	static TextureManager* FromId(int iId)
+	{
+		if(iId < 0 || iId >= TextureManagerNS::MAX_TEXTURES)
+		{
+			return nullptr;
+		}
+
+		return s_Registry[iId];
+	}
+
 	// Initialize the texture.
 	virtual bool Initialize(Graphics *pGraphics, const char* pFile);
 
@@ -42,8 +98,40 @@ public:
 	virtual void OnLostDevice(void);
 
 	// Restore Resources.
+	// Uploads from the cached pixels when there are any, otherwise reloads the file.
 	virtual void OnResetDevice(void);
 
+	// Build collision masks from the texture, pre-rotated and scaled as the layout asks.
+	// Returns the mask's index. Every texel counts as opaque if the backend couldn't decode the file.
+	int CreateCollisionMask(const MaskLayout& layout);
+
+	// Return true if the texture was decoded here, so its masks follow its alpha.
+	bool HasOpacity(void) const { return !m_Opacity.empty(); }
+
+	// Return a mask made by CreateCollisionMask, or nullptr. Valid until the next CreateCollisionMask.
+	const CollisionMask* GetCollisionMask(int iIndex) const
+	{
+		return (iIndex >= 0 && iIndex < (int)m_Masks.size()) ? &m_Masks[iIndex] : nullptr;
+	}
+
+	// Return bytes of cached pixels held by this texture.
+	size_t GetCacheBytes(void) const { return m_Cache.size() * sizeof(COLOR_ARGB); }
+
+	// Set the byte budget for all texture caches. 0 disables caching.
+	static void SetCacheBudget(size_t iBytes);
+
+	// Return the byte budget for all texture caches.
+	static size_t GetCacheBudget(void) { return s_iCacheBudget; }
+
+	// Return bytes of cached pixels held by all textures.
+	static size_t GetTotalCacheBytes(void) { return s_iCacheBytes; }
+
+	// Return the number of resets restored from the cache.
+	static int64_t GetCacheHits(void) { return s_iCacheHits; }
+
+	// Return the number of resets that reloaded the file.
+	static int64_t GetCacheMisses(void) { return s_iCacheMisses; }
+
 };
 
 #endif
\ No newline at end of file
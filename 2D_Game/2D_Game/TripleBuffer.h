@@ -0,0 +1,70 @@
+#ifndef TRIPLE_BUFFER_H_
+#define TRIPLE_BUFFER_H_
+
+#include <atomic>
+
+// TripleBuffer: Lock-free single producer, single consumer handoff of the latest value.
+// The producer fills GetWriteBuffer() and calls Publish(). The consumer calls Acquire()
+// and reads the result until its next Acquire(). Neither side ever waits, and the
+// consumer never sees a buffer the producer is still writing.
+template <typename T>
+class TripleBuffer
+{
+private:
+
+	static const int INDEX_MASK = 3;
+	static const int FRESH = 4;				// Set on the middle index when it holds an unread publish.
+
+	T					m_Buffers[3];
+	int					m_iWrite;			// Owned by the producer.
+	int					m_iRead;			// Owned by the consumer.
+	std::atomic<int>	m_iMiddle;			// Index exchanged between the two, plus FRESH.
+
+public:
+
+	// Constructor.
+	TripleBuffer()
+		: m_iWrite(0)
+		, m_iRead(1)
+		, m_iMiddle(2)
+	{
+
+	}
+
+	// Producer: buffer to fill for the next publish.
+	T& GetWriteBuffer(void)
+	{
+		return m_Buffers[m_iWrite];
+	}
+
+	// Producer: hand the write buffer to the consumer.
+	void Publish(void)
+	{
+		m_iWrite = m_iMiddle.exchange(m_iWrite | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Consumer: switch to the newest published buffer, if any, and return it.
+	const T& Acquire(void)
+	{
+		if(m_iMiddle.load(std::memory_order_relaxed) & FRESH)
+		{
+			m_iRead = m_iMiddle.exchange(m_iRead, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+
+		return m_Buffers[m_iRead];
+	}
+
+	// Consumer: return true if a publish is waiting to be acquired.
+	bool HasFresh(void) const
+	{
+		return (m_iMiddle.load(std::memory_order_relaxed) & FRESH) != 0;
+	}
+
+	// Access a buffer directly, only while neither side is running.
+	T& GetBuffer(int i)
+	{
+		return m_Buffers[i & INDEX_MASK];
+	}
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "Win32Platform.h"
+
+#ifdef _WIN32
+
+#include "Constants.h"
+
+// Constructor.
+Win32Window::Win32Window()
+	: m_Hwnd(nullptr)
+	, m_bQuit(false)
+	, m_ExitCode(0)
+{
+
+}
+
+// Destructor.
+Win32Window::~Win32Window()
+{
+
+}
+
+// Create the window.
+bool Win32Window::Create(HINSTANCE hInstance, int nCmdShow, WNDPROC wndProc)
+{
+	WNDCLASSEX wcx;
+
+	// Fill in the window class structure with parameters.
+	wcx.cbSize = sizeof(WNDCLASSEX);
+	wcx.style = CS_HREDRAW | CS_VREDRAW;
+	wcx.lpfnWndProc = wndProc;
+	wcx.cbClsExtra = 0;
+	wcx.cbWndExtra = 0;
+	wcx.hInstance = hInstance;
+	wcx.hIcon = nullptr;
+	wcx.hCursor = LoadCursor(nullptr, IDC_ARROW);
+	wcx.hbrBackground = (HBRUSH)GetStockObject(BLACK_BRUSH);	// Black background.
+	wcx.lpszMenuName = nullptr;
+	wcx.lpszClassName = CLASS_NAME;
+	wcx.hIconSm = nullptr;
+
+	// Register window class
+	if(RegisterClassEx(&wcx) == 0)
+	{
+		return false;
+	}
+
+	DWORD style;
+	if(FULLSCREEN)
+	{
+		style = WS_EX_TOPMOST | WS_VISIBLE | WS_POPUP;
+	}
+	else
+	{
+		style = WS_OVERLAPPEDWINDOW;
+	}
+
+	// Create window.
+	m_Hwnd = CreateWindow(CLASS_NAME, GAME_TITLE, style, CW_USEDEFAULT, CW_USEDEFAULT, GAME_WIDTH, GAME_HEIGHT, (HWND)nullptr, (HMENU)nullptr, hInstance, (LPVOID)nullptr);
+
+	// If there was an error message creating window.
+	if(!m_Hwnd)
+	{
+		return false;
+	}
+
+	if(!FULLSCREEN)
+	{
+		RECT clientRect;
+		GetClientRect(m_Hwnd, &clientRect);
+
+		MoveWindow(m_Hwnd, 0, 0, GAME_WIDTH + (GAME_WIDTH - clientRect.right), GAME_HEIGHT + (GAME_HEIGHT - clientRect.bottom), TRUE);
+	}
+
+	ShowWindow(m_Hwnd, nCmdShow);
+
+	return true;
+}
+
+void Win32Window::Destroy(void)
+{
+	if(m_Hwnd)
+	{
+		DestroyWindow(m_Hwnd);
+		m_Hwnd = nullptr;
+	}
+}
+
+// Non-blocking, dispatches everything queued.
+bool Win32Window::ProcessMessages(void)
+{
+	MSG msg;
+	while(!m_bQuit && PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+	{
+		// Look for quit.
+		if(msg.message == WM_QUIT)
+		{
+			m_bQuit = true;
+			m_ExitCode = msg.wParam;
+		}
+
+		// Decode and passed messages to WinProc
+		TranslateMessage(&msg);
+		DispatchMessage(&msg);
+	}
+
+	return !m_bQuit;
+}
+
+void Win32Window::RequestExit(void)
+{
+	PostMessage(m_Hwnd, WM_DESTROY, 0, 0);
+}
+
+#endif
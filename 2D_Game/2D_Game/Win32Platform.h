@@ -0,0 +1,46 @@
+#ifndef WIN32_PLATFORM_H_
+#define WIN32_PLATFORM_H_
+
+#define WIN32_LEAN_AND_MEAN
+
+#include "PlatformLayer.h"
+
+#ifdef _WIN32
+
+// Win32Window: Native window with a PeekMessage pump.
+class Win32Window : public PlatformWindow
+{
+private:
+
+	HWND		m_Hwnd;			// Handle to the window.
+	bool		m_bQuit;		// True once WM_QUIT has been received.
+	WPARAM		m_ExitCode;		// wParam of WM_QUIT.
+
+public:
+
+	// Constructor.
+	Win32Window();
+
+	// Destructor.
+	virtual ~Win32Window();
+
+	// Register the window class and create the window.
+	// Messages are delivered to wndProc.
+	bool Create(HINSTANCE hInstance, int nCmdShow, WNDPROC wndProc);
+
+	// Destroy the window.
+	void Destroy(void);
+
+	// Return the exit code posted with WM_QUIT.
+	WPARAM GetExitCode(void) const { return m_ExitCode; }
+
+	virtual HWND GetHandle(void) const { return m_Hwnd; }
+
+	virtual bool ProcessMessages(void);
+
+	virtual void RequestExit(void);
+};
+
+#endif
+
+#endif
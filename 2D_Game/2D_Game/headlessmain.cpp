@@ -0,0 +1,2461 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <new>
+#include <thread>
+
+#include "Spacewar.h"
+#include "HeadlessPlatform.h"
+#include "SpriteRaster.h"
+
+#ifndef SPACEWAR_ASSET_DIR
+#define SPACEWAR_ASSET_DIR "."
+#endif
+
+// Count every heap allocation, so benchmarks can check the steady state allocates nothing.
+// Every form of new and delete goes through CountedAlloc and CountedFree.
+static std::atomic<long long> g_iAllocations(0);
+
+static void* CountedAlloc(size_t iSize)
+{
+	++g_iAllocations;
+	void* pMemory = malloc(iSize ? iSize : 1);
+	if(nullptr == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return pMemory;
+}
+
+static void CountedFree(void* pMemory)
+{
+	free(pMemory);
+}
+
+void* operator new(size_t iSize)
+{
+	return CountedAlloc(iSize);
+}
+
+void* operator new[](size_t iSize)
+{
+	return CountedAlloc(iSize);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	CountedFree(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	CountedFree(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	CountedFree(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+	CountedFree(pMemory);
+}
+
+namespace
+{
+	const long long NOT_MEASURED = -1;		// Heap allocations of a run that never reached its warm point.
+
+	// Command line options.
+	struct Options
+	{
+		long long	iTicks;			// Simulation ticks to run.
+		float		fTickRate;		// Simulation ticks per second.
+		uint32_t	iSeed;			// Scripted input seed.
+		const char*	pAssets;		// Directory holding textures/.
+		int			iPacerFrames;	// Frames for the pacer benchmark, 0 to skip.
+		int			iVerifyPublishes;	// Snapshots for the triple buffer check, 0 to skip.
+		bool		bThreaded;		// Run simulation and rendering on separate threads.
+		int			iDrones;		// AI drones to simulate.
+		int			iWorkers;		// Job system worker threads, -1 for one per spare core.
+		int			iBenchWorkers;	// Highest worker count for the job benchmark, -1 to skip.
+		int			iTextureResets;	// Device resets for the texture benchmark, 0 to skip.
+		int			iEntityTicks;	// Ticks per population for the entity benchmark, 0 to skip.
+		int			iTransformReps;	// Repetitions for the sprite transform benchmark, 0 to skip.
+		int			iAnimationTicks;	// Ticks per population for the animation benchmark, 0 to skip.
+		int			iTorpedoRate;	// Stress test torpedoes per second.
+		int			iProjectileRate;	// Torpedoes per second for the projectile benchmark, 0 to skip.
+		int			iCollisionTicks;	// Ticks per population for the collision benchmark, 0 to skip.
+		int			iMaskPairs;		// Pairs for the collision mask benchmark, 0 to skip.
+		int			iSweepPairs;	// Pairs for the swept collision check, 0 to skip.
+		int			iGravityReps;	// Repetitions for the gravity benchmark, 0 to skip.
+		int			iParticleTicks;	// Ticks for the particle benchmark, 0 to skip.
+		bool		bMutualGravity;	// Ships, drones and torpedoes pull on each other.
+		int			iAIBudget;		// Microseconds of AI decisions per tick, 0 for no limit.
+		int			iAIQuota;		// Most bots decided per tick, 0 for no limit.
+		int			iAITicks;		// Ticks per population for the AI benchmark, 0 to skip.
+		int			iStateTicks;	// Ticks for the state snapshot benchmark, 0 to skip.
+		int			iNetTicks;		// Ticks for the networked loopback test, 0 to skip.
+		int			iInputEvents;	// Events for the input queue benchmark, 0 to skip.
+		int			iRenderFrames;	// Frames per kernel for the software render benchmark, 0 to skip.
+		bool		bRender;		// Draw sprites into a software back buffer, not just count them.
+		const char*	pRenderDump;	// PNG to write the last frame rendered to, nullptr for none.
+		const char*	pRecordFile;	// Journal to record the run's input into, nullptr for none.
+		const char*	pReplayFile;	// Journal to replay instead of running, nullptr for none.
+		bool		bReplayPaced;	// Replay at the recorded pace, not as fast as possible.
+		float		fNetLatency;	// Loopback test one-way delay, jitter and loss.
+		float		fNetJitter;
+		float		fNetLoss;
+		bool		bReportAI;		// Print the AI line even when quiet.
+		bool		bQuiet;			// Only print the summary line.
+	};
+
+	void PrintUsage(void)
+	{
+		printf("Usage: spacewar_headless [options]\n"
+			"  --ticks N          Simulation ticks to run (default 100000)\n"
+			"  --tick-rate HZ     Simulation tick rate (default %.0f)\n"
+			"  --seed N           Scripted input seed (default 1)\n"
+			"  --assets DIR       Directory containing textures/ (default %s)\n"
+			"  --threaded         Simulate on its own thread at the real tick rate, render from snapshots\n"
+			"  --drones N         AI drones to simulate (default %d)\n"
+			"  --workers N        Job system worker threads, -1 for one per spare core (default %d)\n"
+			"  --torpedo-rate N   Have the ships fire N torpedoes per second between them\n"
+			"  --mutual-gravity   Have ships, drones and torpedoes pull on each other, not just the planet on them\n"
+			"  --ai-budget US     Microseconds of AI decisions per tick, 0 for no limit (default %d)\n"
+			"  --ai-quota N       Most bots decided per tick, 0 for no limit (default %d)\n"
+			"  --bench-jobs N     Run the simulation with 0..N workers, report ticks/s and check results match\n"
+			"  --bench-entities N Run N ticks with 10k to 100k drones and time entity create/destroy churn\n"
+			"  --bench-projectiles N Fire N torpedoes per second and check the steady state allocates nothing\n"
+			"  --bench-collisions N  Time N ticks of the collision broadphase at 1k/10k/50k objects\n"
+			"  --bench-masks N       Time N pixel mask tests of overlapping sprites and check them per pixel\n"
+			"  --bench-sweep N       Check N swept circle tests and compare hits across tick rates\n"
+			"  --bench-gravity N     Time N passes of Barnes-Hut gravity against summing every pair at 1k/10k/50k bodies\n"
+			"  --bench-ai N          Run N ticks at 1k/10k/50k drones with and without the AI budget and time the AI\n"
+			"  --record FILE         Record the run's input and frame times in a journal\n"
+			"  --replay FILE         Replay a journal as fast as possible and check the state ends as recorded\n"
+			"  --replay-paced        Replay at the pace the journal was recorded\n"
+			"  --net-loopback N      Play two peers N ticks over UDP on 127.0.0.1, report rollbacks and check they agree\n"
+			"  --net-latency MS      Loopback test one-way delay (default %.0f)\n"
+			"  --net-jitter MS       Loopback test random extra delay, up to (default %.0f)\n"
+			"  --net-loss PCT        Loopback test datagrams dropped (default %.0f)\n"
+			"  --bench-state N       Run N ticks keeping a state history, time snapshots and check every kept tick restores\n"
+			"  --bench-input N       Post N input events across threads, time key state and check input lands on its tick\n"
+			"  --render              Draw sprites into a software back buffer, so the Render phase includes rasterizing\n"
+			"  --render-dump FILE    Write the last frame rendered in software to FILE as PNG\n"
+			"  --bench-render N      Render the scene N times with each raster kernel, report FPS and check they agree\n"
+			"  --bench-particles N   Time N ticks of about 100k particles with each update kernel and check they agree\n"
+			"  --bench-animation N   Time N ticks of Image::Update against AnimationSystem at 1k/10k/100k ships\n"
+			"  --bench-transforms N  Time N passes of each sprite transform kernel at 1k/10k/100k sprites\n"
+			"  --bench-textures N Time N texture restores from the shadow cache and N from file\n"
+			"  --bench-pacer N    Pace N frames at %.0f FPS on the real clock and report jitter\n"
+			"  --verify-snapshots N  Publish N snapshots across threads and check none are torn\n",
+			TICK_RATE, SPACEWAR_ASSET_DIR, DRONE_COUNT, WORKER_COUNT, AI_BUDGET, AI_QUOTA, NET_TEST_LATENCY, NET_TEST_JITTER,
+			NET_TEST_LOSS, FRAME_RATE);
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		options.iTicks = 100000;
+		options.fTickRate = TICK_RATE;
+		options.iSeed = 1;
+		options.pAssets = SPACEWAR_ASSET_DIR;
+		options.iPacerFrames = 0;
+		options.iVerifyPublishes = 0;
+		options.bThreaded = false;
+		options.iDrones = DRONE_COUNT;
+		options.iWorkers = WORKER_COUNT;
+		options.iBenchWorkers = -1;
+		options.iTextureResets = 0;
+		options.iEntityTicks = 0;
+		options.iTransformReps = 0;
+		options.iAnimationTicks = 0;
+		options.iTorpedoRate = 0;
+		options.iProjectileRate = 0;
+		options.iCollisionTicks = 0;
+		options.iMaskPairs = 0;
+		options.iSweepPairs = 0;
+		options.iGravityReps = 0;
+		options.iParticleTicks = 0;
+		options.bMutualGravity = false;
+		options.iAIBudget = AI_BUDGET;
+		options.iAIQuota = AI_QUOTA;
+		options.iAITicks = 0;
+		options.iStateTicks = 0;
+		options.iNetTicks = 0;
+		options.iInputEvents = 0;
+		options.iRenderFrames = 0;
+		options.bRender = false;
+		options.pRenderDump = nullptr;
+		options.pRecordFile = nullptr;
+		options.pReplayFile = nullptr;
+		options.bReplayPaced = false;
+		options.fNetLatency = NET_TEST_LATENCY;
+		options.fNetJitter = NET_TEST_JITTER;
+		options.fNetLoss = NET_TEST_LOSS;
+		options.bReportAI = false;
+		options.bQuiet = false;
+
+		for(int i = 1; i < argc; ++i)
+		{
+			bool bHasValue = i + 1 < argc;
+			if(0 == strcmp(argv[i], "--ticks") && bHasValue)
+			{
+				options.iTicks = atoll(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--tick-rate") && bHasValue)
+			{
+				options.fTickRate = (float)atof(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--seed") && bHasValue)
+			{
+				options.iSeed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+			}
+			else if(0 == strcmp(argv[i], "--assets") && bHasValue)
+			{
+				options.pAssets = argv[++i];
+			}
+			else if(0 == strcmp(argv[i], "--bench-pacer") && bHasValue)
+			{
+				options.iPacerFrames = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--verify-snapshots") && bHasValue)
+			{
+				options.iVerifyPublishes = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--drones") && bHasValue)
+			{
+				options.iDrones = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--workers") && bHasValue)
+			{
+				options.iWorkers = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-jobs") && bHasValue)
+			{
+				options.iBenchWorkers = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-entities") && bHasValue)
+			{
+				options.iEntityTicks = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--torpedo-rate") && bHasValue)
+			{
+				options.iTorpedoRate = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-projectiles") && bHasValue)
+			{
+				options.iProjectileRate = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-collisions") && bHasValue)
+			{
+				options.iCollisionTicks = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-masks") && bHasValue)
+			{
+				options.iMaskPairs = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-sweep") && bHasValue)
+			{
+				options.iSweepPairs = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-gravity") && bHasValue)
+			{
+				options.iGravityReps = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-particles") && bHasValue)
+			{
+				options.iParticleTicks = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-animation") && bHasValue)
+			{
+				options.iAnimationTicks = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-transforms") && bHasValue)
+			{
+				options.iTransformReps = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-textures") && bHasValue)
+			{
+				options.iTextureResets = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--threaded"))
+			{
+				options.bThreaded = true;
+			}
+			else if(0 == strcmp(argv[i], "--mutual-gravity"))
+			{
+				options.bMutualGravity = true;
+			}
+			else if(0 == strcmp(argv[i], "--ai-budget") && bHasValue)
+			{
+				options.iAIBudget = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--ai-quota") && bHasValue)
+			{
+				options.iAIQuota = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-ai") && bHasValue)
+			{
+				options.iAITicks = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--record") && bHasValue)
+			{
+				options.pRecordFile = argv[++i];
+			}
+			else if(0 == strcmp(argv[i], "--replay") && bHasValue)
+			{
+				options.pReplayFile = argv[++i];
+			}
+			else if(0 == strcmp(argv[i], "--replay-paced"))
+			{
+				options.bReplayPaced = true;
+			}
+			else if(0 == strcmp(argv[i], "--net-loopback") && bHasValue)
+			{
+				options.iNetTicks = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--net-latency") && bHasValue)
+			{
+				options.fNetLatency = (float)atof(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--net-jitter") && bHasValue)
+			{
+				options.fNetJitter = (float)atof(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--net-loss") && bHasValue)
+			{
+				options.fNetLoss = (float)atof(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-state") && bHasValue)
+			{
+				options.iStateTicks = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--bench-input") && bHasValue)
+			{
+				options.iInputEvents = atoi(argv[++i]);
+			}
+			else if(0 == strcmp(argv[i], "--render"))
+			{
+				options.bRender = true;
+			}
+			else if(0 == strcmp(argv[i], "--render-dump") && bHasValue)
+			{
+				options.pRenderDump = argv[++i];
+				options.bRender = true;
+			}
+			else if(0 == strcmp(argv[i], "--bench-render") && bHasValue)
+			{
+				options.iRenderFrames = atoi(argv[++i]);
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Hold frames to FRAME_RATE on the real clock and report how closely it was met.
+	void BenchPacer(int iFrames)
+	{
+		HighResClock clock;
+		if(!clock.Initialize())
+		{
+			printf("pacer: no high resolution clock\n");
+			return;
+		}
+
+		FramePacer pacer;
+		pacer.Initialize(&clock, FRAME_RATE);
+
+		int64_t iStart = pacer.Wait();
+		pacer.ResetStats();
+		for(int i = 0; i < iFrames; ++i)
+		{
+			pacer.Wait();
+		}
+		double dElapsed = clock.ToSeconds(clock.GetTicks() - iStart);
+
+		printf("pacer: %d frames in %.3f s (%.2f FPS, target %.0f)\n", iFrames, dElapsed, iFrames / dElapsed, FRAME_RATE);
+		printf("pacer: lateness mean %.1f us, stddev %.1f us, max %.1f us, missed %lld, spin tail %.1f us\n",
+			pacer.GetMeanJitter() * 1e6, pacer.GetJitterStdDev() * 1e6, pacer.GetMaxJitter() * 1e6,
+			(long long)pacer.GetMissedFrames(), pacer.GetSpinTime() * 1e6);
+	}
+
+	// Hammer the snapshot triple buffer from two threads.
+	// Every field of every sprite in a snapshot is written with the snapshot's tick,
+	// so any mix of two publishes shows up as a mismatch. Returns the number of torn reads.
+	int VerifySnapshots(int iPublishes)
+	{
+		TripleBuffer<RenderSnapshot>* pBuffer = new TripleBuffer<RenderSnapshot>;
+		std::atomic<bool> bDone(false);
+
+		std::thread producer([&]()
+		{
+			for(int iTick = 1; iTick <= iPublishes; ++iTick)
+			{
+				RenderSnapshot& snapshot = pBuffer->GetWriteBuffer();
+				snapshot.Begin(iTick, iTick);
+				int iCount = 1 + iTick % 64;
+				for(int i = 0; i < iCount; ++i)
+				{
+					SpriteSnapshot& sprite = snapshot.AddSprite();
+					float fValue = (float)iTick;
+					sprite.fX = sprite.fY = sprite.fScale = sprite.fAngle = fValue;
+					sprite.fPrevX = sprite.fPrevY = sprite.fPrevScale = sprite.fPrevAngle = fValue;
+					sprite.iWidth = sprite.iHeight = sprite.iTextureId = iTick;
+					sprite.rect.left = sprite.rect.top = sprite.rect.right = sprite.rect.bottom = iTick;
+					sprite.color = (COLOR_ARGB)iTick;
+				}
+				pBuffer->Publish();
+			}
+			bDone = true;
+		});
+
+		long long iReads = 0, iTorn = 0, iBackwards = 0;
+		int64_t iLastTick = 0;
+		while(!bDone || pBuffer->HasFresh())
+		{
+			const RenderSnapshot& snapshot = pBuffer->Acquire();
+			int64_t iTick = snapshot.GetTick();
+			++iReads;
+			if(iTick < iLastTick)
+			{
+				++iBackwards;
+			}
+			iLastTick = iTick;
+			if(0 == iTick)
+			{
+				continue;
+			}
+
+			bool bTorn = snapshot.GetPublishTime() != iTick || snapshot.GetSpriteCount() != 1 + iTick % 64;
+			for(int i = 0; i < snapshot.GetSpriteCount() && !bTorn; ++i)
+			{
+				const SpriteSnapshot& sprite = snapshot.GetSprite(i);
+				float fValue = (float)iTick;
+				bTorn = sprite.fX != fValue || sprite.fY != fValue || sprite.fScale != fValue || sprite.fAngle != fValue
+					|| sprite.fPrevX != fValue || sprite.fPrevAngle != fValue || sprite.iTextureId != iTick
+					|| sprite.rect.left != iTick || sprite.rect.bottom != iTick || sprite.color != (COLOR_ARGB)iTick;
+			}
+			if(bTorn)
+			{
+				++iTorn;
+			}
+		}
+		producer.join();
+
+		printf("snapshots: %d published, %lld reads, last tick %lld, %lld torn, %lld out of order\n",
+			iPublishes, iReads, (long long)iLastTick, iTorn, iBackwards);
+		delete pBuffer;
+		return (int)(iTorn + iBackwards);
+	}
+
+	// Run the Spacewar simulation uncapped for the requested number of ticks.
+	// Returns the ticks per second and state checksum through pRate and pChecksum when given.
+	// pAllocations receives the heap allocations made during the second half of the run, or
+	// NOT_MEASURED if the run stopped before it got there.
+	int RunSimulation(const Options& options, double* pRate = nullptr, uint64_t* pChecksum = nullptr, long long* pAllocations = nullptr)
+	{
+		HeadlessWindow window;
+		ManualClock clock;
+		ScriptedInputSource input(options.iSeed);
+		HighResClock wallClock;
+		wallClock.Initialize();
+		InputJournal journal;
+
+		Graphics::SetAssetPath(options.pAssets);
+
+		Spacewar* pGame = new Spacewar();
+		try
+		{
+			// Threaded mode runs against the real clock, the simulation thread paces itself.
+			if(!options.bThreaded)
+			{
+				pGame->SetClock(&clock);
+			}
+			if(options.pRecordFile && !options.bThreaded)
+			{
+				pGame->SetInputJournal(&journal);
+			}
+			pGame->SetInputSource(&input);
+			pGame->SetTickRate(options.fTickRate);
+			pGame->SetWorkerCount(options.iWorkers);
+			pGame->SetDroneCount(options.iDrones);
+			pGame->SetTorpedoRate(options.iTorpedoRate);
+			pGame->SetMutualGravity(options.bMutualGravity);
+			pGame->SetAIBudget(options.iAIBudget, options.iAIQuota);
+			pGame->Initialize(&window);
+			pGame->GetGraphics()->SetSoftwareRender(options.bRender);
+
+			// No frame cap, each frame advances the clock by exactly one tick.
+			pGame->GetFramePacer()->SetFrameRate(0.0f);
+			const int64_t iTickLength = clock.FromSeconds(pGame->GetTickTime()) + 1;
+
+			int64_t iStart = wallClock.GetTicks();
+			long long iFrames = 0;
+			long long iHalfwayAllocations = -1;
+			pGame->SetThreaded(options.bThreaded);
+			while(pGame->GetTickCount() < options.iTicks && window.ProcessMessages())
+			{
+				if(iHalfwayAllocations < 0 && pGame->GetTickCount() >= options.iTicks / 2)
+				{
+					iHalfwayAllocations = g_iAllocations;
+				}
+
+				clock.Advance(iTickLength);
+				pGame->Run();
+				++iFrames;
+
+				// Leave the simulation thread some CPU on small machines.
+				if(options.bThreaded)
+				{
+					std::this_thread::yield();
+				}
+			}
+			long long iAllocations = (iHalfwayAllocations < 0) ? NOT_MEASURED : g_iAllocations - iHalfwayAllocations;
+			pGame->SetThreaded(false);
+			double dElapsed = wallClock.ToSeconds(wallClock.GetTicks() - iStart);
+
+			long long iTicks = (long long)pGame->GetTickCount();
+			double dRate = dElapsed > 0.0 ? iTicks / dElapsed : 0.0;
+			uint64_t iChecksum = pGame->GetStateChecksum();
+			if(pRate)
+			{
+				*pRate = dRate;
+			}
+			if(pChecksum)
+			{
+				*pChecksum = iChecksum;
+			}
+			if(pAllocations)
+			{
+				*pAllocations = iAllocations;
+			}
+
+			printf("sim: %lld ticks, %lld frames in %.3f s, %.0f ticks/s, %d drones, %d workers, state %016llx%s\n",
+				iTicks, iFrames, dElapsed, dRate, pGame->GetDroneCount(), pGame->GetJobSystem()->GetWorkerCount(),
+				(unsigned long long)iChecksum, options.bThreaded ? " (threaded)" : "");
+
+			if(options.pRecordFile && options.bThreaded)
+			{
+				printf("journal: threaded runs read input at times of their own and can't be replayed, nothing recorded\n");
+			}
+			else if(options.pRecordFile)
+			{
+				journal.End(iTicks, iChecksum);
+				bool bSaved = journal.Save(options.pRecordFile);
+				printf("journal: %lld frames, %lld input events, %zu bytes (%.1f per frame) %s %s\n",
+					(long long)journal.GetFrameCount(), (long long)journal.GetEventCount(), journal.GetSize(),
+					journal.GetFrameCount() > 0 ? (double)journal.GetSize() / journal.GetFrameCount() : 0.0,
+					bSaved ? "written to" : "COULD NOT BE WRITTEN TO", options.pRecordFile);
+				if(!bSaved)
+				{
+					delete pGame;
+					return 1;
+				}
+			}
+
+			if(options.pRenderDump)
+			{
+				bool bSaved = SUCCEEDED(pGame->GetGraphics()->SaveBackBuffer(options.pRenderDump));
+				printf("render: last frame %s %s\n", bSaved ? "written to" : "COULD NOT BE WRITTEN TO", options.pRenderDump);
+				if(!bSaved)
+				{
+					delete pGame;
+					return 1;
+				}
+			}
+
+			if(pGame->GetPairsTested() > 0 && !options.bQuiet)
+			{
+				printf("sim: collisions %lld pairs with overlapping boxes, %lld with overlapping pixels\n",
+					(long long)pGame->GetPairsTested(), (long long)pGame->GetPairsTouching());
+			}
+
+			const ProjectilePool* pTorpedoes = pGame->GetTorpedoes();
+			if(pTorpedoes->GetSpawnedTotal() > 0 && !options.bQuiet)
+			{
+				printf("sim: torpedoes %d in flight, %lld fired, %lld dropped, %lld hit drones, %lld hit ships\n", pTorpedoes->GetCount(),
+					(long long)pTorpedoes->GetSpawnedTotal(), (long long)pTorpedoes->GetDroppedTotal(),
+					(long long)pGame->GetDroneTorpedoHits(), (long long)pGame->GetShipTorpedoHits());
+			}
+
+			const ParticleSystem* pParticles = pGame->GetParticles();
+			if(pParticles->GetEmittedTotal() > 0 && !options.bQuiet)
+			{
+				printf("sim: particles %d alive, %lld emitted, %lld dropped\n", pParticles->GetCount(),
+					(long long)pParticles->GetEmittedTotal(), (long long)pParticles->GetDroppedTotal());
+			}
+
+			const AIScheduler* pAI = pGame->GetAI();
+			if(!options.bQuiet || options.bReportAI)
+			{
+				FrameStats* pAIStats = pGame->GetFrameStats();
+				printf("sim: ai %d bots, %.1f decided per tick, every bot within %d ticks (worst %d), %lld overruns (worst %.1f us), "
+					"AI p50 %.4f ms p99 %.4f ms\n", pGame->GetDroneCount() + 1,
+					pAI->GetSliceCount() > 0 ? (double)pAI->GetDecidedCount() / pAI->GetSliceCount() : 0.0,
+					pAI->GetLastPassSlices(), pAI->GetWorstPassSlices(), (long long)pAI->GetOverrunCount(),
+					pAI->GetWorstOverrun() * 1e6, pAIStats->GetPercentile(FrameStatsNS::AI, 50.0),
+					pAIStats->GetPercentile(FrameStatsNS::AI, 99.0));
+			}
+
+			FrameArena* pArena = pGame->GetFrameArena();
+			if(!options.bQuiet && NOT_MEASURED == iAllocations)
+			{
+				printf("sim: heap allocations not measured, the run stopped before tick %lld, frame arena high water %llu of %llu bytes, "
+					"%lld overflows\n", options.iTicks / 2, (unsigned long long)pArena->GetHighWater(),
+					(unsigned long long)pArena->GetCapacity(), (long long)pArena->GetOverflowCount());
+			}
+			else if(!options.bQuiet)
+			{
+				printf("sim: %lld heap allocations in the last %lld ticks, frame arena high water %llu of %llu bytes, %lld overflows\n",
+					iAllocations, iTicks - options.iTicks / 2, (unsigned long long)pArena->GetHighWater(),
+					(unsigned long long)pArena->GetCapacity(), (long long)pArena->GetOverflowCount());
+			}
+
+			FrameStats* pStats = pGame->GetFrameStats();
+			for(int i = 0; i < FrameStatsNS::PHASE_COUNT && !options.bQuiet; ++i)
+			{
+				FrameStatsNS::PHASE phase = (FrameStatsNS::PHASE)i;
+				printf("sim: %-10s p50 %.4f ms  p99 %.4f ms  max %.4f ms\n", FrameStatsNS::PHASE_NAMES[i],
+					pStats->GetPercentile(phase, 50.0), pStats->GetPercentile(phase, 99.0), pStats->GetMax(phase));
+			}
+		}
+		catch(const GameError& err)
+		{
+			printf("error: %s\n", err.GetMessage());
+			delete pGame;
+			return 1;
+		}
+
+		delete pGame;
+		return 0;
+	}
+
+	// Release and restore every texture iResets times, first from the shadow cache, then with
+	// the cache disabled so each restore reads and decodes the file again.
+	int BenchTextures(const Options& options, int iResets)
+	{
+		HeadlessWindow window;
+		ManualClock clock;
+		HighResClock wallClock;
+		wallClock.Initialize();
+
+		Graphics::SetAssetPath(options.pAssets);
+
+		Spacewar* pGame = new Spacewar();
+		try
+		{
+			pGame->SetClock(&clock);
+			pGame->SetWorkerCount(0);
+
+			int64_t iStart = wallClock.GetTicks();
+			pGame->Initialize(&window);
+			double dLoad = wallClock.ToSeconds(wallClock.GetTicks() - iStart);
+			printf("textures: initial load %.3f ms, %zu bytes cached of %zu budget\n",
+				dLoad * 1e3, TextureManager::GetTotalCacheBytes(), TextureManager::GetCacheBudget());
+
+			const char* pModes[2] = { "cache", "file" };
+			size_t iBudget = TextureManager::GetCacheBudget();
+			for(int iMode = 0; iMode < 2; ++iMode)
+			{
+				if(1 == iMode)
+				{
+					TextureManager::SetCacheBudget(0);
+				}
+
+				int64_t iHits = TextureManager::GetCacheHits();
+				int64_t iMisses = TextureManager::GetCacheMisses();
+				iStart = wallClock.GetTicks();
+				for(int i = 0; i < iResets; ++i)
+				{
+					pGame->ReleaseAll();
+					pGame->ResetAll();
+				}
+				double dElapsed = wallClock.ToSeconds(wallClock.GetTicks() - iStart);
+
+				printf("textures: %-5s %d resets, %.3f ms per reset, %lld restored from cache, %lld from file\n",
+					pModes[iMode], iResets, iResets > 0 ? dElapsed * 1e3 / iResets : 0.0,
+					(long long)(TextureManager::GetCacheHits() - iHits), (long long)(TextureManager::GetCacheMisses() - iMisses));
+			}
+			TextureManager::SetCacheBudget(iBudget);
+		}
+		catch(const GameError& err)
+		{
+			printf("error: %s\n", err.GetMessage());
+			delete pGame;
+			return 1;
+		}
+
+		delete pGame;
+		return 0;
+	}
+
+	// Time the per-sprite reference against each batch kernel and check they agree.
+	// Returns 1 if any kernel is further than the tolerance from the reference.
+	int BenchTransforms(int iReps)
+	{
+		const int SIZES[3] = { 1000, 10000, 100000 };
+		const float TOLERANCE = 1e-5f;			// Largest error allowed, relative to the element's magnitude.
+
+		HighResClock clock;
+		clock.Initialize();
+		printf("transforms: best kernel %s\n", SpriteTransformNS::KERNEL_NAMES[SpriteTransform::GetBestKernel()]);
+
+		int iFailures = 0;
+		for(int iSize = 0; iSize < 3; ++iSize)
+		{
+			int iCount = SIZES[iSize];
+			std::vector<SpriteData> sprites(iCount);
+			std::vector<float> fX(iCount), fY(iCount), fScale(iCount), fAngle(iCount);
+			std::vector<int> iWidth(iCount), iHeight(iCount), iFlags(iCount);
+			std::vector<float> fReference(iCount * SpriteTransformNS::ELEMENT_COUNT);
+			std::vector<float> fOut[SpriteTransformNS::ELEMENT_COUNT];
+			float* pOut[SpriteTransformNS::ELEMENT_COUNT];
+			for(int i = 0; i < SpriteTransformNS::ELEMENT_COUNT; ++i)
+			{
+				fOut[i].resize(iCount);
+				pOut[i] = fOut[i].data();
+			}
+
+			uint32_t iState = 7;
+			for(int i = 0; i < iCount; ++i)
+			{
+				float fRandom[7];
+				for(int j = 0; j < 7; ++j)
+				{
+					iState ^= iState << 13;
+					iState ^= iState >> 17;
+					iState ^= iState << 5;
+					fRandom[j] = (iState & 0xFFFFFF) / (float)0x1000000;
+				}
+
+				SpriteData& sd = sprites[i];
+				sd.fX = fX[i] = fRandom[0] * GAME_WIDTH;
+				sd.fY = fY[i] = fRandom[1] * GAME_HEIGHT;
+				sd.fScale = fScale[i] = 0.25f + fRandom[2] * 2.0f;
+				sd.fAngle = fAngle[i] = (fRandom[3] - 0.5f) * 200.0f;
+				sd.iWidth = iWidth[i] = 8 + (int)(fRandom[4] * 120.0f);
+				sd.iHeight = iHeight[i] = 8 + (int)(fRandom[5] * 120.0f);
+				iFlags[i] = (int)(fRandom[6] * 4.0f);
+				sd.bFlipHorizontal = (iFlags[i] & SpriteTransformNS::FLIP_HORIZONTAL) != 0;
+				sd.bFlipVertical = (iFlags[i] & SpriteTransformNS::FLIP_VERTICAL) != 0;
+			}
+			SpriteTransformInput input = { fX.data(), fY.data(), fScale.data(), fAngle.data(), iWidth.data(), iHeight.data(), iFlags.data() };
+
+			int64_t iStart = clock.GetTicks();
+			for(int iRep = 0; iRep < iReps; ++iRep)
+			{
+				for(int i = 0; i < iCount; ++i)
+				{
+					SpriteTransform::Compute(sprites[i], &fReference[i * SpriteTransformNS::ELEMENT_COUNT]);
+				}
+			}
+			double dReference = clock.ToSeconds(clock.GetTicks() - iStart) / ((double)iReps * iCount);
+			printf("transforms: %6d sprites  %-9s %7.2f ns/sprite\n", iCount, "reference", dReference * 1e9);
+
+			for(int iKernel = SpriteTransformNS::SCALAR; iKernel <= SpriteTransformNS::AVX2; ++iKernel)
+			{
+				SpriteTransformNS::KERNEL kernel = (SpriteTransformNS::KERNEL)iKernel;
+				if(kernel > SpriteTransform::GetBestKernel())
+				{
+					continue;
+				}
+
+				iStart = clock.GetTicks();
+				for(int iRep = 0; iRep < iReps; ++iRep)
+				{
+					SpriteTransform::ComputeBatch(input, iCount, pOut, kernel);
+				}
+				double dKernel = clock.ToSeconds(clock.GetTicks() - iStart) / ((double)iReps * iCount);
+
+				// Errors are relative to the largest term feeding each element, so cancellation in the
+				// translation is not mistaken for a kernel fault.
+				float fWorst = 0.0f;
+				for(int i = 0; i < iCount; ++i)
+				{
+					float fLinear = fScale[i] > 1.0f ? fScale[i] : 1.0f;
+					float fTranslation = fabsf(fX[i]) + fabsf(fY[i]) + (iWidth[i] + iHeight[i]) * fScale[i] + 1.0f;
+					for(int j = 0; j < SpriteTransformNS::ELEMENT_COUNT; ++j)
+					{
+						float fExpected = fReference[i * SpriteTransformNS::ELEMENT_COUNT + j];
+						float fMagnitude = (j >= SpriteTransformNS::DX) ? fTranslation : fLinear;
+						float fError = fabsf(fOut[j][i] - fExpected) / fMagnitude;
+						fWorst = fError > fWorst ? fError : fWorst;
+					}
+				}
+
+				bool bPass = fWorst <= TOLERANCE;
+				iFailures += bPass ? 0 : 1;
+				printf("transforms: %6d sprites  %-9s %7.2f ns/sprite  %5.1fx  max error %.2e %s\n", iCount,
+					SpriteTransformNS::KERNEL_NAMES[kernel], dKernel * 1e9, dKernel > 0.0 ? dReference / dKernel : 0.0,
+					fWorst, bPass ? "ok" : "FAIL");
+			}
+		}
+
+		return iFailures ? 1 : 0;
+	}
+
+	// Fire iRate torpedoes per second for 20 simulated seconds, long enough for the pool to
+	// settle. Returns 1 if the second half of the run touched the heap.
+	int BenchProjectiles(const Options& options, int iRate)
+	{
+		Options run = options;
+		run.bThreaded = false;
+		run.iTorpedoRate = iRate;
+		run.iTicks = (long long)(20.0f * options.fTickRate);
+
+		double dRate = 0.0;
+		long long iAllocations = 0;
+		if(RunSimulation(run, &dRate, nullptr, &iAllocations) != 0)
+		{
+			return 1;
+		}
+
+		if(NOT_MEASURED == iAllocations)
+		{
+			printf("projectiles: %d shots/s, %.0f ticks/s, heap allocations not measured, the run stopped early FAIL\n", iRate, dRate);
+			return 1;
+		}
+		printf("projectiles: %d shots/s, %.0f ticks/s, %lld heap allocations in steady state %s\n",
+			iRate, dRate, iAllocations, 0 == iAllocations ? "ok" : "FAIL");
+		return 0 == iAllocations ? 0 : 1;
+	}
+
+	// Order pairs for comparison.
+	bool PairLess(const CollisionPair& a, const CollisionPair& b)
+	{
+		return a.iFirst != b.iFirst ? a.iFirst < b.iFirst : a.iSecond < b.iSecond;
+	}
+
+	// Move a crowd of ships, drones and torpedoes around a wrapping world and time the broadphase.
+	// The world grows with the crowd so it stays as busy as 1k objects on one screen.
+	// At 1k and 10k objects the last tick is checked against testing every pair.
+	// Returns 1 if a pair is missed, invented or reported twice.
+	int BenchCollisions(int iTicks)
+	{
+		using namespace SpacewarNS;
+		const int SIZES[3] = { 1000, 10000, 50000 };
+		const int CHECKED_SIZES = 2;
+
+		HighResClock clock;
+		clock.Initialize();
+
+		int iFailures = 0;
+		for(int iSize = 0; iSize < 3; ++iSize)
+		{
+			int iCount = SIZES[iSize];
+			float fGrow = sqrtf(iCount / (float)SIZES[0]);
+			float fWorldWidth = floorf(GAME_WIDTH * fGrow / COLLISION_CELL_SIZE) * COLLISION_CELL_SIZE;
+			float fWorldHeight = floorf(GAME_HEIGHT * fGrow / COLLISION_CELL_SIZE) * COLLISION_CELL_SIZE;
+			std::vector<float> x(iCount), y(iCount), vx(iCount), vy(iCount), angle(iCount), spin(iCount), scale(iCount);
+			std::vector<int> width(iCount), height(iCount);
+			std::vector<uint32_t> category(iCount), mask(iCount);
+
+			// Two ships, then one torpedo for every seven drones.
+			uint32_t iState = 7;
+			for(int i = 0; i < iCount; ++i)
+			{
+				float fRandom[4];
+				for(int j = 0; j < 4; ++j)
+				{
+					iState ^= iState << 13;
+					iState ^= iState >> 17;
+					iState ^= iState << 5;
+					fRandom[j] = (iState & 0xFFFFFF) / 16777216.0f;
+				}
+
+				bool bTorpedo = i >= 2 && 0 == (i & 7);
+				float fSpeed = (i < 2) ? SHIP_SPEED : (bTorpedo ? TORPEDO_SPEED : DRONE_SPEED);
+				x[i] = fRandom[0] * fWorldWidth;
+				y[i] = fRandom[1] * fWorldHeight;
+				angle[i] = fRandom[2] * (float)PI * 2.0f;
+				vx[i] = sinf(angle[i]) * fSpeed;
+				vy[i] = -cosf(angle[i]) * fSpeed;
+				spin[i] = bTorpedo ? 0.0f : (fRandom[3] - .5f) * ROTATION_RATE * (float)PI / 180.0f;
+				scale[i] = (i < 2) ? SHIP_SCALE : (bTorpedo ? 1.0f : .75f + fRandom[3] * .75f);
+				width[i] = bTorpedo ? TORPEDO_WIDTH : SHIP_WIDTH;
+				height[i] = bTorpedo ? TORPEDO_HEIGHT : SHIP_HEIGHT;
+				category[i] = (i < 2) ? COLLIDE_SHIP : (bTorpedo ? COLLIDE_TORPEDO : COLLIDE_DRONE);
+				mask[i] = (i < 2) ? (COLLIDE_DRONE | COLLIDE_TORPEDO)
+					: (bTorpedo ? (COLLIDE_SHIP | COLLIDE_DRONE) : (COLLIDE_SHIP | COLLIDE_TORPEDO));
+			}
+
+			SpatialHash hash;
+			hash.Initialize(fWorldWidth, fWorldHeight, COLLISION_CELL_SIZE);
+			hash.SetObjectCount(iCount);
+
+			double dElapsed = 0.0;
+			long long iPairs = 0;
+			long long iMoved = 0;
+			for(int iTick = 0; iTick < iTicks; ++iTick)
+			{
+				for(int i = 0; i < iCount; ++i)
+				{
+					x[i] = fmodf(x[i] + vx[i] * TICK_TIME + fWorldWidth, fWorldWidth);
+					y[i] = fmodf(y[i] + vy[i] * TICK_TIME + fWorldHeight, fWorldHeight);
+					angle[i] += spin[i] * TICK_TIME;
+				}
+
+				int64_t iStart = clock.GetTicks();
+				float fCenterX, fCenterY, fExtentX, fExtentY;
+				for(int i = 0; i < iCount; ++i)
+				{
+					SpatialHash::GetBounds(x[i], y[i], width[i], height[i], scale[i], angle[i], fCenterX, fCenterY, fExtentX, fExtentY);
+					hash.SetBounds(i, fCenterX, fCenterY, fExtentX, fExtentY, category[i], mask[i]);
+				}
+				hash.FindPairs();
+				dElapsed += clock.ToSeconds(clock.GetTicks() - iStart);
+
+				// The first tick fills the grid, it isn't an incremental update.
+				if(iTick > 0)
+				{
+					iMoved += hash.GetMovedCount();
+				}
+				iPairs += (long long)hash.GetPairs().size();
+			}
+
+			const char* pCheck = "not checked";
+			if(iSize < CHECKED_SIZES)
+			{
+				std::vector<CollisionPair> expected;
+				for(int i = 0; i < iCount; ++i)
+				{
+					for(int j = i + 1; j < iCount; ++j)
+					{
+						if(0 != ((category[i] & mask[j]) | (category[j] & mask[i])) && hash.Overlaps(i, j))
+						{
+							CollisionPair pair = { (uint32_t)i, (uint32_t)j };
+							expected.push_back(pair);
+						}
+					}
+				}
+
+				std::vector<CollisionPair> found = hash.GetPairs();
+				std::sort(found.begin(), found.end(), PairLess);
+				bool bMatch = found.size() == expected.size();
+				for(size_t i = 0; bMatch && i < found.size(); ++i)
+				{
+					bMatch = found[i].iFirst == expected[i].iFirst && found[i].iSecond == expected[i].iSecond;
+				}
+				pCheck = bMatch ? "matches brute force" : "MISMATCH";
+				iFailures += bMatch ? 0 : 1;
+			}
+
+			double dTick = dElapsed / iTicks;
+			printf("collisions: %5d objects in %4.0fx%-4.0f  %7.3f ms/tick  %7.1f pairs/tick  %6.2f M pairs/s  %5.1f%% moved cells  %s\n",
+				iCount, fWorldWidth, fWorldHeight, dTick * 1e3, (double)iPairs / iTicks, dElapsed > 0.0 ? iPairs / dElapsed * 1e-6 : 0.0,
+				iTicks > 1 ? 100.0 * iMoved / ((double)(iTicks - 1) * iCount) : 0.0, pCheck);
+		}
+
+		return iFailures ? 1 : 0;
+	}
+
+	// Return the solid pixels of a mask frame.
+	int CountSolid(const MaskFrame& frame)
+	{
+		int iSolid = 0;
+		for(int y = 0; y < frame.iHeight; ++y)
+		{
+			for(int x = 0; x < frame.iWidth; ++x)
+			{
+				iSolid += (int)((frame.pRows[y * frame.iStride + (x >> 6)] >> (x & 63)) & 1);
+			}
+		}
+		return iSolid;
+	}
+
+	// Test sprites against each other with collision masks, placed so their boxes overlap.
+	// Ships at any angle, frame and scale meet ships, torpedoes and the planet.
+	// Returns 1 if Overlap and OverlapReference ever disagree, or if the planet and ship masks are solid boxes.
+	int BenchMasks(const Options& options, int iPairs)
+	{
+		HeadlessWindow window;
+		Graphics graphics;
+		graphics.Initialize(window.GetHandle(), GAME_WIDTH, GAME_HEIGHT, false);
+		Graphics::SetAssetPath(options.pAssets);
+
+		TextureManager shipTexture, planetTexture, torpedoTexture;
+		if(!shipTexture.Initialize(&graphics, SHIP_IMAGE) || !planetTexture.Initialize(&graphics, PLANET_IMAGE)
+			|| !torpedoTexture.Initialize(&graphics, TORPEDO_IMAGE))
+		{
+			printf("masks: failed to load textures from %s\n", options.pAssets);
+			return 1;
+		}
+
+		HighResClock clock;
+		clock.Initialize();
+		MaskLayout shipLayout = { SHIP_WIDTH, SHIP_HEIGHT, SHIP_COLS, SHIP_END_FRAME + 1, MASK_ROTATIONS, MASK_MIN_SCALE, MASK_MAX_SCALE, MASK_SCALES };
+		MaskLayout plainLayout = { 0, 0, 0, 0, 0, 1.0f, 1.0f, 0 };
+		int64_t iStart = clock.GetTicks();
+		const CollisionMask* pShip = shipTexture.GetCollisionMask(shipTexture.CreateCollisionMask(shipLayout));
+		const CollisionMask* pPlanet = planetTexture.GetCollisionMask(planetTexture.CreateCollisionMask(plainLayout));
+		const CollisionMask* pTorpedo = torpedoTexture.GetCollisionMask(torpedoTexture.CreateCollisionMask(plainLayout));
+		double dBuild = clock.ToSeconds(clock.GetTicks() - iStart);
+		printf("masks: built %d ship variants, %zu KB, in %.2f ms\n", pShip->GetVariantCount(), pShip->GetBytes() / 1024, dBuild * 1e3);
+
+		// The color key must have cut the backgrounds out: the planet is round and the ship not a box.
+		int iFailures = 0;
+		if(shipTexture.HasOpacity() && planetTexture.HasOpacity())
+		{
+			const MaskFrame& planet = pPlanet->Get(0, 0.0f, 1.0f);
+			const MaskFrame& ship = pShip->Get(0, 0.0f, 1.0f);
+			int iCorners = 0;
+			for(int i = 0; i < 4; ++i)
+			{
+				int x = (i & 1) ? planet.iWidth - 1 : 0, y = (i & 2) ? planet.iHeight - 1 : 0;
+				iCorners += (int)((planet.pRows[y * planet.iStride + (x >> 6)] >> (x & 63)) & 1);
+			}
+			int iShipSolid = CountSolid(ship);
+			bool bKeyed = 0 == iCorners && iShipSolid < ship.iWidth * ship.iHeight;
+			printf("masks: planet %d of %d pixels solid, %d solid corners, ship %d of %d solid %s\n", CountSolid(planet),
+				planet.iWidth * planet.iHeight, iCorners, iShipSolid, ship.iWidth * ship.iHeight, bKeyed ? "ok" : "NOT COLOR KEYED");
+			iFailures += bKeyed ? 0 : 1;
+		}
+		else
+		{
+			printf("masks: textures not decoded, every pixel is solid\n");
+		}
+
+		// Pair up variants at random, B placed anywhere its box overlaps A's.
+		std::vector<const MaskFrame*> first(iPairs), second(iPairs);
+		std::vector<int> ax(iPairs), ay(iPairs), bx(iPairs), by(iPairs);
+		uint32_t iState = 11;
+		for(int i = 0; i < iPairs; ++i)
+		{
+			float fRandom[6];
+			for(int j = 0; j < 6; ++j)
+			{
+				iState ^= iState << 13;
+				iState ^= iState >> 17;
+				iState ^= iState << 5;
+				fRandom[j] = (iState & 0xFFFFFF) / 16777216.0f;
+			}
+
+			int iFrame = (int)(fRandom[0] * (SHIP_END_FRAME + 1));
+			float fAngle = fRandom[1] * (float)PI * 2.0f;
+			float fScale = MASK_MIN_SCALE + fRandom[2] * (MASK_MAX_SCALE - MASK_MIN_SCALE);
+			const MaskFrame* pA = &pShip->Get(iFrame, fAngle, fScale);
+			const MaskFrame* pB = &pShip->Get(SHIP_END_FRAME - iFrame, fAngle * 3.0f, 2.0f - fScale);
+			int iKind = (int)(iState >> 28) & 3;
+			if(1 == iKind)
+			{
+				pB = &pTorpedo->Get(0, 0.0f, 1.0f);
+			}
+			else if(2 == iKind)
+			{
+				pB = pA;
+				pA = &pPlanet->Get(0, 0.0f, 1.0f);
+			}
+
+			first[i] = pA;
+			second[i] = pB;
+			ax[i] = 0;
+			ay[i] = 0;
+			bx[i] = (int)(fRandom[3] * (pA->iWidth + pB->iWidth - 1)) - pB->iWidth + 1;
+			by[i] = (int)(fRandom[4] * (pA->iHeight + pB->iHeight - 1)) - pB->iHeight + 1;
+		}
+
+		std::vector<char> fast(iPairs), reference(iPairs);
+		iStart = clock.GetTicks();
+		for(int i = 0; i < iPairs; ++i)
+		{
+			fast[i] = CollisionMask::Overlap(*first[i], ax[i], ay[i], *second[i], bx[i], by[i]);
+		}
+		double dFast = clock.ToSeconds(clock.GetTicks() - iStart) / iPairs;
+
+		iStart = clock.GetTicks();
+		for(int i = 0; i < iPairs; ++i)
+		{
+			reference[i] = CollisionMask::OverlapReference(*first[i], ax[i], ay[i], *second[i], bx[i], by[i]);
+		}
+		double dReference = clock.ToSeconds(clock.GetTicks() - iStart) / iPairs;
+
+		int iHits = 0;
+		int iMismatches = 0;
+		for(int i = 0; i < iPairs; ++i)
+		{
+			iHits += fast[i] ? 1 : 0;
+			iMismatches += (fast[i] != reference[i]) ? 1 : 0;
+		}
+
+		printf("masks: %d box overlaps, %.1f%% touch pixel to pixel, Overlap %.1f ns, per pixel %.1f ns, %.1fx, %d mismatches\n",
+			iPairs, 100.0 * iHits / iPairs, dFast * 1e9, dReference * 1e9, dFast > 0.0 ? dReference / dFast : 0.0, iMismatches);
+		return (iMismatches + iFailures) ? 1 : 0;
+	}
+
+	// Return the distance between two points the short way around the screen.
+	float WrappedDistance(float fDX, float fDY)
+	{
+		fDX = SweptCollision::Wrap(fDX, (float)GAME_WIDTH);
+		fDY = SweptCollision::Wrap(fDY, (float)GAME_HEIGHT);
+		return sqrtf(fDX * fDX + fDY * fDY);
+	}
+
+	// Check SweptCollision::FirstContact against sampling each path finely, wrapping at every
+	// sample, over iPairs random pairs. Motions are short enough that only one image of each
+	// object can be reached in a tick. Then fire torpedoes through a drone at tick rates from
+	// 120 down to 10 and count hits tested at the end of each tick against swept hits.
+	// Returns 1 if FirstContact disagrees with the sampling or a swept shot misses.
+	int BenchSweep(int iPairs)
+	{
+		const int SAMPLES = 4096;
+		const float TOLERANCE = .01f;
+		std::vector<SweptCircle> first(iPairs), second(iPairs);
+		uint32_t iState = 17;
+		for(int i = 0; i < iPairs; ++i)
+		{
+			float fRandom[10];
+			for(int j = 0; j < 10; ++j)
+			{
+				iState ^= iState << 13;
+				iState ^= iState >> 17;
+				iState ^= iState << 5;
+				fRandom[j] = (iState & 0xFFFFFF) / 16777216.0f;
+			}
+
+			SweptCircle a = { fRandom[0] * GAME_WIDTH, fRandom[1] * GAME_HEIGHT, fRandom[2] * 120.0f - 60.0f, fRandom[3] * 120.0f - 60.0f, 1.0f + fRandom[4] * 29.0f };
+
+			// Start half of B near A so the pairs that meet aren't rare.
+			float fNear = (i & 1) ? 80.0f : (float)GAME_WIDTH;
+			SweptCircle b = { a.fX + (fRandom[5] - .5f) * fNear, a.fY + (fRandom[6] - .5f) * fNear, fRandom[7] * 120.0f - 60.0f, fRandom[8] * 120.0f - 60.0f, 1.0f + fRandom[9] * 29.0f };
+			b.fX -= (b.fX >= GAME_WIDTH) ? GAME_WIDTH : ((b.fX < 0.0f) ? -(float)GAME_WIDTH : 0.0f);
+			b.fY -= (b.fY >= GAME_HEIGHT) ? GAME_HEIGHT : ((b.fY < 0.0f) ? -(float)GAME_HEIGHT : 0.0f);
+			first[i] = a;
+			second[i] = b;
+		}
+
+		HighResClock clock;
+		clock.Initialize();
+		std::vector<float> times(iPairs);
+		std::vector<char> hits(iPairs);
+		int64_t iStart = clock.GetTicks();
+		for(int i = 0; i < iPairs; ++i)
+		{
+			hits[i] = SweptCollision::FirstContact(first[i], second[i], (float)GAME_WIDTH, (float)GAME_HEIGHT, times[i]);
+		}
+		double dSwept = clock.ToSeconds(clock.GetTicks() - iStart) / iPairs;
+
+		int iHits = 0;
+		int iMismatches = 0;
+		for(int i = 0; i < iPairs; ++i)
+		{
+			const SweptCircle& a = first[i];
+			const SweptCircle& b = second[i];
+			float fRadius = a.fRadius + b.fRadius;
+
+			// First sample clearly inside, and the closest any sample comes.
+			float fInside = 2.0f;
+			float fClosest = 1e30f;
+			for(int s = 0; s <= SAMPLES; ++s)
+			{
+				float fT = (float)s / SAMPLES;
+				float fDistance = WrappedDistance(b.fX + b.fDX * fT - a.fX - a.fDX * fT, b.fY + b.fDY * fT - a.fY - a.fDY * fT);
+				fClosest = (fDistance < fClosest) ? fDistance : fClosest;
+				if(fInside > 1.0f && fDistance < fRadius - TOLERANCE)
+				{
+					fInside = fT;
+				}
+			}
+
+			bool bMatch;
+			if(hits[i])
+			{
+				// Touching then, and not clearly inside before.
+				float fT = times[i];
+				float fDistance = WrappedDistance(b.fX + b.fDX * fT - a.fX - a.fDX * fT, b.fY + b.fDY * fT - a.fY - a.fDY * fT);
+				bMatch = (fT <= 0.0f) ? fDistance <= fRadius + TOLERANCE : fabsf(fDistance - fRadius) <= TOLERANCE;
+				bMatch = bMatch && fInside >= fT - 1.0f / SAMPLES;
+				++iHits;
+			}
+			else
+			{
+				bMatch = fClosest >= fRadius - TOLERANCE;
+			}
+
+			iMismatches += bMatch ? 0 : 1;
+		}
+
+		printf("sweep: %d pairs, %.1f%% meet, FirstContact %.1f ns, %d mismatches with sampling\n",
+			iPairs, 100.0 * iHits / iPairs, dSwept * 1e9, iMismatches);
+
+		// Torpedoes fired at a drone coming the other way, offset across it, from 200 pixels off.
+		// Any offset less than the sum of the radii is a hit.
+		const float RATES[] = { 120.0f, 60.0f, 30.0f, 15.0f, 10.0f };
+		const int SHOTS = 1000;
+		const float fTorpedoRadius = TORPEDO_WIDTH * .5f;
+		const float fDroneRadius = SHIP_WIDTH * MASK_MIN_SCALE * .5f;
+		const float fClosing = TORPEDO_SPEED + DRONE_SPEED;
+		int iMissed = 0;
+		for(size_t r = 0; r < sizeof(RATES) / sizeof(RATES[0]); ++r)
+		{
+			float fStep = fClosing / RATES[r];
+			int iDiscrete = 0;
+			int iSwept = 0;
+			for(int i = 0; i < SHOTS; ++i)
+			{
+				float fOffset = ((i + .5f) / SHOTS * 2.0f - 1.0f) * (fTorpedoRadius + fDroneRadius) * .999f;
+				SweptCircle torpedo = { 200.0f, 240.0f + fOffset, -fStep, 0.0f, fTorpedoRadius };
+				SweptCircle drone = { 0.0f, 240.0f, 0.0f, 0.0f, fDroneRadius };
+				bool bDiscrete = false;
+				bool bSwept = false;
+				for(float fFlown = 0.0f; fFlown < 400.0f; fFlown += fStep)
+				{
+					float fTime;
+					bSwept = bSwept || SweptCollision::FirstContact(drone, torpedo, (float)GAME_WIDTH, (float)GAME_HEIGHT, fTime);
+					torpedo.fX += torpedo.fDX;
+					bDiscrete = bDiscrete || WrappedDistance(torpedo.fX - drone.fX, torpedo.fY - drone.fY) <= fTorpedoRadius + fDroneRadius;
+				}
+
+				iDiscrete += bDiscrete ? 1 : 0;
+				iSwept += bSwept ? 1 : 0;
+			}
+
+			iMissed += SHOTS - iSwept;
+			printf("sweep: %3.0f ticks/s, %4.1f px per tick, hits tested at tick end %5.1f%%, swept %5.1f%%\n",
+				RATES[r], fStep, 100.0 * iDiscrete / SHOTS, 100.0 * iSwept / SHOTS);
+		}
+
+		return (iMismatches || iMissed) ? 1 : 0;
+	}
+
+	// Pull 1k, 10k and 50k bodies toward each other with the Barnes-Hut tree at a few opening
+	// angles, and by summing every body. Half the bodies are spread evenly and half crowd into
+	// clumps, the way drones gather on the ships. Sums are timed and checked on a sample of at
+	// most 1000 bodies, and the time scaled up to all of them.
+	// Returns 1 if the tree's error at the default opening angle is over 1%.
+	int BenchGravity(int iReps)
+	{
+		const int POPULATIONS[] = { 1000, 10000, 50000 };
+		const float THETAS[] = { .3f, GravityNS::DEFAULT_THETA, .8f };
+		const int SAMPLE = 1000;
+		HighResClock clock;
+		clock.Initialize();
+		Gravity gravity;
+		gravity.Initialize((float)GAME_WIDTH, (float)GAME_HEIGHT, GRAVITY_SOFTENING, GRAVITY_RANGE);
+		int iFailed = 0;
+		for(size_t p = 0; p < sizeof(POPULATIONS) / sizeof(POPULATIONS[0]); ++p)
+		{
+			int iCount = POPULATIONS[p];
+			std::vector<float> x(iCount), y(iCount), mass(iCount);
+			uint32_t iState = 23;
+			for(int i = 0; i < iCount; ++i)
+			{
+				float fRandom[4];
+				for(int j = 0; j < 4; ++j)
+				{
+					iState ^= iState << 13;
+					iState ^= iState >> 17;
+					iState ^= iState << 5;
+					fRandom[j] = (iState & 0xFFFFFF) / 16777216.0f;
+				}
+
+				x[i] = fRandom[0] * GAME_WIDTH;
+				y[i] = fRandom[1] * GAME_HEIGHT;
+				if(i & 1)
+				{
+					// One of eight clumps, about 20 pixels across.
+					int iClump = i % 16 / 2;
+					x[i] = GAME_WIDTH * (iClump + .5f) / 8.0f + (fRandom[0] - .5f) * 20.0f;
+					y[i] = GAME_HEIGHT * (.25f + .5f * (iClump & 1)) + (fRandom[1] - .5f) * 20.0f;
+				}
+				mass[i] = (fRandom[2] < .01f) ? SHIP_GRAVITY : ((fRandom[3] < .2f) ? TORPEDO_GRAVITY : DRONE_GRAVITY);
+			}
+
+			int64_t iStart = clock.GetTicks();
+			for(int r = 0; r < iReps; ++r)
+			{
+				gravity.Build(x.data(), y.data(), mass.data(), iCount);
+			}
+			double dBuild = clock.ToSeconds(clock.GetTicks() - iStart) / iReps;
+
+			int iSample = (iCount < SAMPLE) ? iCount : SAMPLE;
+			int iStride = iCount / iSample;
+			std::vector<float> directX(iSample), directY(iSample);
+			iStart = clock.GetTicks();
+			for(int s = 0; s < iSample; ++s)
+			{
+				gravity.GetAccelerationDirect(x[s * iStride], y[s * iStride], directX[s], directY[s]);
+			}
+			double dDirect = clock.ToSeconds(clock.GetTicks() - iStart) * iCount / iSample;
+
+			printf("gravity: %5d bodies, %d nodes, build %.2f ms, every pair %.1f ms\n",
+				iCount, gravity.GetNodeCount(), dBuild * 1e3, dDirect * 1e3);
+
+			std::vector<float> vx(iCount), vy(iCount);
+			for(size_t t = 0; t < sizeof(THETAS) / sizeof(THETAS[0]); ++t)
+			{
+				gravity.SetTheta(THETAS[t]);
+				iStart = clock.GetTicks();
+				for(int r = 0; r < iReps; ++r)
+				{
+					gravity.Accelerate(x.data(), y.data(), 0.0f, 0.0f, iCount, vx.data(), vy.data(), 1.0f);
+				}
+				double dTree = clock.ToSeconds(clock.GetTicks() - iStart) / iReps;
+
+				// RMS error relative to the RMS pull.
+				double dError = 0.0;
+				double dTotal = 0.0;
+				for(int s = 0; s < iSample; ++s)
+				{
+					float fAX, fAY;
+					gravity.GetAcceleration(x[s * iStride], y[s * iStride], fAX, fAY);
+					dError += (double)(fAX - directX[s]) * (fAX - directX[s]) + (double)(fAY - directY[s]) * (fAY - directY[s]);
+					dTotal += (double)directX[s] * directX[s] + (double)directY[s] * directY[s];
+				}
+				double dRelative = (dTotal > 0.0) ? sqrt(dError / dTotal) : 0.0;
+				bool bDefault = THETAS[t] == GravityNS::DEFAULT_THETA;
+				iFailed += (bDefault && dRelative > .01) ? 1 : 0;
+
+				printf("gravity:   theta %.1f  %7.2f ms  %6.1fx  error %.3f%%%s\n", THETAS[t], dTree * 1e3,
+					dTree > 0.0 ? dDirect / dTree : 0.0, dRelative * 100.0, (bDefault && dRelative > .01) ? " FAIL" : "");
+			}
+			gravity.SetTheta(GravityNS::DEFAULT_THETA);
+		}
+
+		return iFailed ? 1 : 0;
+	}
+
+	// Keep about 100k particles alive, emitting as many each tick as die, and time
+	// iTicks updates with each kernel. Every kernel starts from the same particles, so
+	// they must end with the same ones. Returns 1 if they don't, or if updating or
+	// emitting touched the heap.
+	int BenchParticles(const Options& options, int iTicks)
+	{
+		const int LIVE = 100000;
+		const float LIFETIME = 2.0f;
+		const double BUDGET = 1e-3;
+		float fDelta = 1.0f / options.fTickRate;
+
+		// Particles live three quarters of LIFETIME on average.
+		int iPerTick = (int)(LIVE * fDelta / (LIFETIME * .75f));
+		HighResClock clock;
+		clock.Initialize();
+		ParticleSystem reference;
+		int iFailed = 0;
+		for(int iKernel = SpriteTransformNS::SCALAR; iKernel <= SpriteTransformNS::AVX2; ++iKernel)
+		{
+			SpriteTransformNS::KERNEL kernel = (SpriteTransformNS::KERNEL)iKernel;
+			if(kernel > SpriteTransform::GetBestKernel())
+			{
+				continue;
+			}
+
+			ParticleSystem particles;
+			particles.Initialize(PARTICLE_CAPACITY, PARTICLE_DRAG, PARTICLE_SEED);
+			particles.Emit(GAME_WIDTH * .5f, GAME_HEIGHT * .5f, 0.0f, 0.0f, 200.0f, LIFETIME, EXPLOSION_COLOR, LIVE);
+
+			long long iAllocations = g_iAllocations;
+			int64_t iUpdated = 0;
+			double dUpdate = 0.0;
+			for(int t = 0; t < iTicks; ++t)
+			{
+				// A ring of exhaust sources around the screen.
+				float fAngle = t * .05f;
+				particles.Emit(GAME_WIDTH * (.5f + .3f * cosf(fAngle)), GAME_HEIGHT * (.5f + .3f * sinf(fAngle)),
+					-60.0f * cosf(fAngle), -60.0f * sinf(fAngle), EXHAUST_SPREAD, LIFETIME, EXHAUST_COLOR, iPerTick);
+
+				iUpdated += particles.GetCount();
+				int64_t iStart = clock.GetTicks();
+				particles.Update(fDelta, kernel);
+				dUpdate += clock.ToSeconds(clock.GetTicks() - iStart);
+			}
+			iAllocations = g_iAllocations - iAllocations;
+
+			bool bMatch = true;
+			if(SpriteTransformNS::SCALAR == kernel)
+			{
+				reference = particles;
+			}
+			else
+			{
+				int iCount = particles.GetCount();
+				bMatch = iCount == reference.GetCount()
+					&& 0 == memcmp(particles.GetX(), reference.GetX(), iCount * sizeof(float))
+					&& 0 == memcmp(particles.GetY(), reference.GetY(), iCount * sizeof(float))
+					&& 0 == memcmp(particles.GetLife(), reference.GetLife(), iCount * sizeof(float))
+					&& 0 == memcmp(particles.GetColors(), reference.GetColors(), iCount * sizeof(COLOR_ARGB));
+			}
+
+			double dTick = dUpdate / iTicks;
+			bool bPass = bMatch && 0 == iAllocations;
+			iFailed += bPass ? 0 : 1;
+			printf("particles: %-6s %6d live, %6.1f M particles/s, %.3f ms/tick (%s %.0f ms budget), %lld allocations%s\n",
+				SpriteTransformNS::KERNEL_NAMES[kernel], particles.GetCount(), dUpdate > 0.0 ? iUpdated / dUpdate / 1e6 : 0.0,
+				dTick * 1e3, (dTick <= BUDGET) ? "within" : "over", BUDGET * 1e3, iAllocations,
+				bMatch ? "" : ", differs from scalar FAIL");
+		}
+
+		return iFailed ? 1 : 0;
+	}
+
+	// Animate the same ships with Image::Update and with an AnimationSystem and compare.
+	// A quarter of the ships are one-shot so both end modes are covered.
+	// Returns 1 if any ship ends up on a different frame, rect or complete flag.
+	int BenchAnimation(int iTicks)
+	{
+		const int SIZES[3] = { 1000, 10000, 100000 };
+
+		HighResClock clock;
+		clock.Initialize();
+		TextureManager texture;
+
+		int iFailures = 0;
+		for(int iSize = 0; iSize < 3; ++iSize)
+		{
+			int iCount = SIZES[iSize];
+			AnimationSystem animations;
+			std::vector<Image> legacy(iCount);
+			std::vector<Image> batched(iCount);
+
+			uint32_t iState = 3;
+			for(int i = 0; i < iCount; ++i)
+			{
+				iState ^= iState << 13;
+				iState ^= iState >> 17;
+				iState ^= iState << 5;
+				float fDelay = 0.02f + (iState & 0xFFFF) / 65536.0f * 0.3f;
+				int iFrame = SHIP_START_FRAME + (int)(iState >> 16) % (SHIP_END_FRAME - SHIP_START_FRAME + 1);
+
+				Image* pImages[2] = { &legacy[i], &batched[i] };
+				for(int j = 0; j < 2; ++j)
+				{
+					pImages[j]->Initialize(nullptr, SHIP_WIDTH, SHIP_HEIGHT, SHIP_COLS, &texture);
+					pImages[j]->SetFrames(SHIP_START_FRAME, SHIP_END_FRAME);
+					pImages[j]->SetCurrentFrame(iFrame);
+					pImages[j]->SetFrameDelay(fDelay);
+					pImages[j]->SetLoop(0 != (i & 3));
+				}
+				batched[i].SetAnimationSystem(&animations);
+			}
+
+			int64_t iStart = clock.GetTicks();
+			for(int iTick = 0; iTick < iTicks; ++iTick)
+			{
+				for(int i = 0; i < iCount; ++i)
+				{
+					legacy[i].Update(TICK_TIME);
+				}
+			}
+			double dLegacy = clock.ToSeconds(clock.GetTicks() - iStart) / ((double)iTicks * iCount);
+
+			iStart = clock.GetTicks();
+			for(int iTick = 0; iTick < iTicks; ++iTick)
+			{
+				animations.Advance(TICK_TIME);
+			}
+			double dBatched = clock.ToSeconds(clock.GetTicks() - iStart) / ((double)iTicks * iCount);
+
+			int iMismatches = 0;
+			int iComplete = 0;
+			for(int i = 0; i < iCount; ++i)
+			{
+				RECT a = legacy[i].GetSpriteDataRect();
+				RECT b = batched[i].GetSpriteDataRect();
+				if(legacy[i].GetCurrentFrame() != batched[i].GetCurrentFrame()
+					|| legacy[i].HasAnimationCompleted() != batched[i].HasAnimationCompleted()
+					|| a.left != b.left || a.top != b.top || a.right != b.right || a.bottom != b.bottom)
+				{
+					++iMismatches;
+				}
+				iComplete += batched[i].HasAnimationCompleted() ? 1 : 0;
+			}
+
+			iFailures += iMismatches;
+			printf("animation: %6d ships  Image::Update %6.2f ns/ship  AnimationSystem %6.2f ns/ship  %5.1fx  %d complete, %d mismatches\n",
+				iCount, dLegacy * 1e9, dBatched * 1e9, dBatched > 0.0 ? dLegacy / dBatched : 0.0, iComplete, iMismatches);
+		}
+
+		return iFailures ? 1 : 0;
+	}
+
+	// Create and destroy entities at random and check stale handles never resolve.
+	// Returns the number of handle errors.
+	int BenchEntityChurn(int iLive, int iOperations)
+	{
+		SpriteSheet sheet = { 0, SHIP_WIDTH, SHIP_HEIGHT, SHIP_COLS, SHIP_START_FRAME, SHIP_END_FRAME, SHIP_ANIMATION_DELAY, 0 };
+		EntityStore store;
+		int iSheet = store.AddSheet(sheet);
+		store.Reserve(iLive);
+
+		std::vector<EntityHandle> live, dead;
+		for(int i = 0; i < iLive; ++i)
+		{
+			live.push_back(store.Create(iSheet, (float)i, 0.0f));
+		}
+
+		HighResClock clock;
+		clock.Initialize();
+		uint32_t iState = 1;
+		int iErrors = 0;
+		int64_t iStart = clock.GetTicks();
+		for(int i = 0; i < iOperations; ++i)
+		{
+			iState ^= iState << 13;
+			iState ^= iState >> 17;
+			iState ^= iState << 5;
+
+			// Replace a random entity. Its handle must stop resolving, the new one must resolve to its own data.
+			size_t iPick = iState % live.size();
+			EntityHandle old = live[iPick];
+			float fX = (float)i;
+			if(!store.Destroy(old) || store.IsAlive(old))
+			{
+				++iErrors;
+			}
+			live[iPick] = store.Create(iSheet, fX, 0.0f);
+			if(store.GetX()[store.GetIndex(live[iPick])] != fX || store.GetIndex(old) != EntityStoreNS::INVALID_INDEX)
+			{
+				++iErrors;
+			}
+			if(dead.size() < 1024)
+			{
+				dead.push_back(old);
+			}
+		}
+		double dElapsed = clock.ToSeconds(clock.GetTicks() - iStart);
+
+		for(size_t i = 0; i < dead.size(); ++i)
+		{
+			iErrors += store.IsAlive(dead[i]) ? 1 : 0;
+		}
+
+		printf("entities: churn %d destroy+create pairs on %d live in %.3f ms (%.1f ns per pair), %d handle errors\n",
+			iOperations, store.GetCount(), dElapsed * 1e3, dElapsed * 1e9 / iOperations, iErrors);
+		return iErrors;
+	}
+
+	// Simulate growing drone populations and report the cost per drone per tick.
+	int BenchEntities(const Options& options, int iTicks)
+	{
+		const int POPULATIONS[4] = { 10000, 25000, 50000, 100000 };
+
+		Options run = options;
+		run.iTicks = iTicks;
+		run.bThreaded = false;
+		run.bQuiet = true;
+		for(int i = 0; i < 4; ++i)
+		{
+			run.iDrones = POPULATIONS[i];
+			double dRate = 0.0;
+			if(RunSimulation(run, &dRate) != 0)
+			{
+				return 1;
+			}
+			printf("entities: %6d drones  %8.1f ticks/s  %6.1f ns per drone per tick (simulate and render)\n",
+				POPULATIONS[i], dRate, dRate > 0.0 ? 1e9 / (dRate * POPULATIONS[i]) : 0.0);
+		}
+
+		return BenchEntityChurn(POPULATIONS[3], 1000000) == 0 ? 0 : 1;
+	}
+
+	// Run iTicks ticks at each population, first with every bot deciding every tick,
+	// then under the AI budget, to show the AI's time staying flat as bots are added.
+	int BenchAI(const Options& options, int iTicks)
+	{
+		const int POPULATIONS[3] = { 1000, 10000, 50000 };
+
+		Options run = options;
+		run.iTicks = iTicks;
+		run.bThreaded = false;
+		run.bQuiet = true;
+		run.bReportAI = true;
+		for(int i = 0; i < 3; ++i)
+		{
+			run.iDrones = POPULATIONS[i];
+			for(int iBudgeted = 0; iBudgeted < 2; ++iBudgeted)
+			{
+				run.iAIBudget = iBudgeted ? options.iAIBudget : 0;
+				printf("ai: %5d drones, budget %d us\n", POPULATIONS[i], run.iAIBudget);
+				if(RunSimulation(run) != 0)
+				{
+					return 1;
+				}
+			}
+		}
+		return 0;
+	}
+
+	// Run iTicks ticks keeping the state after each of the last second of them, as rollback
+	// would, and time saving and loading a whole state. Then roll back through the history
+	// and check each kept tick comes back with the checksum it had when it was run, and that
+	// a loaded state saves to the same bytes. Returns 1 if any doesn't, or if, once warmed up,
+	// the history still has to grow its buffers or the simulation allocates at all. The run
+	// warms up by halfway or after the history has filled twice, whichever is later. A run
+	// too short to warm up fails, as nothing was measured.
+	int BenchState(const Options& options, int iTicks)
+	{
+		const int HISTORY_TICKS = (int)options.fTickRate;
+		const int TIMING_REPS = 100;
+
+		HeadlessWindow window;
+		ManualClock clock;
+		ScriptedInputSource input(options.iSeed);
+		HighResClock wallClock;
+		wallClock.Initialize();
+
+		Graphics::SetAssetPath(options.pAssets);
+
+		Spacewar* pGame = new Spacewar();
+		int iFailures = 0;
+		try
+		{
+			// A time budget would make the AI, and so the checksums, depend on the machine.
+			pGame->SetClock(&clock);
+			pGame->SetInputSource(&input);
+			pGame->SetTickRate(options.fTickRate);
+			pGame->SetWorkerCount(options.iWorkers);
+			pGame->SetDroneCount(options.iDrones);
+			pGame->SetTorpedoRate(options.iTorpedoRate);
+			pGame->SetMutualGravity(options.bMutualGravity);
+			pGame->SetAIBudget(0, 0);
+			pGame->SetStateHistory(HISTORY_TICKS);
+			pGame->Initialize(&window);
+			pGame->GetFramePacer()->SetFrameRate(0.0f);
+			const int64_t iTickLength = clock.FromSeconds(pGame->GetTickTime()) + 1;
+
+			std::vector<uint64_t> checksums(iTicks + 1, 0);
+			const int iWarmTicks = (iTicks / 2 > 2 * HISTORY_TICKS) ? iTicks / 2 : 2 * HISTORY_TICKS;
+			long long iWarmAllocations = -1;
+			long long iWarmGrowths = -1;
+			while(pGame->GetTickCount() < iTicks && window.ProcessMessages())
+			{
+				if(iWarmAllocations < 0 && pGame->GetTickCount() >= iWarmTicks)
+				{
+					iWarmAllocations = g_iAllocations;
+					iWarmGrowths = pGame->GetStateHistory()->GetGrowthCount();
+				}
+				clock.Advance(iTickLength);
+				pGame->Run();
+				checksums[pGame->GetTickCount()] = pGame->GetStateChecksum();
+			}
+			long long iAllocations = (iWarmAllocations < 0) ? NOT_MEASURED : g_iAllocations - iWarmAllocations;
+			long long iGrowths = (iWarmGrowths < 0) ? NOT_MEASURED : pGame->GetStateHistory()->GetGrowthCount() - iWarmGrowths;
+
+			// Whole state round trips.
+			StateBuffer state, again;
+			int64_t iStart = wallClock.GetTicks();
+			for(int i = 0; i < TIMING_REPS; ++i)
+			{
+				state.Clear();
+				pGame->SaveState(state);
+			}
+			double dSave = wallClock.ToSeconds(wallClock.GetTicks() - iStart) / TIMING_REPS;
+
+			iStart = wallClock.GetTicks();
+			for(int i = 0; i < TIMING_REPS; ++i)
+			{
+				state.Rewind();
+				if(!pGame->LoadState(state))
+				{
+					++iFailures;
+				}
+			}
+			double dLoad = wallClock.ToSeconds(wallClock.GetTicks() - iStart) / TIMING_REPS;
+
+			pGame->SaveState(again);
+			if(again.GetSize() != state.GetSize() || 0 != memcmp(again.GetData(), state.GetData(), state.GetSize()))
+			{
+				printf("state: a loaded state saves differently\n");
+				++iFailures;
+			}
+
+			const StateHistory* pHistory = pGame->GetStateHistory();
+			int64_t iLatest = pHistory->GetLatestTick();
+			int64_t iOldest = pHistory->GetOldestTick();
+			size_t iStateSize = pHistory->GetLatestSize();
+			double dDelta = pHistory->GetAverageDeltaSize();
+			printf("state: %zu bytes, save %.1f us, load %.1f us, %d drones, %d torpedoes, %d particles\n",
+				iStateSize, dSave * 1e6, dLoad * 1e6, pGame->GetDroneCount(), pGame->GetTorpedoes()->GetCount(),
+				pGame->GetParticles()->GetCount());
+			printf("state: ticks %lld to %lld kept, average delta %.0f bytes (%.1f%% of a state)\n",
+				(long long)iOldest, (long long)iLatest, dDelta, iStateSize > 0 ? 100.0 * dDelta / iStateSize : 0.0);
+
+			// Walk back through every kept tick.
+			int iRestored = 0;
+			iStart = wallClock.GetTicks();
+			for(int64_t iTick = iLatest; iTick >= iOldest && iTick >= 0; --iTick)
+			{
+				if(!pGame->RollBack(iTick) || pGame->GetTickCount() != iTick || pGame->GetStateChecksum() != checksums[iTick])
+				{
+					printf("state: tick %lld restored wrong\n", (long long)iTick);
+					++iFailures;
+				}
+				++iRestored;
+			}
+			double dRollBack = wallClock.ToSeconds(wallClock.GetTicks() - iStart);
+
+			if(NOT_MEASURED == iAllocations)
+			{
+				printf("state: %d ticks rolled back, %.1f us each, heap allocations not measured, run at least %d ticks, FAIL\n",
+					iRestored, iRestored > 0 ? dRollBack * 1e6 / iRestored : 0.0, iWarmTicks + 1);
+			}
+			else
+			{
+				printf("state: %d ticks rolled back, %.1f us each, in steady state %lld buffer growths keeping history, "
+					"%lld heap allocations in the whole simulation, %s\n",
+					iRestored, iRestored > 0 ? dRollBack * 1e6 / iRestored : 0.0, iGrowths, iAllocations,
+					(0 == iFailures && 0 == iGrowths && 0 == iAllocations) ? "ok" : "FAIL");
+			}
+			if(iGrowths != 0 || iAllocations != 0)
+			{
+				++iFailures;
+			}
+		}
+		catch(const GameError& err)
+		{
+			printf("error: %s\n", err.GetMessage());
+			delete pGame;
+			return 1;
+		}
+
+		delete pGame;
+		return iFailures ? 1 : 0;
+	}
+
+	// Post iEvents key events to an Input from one thread and apply them from another, one
+	// timestamp at a time, checking each arrives once, in order, with the key state it
+	// should leave. Time clearing and testing the key bits. Then run the game four ticks a
+	// frame, posting the fire key down or up partway through one tick of every frame, and
+	// check from the state history that each change reached exactly the tick it happened
+	// in, and that a journal of the run replays to the same state. Returns 1 on any miss.
+	int BenchInput(const Options& options, int iEvents)
+	{
+		const int TICKS_PER_FRAME = 4;
+		const int FRAMES = 64;
+		const int KEY_REPS = 1000000;
+
+		HighResClock wallClock;
+		wallClock.Initialize();
+		int iFailures = 0;
+
+		// Across threads. The producer never overfills the queue, so nothing is dropped.
+		Input* pInput = new Input();
+		std::thread producer([pInput, iEvents]()
+		{
+			for(int i = 0; i < iEvents; ++i)
+			{
+				while(pInput->GetQueuedEventCount() >= InputNS::EVENT_QUEUE_SIZE)
+				{
+					std::this_thread::yield();
+				}
+				InputNS::EVENT type = (i & 256) ? InputNS::EVENT_KEY_UP : InputNS::EVENT_KEY_DOWN;
+				pInput->PostEvent(type, i & 255, 0, i);
+			}
+		});
+
+		long long iWrong = 0;
+		int64_t iStart = wallClock.GetTicks();
+		for(int i = 0; i < iEvents; ++i)
+		{
+			int iApplied = pInput->ApplyEvents(i);
+			while(0 == iApplied)
+			{
+				std::this_thread::yield();
+				iApplied = pInput->ApplyEvents(i);
+			}
+			bool bDown = 0 == (i & 256);
+			if(iApplied != 1 || pInput->IsKeyDown((UCHAR)(i & 255)) != bDown)
+			{
+				++iWrong;
+			}
+		}
+		double dQueue = wallClock.ToSeconds(wallClock.GetTicks() - iStart);
+		producer.join();
+		long long iDropped = (long long)pInput->GetDroppedEventCount();
+		printf("input: %d events across threads, %.0f ns each, %lld wrong, %lld dropped\n",
+			iEvents, iEvents > 0 ? dQueue * 1e9 / iEvents : 0.0, iWrong, iDropped);
+		iFailures += (iWrong || iDropped || pInput->GetQueuedEventCount()) ? 1 : 0;
+
+		// Key bits, as Run uses them every frame.
+		long long iAny = 0;
+		iStart = wallClock.GetTicks();
+		for(int i = 0; i < KEY_REPS; ++i)
+		{
+			pInput->KeyDown((WPARAM)(i & 255));
+			iAny += pInput->AnyKeyPressed() ? 1 : 0;
+			pInput->Clear(InputNS::KEYS_PRESSED);
+			iAny += pInput->AnyKeyPressed() ? 1 : 0;
+		}
+		double dKeys = wallClock.ToSeconds(wallClock.GetTicks() - iStart);
+		printf("input: key down, any pressed, clear, any pressed %.1f ns, %s\n", dKeys * 1e9 / KEY_REPS,
+			KEY_REPS == iAny ? "ok" : "FAIL");
+		iFailures += (KEY_REPS == iAny) ? 0 : 1;
+		delete pInput;
+
+		// Ticks.
+		HeadlessWindow window;
+		ManualClock clock;
+		InputJournal journal;
+		JournalPlayer player;
+		Graphics::SetAssetPath(options.pAssets);
+
+		Spacewar* pGame = new Spacewar();
+		Spacewar* pReplay = new Spacewar();
+		try
+		{
+			pGame->SetClock(&clock);
+			pGame->SetTickRate(options.fTickRate);
+			pGame->SetWorkerCount(options.iWorkers);
+			pGame->SetDroneCount(options.iDrones);
+			pGame->SetAIBudget(0, 0);
+			pGame->SetStateHistory(TICKS_PER_FRAME * FRAMES);
+			pGame->SetInputJournal(&journal);
+			pGame->Initialize(&window);
+			pGame->GetFramePacer()->SetFrameRate(0.0f);
+			const int64_t iTickLength = clock.FromSeconds(pGame->GetTickTime()) + 1;
+
+			std::vector<char> expected(TICKS_PER_FRAME * FRAMES + 1, 0);
+			uint32_t iRandom = options.iSeed ? options.iSeed : 1;
+			bool bDown = false;
+			for(int iFrame = 0; iFrame < FRAMES; ++iFrame)
+			{
+				iRandom ^= iRandom << 13;
+				iRandom ^= iRandom >> 17;
+				iRandom ^= iRandom << 5;
+				int iTick = (int)(iRandom % TICKS_PER_FRAME);
+				bDown = !bDown;
+				pGame->GetInput()->PostEvent(bDown ? InputNS::EVENT_KEY_DOWN : InputNS::EVENT_KEY_UP, SHIP_FIRE_KEY, 0,
+					clock.GetTicks() + iTick * iTickLength + iTickLength / 2);
+
+				int64_t iFirst = pGame->GetTickCount();
+				for(int i = 0; i < TICKS_PER_FRAME; ++i)
+				{
+					expected[iFirst + i + 1] = (i >= iTick) == bDown;
+				}
+				clock.Advance(TICKS_PER_FRAME * iTickLength);
+				pGame->Run();
+				if(pGame->GetTickCount() != iFirst + TICKS_PER_FRAME)
+				{
+					throw(GameError(GameErrorNS::FATAL_ERROR, "A frame didn't run four ticks!"));
+				}
+			}
+			journal.End(pGame->GetTickCount(), pGame->GetStateChecksum());
+
+			// The same input from the journal.
+			player.Initialize(&journal);
+			journal.GetSettings().Rewind();
+			pReplay->LoadSettings(journal.GetSettings());
+			pReplay->SetClock(&player);
+			pReplay->SetInputSource(&player);
+			pReplay->SetWorkerCount(options.iWorkers);
+			pReplay->Initialize(&window);
+			pReplay->GetFramePacer()->SetFrameRate(0.0f);
+			while(player.NextFrame())
+			{
+				pReplay->Run();
+			}
+			int64_t iRecordedTicks = 0;
+			uint64_t iRecordedChecksum = 0;
+			bool bReplayed = player.GetEnd(iRecordedTicks, iRecordedChecksum) && pReplay->GetTickCount() == iRecordedTicks &&
+				pReplay->GetStateChecksum() == iRecordedChecksum;
+
+			const StateHistory* pHistory = pGame->GetStateHistory();
+			int iMissed = 0, iChecked = 0;
+			for(int64_t iTick = pHistory->GetLatestTick(); iTick >= pHistory->GetOldestTick() && iTick > 0; --iTick)
+			{
+				if(!pGame->RollBack(iTick) || pGame->GetInput()->IsKeyDown(SHIP_FIRE_KEY) != (0 != expected[iTick]))
+				{
+					++iMissed;
+				}
+				++iChecked;
+			}
+			printf("input: %d key changes over %d ticks, %d ticks checked, %d on the wrong tick, %lld events in the journal, replay %s\n",
+				FRAMES, TICKS_PER_FRAME * FRAMES, iChecked, iMissed, (long long)journal.GetEventCount(),
+				bReplayed ? "matches" : "DIFFERS");
+			iFailures += (iMissed || iChecked != TICKS_PER_FRAME * FRAMES || !bReplayed) ? 1 : 0;
+		}
+		catch(const GameError& err)
+		{
+			printf("error: %s\n", err.GetMessage());
+			++iFailures;
+		}
+
+		delete pReplay;
+		delete pGame;
+		return iFailures ? 1 : 0;
+	}
+
+	// Play a journal back through Input and Game::Run, as fast as possible or at the pace it
+	// was recorded, set up with the settings it was recorded with. Reports the phase timings
+	// like a run would, and returns 1 if the state doesn't end as it did when recorded.
+	int ReplayJournal(const Options& options)
+	{
+		InputJournal journal;
+		if(!journal.Load(options.pReplayFile))
+		{
+			printf("replay: %s is not a journal\n", options.pReplayFile);
+			return 1;
+		}
+
+		HeadlessWindow window;
+		JournalPlayer player;
+		player.Initialize(&journal);
+		HighResClock wallClock;
+		wallClock.Initialize();
+
+		Graphics::SetAssetPath(options.pAssets);
+
+		Spacewar* pGame = new Spacewar();
+		int iFailures = 0;
+		try
+		{
+			journal.GetSettings().Rewind();
+			if(journal.GetSettings().GetSize() > 0 && !pGame->LoadSettings(journal.GetSettings()))
+			{
+				throw(GameError(GameErrorNS::FATAL_ERROR, "The journal's settings are malformed!"));
+			}
+			pGame->SetClock(&player);
+			pGame->SetInputSource(&player);
+			pGame->SetWorkerCount(options.iWorkers);
+			pGame->Initialize(&window);
+			pGame->GetFramePacer()->SetFrameRate(0.0f);
+
+			int64_t iStart = wallClock.GetTicks();
+			while(player.NextFrame() && window.ProcessMessages())
+			{
+				if(options.bReplayPaced)
+				{
+					// Sleep most of the way, then spin.
+					double dDue = player.ToSeconds(player.GetTicks());
+					double dWait = dDue - wallClock.ToSeconds(wallClock.GetTicks() - iStart);
+					if(dWait > .002)
+					{
+						wallClock.SleepMs((unsigned int)((dWait - .002) * 1000.0));
+					}
+					while(wallClock.ToSeconds(wallClock.GetTicks() - iStart) < dDue)
+					{
+					}
+				}
+				pGame->Run();
+			}
+			double dElapsed = wallClock.ToSeconds(wallClock.GetTicks() - iStart);
+
+			int64_t iRecordedTicks = 0;
+			uint64_t iRecordedChecksum = 0;
+			bool bEnded = player.GetEnd(iRecordedTicks, iRecordedChecksum);
+			long long iTicks = (long long)pGame->GetTickCount();
+			uint64_t iChecksum = pGame->GetStateChecksum();
+			bool bMatch = bEnded && !player.IsBad() && iTicks == iRecordedTicks && iChecksum == iRecordedChecksum;
+			printf("replay: %lld frames, %lld ticks in %.3f s, %.0f ticks/s, %.3f s recorded, %d drones, state %016llx, recorded %016llx %s\n",
+				(long long)player.GetFrameCount(), iTicks, dElapsed, dElapsed > 0.0 ? iTicks / dElapsed : 0.0,
+				player.ToSeconds(player.GetTicks()), pGame->GetDroneCount(), (unsigned long long)iChecksum,
+				(unsigned long long)iRecordedChecksum, player.IsBad() ? "JOURNAL MALFORMED" : (!bEnded ? "JOURNAL UNFINISHED" :
+				(bMatch ? "match" : "DIFFER")));
+			iFailures += bMatch ? 0 : 1;
+
+			FrameStats* pStats = pGame->GetFrameStats();
+			for(int i = 0; i < FrameStatsNS::PHASE_COUNT && !options.bQuiet; ++i)
+			{
+				FrameStatsNS::PHASE phase = (FrameStatsNS::PHASE)i;
+				printf("replay: %-10s p50 %.4f ms  p99 %.4f ms  max %.4f ms\n", FrameStatsNS::PHASE_NAMES[i],
+					pStats->GetPercentile(phase, 50.0), pStats->GetPercentile(phase, 99.0), pStats->GetMax(phase));
+			}
+		}
+		catch(const GameError& err)
+		{
+			printf("error: %s\n", err.GetMessage());
+			++iFailures;
+		}
+
+		delete pGame;
+		return iFailures ? 1 : 0;
+	}
+
+	// Play two peers iTicks ticks against each other over UDP sockets on 127.0.0.1, each
+	// sending through a LossyLink and driven by its own scripted input, and report how
+	// often and how deep they rolled back and what simulating again cost. Then let them
+	// exchange input until each has all of the other's and check they ended on the same
+	// state. Returns 1 if they didn't, or if the steady state allocated.
+	int BenchNetwork(const Options& options, int iTicks)
+	{
+		const int PEERS = NetSessionNS::PLAYERS;
+
+		HeadlessWindow windows[PEERS];
+		ManualClock clock;
+		HighResClock wallClock;
+		wallClock.Initialize();
+		UdpLink udp[PEERS];
+		LossyLink links[PEERS];
+		NetSession sessions[PEERS];
+		ScriptedInputSource inputs[PEERS] = { ScriptedInputSource(options.iSeed), ScriptedInputSource(options.iSeed + 1) };
+		Spacewar* pGames[PEERS] = { nullptr, nullptr };
+
+		Graphics::SetAssetPath(options.pAssets);
+
+		int iFailures = 0;
+		try
+		{
+			for(int i = 0; i < PEERS; ++i)
+			{
+				udp[i].Open(0);
+			}
+			for(int i = 0; i < PEERS; ++i)
+			{
+				udp[i].SetPeer("127.0.0.1", udp[1 - i].GetLocalPort());
+				links[i].Initialize(&udp[i], &clock, options.fNetLatency * .001f, options.fNetJitter * .001f, options.fNetLoss * .01f, i + 1);
+				sessions[i].Initialize(&links[i], i, NET_INPUT_DELAY, NET_MAX_ROLLBACK);
+
+				// One tick a frame, so both peers stop on the same one.
+				pGames[i] = new Spacewar();
+				pGames[i]->SetClock(&clock);
+				pGames[i]->SetInputSource(&inputs[i]);
+				pGames[i]->SetTickRate(options.fTickRate);
+				pGames[i]->SetMaxTicksPerFrame(1);
+				pGames[i]->SetWorkerCount(options.iWorkers);
+				pGames[i]->SetDroneCount(options.iDrones);
+				pGames[i]->SetTorpedoRate(options.iTorpedoRate);
+				pGames[i]->SetMutualGravity(options.bMutualGravity);
+				pGames[i]->SetAIBudget(0, options.iAIQuota);
+				pGames[i]->SetNetSession(&sessions[i]);
+				pGames[i]->Initialize(&windows[i]);
+				pGames[i]->GetFramePacer()->SetFrameRate(0.0f);
+			}
+			const int64_t iTickLength = clock.FromSeconds(pGames[0]->GetTickTime()) + 1;
+
+			// Give up if the peers stop getting anywhere.
+			const long long MAX_FRAMES = 4LL * iTicks + 10LL * (long long)options.fTickRate;
+			long long iFrames = 0;
+			long long iHalfwayAllocations = -1;
+			int64_t iStart = wallClock.GetTicks();
+			while((pGames[0]->GetTickCount() < iTicks || pGames[1]->GetTickCount() < iTicks) && iFrames < MAX_FRAMES)
+			{
+				if(iHalfwayAllocations < 0 && pGames[0]->GetTickCount() >= iTicks / 2)
+				{
+					iHalfwayAllocations = g_iAllocations;
+				}
+
+				clock.Advance(iTickLength);
+				for(int i = 0; i < PEERS; ++i)
+				{
+					if(pGames[i]->GetTickCount() < iTicks)
+					{
+						pGames[i]->Run();
+					}
+					else
+					{
+						pGames[i]->PollNetwork();
+					}
+				}
+				++iFrames;
+			}
+			double dElapsed = wallClock.ToSeconds(wallClock.GetTicks() - iStart);
+			long long iAllocations = (iHalfwayAllocations < 0) ? NOT_MEASURED : g_iAllocations - iHalfwayAllocations;
+
+			// Until each has the other's input for every tick, and has rolled back for it.
+			while((sessions[0].GetRemoteTick() < iTicks - 1 || sessions[1].GetRemoteTick() < iTicks - 1) && iFrames < MAX_FRAMES)
+			{
+				clock.Advance(iTickLength);
+				for(int i = 0; i < PEERS; ++i)
+				{
+					pGames[i]->PollNetwork();
+				}
+				++iFrames;
+				std::this_thread::yield();
+			}
+
+			for(int i = 0; i < PEERS; ++i)
+			{
+				const NetSession& session = sessions[i];
+				long long iRollbacks = (long long)session.GetRollbackCount();
+				long long iResimulated = (long long)session.GetResimulatedTicks();
+				printf("net: peer %d  %lld rollbacks in %lld ticks, depth avg %.1f worst %d, %.3f ms per tick simulated again, "
+					"%lld stalls, %lld of %lld predictions wrong\n", i + 1, iRollbacks, (long long)pGames[i]->GetTickCount(),
+					iRollbacks > 0 ? (double)iResimulated / iRollbacks : 0.0, session.GetWorstRollback(),
+					iResimulated > 0 ? session.GetResimulateSeconds() * 1e3 / iResimulated : 0.0, (long long)session.GetStallCount(),
+					(long long)session.GetMispredictionCount(), (long long)session.GetPredictionCount());
+				printf("net: peer %d  %lld packets sent, %lld dropped on the way, %lld received, %lld lost, %lld late, %lld bad\n",
+					i + 1, (long long)session.GetPacketsSent(), (long long)links[i].GetDroppedCount(),
+					(long long)session.GetPacketsReceived(), (long long)session.GetPacketsLost(),
+					(long long)session.GetPacketsLate(), (long long)session.GetPacketsBad());
+			}
+
+			uint64_t iChecksums[PEERS] = { pGames[0]->GetStateChecksum(), pGames[1]->GetStateChecksum() };
+			bool bSynced = sessions[0].GetRemoteTick() >= iTicks - 1 && sessions[1].GetRemoteTick() >= iTicks - 1;
+			bool bAgree = bSynced && iChecksums[0] == iChecksums[1] && pGames[0]->GetTickCount() == pGames[1]->GetTickCount();
+			char allocations[64];
+			if(NOT_MEASURED == iAllocations)
+			{
+				snprintf(allocations, sizeof(allocations), "heap allocations not measured");
+			}
+			else
+			{
+				snprintf(allocations, sizeof(allocations), "%lld heap allocations in steady state", iAllocations);
+			}
+			printf("net: %d ticks at %.0f ms latency, %.0f ms jitter, %.1f%% loss in %lld frames, %.0f ticks/s, "
+				"%s, states %016llx %016llx %s\n", iTicks, options.fNetLatency,
+				options.fNetJitter, options.fNetLoss, iFrames, dElapsed > 0.0 ? iTicks / dElapsed : 0.0, allocations,
+				(unsigned long long)iChecksums[0], (unsigned long long)iChecksums[1],
+				!bSynced ? "NEVER CAUGHT UP" : (bAgree ? "agree" : "DIFFER"));
+			iFailures += (bAgree && 0 == iAllocations) ? 0 : 1;
+		}
+		catch(const GameError& err)
+		{
+			printf("error: %s\n", err.GetMessage());
+			++iFailures;
+		}
+
+		for(int i = 0; i < PEERS; ++i)
+		{
+			delete pGames[i];
+		}
+		return iFailures ? 1 : 0;
+	}
+
+	// Run the same simulation with 0 to iMaxWorkers workers.
+	// The state at the end must be identical for every worker count. Returns 1 if it isn't.
+	int BenchJobs(const Options& options, int iMaxWorkers)
+	{
+		// A time budget would let the AI get further on a faster run.
+		Options run = options;
+		run.bThreaded = false;
+		run.bQuiet = true;
+		run.iAIBudget = 0;
+
+		double dBaseRate = 0.0;
+		uint64_t iBaseChecksum = 0;
+		int iMismatches = 0;
+		for(int iWorkers = 0; iWorkers <= iMaxWorkers; ++iWorkers)
+		{
+			run.iWorkers = iWorkers;
+			double dRate = 0.0;
+			uint64_t iChecksum = 0;
+			if(RunSimulation(run, &dRate, &iChecksum) != 0)
+			{
+				return 1;
+			}
+
+			if(0 == iWorkers)
+			{
+				dBaseRate = dRate;
+				iBaseChecksum = iChecksum;
+			}
+			else if(iChecksum != iBaseChecksum)
+			{
+				++iMismatches;
+			}
+			printf("jobs: %d workers  %.0f ticks/s  %.2fx\n", iWorkers, dRate, dBaseRate > 0.0 ? dRate / dBaseRate : 0.0);
+		}
+
+		printf("jobs: %s on %u hardware threads\n", iMismatches ? "RESULTS DIFFER" : "results identical",
+			std::thread::hardware_concurrency());
+		return iMismatches ? 1 : 0;
+	}
+
+	// Texel x, y of a test texture for CheckRaster. Opaque, or with alpha varying across it.
+	COLOR_ARGB TestTexel(int x, int y, bool bOpaque)
+	{
+		return SETCOLOR_ARGB(bOpaque ? 255 : (x * 37 + y * 11) & 255, x * 16, y * 16, (x ^ y) * 16);
+	}
+
+	// Draw known sprites with every raster kernel and compare each pixel to a blend done here in
+	// double precision: a source rect, each flip, a quarter turn, scaling, color filters and
+	// translucent texels. Returns the number of wrong pixels.
+	long long CheckRaster(void)
+	{
+		const int SIZE = 64;						// Framebuffer and texture are square.
+		const int TEXTURE = 16;
+		const COLOR_ARGB BACK = SETCOLOR_ARGB(255, 32, 64, 96);
+
+		struct Case
+		{
+			const char*	pName;
+			float		matrix[SpriteTransformNS::ELEMENT_COUNT];	// M11, M12, M21, M22, DX, DY.
+			bool		bOpaque;
+			COLOR_ARGB	color;
+		};
+		const Case CASES[] =
+		{
+			{ "rect",		{ 1.0f, 0.0f, 0.0f, 1.0f, 5.0f, 6.0f },		true,	GraphicsNS::WHITE },
+			{ "flip x",		{ -1.0f, 0.0f, 0.0f, 1.0f, 40.0f, 3.0f },	false,	GraphicsNS::WHITE },
+			{ "flip y",		{ 1.0f, 0.0f, 0.0f, -1.0f, 3.0f, 60.0f },	true,	SETCOLOR_ARGB(200, 255, 128, 0) },
+			{ "turn",		{ 0.0f, 1.0f, -1.0f, 0.0f, 50.0f, 20.0f },	true,	SETCOLOR_ARGB(255, 64, 255, 128) },
+			{ "scale",		{ 3.0f, 0.0f, 0.0f, 2.0f, 10.0f, 30.0f },	false,	SETCOLOR_ARGB(128, 255, 255, 255) },
+		};
+		const RECT rect = { 2, 3, 14, 13 };			// 12 x 10.
+		const int iCases = (int)(sizeof(CASES) / sizeof(CASES[0]));
+
+		HeadlessTexture textures[2];
+		for(int t = 0; t < 2; ++t)
+		{
+			textures[t].iWidth = textures[t].iHeight = TEXTURE;
+			textures[t].pixels.resize(TEXTURE * TEXTURE);
+			for(int i = 0; i < TEXTURE * TEXTURE; ++i)
+			{
+				textures[t].pixels[i] = TestTexel(i % TEXTURE, i / TEXTURE, 0 == t);
+			}
+		}
+
+		long long iWrong = 0;
+		SpriteRaster raster;
+		raster.Initialize(SIZE, SIZE);
+		for(int iKernel = SpriteTransformNS::SCALAR; iKernel <= SpriteTransformNS::AVX2; ++iKernel)
+		{
+			if(iKernel > SpriteTransform::GetBestKernel())
+			{
+				continue;
+			}
+			raster.SetKernel((SpriteTransformNS::KERNEL)iKernel);
+
+			for(int c = 0; c < iCases; ++c)
+			{
+				const Case& test = CASES[c];
+				raster.Clear(BACK);
+				raster.Draw(&textures[test.bOpaque ? 0 : 1], rect, test.matrix, test.color);
+
+				const float* m = test.matrix;
+				double dDeterminant = (double)m[0] * m[3] - (double)m[1] * m[2];
+				long long iCaseWrong = 0;
+				for(int y = 0; y < SIZE; ++y)
+				{
+					for(int x = 0; x < SIZE; ++x)
+					{
+						// Pixel center back to the source rect. No center lands on a texel edge in these cases.
+						double dX = x + 0.5 - m[4], dY = y + 0.5 - m[5];
+						double dU = (dX * m[3] - dY * m[2]) / dDeterminant;
+						double dV = (dY * m[0] - dX * m[1]) / dDeterminant;
+						COLOR_ARGB expected = BACK;
+						if(dU >= 0.0 && dU < rect.right - rect.left && dV >= 0.0 && dV < rect.bottom - rect.top)
+						{
+							COLOR_ARGB texel = TestTexel(rect.left + (int)dU, rect.top + (int)dV, test.bOpaque);
+							double dAlpha = (double)lround((texel >> 24) * (test.color >> 24) / 255.0);
+							expected = 0;
+							for(int iShift = 0; iShift < 32; iShift += 8)
+							{
+								double dSource = (double)lround(((texel >> iShift) & 0xFF) * ((test.color >> iShift) & 0xFF) / 255.0);
+								double dDest = (BACK >> iShift) & 0xFF;
+								expected |= (COLOR_ARGB)lround((dSource * dAlpha + dDest * (255.0 - dAlpha)) / 255.0) << iShift;
+							}
+						}
+						if(raster.GetPixels()[y * SIZE + x] != expected)
+						{
+							++iCaseWrong;
+						}
+					}
+				}
+				if(iCaseWrong > 0)
+				{
+					printf("render: %s kernel, %s case: %lld WRONG PIXELS\n", SpriteTransformNS::KERNEL_NAMES[iKernel], test.pName, iCaseWrong);
+				}
+				iWrong += iCaseWrong;
+			}
+		}
+
+		printf("render: %d known sprites drawn with each kernel, %lld wrong pixels\n", iCases, iWrong);
+		return iWrong;
+	}
+
+	// Run the scene RENDER_TICKS ticks, then render that frame iFrames times with each raster
+	// kernel, timing them and checking each framebuffer matches the scalar one.
+	int BenchRender(const Options& options, int iFrames)
+	{
+		const int RENDER_TICKS = 600;
+
+		HeadlessWindow window;
+		ManualClock clock;
+		ScriptedInputSource input(options.iSeed);
+		HighResClock wallClock;
+		wallClock.Initialize();
+
+		Graphics::SetAssetPath(options.pAssets);
+
+		long long iFailures = CheckRaster();
+		Spacewar* pGame = new Spacewar();
+		try
+		{
+			pGame->SetClock(&clock);
+			pGame->SetInputSource(&input);
+			pGame->SetTickRate(options.fTickRate);
+			pGame->SetWorkerCount(options.iWorkers);
+			pGame->SetDroneCount(options.iDrones);
+			pGame->SetTorpedoRate(options.iTorpedoRate);
+			pGame->SetAIBudget(0, 0);
+			pGame->Initialize(&window);
+			pGame->GetFramePacer()->SetFrameRate(0.0f);
+
+			const int64_t iTickLength = clock.FromSeconds(pGame->GetTickTime()) + 1;
+			while(pGame->GetTickCount() < RENDER_TICKS && window.ProcessMessages())
+			{
+				clock.Advance(iTickLength);
+				pGame->Run();
+			}
+
+			Graphics* pGraphics = pGame->GetGraphics();
+			pGraphics->SetSoftwareRender(true);
+			SpriteRaster* pRaster = pGraphics->GetRaster();
+			std::vector<COLOR_ARGB> reference;
+			printf("render: %dx%d, %d drones, best kernel %s\n", pRaster->GetWidth(), pRaster->GetHeight(), pGame->GetDroneCount(),
+				SpriteTransformNS::KERNEL_NAMES[SpriteTransform::GetBestKernel()]);
+
+			double dScalar = 0.0;
+			for(int iKernel = SpriteTransformNS::SCALAR; iKernel <= SpriteTransformNS::AVX2; ++iKernel)
+			{
+				SpriteTransformNS::KERNEL kernel = (SpriteTransformNS::KERNEL)iKernel;
+				if(kernel > SpriteTransform::GetBestKernel())
+				{
+					continue;
+				}
+				pRaster->SetKernel(kernel);
+
+				int64_t iStart = wallClock.GetTicks();
+				for(int i = 0; i < iFrames; ++i)
+				{
+					pGame->RenderGame();
+				}
+				double dFrame = wallClock.ToSeconds(wallClock.GetTicks() - iStart) / iFrames;
+				if(SpriteTransformNS::SCALAR == kernel)
+				{
+					dScalar = dFrame;
+				}
+
+				const COLOR_ARGB* pPixels = pRaster->GetPixels();
+				size_t iPixels = (size_t)pRaster->GetWidth() * pRaster->GetHeight();
+				long long iDiffer = 0;
+				if(reference.empty())
+				{
+					reference.assign(pPixels, pPixels + iPixels);
+				}
+				for(size_t i = 0; i < iPixels; ++i)
+				{
+					iDiffer += (pPixels[i] != reference[i]) ? 1 : 0;
+				}
+				iFailures += iDiffer;
+
+				printf("render: %-6s %8.3f ms/frame  %8.0f FPS  %.2fx  %u sprites, %lld pixels visited, %s\n",
+					SpriteTransformNS::KERNEL_NAMES[kernel], dFrame * 1e3, dFrame > 0.0 ? 1.0 / dFrame : 0.0,
+					dFrame > 0.0 ? dScalar / dFrame : 0.0, pGraphics->GetSpritesDrawn(), (long long)pRaster->GetPixelsDrawn(),
+					iDiffer ? "PIXELS DIFFER FROM SCALAR" : "same pixels as scalar");
+			}
+
+			if(options.pRenderDump)
+			{
+				bool bSaved = SUCCEEDED(pGraphics->SaveBackBuffer(options.pRenderDump));
+				printf("render: last frame %s %s\n", bSaved ? "written to" : "COULD NOT BE WRITTEN TO", options.pRenderDump);
+				iFailures += bSaved ? 0 : 1;
+			}
+		}
+		catch(const GameError& err)
+		{
+			printf("error: %s\n", err.GetMessage());
+			delete pGame;
+			return 1;
+		}
+
+		delete pGame;
+		return iFailures ? 1 : 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if(!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	if(options.iVerifyPublishes > 0)
+	{
+		return VerifySnapshots(options.iVerifyPublishes) == 0 ? 0 : 1;
+	}
+
+	if(options.iPacerFrames > 0)
+	{
+		BenchPacer(options.iPacerFrames);
+		return 0;
+	}
+
+	if(options.iProjectileRate > 0)
+	{
+		return BenchProjectiles(options, options.iProjectileRate);
+	}
+
+	if(options.iCollisionTicks > 0)
+	{
+		return BenchCollisions(options.iCollisionTicks);
+	}
+
+	if(options.iMaskPairs > 0)
+	{
+		return BenchMasks(options, options.iMaskPairs);
+	}
+
+	if(options.iSweepPairs > 0)
+	{
+		return BenchSweep(options.iSweepPairs);
+	}
+
+	if(options.iGravityReps > 0)
+	{
+		return BenchGravity(options.iGravityReps);
+	}
+
+	if(options.iAITicks > 0)
+	{
+		return BenchAI(options, options.iAITicks);
+	}
+
+	if(options.pReplayFile)
+	{
+		return ReplayJournal(options);
+	}
+
+	if(options.iNetTicks > 0)
+	{
+		return BenchNetwork(options, options.iNetTicks);
+	}
+
+	if(options.iStateTicks > 0)
+	{
+		return BenchState(options, options.iStateTicks);
+	}
+
+	if(options.iInputEvents > 0)
+	{
+		return BenchInput(options, options.iInputEvents);
+	}
+
+	if(options.iRenderFrames > 0)
+	{
+		return BenchRender(options, options.iRenderFrames);
+	}
+
+	if(options.iParticleTicks > 0)
+	{
+		return BenchParticles(options, options.iParticleTicks);
+	}
+
+	if(options.iAnimationTicks > 0)
+	{
+		return BenchAnimation(options.iAnimationTicks);
+	}
+
+	if(options.iTransformReps > 0)
+	{
+		return BenchTransforms(options.iTransformReps);
+	}
+
+	if(options.iEntityTicks > 0)
+	{
+		return BenchEntities(options, options.iEntityTicks);
+	}
+
+	if(options.iTextureResets > 0)
+	{
+		return BenchTextures(options, options.iTextureResets);
+	}
+
+	if(options.iBenchWorkers >= 0)
+	{
+		return BenchJobs(options, options.iBenchWorkers);
+	}
+
+	return RunSimulation(options);
+}